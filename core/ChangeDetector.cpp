@@ -0,0 +1,224 @@
+/*
+ * 分块哈希的画面变化检测
+ */
+
+#include "ChangeDetector.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define QRCORE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(QRCORE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define QRCORE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define QRCORE_TARGET_AVX2
+#endif
+
+namespace qrcore {
+
+static const int kLanes = 8;                 // 每块的并行通道数 (每步消费 32 字节)
+static const uint32_t kLaneMul = 0x9E3779B1u; // 奇数, 乘法在 2^32 上可逆
+
+// ---------------------------------------------------------------------------
+// 标量参考实现
+// ---------------------------------------------------------------------------
+
+static inline uint32_t MixLane(uint32_t h, uint32_t word) {
+    h = (h ^ word) * kLaneMul;
+    return h ^ (h >> 15);
+}
+
+// 不足 32 字节的段尾逐字节并入通道 0 (各实现共用)
+static void HashTail(const uint8_t* data, size_t size, uint32_t* lanes) {
+    for (size_t i = 0; i < size; i++) {
+        lanes[0] = MixLane(lanes[0], data[i]);
+    }
+}
+
+/*
+ * 处理一行: 行按 tileBytes 分段, 第 c 段累积到 lanes[c * 8 .. c * 8 + 7]
+ */
+static void HashRowScalar(const uint8_t* row, size_t rowBytes, size_t tileBytes, uint32_t* lanes) {
+    for (size_t start = 0, c = 0; start < rowBytes; start += tileBytes, c++) {
+        const uint8_t* p = row + start;
+        size_t size = std::min(tileBytes, rowBytes - start);
+        uint32_t* h = lanes + c * kLanes;
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            uint32_t words[kLanes];
+            memcpy(words, p + i, sizeof(words));
+            for (int k = 0; k < kLanes; k++) {
+                h[k] = MixLane(h[k], words[k]);
+            }
+        }
+        HashTail(p + i, size - i, h);
+    }
+}
+
+#ifdef QRCORE_X86
+
+// ---------------------------------------------------------------------------
+// SSE2: 两个寄存器各 4 个通道; SSE2 没有 32 位低位乘法, 用两次 pmuludq 拼出
+// ---------------------------------------------------------------------------
+
+static inline __m128i Mullo32(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);                                      // 通道 0, 2
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)); // 通道 1, 3
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i MixLane4(__m128i h, __m128i words, __m128i mul) {
+    h = Mullo32(_mm_xor_si128(h, words), mul);
+    return _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+}
+
+static void HashRowSSE2(const uint8_t* row, size_t rowBytes, size_t tileBytes, uint32_t* lanes) {
+    const __m128i mul = _mm_set1_epi32((int)kLaneMul);
+    for (size_t start = 0, c = 0; start < rowBytes; start += tileBytes, c++) {
+        const uint8_t* p = row + start;
+        size_t size = std::min(tileBytes, rowBytes - start);
+        uint32_t* h = lanes + c * kLanes;
+        __m128i lo = _mm_loadu_si128((const __m128i*)h);
+        __m128i hi = _mm_loadu_si128((const __m128i*)(h + 4));
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            lo = MixLane4(lo, _mm_loadu_si128((const __m128i*)(p + i)), mul);
+            hi = MixLane4(hi, _mm_loadu_si128((const __m128i*)(p + i + 16)), mul);
+        }
+        _mm_storeu_si128((__m128i*)h, lo);
+        _mm_storeu_si128((__m128i*)(h + 4), hi);
+        HashTail(p + i, size - i, h);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: 一个寄存器 8 个通道
+// ---------------------------------------------------------------------------
+
+QRCORE_TARGET_AVX2
+static void HashRowAVX2(const uint8_t* row, size_t rowBytes, size_t tileBytes, uint32_t* lanes) {
+    const __m256i mul = _mm256_set1_epi32((int)kLaneMul);
+    for (size_t start = 0, c = 0; start < rowBytes; start += tileBytes, c++) {
+        const uint8_t* p = row + start;
+        size_t size = std::min(tileBytes, rowBytes - start);
+        uint32_t* h = lanes + c * kLanes;
+        __m256i v = _mm256_loadu_si256((const __m256i*)h);
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            v = _mm256_mullo_epi32(_mm256_xor_si256(v, _mm256_loadu_si256((const __m256i*)(p + i))), mul);
+            v = _mm256_xor_si256(v, _mm256_srli_epi32(v, 15));
+        }
+        _mm256_storeu_si256((__m256i*)h, v);
+        HashTail(p + i, size - i, h);
+    }
+}
+
+#endif // QRCORE_X86
+
+// 把一块的 8 个通道合成 64 位哈希
+static uint64_t FinishTile(const uint32_t* lanes) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int k = 0; k < kLanes; k++) {
+        hash = (hash ^ lanes[k]) * 0x100000001B3ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+void HashTiles(SimdLevel level, const ImageFrame& frame, int tileSize, std::vector<uint64_t>& outHashes) {
+    outHashes.clear();
+    if (frame.empty() || tileSize <= 0) {
+        return;
+    }
+    int cols = (frame.width + tileSize - 1) / tileSize;
+    int rows = (frame.height + tileSize - 1) / tileSize;
+    size_t bpp = (size_t)BytesPerPixel(frame.format);
+    size_t rowBytes = (size_t)frame.width * bpp;
+    size_t tileBytes = (size_t)tileSize * bpp;
+
+    auto hashRow = HashRowScalar;
+    level = ClampSimdLevel(level);
+#ifdef QRCORE_X86
+    if (level == SimdLevel::AVX2) {
+        hashRow = HashRowAVX2;
+    } else if (level == SimdLevel::SSE2) {
+        hashRow = HashRowSSE2;
+    }
+#else
+    (void)level;
+#endif
+
+    // 逐行处理 (顺序读内存), 每个分块列各有一组通道
+    std::vector<uint32_t> lanes((size_t)cols * kLanes);
+    outHashes.resize((size_t)cols * rows);
+    for (int ty = 0; ty < rows; ty++) {
+        for (size_t i = 0; i < lanes.size(); i++) {
+            lanes[i] = (uint32_t)i * kLaneMul; // 通道初值互不相同
+        }
+        int y0 = ty * tileSize;
+        int y1 = std::min(y0 + tileSize, frame.height);
+        for (int y = y0; y < y1; y++) {
+            hashRow(frame.row(y), rowBytes, tileBytes, lanes.data());
+        }
+        for (int tx = 0; tx < cols; tx++) {
+            outHashes[(size_t)ty * cols + tx] = FinishTile(&lanes[(size_t)tx * kLanes]);
+        }
+    }
+}
+
+ChangeDetector::ChangeDetector(int tileSize) : m_tileSize(std::max(8, tileSize)) {}
+
+void ChangeDetector::Reset() {
+    m_valid = false;
+}
+
+ChangeResult ChangeDetector::Update(const ImageFrame& frame) {
+    ChangeResult result;
+    HashTiles(ActiveSimdLevel(), frame, m_tileSize, m_current);
+    int cols = (frame.width + m_tileSize - 1) / m_tileSize;
+    int rows = (frame.height + m_tileSize - 1) / m_tileSize;
+    result.totalTiles = (int)m_current.size();
+
+    bool sameShape = m_valid && frame.width == m_width && frame.height == m_height && frame.format == m_format;
+    if (!sameShape) {
+        result.reset = true;
+        result.changed = !frame.empty();
+        result.changedTiles = result.totalTiles;
+        result.width = std::max(0, frame.width);
+        result.height = std::max(0, frame.height);
+    } else {
+        int minX = cols, minY = rows, maxX = -1, maxY = -1;
+        for (size_t i = 0; i < m_current.size(); i++) {
+            if (m_current[i] == m_hashes[i]) {
+                continue;
+            }
+            int tx = (int)(i % cols), ty = (int)(i / cols);
+            minX = std::min(minX, tx);
+            maxX = std::max(maxX, tx);
+            minY = std::min(minY, ty);
+            maxY = std::max(maxY, ty);
+            result.changedTiles++;
+        }
+        if (result.changedTiles > 0) {
+            result.changed = true;
+            result.left = minX * m_tileSize;
+            result.top = minY * m_tileSize;
+            result.width = std::min((maxX + 1) * m_tileSize, frame.width) - result.left;
+            result.height = std::min((maxY + 1) * m_tileSize, frame.height) - result.top;
+        }
+    }
+
+    m_hashes.swap(m_current);
+    m_width = frame.width;
+    m_height = frame.height;
+    m_format = frame.format;
+    m_valid = !frame.empty();
+    return result;
+}
+
+} // namespace qrcore
@@ -0,0 +1,62 @@
+/*
+ * 分块哈希的画面变化检测
+ *
+ * 把帧切成 tileSize 见方的分块, 每块算一个 64 位哈希, 与上一帧逐块比较:
+ * 完全相同的帧不必再识别, 只有局部变化时只需识别变化分块的外接矩形。
+ *
+ * 哈希按 8 个 32 位通道并行累积 (每通道: 异或、乘奇数常数、移位异或),
+ * 一次消费 32 字节, 与 SSE2 / AVX2 的寄存器宽度对应; 三种实现与标量参考逐位一致,
+ * 运行时按 PixelConvert 的 SIMD 级别选择。只用于检测变化, 不追求抗碰撞。
+ */
+
+#pragma once
+
+#include "PixelConvert.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace qrcore {
+
+struct ChangeResult {
+    bool changed = false;  // 与上一帧有任一分块不同
+    bool reset = false;    // 首帧, 或尺寸 / 像素格式与上一帧不同 (整帧视为变化)
+    int changedTiles = 0;
+    int totalTiles = 0;
+    // 变化区域: 所有变化分块的外接矩形 (像素, 已裁剪到帧内); 未变化时宽高为 0
+    int left = 0;
+    int top = 0;
+    int width = 0;
+    int height = 0;
+};
+
+/**
+ * @brief 计算帧的分块哈希 (按行优先排列, 右侧和底部不足一块的部分单独成块)
+ */
+void HashTiles(SimdLevel level, const ImageFrame& frame, int tileSize, std::vector<uint64_t>& outHashes);
+
+class ChangeDetector {
+public:
+    explicit ChangeDetector(int tileSize = 64);
+
+    /**
+     * @brief 与上一帧比较, 并以本帧为新的比较基准
+     */
+    ChangeResult Update(const ImageFrame& frame);
+
+    // 丢弃比较基准 (下一帧视为首帧)
+    void Reset();
+
+    int TileSize() const { return m_tileSize; }
+
+private:
+    int m_tileSize;
+    int m_width = 0;
+    int m_height = 0;
+    PixelFormat m_format = PixelFormat::BGRX;
+    bool m_valid = false;
+    std::vector<uint64_t> m_hashes;  // 上一帧
+    std::vector<uint64_t> m_current; // 本帧 (与 m_hashes 交换, 复用内存)
+};
+
+} // namespace qrcore
@@ -0,0 +1,239 @@
+/*
+ * 分级识别 (识别级联)
+ */
+
+#include "DecodeCascade.h"
+#include "ImageFilters.h"
+#include "Trace.h"
+
+#include <chrono>
+
+namespace qrcore {
+
+bool MakeTier(const std::string& name, CascadeTier& outTier) {
+    CascadeTier tier;
+    tier.name = name;
+
+    if (name == "fast") {
+        tier.options.tryHarder = false;
+        tier.options.tryRotate = false;
+    } else if (name == "harder") {
+        tier.options.tryHarder = true;
+        tier.options.tryRotate = true;
+    } else if (name == "invert") {
+        tier.options.tryHarder = true;
+        tier.options.tryRotate = true;
+        tier.options.tryInvert = true;
+    } else if (name == "contrast") {
+        tier.preprocess = Preprocess::Contrast;
+    } else if (name == "brightness") {
+        tier.preprocess = Preprocess::Brightness;
+    } else {
+        return false;
+    }
+
+    outTier = tier;
+    return true;
+}
+
+CascadeConfig DefaultCascade() {
+    CascadeConfig config;
+    std::string errorMsg;
+    ParseCascade("fast,harder,contrast,brightness", config.budgetMs, config, errorMsg);
+    return config;
+}
+
+bool ParseCascade(const std::string& spec, int budgetMs, CascadeConfig& outConfig, std::string& outErrorMsg) {
+    CascadeConfig config;
+    config.budgetMs = budgetMs;
+
+    size_t pos = 0;
+    while (pos <= spec.size()) {
+        size_t comma = spec.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = spec.size();
+        }
+        std::string name = spec.substr(pos, comma - pos);
+        // 去除首尾空白
+        size_t first = name.find_first_not_of(" \t\r");
+        size_t last = name.find_last_not_of(" \t\r");
+        name = (first == std::string::npos) ? std::string() : name.substr(first, last - first + 1);
+
+        if (!name.empty()) {
+            CascadeTier tier;
+            if (!MakeTier(name, tier)) {
+                outErrorMsg = "未知的识别层级: " + name;
+                return false;
+            }
+            config.tiers.push_back(tier);
+        }
+        pos = comma + 1;
+    }
+
+    if (config.tiers.empty()) {
+        outErrorMsg = "识别层级列表为空";
+        return false;
+    }
+
+    outConfig = config;
+    return true;
+}
+
+std::string CascadeToString(const CascadeConfig& config) {
+    std::string spec;
+    for (const CascadeTier& tier : config.tiers) {
+        if (!spec.empty()) {
+            spec += ',';
+        }
+        spec += tier.name;
+    }
+    return spec;
+}
+
+// 按层级设置做预处理
+static ImageFrame ApplyPreprocess(const ImageFrame& lum, Preprocess preprocess) {
+    if (preprocess == Preprocess::Contrast) {
+        return StretchContrast(lum);
+    } else if (preprocess == Preprocess::Brightness) {
+        return AdjustBrightness(lum);
+    }
+    return lum;
+}
+
+bool RunCascade(const ImageFrame& frame, const CascadeConfig& config, ScanResult& outResult) {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point deadline = Clock::time_point::max();
+    if (config.budgetMs > 0) {
+        deadline = Clock::now() + std::chrono::milliseconds(config.budgetMs);
+    }
+    return RunCascadeUntil(frame, config, deadline, outResult);
+}
+
+bool RunCascadeUntil(const ImageFrame& frame, const CascadeConfig& config,
+                     std::chrono::steady_clock::time_point deadline, ScanResult& outResult) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    auto elapsedMs = [&start]() {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    ScanResult summary;
+    summary.errorMsg = "未能在图像中识别到二维码。\n请确保截图清晰且完整。";
+
+    // 先用 SIMD 内核转换一次灰度, 所有层级都以 ImageFormat::Lum 识别,
+    // ZXing 不必在每个层级内部各自重复转换 (内存访问量也只有 BGRX 的 1/4)
+    ImageFrame lum;
+    {
+        QRCORE_TRACE_SCOPE("ToLuminance");
+        lum = ToLuminance(frame);
+    }
+
+    // 大图先在缩小层级上执行第一层 (由粗到细), 每一级之前检查截止时间。
+    // 单码模式下某一级成功即返回; 多码模式下粗层级会漏掉模块过小的码,
+    // 成功的结果先记下, 仍回到原图执行第一层, 两者合并 (到达截止时间时直接返回粗层级的结果)。
+    ScanResult coarse;
+    if (!config.tiers.empty()) {
+        const CascadeTier& first = config.tiers[0];
+        ScanOptions options = first.options;
+        options.maxSymbols = config.maxSymbols;
+
+        // 层级列表按线程复用, 用完清空以便各层的帧归还帧缓冲池
+        thread_local std::vector<PyramidLevel> levels;
+        BuildPyramid(lum, config.pyramid, levels);
+        for (size_t l = 0; l < levels.size(); l++) {
+            const PyramidLevel& level = levels[l];
+            if (l > 0 && Clock::now() >= deadline) {
+                summary.budgetExceeded = true;
+                break;
+            }
+
+            QRCORE_TRACE_SCOPE("pyramid_level");
+            ScanResult attempt;
+            bool success = DecodeFrame(ApplyPreprocess(level.frame, first.preprocess), options, attempt);
+            summary.decodeMs += attempt.decodeMs;
+
+            if (success) {
+                for (DecodedSymbol& symbol : attempt.symbols) {
+                    symbol.position = symbol.position.transformed(level.scale, 0, 0);
+                }
+                attempt.decodeMs = summary.decodeMs;
+                attempt.tiersTried = 1;
+                attempt.tier = first.name + "@1/" + std::to_string(level.scale);
+                attempt.tierIndex = 0;
+                attempt.scale = level.scale;
+                coarse = std::move(attempt);
+                break;
+            }
+        }
+        levels.clear();
+
+        if (coarse.success && (config.maxSymbols == 1 || Clock::now() >= deadline)) {
+            coarse.budgetExceeded = config.maxSymbols != 1;
+            coarse.totalMs = elapsedMs();
+            outResult = std::move(coarse);
+            return true;
+        }
+    }
+
+    for (size_t i = 0; i < config.tiers.size(); i++) {
+        const CascadeTier& tier = config.tiers[i];
+
+        // 第一层总是执行; 之后超出预算就不再开始新的层级。
+        // 粗层级已有结果时原图只补充识别小码, 不再继续后面的层级
+        if (i > 0 && coarse.success) {
+            break;
+        }
+        if (i > 0 && Clock::now() >= deadline) {
+            summary.budgetExceeded = true;
+            break;
+        }
+
+        // 层级名称是配置中的字符串, 只在跟踪开启时转为静态字符串
+        QRCORE_TRACE_SCOPE(IsTraceEnabled() ? TraceIntern(tier.name) : "tier");
+        ImageFrame input = ApplyPreprocess(lum, tier.preprocess);
+
+        ScanOptions options = tier.options;
+        options.maxSymbols = config.maxSymbols;
+
+        ScanResult attempt;
+        bool success = DecodeFrame(input, options, attempt);
+        summary.tiersTried++;
+        summary.decodeMs += attempt.decodeMs;
+
+        if (success) {
+            if (coarse.success) {
+                // 原图的位置更精确, 排在前面以便去重时保留
+                for (DecodedSymbol& symbol : coarse.symbols) {
+                    attempt.symbols.push_back(std::move(symbol));
+                }
+                DeduplicateSymbols(attempt.symbols);
+                FinishResult(attempt);
+            }
+            attempt.decodeMs = summary.decodeMs;
+            attempt.tiersTried = summary.tiersTried;
+            attempt.tier = tier.name;
+            attempt.tierIndex = (int)i;
+            attempt.totalMs = elapsedMs();
+            outResult = attempt;
+            return true;
+        }
+        if (!attempt.errorMsg.empty()) {
+            summary.errorMsg = attempt.errorMsg;
+        }
+    }
+
+    if (coarse.success) {
+        // 原图没有补充识别到码, 以粗层级的结果为准
+        coarse.decodeMs = summary.decodeMs;
+        coarse.tiersTried += summary.tiersTried;
+        coarse.totalMs = elapsedMs();
+        outResult = std::move(coarse);
+        return true;
+    }
+
+    summary.totalMs = elapsedMs();
+    outResult = summary;
+    return false;
+}
+
+} // namespace qrcore
@@ -0,0 +1,83 @@
+/*
+ * 分级识别 (识别级联)
+ *
+ * 大多数屏幕上的二维码方正清晰, 一次快速识别即可成功;
+ * 只有失败时才逐级加大 ZXing 的识别力度并加入预处理。
+ * 在第一个成功的层级停止, 并遵守每次扫描的时间预算。
+ *
+ * 大图在执行级联之前, 先用第一层在金字塔的缩小层级上由粗到细尝试,
+ * 识别到的位置按缩小倍数映射回原图坐标。多码模式下粗层级成功后仍在原图上执行第一层,
+ * 补上缩小后模块过小而漏掉的码。
+ */
+
+#pragma once
+
+#include "ImagePyramid.h"
+#include "QRDecoder.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace qrcore {
+
+// 识别前的预处理
+enum class Preprocess {
+    None,       // 原图
+    Contrast,   // 灰度化 + 对比度拉伸
+    Brightness, // 灰度化 + 亮度增强
+};
+
+struct CascadeTier {
+    std::string name;
+    ScanOptions options;
+    Preprocess preprocess = Preprocess::None;
+};
+
+struct CascadeConfig {
+    std::vector<CascadeTier> tiers;
+    int budgetMs = 1500; // 每次扫描的时间预算; 超出后不再开始新的层级 (<= 0 表示不限)
+    int maxSymbols = 0;  // 各层级最多识别的码数 (覆盖层级自身设置); 0 为不限, 1 为只取第一个
+    // 缩小层级: 单码模式下某一级成功即结束; 多码模式下粗层级成功后仍回到原图执行第一层并合并,
+    // 以免漏掉同一选区内模块过小的码
+    PyramidConfig pyramid;
+};
+
+/**
+ * @brief 按名称构造预定义层级
+ *
+ * fast       快速识别 (不加强、不旋转)
+ * harder     加强 + 旋转 (原先唯一的一次识别)
+ * invert     加强 + 旋转 + 反色
+ * contrast   对比度拉伸后加强识别
+ * brightness 亮度增强后加强识别
+ */
+bool MakeTier(const std::string& name, CascadeTier& outTier);
+
+// 默认级联: fast,harder,contrast,brightness
+CascadeConfig DefaultCascade();
+
+/**
+ * @brief 解析逗号分隔的层级列表, 如 "fast,harder,contrast"
+ */
+bool ParseCascade(const std::string& spec, int budgetMs, CascadeConfig& outConfig, std::string& outErrorMsg);
+
+std::string CascadeToString(const CascadeConfig& config);
+
+/**
+ * @brief 按级联依次识别, 在第一个成功的层级停止
+ * @return 识别成功返回 true; outResult 记录成功层级、尝试层数和耗时;
+ *         在缩小层级上成功时 tier 形如 "fast@1/4", scale 为缩小倍数
+ */
+bool RunCascade(const ImageFrame& frame, const CascadeConfig& config, ScanResult& outResult);
+
+/**
+ * @brief 同 RunCascade, 但以调用方给出的截止时间代替 config.budgetMs
+ *
+ * 多次识别共用一个时间预算时使用 (如全屏扫码的各个分块); 到达 deadline 后不再开始新的层级,
+ * 第一层仍总是执行。
+ */
+bool RunCascadeUntil(const ImageFrame& frame, const CascadeConfig& config,
+                     std::chrono::steady_clock::time_point deadline, ScanResult& outResult);
+
+} // namespace qrcore
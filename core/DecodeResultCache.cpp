@@ -0,0 +1,501 @@
+/*
+ * 识别结果缓存 (按图像内容索引)
+ */
+
+#include "DecodeResultCache.h"
+
+#include "ChangeDetector.h"
+#include "MappedFile.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace qrcore {
+
+// 序列化格式: "QRRC" | 版本 u16 | 保留 u16 | 条目数 u32 | 条目... | CRC32 (其前全部字节)
+// 条目: exact u64 | perceptual u64 | mode u32 | width u32 | height u32 | 层级 (u16 长度 + 字节)
+//       | 码数 u16 | 每个码: 码制 (u16 长度 + 字节) | 内容 (u32 长度 + 字节) | 四角 8 × i32
+// 整数均为小端
+static const char kMagic[4] = {'Q', 'R', 'R', 'C'};
+static const uint16_t kVersion = 1;
+static const int kHashCols = 9; // dHash: 9x8 灰度, 每行相邻 8 对比较
+static const int kHashRows = 8;
+
+// ---------------------------------------------------------------------------
+// 缓存键
+// ---------------------------------------------------------------------------
+
+static uint64_t MixKey(uint64_t hash, uint64_t value) {
+    hash = (hash ^ value) * 0x100000001B3ull;
+    return hash ^ (hash >> 29);
+}
+
+int HammingDistance(uint64_t a, uint64_t b) {
+    uint64_t x = a ^ b;
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (int)((x * 0x0101010101010101ull) >> 56);
+}
+
+// dHash: 灰度图按面积平均缩小到 9x8, 再逐行比较相邻两格; 按行累加, 不保留整幅灰度图
+class DifferenceHasher {
+public:
+    DifferenceHasher(int width, int height) : m_height(height) {
+        for (int cx = 0; cx <= kHashCols; cx++) {
+            m_edges[cx] = (int)(((int64_t)cx * width + kHashCols - 1) / kHashCols);
+        }
+    }
+
+    void AddRow(int y, const uint8_t* row) {
+        int cy = (int)((int64_t)y * kHashRows / m_height);
+        for (int cx = 0; cx < kHashCols; cx++) {
+            // 连续区间求和, 编译器可向量化
+            uint32_t sum = 0;
+            for (int x = m_edges[cx]; x < m_edges[cx + 1]; x++) {
+                sum += row[x];
+            }
+            m_sums[cy][cx] += sum;
+        }
+    }
+
+    uint64_t Finish() const {
+        uint64_t hash = 0;
+        for (int cy = 0; cy < kHashRows; cy++) {
+            for (int cx = 0; cx + 1 < kHashCols; cx++) {
+                // 比较平均值 sum / (行数 × 列数); 同一行的两格行数相同, 列数交叉相乘避免除法
+                uint64_t a = m_sums[cy][cx] * (uint64_t)(m_edges[cx + 2] - m_edges[cx + 1]);
+                uint64_t b = m_sums[cy][cx + 1] * (uint64_t)(m_edges[cx + 1] - m_edges[cx]);
+                hash = (hash << 1) | (a < b ? 1 : 0);
+            }
+        }
+        return hash;
+    }
+
+private:
+    int m_height;
+    int m_edges[kHashCols + 1]; // 第 cx 格的列范围为 [m_edges[cx], m_edges[cx + 1])
+    uint64_t m_sums[kHashRows][kHashCols] = {};
+};
+
+bool MakeDecodeCacheKey(const ImageFrame& frame, uint32_t mode, DecodeCacheKey& outKey) {
+    std::string errorMsg;
+    if (frame.empty() || !ValidateFrame(frame, errorMsg)) {
+        return false;
+    }
+
+    // 统一为灰度: 同一画面无论以 BGRX 还是 RGB 提交, 键都相同。
+    // 按 kBandRows 行一段转换 (段缓冲留在缓存中), 每段作为一个分块复用变化检测的 SIMD 哈希,
+    // 各段哈希依次混合; 不分配整幅灰度图
+    const int kBandRows = 32;
+    SimdLevel level = ActiveSimdLevel();
+    ImageFrame band = AllocateFrame(frame.width, std::min(kBandRows, frame.height), PixelFormat::Lum);
+    DifferenceHasher dhash(frame.width, frame.height);
+    std::vector<uint64_t> hashes;
+    uint64_t exact = MixKey(0xCBF29CE484222325ull, ((uint64_t)(uint32_t)frame.width << 32) | (uint32_t)frame.height);
+    for (int y0 = 0; y0 < frame.height; y0 += kBandRows) {
+        int rows = std::min(kBandRows, frame.height - y0);
+        for (int y = 0; y < rows; y++) {
+            ConvertRowToLum(level, frame.row(y0 + y), frame.format, band.row(y), frame.width);
+            dhash.AddRow(y0 + y, band.row(y));
+        }
+        ImageFrame view = CropFrame(band, 0, 0, frame.width, rows);
+        HashTiles(level, view, std::max(frame.width, rows), hashes);
+        exact = MixKey(exact, hashes.empty() ? 0 : hashes[0]);
+    }
+
+    outKey.width = frame.width;
+    outKey.height = frame.height;
+    outKey.mode = mode;
+    outKey.exact = MixKey(exact, mode);
+    outKey.perceptual = dhash.Finish();
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// 缓存
+// ---------------------------------------------------------------------------
+
+static size_t EntryBytes(const std::vector<DecodedSymbol>& symbols, const std::string& tier) {
+    size_t bytes = tier.size();
+    for (const DecodedSymbol& symbol : symbols) {
+        bytes += symbol.text.size() + symbol.format.size();
+    }
+    return bytes;
+}
+
+// 重新框选时宽高相差不超过 1/8 才按感知键比较
+static bool SimilarSize(int a, int b) {
+    return std::abs(a - b) * 8 <= std::max(a, b);
+}
+
+DecodeResultCache::DecodeResultCache(const DecodeCacheConfig& config) {
+    Configure(config);
+}
+
+void DecodeResultCache::Configure(const DecodeCacheConfig& config) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = config;
+    m_config.capacity = std::max<size_t>(1, m_config.capacity);
+    m_config.maxDistance = std::min(64, std::max(0, m_config.maxDistance));
+    EvictLocked();
+}
+
+DecodeCacheConfig DecodeResultCache::GetConfig() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_config;
+}
+
+bool VerifyCachedResult(const ImageFrame& frame, const std::string& tier, const CascadeConfig& cascade,
+                        ScanResult& inOutResult) {
+    if (inOutResult.symbols.empty()) {
+        return false;
+    }
+    // 层级名称可能带缩小倍数 ("fast@1/4"), 码区域很小, 只取层级本身
+    CascadeConfig verify;
+    verify.budgetMs = cascade.budgetMs;
+    verify.maxSymbols = 1;
+    verify.pyramid.maxLevels = 0;
+    CascadeTier base;
+    if (MakeTier(tier.substr(0, tier.find('@')), base)) {
+        verify.tiers.push_back(base);
+    } else if (!cascade.tiers.empty()) {
+        verify.tiers.push_back(cascade.tiers.front());
+    } else {
+        return false;
+    }
+
+    std::vector<DecodedSymbol> symbols = inOutResult.symbols;
+    for (DecodedSymbol& symbol : symbols) {
+        int left, top, right, bottom;
+        symbol.position.bounds(left, top, right, bottom);
+        // 选区偏移后码的位置也会偏移, 向外扩展码尺寸的 1/4 (至少 16 像素)
+        int margin = std::max(16, std::max(right - left, bottom - top) / 4);
+        left = std::max(0, left - margin);
+        top = std::max(0, top - margin);
+        right = std::min(frame.width, right + margin);
+        bottom = std::min(frame.height, bottom + margin);
+        if (right <= left || bottom <= top) {
+            return false;
+        }
+        ScanResult check;
+        if (!RunCascade(CropFrame(frame, left, top, right - left, bottom - top), verify, check) ||
+            check.text != symbol.text) {
+            return false;
+        }
+        symbol.position = check.symbols.front().position.transformed(1.0, left, top);
+    }
+    inOutResult.symbols = symbols;
+    FinishResult(inOutResult);
+    return true;
+}
+
+bool DecodeResultCache::Lookup(const DecodeCacheKey& key, ScanResult& outResult, DecodeCacheHit* outHit) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_entries.end();
+    auto it = m_index.find(key.exact);
+    if (it != m_index.end() && it->second->key.width == key.width && it->second->key.height == key.height &&
+        it->second->key.mode == key.mode) {
+        found = it->second;
+        m_stats.exactHits++;
+    } else if (m_config.maxDistance > 0) {
+        // 条目数有上限 (默认 128), 线性比较即可
+        int best = m_config.maxDistance + 1;
+        for (auto entry = m_entries.begin(); entry != m_entries.end(); ++entry) {
+            if (entry->key.mode != key.mode || !SimilarSize(entry->key.width, key.width) ||
+                !SimilarSize(entry->key.height, key.height)) {
+                continue;
+            }
+            int distance = HammingDistance(entry->key.perceptual, key.perceptual);
+            if (distance < best) {
+                best = distance;
+                found = entry;
+            }
+        }
+        if (found != m_entries.end()) {
+            m_stats.fuzzyHits++;
+        }
+    }
+    if (found == m_entries.end()) {
+        m_stats.misses++;
+        return false;
+    }
+
+    if (outHit) {
+        outHit->fuzzy = found->key.exact != key.exact;
+        outHit->distance = HammingDistance(found->key.perceptual, key.perceptual);
+        outHit->tier = found->tier;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, found);
+    outResult = ScanResult();
+    outResult.symbols = found->symbols;
+    outResult.tier = "cache";
+    outResult.cached = true;
+    FinishResult(outResult);
+    return true;
+}
+
+void DecodeResultCache::Insert(const DecodeCacheKey& key, const ScanResult& result) {
+    if (!result.success || result.symbols.empty() || result.cached) {
+        return;
+    }
+    Entry entry;
+    entry.key = key;
+    entry.symbols = result.symbols;
+    entry.tier = result.tier;
+    entry.bytes = EntryBytes(entry.symbols, entry.tier);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    InsertLocked(std::move(entry));
+    m_stats.inserts++;
+    m_dirty = true;
+}
+
+void DecodeResultCache::InsertLocked(Entry entry) {
+    auto it = m_index.find(entry.key.exact);
+    if (it != m_index.end()) {
+        m_bytes -= it->second->bytes;
+        m_entries.erase(it->second);
+        m_index.erase(it);
+    }
+    m_bytes += entry.bytes;
+    uint64_t exact = entry.key.exact;
+    m_entries.push_front(std::move(entry));
+    m_index[exact] = m_entries.begin();
+    EvictLocked();
+}
+
+void DecodeResultCache::EvictLocked() {
+    // 至少保留最近的一条, 即使它本身超过字节上限
+    while (m_entries.size() > m_config.capacity || (m_bytes > m_config.maxBytes && m_entries.size() > 1)) {
+        m_bytes -= m_entries.back().bytes;
+        m_index.erase(m_entries.back().key.exact);
+        m_entries.pop_back();
+        m_stats.evictions++;
+        m_dirty = true;
+    }
+}
+
+DecodeCacheStats DecodeResultCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    DecodeCacheStats stats = m_stats;
+    stats.entries = m_entries.size();
+    stats.bytes = m_bytes;
+    return stats;
+}
+
+void DecodeResultCache::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dirty = m_dirty || !m_entries.empty();
+    m_entries.clear();
+    m_index.clear();
+    m_bytes = 0;
+}
+
+bool DecodeResultCache::IsDirty() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dirty;
+}
+
+// ---------------------------------------------------------------------------
+// 序列化
+// ---------------------------------------------------------------------------
+
+static void PutU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back((uint8_t)value);
+    out.push_back((uint8_t)(value >> 8));
+}
+
+static void PutU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+static void PutU64(std::vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+// 按顺序读取; 越界后 ok 为 false, 之后的读取都返回 0
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    bool ok() const { return m_ok; }
+    size_t remaining() const { return m_size - m_pos; }
+
+    uint64_t Read(int bytes) {
+        if (!m_ok || remaining() < (size_t)bytes) {
+            m_ok = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= (uint64_t)m_data[m_pos + i] << (8 * i);
+        }
+        m_pos += bytes;
+        return value;
+    }
+
+    std::string ReadString(size_t length) {
+        if (!m_ok || remaining() < length) {
+            m_ok = false;
+            return std::string();
+        }
+        std::string value((const char*)m_data + m_pos, length);
+        m_pos += length;
+        return value;
+    }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+    bool m_ok = true;
+};
+
+static void PutString16(std::vector<uint8_t>& out, const std::string& value) {
+    size_t length = std::min<size_t>(value.size(), 0xFFFF);
+    PutU16(out, (uint16_t)length);
+    out.insert(out.end(), value.begin(), value.begin() + length);
+}
+
+void DecodeResultCache::Serialize(std::vector<uint8_t>& outData) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    outData.clear();
+    outData.reserve(16 + m_bytes + m_entries.size() * 80);
+    outData.insert(outData.end(), kMagic, kMagic + 4);
+    PutU16(outData, kVersion);
+    PutU16(outData, 0);
+    PutU32(outData, (uint32_t)m_entries.size());
+    for (const Entry& entry : m_entries) {
+        PutU64(outData, entry.key.exact);
+        PutU64(outData, entry.key.perceptual);
+        PutU32(outData, entry.key.mode);
+        PutU32(outData, (uint32_t)entry.key.width);
+        PutU32(outData, (uint32_t)entry.key.height);
+        PutString16(outData, entry.tier);
+        size_t count = std::min<size_t>(entry.symbols.size(), 0xFFFF);
+        PutU16(outData, (uint16_t)count);
+        for (size_t i = 0; i < count; i++) {
+            const DecodedSymbol& symbol = entry.symbols[i];
+            PutString16(outData, symbol.format);
+            PutU32(outData, (uint32_t)symbol.text.size());
+            outData.insert(outData.end(), symbol.text.begin(), symbol.text.end());
+            const PointI* corners[4] = {&symbol.position.topLeft, &symbol.position.topRight,
+                                        &symbol.position.bottomRight, &symbol.position.bottomLeft};
+            for (const PointI* corner : corners) {
+                PutU32(outData, (uint32_t)corner->x);
+                PutU32(outData, (uint32_t)corner->y);
+            }
+        }
+    }
+    PutU32(outData, (uint32_t)crc32(0L, outData.data(), (uInt)outData.size()));
+    m_dirty = false;
+}
+
+bool DecodeResultCache::Deserialize(const uint8_t* data, size_t size, std::string& outErrorMsg) {
+    if (size < 16 || memcmp(data, kMagic, 4) != 0) {
+        Clear();
+        outErrorMsg = "不是识别结果缓存文件";
+        return false;
+    }
+    uint32_t storedCrc = (uint32_t)data[size - 4] | ((uint32_t)data[size - 3] << 8) |
+                         ((uint32_t)data[size - 2] << 16) | ((uint32_t)data[size - 1] << 24);
+    if ((uint32_t)crc32(0L, data, (uInt)(size - 4)) != storedCrc) {
+        Clear();
+        outErrorMsg = "缓存文件校验失败";
+        return false;
+    }
+
+    ByteReader reader(data + 4, size - 8);
+    uint16_t version = (uint16_t)reader.Read(2);
+    reader.Read(2);
+    if (version != kVersion) {
+        Clear();
+        outErrorMsg = "缓存文件版本不符: " + std::to_string(version);
+        return false;
+    }
+
+    uint32_t count = (uint32_t)reader.Read(4);
+    std::vector<Entry> entries;
+    for (uint32_t n = 0; n < count && reader.ok(); n++) {
+        Entry entry;
+        entry.key.exact = reader.Read(8);
+        entry.key.perceptual = reader.Read(8);
+        entry.key.mode = (uint32_t)reader.Read(4);
+        entry.key.width = (int)reader.Read(4);
+        entry.key.height = (int)reader.Read(4);
+        entry.tier = reader.ReadString((size_t)reader.Read(2));
+        uint16_t symbols = (uint16_t)reader.Read(2);
+        for (uint16_t i = 0; i < symbols && reader.ok(); i++) {
+            DecodedSymbol symbol;
+            symbol.format = reader.ReadString((size_t)reader.Read(2));
+            symbol.text = reader.ReadString((size_t)reader.Read(4));
+            PointI* corners[4] = {&symbol.position.topLeft, &symbol.position.topRight,
+                                  &symbol.position.bottomRight, &symbol.position.bottomLeft};
+            for (PointI* corner : corners) {
+                corner->x = (int32_t)(uint32_t)reader.Read(4);
+                corner->y = (int32_t)(uint32_t)reader.Read(4);
+            }
+            entry.symbols.push_back(std::move(symbol));
+        }
+        entry.bytes = EntryBytes(entry.symbols, entry.tier);
+        entries.push_back(std::move(entry));
+    }
+    if (!reader.ok() || reader.remaining() != 0) {
+        Clear();
+        outErrorMsg = "缓存文件内容损坏";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+    m_bytes = 0;
+    // 文件按最近使用顺序排列, 倒序插入后顺序不变; 超出上限的旧条目随即淘汰
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+        InsertLocked(std::move(*it));
+    }
+    m_dirty = false;
+    return true;
+}
+
+bool DecodeResultCache::SaveFile(const std::string& path, std::string& outErrorMsg) {
+    std::vector<uint8_t> data;
+    Serialize(data);
+
+    // 先完整写出临时文件, 再一步替换原文件: 替换失败时原文件仍然完好
+    std::string tempPath = path + ".tmp";
+    bool ok;
+    {
+        AppendFile file;
+        ok = file.Open(tempPath, true, outErrorMsg) && file.Append(data.data(), data.size(), outErrorMsg);
+        if (ok && !file.Sync()) {
+            outErrorMsg = "写入文件失败: " + tempPath;
+            ok = false;
+        }
+    }
+    ok = ok && ReplaceFileWith(tempPath, path, outErrorMsg);
+    if (!ok) {
+        RemoveFile(tempPath);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_dirty = true; // 下次保存时重试
+    }
+    return ok;
+}
+
+bool DecodeResultCache::LoadFile(const std::string& path, std::string& outErrorMsg) {
+    MappedFile file;
+    if (!file.Map(path, outErrorMsg)) {
+        return false;
+    }
+    return Deserialize(file.data(), file.size(), outErrorMsg);
+}
+
+} // namespace qrcore
@@ -0,0 +1,137 @@
+/*
+ * 识别结果缓存 (按图像内容索引)
+ *
+ * 用户经常反复扫描同一个码 (Wi-Fi 二维码、会议链接), 每次都完整执行识别级联并不必要。
+ * 缓存以图像内容为键:
+ *   - 精确键: 帧统一转为 8 位灰度后的 64 位哈希 (与像素格式、行跨度无关), 另计入宽高和识别模式;
+ *   - 感知键: 灰度图缩小到 9x8 后相邻像素比较得到的 64 位差值哈希 (dHash)。
+ * 精确键未命中时, 可选地接受感知键汉明距离不超过 maxDistance、宽高相近的条目
+ * (重新框选同一个码时选区会差几个像素)。距离为 0 时只做精确匹配。
+ * 感知键由整幅画面主导, 同一位置换了一个码时距离往往很小, 因此感知命中只是候选,
+ * 须经 VerifyCachedResult 在码所在的小区域内重新识别确认。
+ *
+ * 只缓存识别成功的结果, 按最近使用淘汰, 条目数与总字节数都有上限。
+ * 可序列化为紧凑的二进制 (末尾带 CRC32), 损坏或版本不符的数据整体丢弃。线程安全。
+ */
+
+#pragma once
+
+#include "DecodeCascade.h"
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace qrcore {
+
+struct DecodeCacheKey {
+    uint64_t exact = 0;      // 灰度内容 + 宽高 + 模式的哈希
+    uint64_t perceptual = 0; // 9x8 dHash
+    uint32_t mode = 0;       // 调用方定义的识别模式 (如单码 / 多码、是否分块), 模式不同的结果互不命中
+    int width = 0;
+    int height = 0;
+};
+
+struct DecodeCacheConfig {
+    size_t capacity = 128;      // 最多条目数
+    size_t maxBytes = 1 << 20;  // 所有条目的内容 (码的文本与码制名称) 总字节数上限
+    int maxDistance = 0;        // 感知键允许的汉明距离 (0 ~ 64); 0 为只做精确匹配
+};
+
+// 命中的方式
+struct DecodeCacheHit {
+    bool fuzzy = false; // 按感知键命中 (须确认)
+    int distance = 0;   // 感知键的汉明距离
+    std::string tier;   // 当时成功的识别层级
+};
+
+struct DecodeCacheStats {
+    uint64_t exactHits = 0;
+    uint64_t fuzzyHits = 0;
+    uint64_t misses = 0;
+    uint64_t inserts = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+};
+
+/**
+ * @brief 计算帧的缓存键 (灰度转换 + 哈希 + 缩小, 各一次遍历)
+ * @return 帧为空或无效时返回 false
+ */
+bool MakeDecodeCacheKey(const ImageFrame& frame, uint32_t mode, DecodeCacheKey& outKey);
+
+// 64 位感知哈希的汉明距离
+int HammingDistance(uint64_t a, uint64_t b);
+
+/**
+ * @brief 确认感知命中的结果: 在缓存的每个码的位置 (向外扩展) 用当时成功的层级识别该区域,
+ *        每个码都识别出相同内容才算命中; 确认后码的位置更新为本帧中的位置
+ * @param tier 当时成功的层级 (DecodeCacheHit::tier); 无法识别的名称改用级联的第一层
+ */
+bool VerifyCachedResult(const ImageFrame& frame, const std::string& tier, const CascadeConfig& cascade,
+                        ScanResult& inOutResult);
+
+class DecodeResultCache {
+public:
+    explicit DecodeResultCache(const DecodeCacheConfig& config = DecodeCacheConfig());
+
+    // 修改上限 (超出的条目立即淘汰)
+    void Configure(const DecodeCacheConfig& config);
+    DecodeCacheConfig GetConfig() const;
+
+    /**
+     * @brief 查找缓存的识别结果
+     * @param outHit 可为空; 命中时给出命中方式, 感知命中须由调用方确认
+     * @return 命中时返回 true, outResult 为当时的识别结果 (cached 为 true, tier 为 "cache")
+     */
+    bool Lookup(const DecodeCacheKey& key, ScanResult& outResult, DecodeCacheHit* outHit = nullptr);
+
+    // 记录识别结果; 失败的结果、没有内容的结果不记录
+    void Insert(const DecodeCacheKey& key, const ScanResult& result);
+
+    DecodeCacheStats GetStats() const;
+    void Clear();
+
+    // 自上次序列化 / 加载以来内容是否变化 (用于决定是否需要写回磁盘)
+    bool IsDirty() const;
+
+    // 序列化全部条目 (按最近使用顺序); 清除 dirty 标记
+    void Serialize(std::vector<uint8_t>& outData);
+
+    /**
+     * @brief 用序列化的数据替换全部条目 (超出当前上限的部分按最近使用顺序丢弃)
+     * @return 数据损坏或版本不符时返回 false, 缓存保持为空
+     */
+    bool Deserialize(const uint8_t* data, size_t size, std::string& outErrorMsg);
+
+    // 读写文件 (路径为 UTF-8); 写入先写临时文件再以 ReplaceFileWith 替换, 中途失败不破坏原文件
+    bool SaveFile(const std::string& path, std::string& outErrorMsg);
+    bool LoadFile(const std::string& path, std::string& outErrorMsg);
+
+private:
+    struct Entry {
+        DecodeCacheKey key;
+        std::vector<DecodedSymbol> symbols;
+        std::string tier; // 当时成功的识别层级 (确认感知命中时使用)
+        size_t bytes = 0;
+    };
+
+    void InsertLocked(Entry entry);
+    void EvictLocked();
+
+    DecodeCacheConfig m_config;
+
+    mutable std::mutex m_mutex;
+    // 链表头为最近使用; 索引按精确键指向链表节点
+    std::list<Entry> m_entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+    size_t m_bytes = 0;
+    bool m_dirty = false;
+    DecodeCacheStats m_stats;
+};
+
+} // namespace qrcore
@@ -0,0 +1,96 @@
+/*
+ * 解码工作线程
+ */
+
+#include "DecodeWorker.h"
+#include "Trace.h"
+
+namespace qrcore {
+
+DecodeWorker::~DecodeWorker() {
+    Stop();
+}
+
+void DecodeWorker::Start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_thread = std::thread(&DecodeWorker::Run, this);
+}
+
+void DecodeWorker::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+        m_queue.clear();
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool DecodeWorker::Submit(DecodeJob job, DecodeCallback onDone) {
+    if (!job.cascade && !job.tiles) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return false;
+        }
+        m_queue.push_back(Task{std::move(job), std::move(onDone), IsTraceEnabled() ? TraceNow() : 0});
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+size_t DecodeWorker::PendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.size();
+}
+
+void DecodeWorker::Run() {
+    SetTraceThreadName("decode");
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return !m_running || !m_queue.empty(); });
+            if (!m_running) {
+                return;
+            }
+            task = std::move(m_queue.front());
+            m_queue.erase(m_queue.begin());
+        }
+
+        if (task.submitNs != 0) {
+            TraceRecord(TracePhase::Complete, "decode_queue_wait", task.submitNs, TraceNow() - task.submitNs,
+                        task.job.traceId);
+        }
+
+        auto result = std::make_unique<ScanResult>();
+        {
+            QRCORE_TRACE_SCOPE("decode_job", task.job.traceId);
+            if (task.job.tiles) {
+                ScanTiles(task.job.frame, *task.job.tiles, *result);
+            } else {
+                RunCascade(task.job.frame, *task.job.cascade, *result);
+            }
+        }
+
+        // 释放像素内存后再回调, 大选区时可尽早归还内存
+        task.job.frame = ImageFrame();
+        if (task.onDone) {
+            QRCORE_TRACE_SCOPE("decode_callback", task.job.traceId);
+            task.onDone(std::move(result));
+        }
+    }
+}
+
+} // namespace qrcore
@@ -0,0 +1,70 @@
+/*
+ * 解码工作线程
+ *
+ * 持有 ZXing 调用, 使识别不在托盘窗口的消息线程上执行。
+ * 截图线程提交 (图像帧 + 识别级联), 识别完成后通过回调交回结果对象,
+ * 回调运行在工作线程上, Win32 外壳在其中 PostMessage 回 UI 线程。
+ *
+ * 识别配置以只读共享指针传入, 各次提交共用一份, 不复制层级列表; 队列容量用过即保留,
+ * 回调只捕获一两个指针时 std::function 不分配。稳定状态下一次提交只分配交给回调的结果对象,
+ * 其余堆分配都在 ZXing 识别内部。
+ */
+
+#pragma once
+
+#include "TileScanner.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qrcore {
+
+struct DecodeJob {
+    ImageFrame frame;
+    std::shared_ptr<const CascadeConfig> cascade; // 识别级联 (多次提交共用, 不复制)
+    std::shared_ptr<const TileScanConfig> tiles;  // 非空时整屏分块并行识别 (使用其中的 cascade), 忽略上面的 cascade
+    uint64_t traceId = 0;   // 跟踪事件关联的扫描序号 (见 Trace.h)
+};
+
+using DecodeCallback = std::function<void(std::unique_ptr<ScanResult>)>;
+
+class DecodeWorker {
+public:
+    DecodeWorker() = default;
+    ~DecodeWorker();
+
+    DecodeWorker(const DecodeWorker&) = delete;
+    DecodeWorker& operator=(const DecodeWorker&) = delete;
+
+    void Start();
+    // 停止线程; 尚未开始的任务被丢弃 (不会调用其回调)
+    void Stop();
+
+    // 提交任务; 线程未启动、正在停止或任务未给出识别配置 (cascade 与 tiles 均为空) 时返回 false
+    bool Submit(DecodeJob job, DecodeCallback onDone);
+
+    // 排队中 (尚未开始) 的任务数
+    size_t PendingCount() const;
+
+private:
+    void Run();
+
+    struct Task {
+        DecodeJob job;
+        DecodeCallback onDone;
+        uint64_t submitNs = 0; // 提交时刻 (TraceNow), 用于记录排队等待
+    };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    // 先进先出; 队列通常只有 0~1 个任务, 用 vector 以便容量保留下来, 出队时不释放、入队时不分配
+    std::vector<Task> m_queue;
+    std::thread m_thread;
+    bool m_running = false;
+};
+
+} // namespace qrcore
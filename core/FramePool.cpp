@@ -0,0 +1,176 @@
+/*
+ * 可复用的帧缓冲池
+ */
+
+#include "FramePool.h"
+
+#include <atomic>
+#include <new>
+
+namespace qrcore {
+
+namespace {
+
+const size_t kRowAlign = 64;
+
+class HeapAllocator : public IFrameAllocator {
+public:
+    bool Allocate(int width, int height, PixelFormat format, FrameBuffer& outBuffer) override {
+        size_t stride = ((size_t)width * BytesPerPixel(format) + kRowAlign - 1) / kRowAlign * kRowAlign;
+        void* data = ::operator new(stride * height, std::align_val_t(kRowAlign), std::nothrow);
+        if (!data) {
+            return false;
+        }
+        outBuffer.data = (uint8_t*)data;
+        outBuffer.width = width;
+        outBuffer.height = height;
+        outBuffer.stride = (int)stride;
+        outBuffer.format = format;
+        return true;
+    }
+
+    void Free(FrameBuffer& buffer) override {
+        ::operator delete(buffer.data, std::align_val_t(kRowAlign));
+        buffer.data = nullptr;
+    }
+};
+
+} // namespace
+
+IFrameAllocator& HeapFrameAllocator() {
+    // 不析构: 池中取出的帧可能在静态对象析构之后才释放
+    static HeapAllocator* allocator = new HeapAllocator();
+    return *allocator;
+}
+
+// 缓冲区由池和取出的帧共同持有; 只剩池持有 (use_count 为 1) 时即为空闲
+struct FramePool::Slot {
+    FrameBuffer buffer;
+    IFrameAllocator* allocator = nullptr;
+    size_t bytes = 0;
+    uint64_t lastUsed = 0;
+
+    ~Slot() {
+        if (buffer.data) {
+            allocator->Free(buffer);
+        }
+    }
+};
+
+FramePool::FramePool(IFrameAllocator& allocator, const FramePoolConfig& config)
+    : m_allocator(allocator), m_config(config) {
+    m_slots.reserve(32); // 稳定状态下不再扩容
+}
+
+FramePool::~FramePool() {
+    // 使用中的缓冲区由取出的帧继续持有, 最后一个帧释放时销毁
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_slots.clear();
+}
+
+size_t FramePool::EvictIdle(size_t maxIdleBytes) {
+    size_t idleBytes = 0;
+    for (const auto& slot : m_slots) {
+        idleBytes += slot.use_count() == 1 ? slot->bytes : 0;
+    }
+    while (idleBytes > maxIdleBytes) {
+        size_t oldest = m_slots.size();
+        for (size_t i = 0; i < m_slots.size(); i++) {
+            if (m_slots[i].use_count() == 1 && (oldest == m_slots.size() || m_slots[i]->lastUsed < m_slots[oldest]->lastUsed)) {
+                oldest = i;
+            }
+        }
+        if (oldest == m_slots.size()) {
+            break;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire); // 与最后一个帧释放时的引用计数递减配对
+        idleBytes -= m_slots[oldest]->bytes;
+        m_slots.erase(m_slots.begin() + oldest);
+        m_stats.evicted++;
+    }
+    return idleBytes;
+}
+
+ImageFrame FramePool::Acquire(int width, int height, PixelFormat format, void** outHandle) {
+    if (width <= 0 || height <= 0) {
+        return ImageFrame();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.acquired++;
+    EvictIdle(m_config.maxIdleBytes);
+
+    // 取能容纳请求、面积最小的空闲缓冲区
+    double area = (double)width * height;
+    Slot* best = nullptr;
+    std::shared_ptr<Slot>* bestRef = nullptr;
+    for (auto& slot : m_slots) {
+        const FrameBuffer& buffer = slot->buffer;
+        if (slot.use_count() != 1 || buffer.format != format || buffer.width < width || buffer.height < height ||
+            (double)buffer.width * buffer.height > area * m_config.maxWaste) {
+            continue;
+        }
+        if (!best || (double)buffer.width * buffer.height < (double)best->buffer.width * best->buffer.height) {
+            best = slot.get();
+            bestRef = &slot;
+        }
+    }
+
+    if (best) {
+        std::atomic_thread_fence(std::memory_order_acquire); // 上一个使用者的读写先于这里的复用
+        m_stats.reused++;
+    } else {
+        int granularity = m_config.granularity > 0 ? m_config.granularity : 1;
+        int capacityWidth = (width + granularity - 1) / granularity * granularity;
+        int capacityHeight = (height + granularity - 1) / granularity * granularity;
+        auto slot = std::make_shared<Slot>();
+        if (!m_allocator.Allocate(capacityWidth, capacityHeight, format, slot->buffer)) {
+            return ImageFrame();
+        }
+        slot->allocator = &m_allocator;
+        slot->bytes = (size_t)slot->buffer.stride * slot->buffer.height;
+        m_slots.push_back(std::move(slot));
+        bestRef = &m_slots.back();
+        best = bestRef->get();
+        m_stats.allocated++;
+    }
+
+    best->lastUsed = ++m_tick;
+    if (outHandle) {
+        *outHandle = best->buffer.handle;
+    }
+    // 别名构造: 与池共用 Slot 的引用计数, 不另外分配控制块
+    std::shared_ptr<void> owner(*bestRef, best->buffer.data);
+    return WrapFrame(best->buffer.data, width, height, best->buffer.stride, format, std::move(owner));
+}
+
+void FramePool::Trim() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    EvictIdle(0);
+}
+
+void FramePool::Configure(const FramePoolConfig& config) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = config;
+}
+
+FramePoolStats FramePool::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FramePoolStats stats = m_stats;
+    stats.buffers = m_slots.size();
+    stats.idleBytes = 0;
+    for (const auto& slot : m_slots) {
+        stats.idleBytes += slot.use_count() == 1 ? slot->bytes : 0;
+    }
+    return stats;
+}
+
+FramePool& DefaultFramePool() {
+    static FramePool* pool = new FramePool();
+    return *pool;
+}
+
+ImageFrame AcquireFrame(int width, int height, PixelFormat format) {
+    return DefaultFramePool().Acquire(width, height, format);
+}
+
+} // namespace qrcore
@@ -0,0 +1,105 @@
+/*
+ * 可复用的帧缓冲池
+ *
+ * 截图、灰度转换、金字塔和预处理每次扫码都要申请数 MB 到数十 MB 的像素内存,
+ * 用完立即释放; 连续扫码时每秒重复多次。池按尺寸保留用完的缓冲区,
+ * 尺寸相同或略小的请求直接取用, 稳定状态下截图到识别之间不再申请堆内存。
+ *
+ * 取出的帧与普通帧一样以 owner 持有缓冲区, 帧的最后一个副本释放时缓冲区回到池中
+ * (只是引用计数归一, 不加锁、不分配)。缓冲区的行字节数按 64 字节对齐,
+ * 可能大于 width 个像素所需 (取用了较大的缓冲区时), 使用方须按 stride 访问。
+ */
+
+#pragma once
+
+#include "ImageFrame.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace qrcore {
+
+// 分配器给出的一块像素内存
+struct FrameBuffer {
+    uint8_t* data = nullptr;
+    int width = 0;  // 容量 (像素)
+    int height = 0;
+    int stride = 0; // 行字节数
+    PixelFormat format = PixelFormat::BGRX;
+    void* handle = nullptr; // 分配器附带的平台对象 (如 DIB 节的 HBITMAP)
+};
+
+// 缓冲区的来源 (堆内存、DIB 节等); 须比池和池中取出的所有帧活得更久
+class IFrameAllocator {
+public:
+    virtual ~IFrameAllocator() = default;
+
+    // 分配至少 width x height 像素的缓冲区, 失败返回 false
+    virtual bool Allocate(int width, int height, PixelFormat format, FrameBuffer& outBuffer) = 0;
+    virtual void Free(FrameBuffer& buffer) = 0;
+};
+
+// 堆内存 (64 字节对齐, 行字节数取 64 的倍数)
+IFrameAllocator& HeapFrameAllocator();
+
+struct FramePoolConfig {
+    size_t maxIdleBytes = (size_t)64 << 20; // 保留的空闲缓冲区总量上限, 0 为不复用
+    int granularity = 32;   // 新缓冲区的宽高向上取整到此像素数的倍数, 尺寸略有变化的请求可以复用
+    double maxWaste = 2.0;  // 取用的缓冲区面积不超过请求面积的倍数
+};
+
+struct FramePoolStats {
+    uint64_t acquired = 0;  // 取用次数
+    uint64_t reused = 0;    // 其中复用空闲缓冲区的次数
+    uint64_t allocated = 0; // 新分配的缓冲区数
+    uint64_t evicted = 0;   // 因超出空闲上限而释放的缓冲区数
+    size_t buffers = 0;     // 当前缓冲区数 (含使用中的)
+    size_t idleBytes = 0;   // 当前空闲缓冲区的总字节数
+};
+
+class FramePool {
+public:
+    explicit FramePool(IFrameAllocator& allocator = HeapFrameAllocator(), const FramePoolConfig& config = FramePoolConfig());
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    /**
+     * @brief 取一块至少 width x height 的缓冲区, 返回描述其左上角 width x height 的帧
+     *
+     * 像素内容未初始化 (可能是上一次使用留下的)。
+     * 超出空闲上限的缓冲区在这里按最久未用先释放。分配失败时返回空帧。
+     * @param outHandle 非空时返回缓冲区的平台对象 (FrameBuffer::handle)
+     */
+    ImageFrame Acquire(int width, int height, PixelFormat format, void** outHandle = nullptr);
+
+    // 释放全部空闲缓冲区 (使用中的在帧释放后由引用计数销毁)
+    void Trim();
+
+    void Configure(const FramePoolConfig& config);
+    FramePoolStats GetStats() const;
+
+private:
+    struct Slot;
+
+    size_t EvictIdle(size_t maxIdleBytes); // 返回剩余的空闲字节数; 需持锁
+
+    IFrameAllocator& m_allocator;
+    FramePoolConfig m_config;
+    mutable std::mutex m_mutex;
+    std::vector<std::shared_ptr<Slot>> m_slots;
+    uint64_t m_tick = 0;
+    FramePoolStats m_stats;
+};
+
+// 识别流水线 (灰度、缩小层级、预处理) 共用的池
+FramePool& DefaultFramePool();
+
+// 从 DefaultFramePool 取一个帧
+ImageFrame AcquireFrame(int width, int height, PixelFormat format);
+
+} // namespace qrcore
@@ -0,0 +1,80 @@
+/*
+ * 识别前的图像预处理
+ */
+
+#include "ImageFilters.h"
+#include "FramePool.h"
+
+#include <cmath>
+
+namespace qrcore {
+
+ImageFrame ToLuminance(const ImageFrame& src) {
+    if (src.format == PixelFormat::Lum || src.empty()) {
+        return src;
+    }
+
+    ImageFrame dst;
+    ConvertToLum(src, 0, 0, src.width, src.height, dst);
+    return dst;
+}
+
+// 以查找表映射每个灰度像素
+static ImageFrame ApplyLut(const ImageFrame& lum, const uint8_t lut[256]) {
+    ImageFrame dst = AcquireFrame(lum.width, lum.height, PixelFormat::Lum);
+    if (dst.empty()) {
+        return lum;
+    }
+    for (int y = 0; y < lum.height; y++) {
+        const uint8_t* s = lum.row(y);
+        uint8_t* d = dst.row(y);
+        for (int x = 0; x < lum.width; x++) {
+            d[x] = lut[s[x]];
+        }
+    }
+    return dst;
+}
+
+ImageFrame StretchContrast(const ImageFrame& lum, double lowPercent) {
+    if (lum.empty() || lum.format != PixelFormat::Lum) {
+        return ImageFrame();
+    }
+
+    size_t histogram[256] = {0};
+    for (int y = 0; y < lum.height; y++) {
+        const uint8_t* s = lum.row(y);
+        for (int x = 0; x < lum.width; x++) {
+            histogram[s[x]]++;
+        }
+    }
+
+    size_t total = (size_t)lum.width * lum.height;
+    size_t clip = (size_t)(total * lowPercent / 100.0);
+    int lo = 0, hi = 255;
+    for (size_t acc = 0; lo < 255 && (acc += histogram[lo]) <= clip; lo++) {}
+    for (size_t acc = 0; hi > 0 && (acc += histogram[hi]) <= clip; hi--) {}
+    if (hi <= lo) {
+        return lum; // 单一灰度, 无可拉伸
+    }
+
+    uint8_t lut[256];
+    for (int v = 0; v < 256; v++) {
+        int mapped = (v - lo) * 255 / (hi - lo);
+        lut[v] = (uint8_t)(mapped < 0 ? 0 : (mapped > 255 ? 255 : mapped));
+    }
+    return ApplyLut(lum, lut);
+}
+
+ImageFrame AdjustBrightness(const ImageFrame& lum, double gamma) {
+    if (lum.empty() || lum.format != PixelFormat::Lum) {
+        return ImageFrame();
+    }
+
+    uint8_t lut[256];
+    for (int v = 0; v < 256; v++) {
+        lut[v] = (uint8_t)std::lround(255.0 * std::pow(v / 255.0, gamma));
+    }
+    return ApplyLut(lum, lut);
+}
+
+} // namespace qrcore
@@ -0,0 +1,27 @@
+/*
+ * 识别前的图像预处理 (灰度化、对比度增强、亮度增强)
+ *
+ * 所有滤镜输出 8 位灰度 (PixelFormat::Lum) 帧, 像素内存取自 DefaultFramePool;
+ * 输入已是灰度时 ToLuminance 直接返回原帧而不复制。
+ */
+
+#pragma once
+
+#include "PixelConvert.h"
+
+namespace qrcore {
+
+// 灰度化 (使用 PixelConvert 中按 CPU 选择的 SIMD 内核)
+ImageFrame ToLuminance(const ImageFrame& src);
+
+/**
+ * @brief 对比度拉伸: 把 [lowPercent, 100 - lowPercent] 分位区间线性映射到 [0, 255]
+ */
+ImageFrame StretchContrast(const ImageFrame& lum, double lowPercent = 1.0);
+
+/**
+ * @brief 亮度增强: 灰度 gamma 校正 (gamma < 1 提亮暗部)
+ */
+ImageFrame AdjustBrightness(const ImageFrame& lum, double gamma = 0.6);
+
+} // namespace qrcore
@@ -0,0 +1,72 @@
+/*
+ * 平台无关的图像帧定义
+ */
+
+#include "ImageFrame.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace qrcore {
+
+int BytesPerPixel(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::Lum: return 1;
+        case PixelFormat::RGB: return 3;
+        case PixelFormat::BGR: return 3;
+        case PixelFormat::BGRX: return 4;
+    }
+    return 0;
+}
+
+ImageFrame AllocateFrame(int width, int height, PixelFormat format, int rowAlign) {
+    if (width <= 0 || height <= 0) {
+        return ImageFrame();
+    }
+    if (rowAlign <= 0) {
+        rowAlign = 1;
+    }
+    int stride = (width * BytesPerPixel(format) + rowAlign - 1) / rowAlign * rowAlign;
+
+    auto buffer = std::make_shared<std::vector<uint8_t>>((size_t)stride * height);
+    return WrapFrame(buffer->data(), width, height, stride, format, buffer);
+}
+
+ImageFrame WrapFrame(uint8_t* data, int width, int height, int stride, PixelFormat format,
+                     std::shared_ptr<void> owner) {
+    ImageFrame frame;
+    frame.data = data;
+    frame.width = width;
+    frame.height = height;
+    frame.stride = stride;
+    frame.format = format;
+    frame.owner = std::move(owner);
+    return frame;
+}
+
+ImageFrame CropFrame(const ImageFrame& frame, int left, int top, int width, int height) {
+    int right = std::min(left + width, frame.width);
+    int bottom = std::min(top + height, frame.height);
+    left = std::max(left, 0);
+    top = std::max(top, 0);
+    if (frame.empty() || right <= left || bottom <= top) {
+        return ImageFrame();
+    }
+
+    uint8_t* data = frame.row(top) + (ptrdiff_t)left * BytesPerPixel(frame.format);
+    return WrapFrame(data, right - left, bottom - top, frame.stride, frame.format, frame.owner);
+}
+
+bool ValidateFrame(const ImageFrame& frame, std::string& outErrorMsg) {
+    if (frame.width <= 0 || frame.height <= 0) {
+        outErrorMsg = "位图尺寸无效";
+        return false;
+    }
+    if (!frame.data || frame.stride < frame.width * BytesPerPixel(frame.format)) {
+        outErrorMsg = "图像数据不完整";
+        return false;
+    }
+    return true;
+}
+
+} // namespace qrcore
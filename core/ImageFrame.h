@@ -0,0 +1,72 @@
+/*
+ * 平台无关的图像帧定义
+ *
+ * 识别核心只依赖这里的像素描述，不接触任何 Win32 对象，
+ * 因此可以在 Linux 上无界面构建和测试。
+ *
+ * ImageFrame 只描述像素内存 (指针 + 行字节数), 内存本身由 owner 持有:
+ * 可以是核心自己分配的缓冲区, 也可以是截图得到的 DIB 节。
+ * 帧在线程间传递时只复制描述和引用计数, 不复制像素。
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace qrcore {
+
+// 像素格式 (与 ZXing::ImageFormat 中用到的子集一一对应)
+enum class PixelFormat {
+    Lum,  // 8 位灰度
+    RGB,  // 24 位, 字节序 R G B
+    BGR,  // 24 位, 字节序 B G R
+    BGRX, // 32 位, 字节序 B G R X (GDI 32 位 DIB 的内存布局)
+};
+
+// 每个像素占用的字节数
+int BytesPerPixel(PixelFormat format);
+
+// 图像帧 (自上而下的行顺序)
+struct ImageFrame {
+    uint8_t* data = nullptr;       // 第 0 行首像素
+    int width = 0;
+    int height = 0;
+    int stride = 0;                // 行字节数 (可能包含对齐填充)
+    PixelFormat format = PixelFormat::BGRX;
+    std::shared_ptr<void> owner;   // 持有像素内存; 为空表示借用调用方的内存
+
+    bool empty() const { return data == nullptr || width <= 0 || height <= 0; }
+    uint8_t* row(int y) const { return data + (ptrdiff_t)y * stride; }
+    size_t byteSize() const { return (size_t)stride * height; }
+};
+
+/**
+ * @brief 分配一块新的像素内存并返回描述它的帧
+ * @param rowAlign 行字节数对齐 (字节), 默认与 DIB 一致按 4 字节对齐
+ */
+ImageFrame AllocateFrame(int width, int height, PixelFormat format, int rowAlign = 4);
+
+/**
+ * @brief 包装外部像素内存, 不复制
+ * @param owner 外部内存的持有者; 帧的所有副本释放后才会释放 owner
+ */
+ImageFrame WrapFrame(uint8_t* data, int width, int height, int stride, PixelFormat format,
+                     std::shared_ptr<void> owner = nullptr);
+
+/**
+ * @brief 截取帧的矩形区域, 不复制像素
+ *
+ * 返回的帧以行偏移指向原帧内存, 共享同一个 owner;
+ * 区域会裁剪到原帧范围内, 裁剪后为空时返回空帧。
+ */
+ImageFrame CropFrame(const ImageFrame& frame, int left, int top, int width, int height);
+
+/**
+ * @brief 检查帧描述是否自洽 (尺寸为正, 行字节数足够容纳一行像素)
+ */
+bool ValidateFrame(const ImageFrame& frame, std::string& outErrorMsg);
+
+} // namespace qrcore
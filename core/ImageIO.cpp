@@ -0,0 +1,187 @@
+/*
+ * 图像文件读写 (供无界面工具使用)
+ */
+
+#include "ImageIO.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef QRCORE_HAVE_STB_IMAGE
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_HDR
+#define STBI_NO_LINEAR
+#include <stb_image.h>
+#endif
+
+namespace qrcore {
+
+// 读取 PNM 头部的下一个整数 (跳过空白和 # 注释)
+static bool ReadPnmInt(const std::vector<uint8_t>& data, size_t& pos, int& outValue) {
+    while (pos < data.size()) {
+        if (data[pos] == '#') {
+            while (pos < data.size() && data[pos] != '\n') pos++;
+        } else if (std::isspace(data[pos])) {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    if (pos >= data.size() || !std::isdigit(data[pos])) {
+        return false;
+    }
+    outValue = 0;
+    while (pos < data.size() && std::isdigit(data[pos])) {
+        outValue = outValue * 10 + (data[pos++] - '0');
+        if (outValue > 1 << 20) return false;
+    }
+    return true;
+}
+
+static bool LoadPnm(const std::vector<uint8_t>& data, ImageFrame& outFrame, std::string& outErrorMsg) {
+    bool gray = data[1] == '5';
+    size_t pos = 2;
+    int width = 0, height = 0, maxValue = 0;
+    if (!ReadPnmInt(data, pos, width) || !ReadPnmInt(data, pos, height) || !ReadPnmInt(data, pos, maxValue) ||
+        width <= 0 || height <= 0 || maxValue != 255) {
+        outErrorMsg = "不支持的 PNM 头部 (仅支持 8 位 P5/P6)";
+        return false;
+    }
+    pos++; // 头部后的单个空白
+
+    ImageFrame frame = AllocateFrame(width, height, gray ? PixelFormat::Lum : PixelFormat::RGB, 1);
+    size_t rowBytes = (size_t)width * BytesPerPixel(frame.format);
+    if (data.size() < pos + rowBytes * height) {
+        outErrorMsg = "PNM 像素数据不完整";
+        return false;
+    }
+    for (int y = 0; y < height; y++) {
+        memcpy(frame.row(y), &data[pos + rowBytes * y], rowBytes);
+    }
+    outFrame = frame;
+    return true;
+}
+
+bool LoadImageFile(const std::string& path, ImageFrame& outFrame, std::string& outErrorMsg) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        outErrorMsg = "无法打开文件: " + path;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (data.size() > 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6')) {
+        return LoadPnm(data, outFrame, outErrorMsg);
+    }
+
+#ifdef QRCORE_HAVE_STB_IMAGE
+    int width = 0, height = 0, channels = 0;
+    if (data.size() > (size_t)INT32_MAX) {
+        outErrorMsg = "文件过大: " + path;
+        return false;
+    }
+    stbi_uc* pixels = stbi_load_from_memory(data.data(), (int)data.size(), &width, &height, &channels, 0);
+    if (!pixels) {
+        outErrorMsg = std::string("无法解码图像: ") + stbi_failure_reason();
+        return false;
+    }
+
+    // 灰度图保持单通道, 其余统一为 RGB
+    ImageFrame frame = AllocateFrame(width, height, channels <= 2 ? PixelFormat::Lum : PixelFormat::RGB, 1);
+    int dstBpp = BytesPerPixel(frame.format);
+    for (int y = 0; y < height; y++) {
+        const stbi_uc* s = pixels + (size_t)y * width * channels;
+        uint8_t* d = frame.row(y);
+        for (int x = 0; x < width; x++, s += channels, d += dstBpp) {
+            for (int c = 0; c < dstBpp; c++) {
+                d[c] = s[c];
+            }
+        }
+    }
+    stbi_image_free(pixels);
+    outFrame = frame;
+    return true;
+#else
+    outErrorMsg = "不支持的图像格式 (构建时未找到 stb_image, 仅支持 PGM/PPM): " + path;
+    return false;
+#endif
+}
+
+bool ReadImageInfo(const std::string& path, int& outWidth, int& outHeight, int& outBytesPerPixel,
+                   std::string& outErrorMsg) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        outErrorMsg = "无法打开文件: " + path;
+        return false;
+    }
+    // PNM 头部 (含注释) 不会超过几百字节
+    std::vector<uint8_t> head(512);
+    file.read((char*)head.data(), head.size());
+    head.resize((size_t)file.gcount());
+
+    if (head.size() > 2 && head[0] == 'P' && (head[1] == '5' || head[1] == '6')) {
+        size_t pos = 2;
+        int maxValue = 0;
+        if (!ReadPnmInt(head, pos, outWidth) || !ReadPnmInt(head, pos, outHeight) ||
+            !ReadPnmInt(head, pos, maxValue) || outWidth <= 0 || outHeight <= 0) {
+            outErrorMsg = "不支持的 PNM 头部 (仅支持 8 位 P5/P6)";
+            return false;
+        }
+        outBytesPerPixel = head[1] == '5' ? 1 : 3;
+        return true;
+    }
+
+#ifdef QRCORE_HAVE_STB_IMAGE
+    int channels = 0;
+    if (!stbi_info(path.c_str(), &outWidth, &outHeight, &channels)) {
+        outErrorMsg = std::string("无法解码图像: ") + stbi_failure_reason();
+        return false;
+    }
+    outBytesPerPixel = channels <= 2 ? 1 : 3;
+    return true;
+#else
+    outErrorMsg = "不支持的图像格式 (构建时未找到 stb_image, 仅支持 PGM/PPM): " + path;
+    return false;
+#endif
+}
+
+bool HaveStbImage() {
+#ifdef QRCORE_HAVE_STB_IMAGE
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SavePnmFile(const std::string& path, const ImageFrame& frame, std::string& outErrorMsg) {
+    if (!ValidateFrame(frame, outErrorMsg)) {
+        return false;
+    }
+    if (frame.format != PixelFormat::Lum && frame.format != PixelFormat::RGB) {
+        outErrorMsg = "PNM 仅支持灰度或 RGB 帧";
+        return false;
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        outErrorMsg = "无法创建文件: " + path;
+        return false;
+    }
+    bool gray = frame.format == PixelFormat::Lum;
+    fprintf(file, "%s\n%d %d\n255\n", gray ? "P5" : "P6", frame.width, frame.height);
+    size_t rowBytes = (size_t)frame.width * BytesPerPixel(frame.format);
+    for (int y = 0; y < frame.height; y++) {
+        fwrite(frame.row(y), 1, rowBytes, file);
+    }
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    if (!ok) {
+        outErrorMsg = "写入文件失败: " + path;
+    }
+    return ok;
+}
+
+} // namespace qrcore
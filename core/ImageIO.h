@@ -0,0 +1,39 @@
+/*
+ * 图像文件读写 (供无界面工具使用)
+ *
+ * 始终支持 PGM/PPM (P5/P6); 构建时找到 stb_image 时
+ * 另支持 PNG、JPEG、BMP 等常见格式。
+ */
+
+#pragma once
+
+#include "ImageFrame.h"
+
+#include <string>
+
+namespace qrcore {
+
+/**
+ * @brief 读取图像文件为 8 位灰度或 24 位 RGB 帧
+ */
+bool LoadImageFile(const std::string& path, ImageFrame& outFrame, std::string& outErrorMsg);
+
+/**
+ * @brief 只读取图像头部, 得到 LoadImageFile 将返回的帧尺寸和每像素字节数
+ *
+ * 用于批量识别时在解码像素之前估算内存占用。
+ */
+bool ReadImageInfo(const std::string& path, int& outWidth, int& outHeight, int& outBytesPerPixel,
+                   std::string& outErrorMsg);
+
+/**
+ * @brief 构建时是否找到了 stb_image (LoadImageFile 是否支持 PNG/JPEG 等格式)
+ */
+bool HaveStbImage();
+
+/**
+ * @brief 将帧写为 PGM (灰度) 或 PPM (彩色), 用于调试输出
+ */
+bool SavePnmFile(const std::string& path, const ImageFrame& frame, std::string& outErrorMsg);
+
+} // namespace qrcore
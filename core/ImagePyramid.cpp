@@ -0,0 +1,70 @@
+/*
+ * 灰度图像金字塔
+ */
+
+#include "ImagePyramid.h"
+#include "FramePool.h"
+
+#include <algorithm>
+
+namespace qrcore {
+
+ImageFrame Downsample2x(const ImageFrame& lum) {
+    if (lum.empty() || lum.format != PixelFormat::Lum) {
+        return ImageFrame();
+    }
+
+    int width = lum.width / 2;
+    int height = lum.height / 2;
+    if (width <= 0 || height <= 0) {
+        return ImageFrame();
+    }
+
+    ImageFrame dst = AcquireFrame(width, height, PixelFormat::Lum);
+    if (dst.empty()) {
+        return ImageFrame();
+    }
+    for (int y = 0; y < height; y++) {
+        const uint8_t* s0 = lum.row(2 * y);
+        const uint8_t* s1 = lum.row(2 * y + 1);
+        uint8_t* d = dst.row(y);
+        // 简单的定长循环, 编译器可自动向量化
+        for (int x = 0; x < width; x++) {
+            int sum = s0[2 * x] + s0[2 * x + 1] + s1[2 * x] + s1[2 * x + 1];
+            d[x] = (uint8_t)((sum + 2) >> 2);
+        }
+    }
+    return dst;
+}
+
+std::vector<PyramidLevel> BuildPyramid(const ImageFrame& lum, const PyramidConfig& config) {
+    std::vector<PyramidLevel> levels;
+    BuildPyramid(lum, config, levels);
+    return levels;
+}
+
+void BuildPyramid(const ImageFrame& lum, const PyramidConfig& config, std::vector<PyramidLevel>& outLevels) {
+    outLevels.clear();
+    if (lum.empty() || lum.format != PixelFormat::Lum) {
+        return;
+    }
+
+    ImageFrame current = lum;
+    int scale = 1;
+    for (int i = 0; i < config.maxLevels; i++) {
+        if (std::min(current.width, current.height) / 2 < config.minSide) {
+            break;
+        }
+        current = Downsample2x(current);
+        if (current.empty()) {
+            break;
+        }
+        scale *= 2;
+        outLevels.push_back({current, scale});
+    }
+
+    // 从粗到细: 最小的层级最先尝试
+    std::reverse(outLevels.begin(), outLevels.end());
+}
+
+} // namespace qrcore
@@ -0,0 +1,44 @@
+/*
+ * 灰度图像金字塔
+ *
+ * 高 DPI 屏幕上框选的大区域里, 二维码模块往往有 6~10 像素宽,
+ * 缩小 2 倍、4 倍后仍然可以识别, 而 ZXing 的耗时大致与像素数成正比。
+ * 因此大图先在缩小的层级上快速识别, 失败后再回到原始分辨率。
+ */
+
+#pragma once
+
+#include "ImageFrame.h"
+
+#include <vector>
+
+namespace qrcore {
+
+struct PyramidConfig {
+    int maxLevels = 2;  // 最多缩小几级 (每级 2 倍); 0 表示不使用金字塔
+    int minSide = 512;  // 缩小后的短边不得小于此值 (像素)
+};
+
+struct PyramidLevel {
+    ImageFrame frame; // 该层灰度帧
+    int scale = 1;    // 相对原图的缩小倍数 (1, 2, 4, ...)
+};
+
+/**
+ * @brief 2x2 盒式滤波缩小一半 (四舍五入取平均)
+ *
+ * 输入必须是灰度帧; 奇数宽高时丢弃最后一列/行。输出取自 DefaultFramePool。
+ */
+ImageFrame Downsample2x(const ImageFrame& lum);
+
+/**
+ * @brief 构造缩小层级, 按从粗到细排列 (不含原图)
+ *
+ * 原图过小或 config.maxLevels <= 0 时返回空列表。
+ */
+std::vector<PyramidLevel> BuildPyramid(const ImageFrame& lum, const PyramidConfig& config);
+
+// 同上, 写入调用方复用的列表 (先清空; 列表容量足够时不分配内存)
+void BuildPyramid(const ImageFrame& lum, const PyramidConfig& config, std::vector<PyramidLevel>& outLevels);
+
+} // namespace qrcore
@@ -0,0 +1,260 @@
+/*
+ * 固定区域的连续扫码
+ */
+
+#include "LiveScanner.h"
+
+#include <algorithm>
+
+namespace qrcore {
+
+using Clock = std::chrono::steady_clock;
+
+LiveScanner::Region LiveScanner::Union(const Region& a, const Region& b) {
+    if (a.width <= 0 || a.height <= 0) {
+        return b;
+    }
+    if (b.width <= 0 || b.height <= 0) {
+        return a;
+    }
+    Region r;
+    r.left = std::min(a.left, b.left);
+    r.top = std::min(a.top, b.top);
+    r.width = std::max(a.left + a.width, b.left + b.width) - r.left;
+    r.height = std::max(a.top + a.height, b.top + b.height) - r.top;
+    return r;
+}
+
+LiveScanner::~LiveScanner() {
+    Stop();
+}
+
+bool LiveScanner::Start(const LiveScanConfig& config, LiveScanCallback onEvent) {
+    std::lock_guard<std::mutex> control(m_controlMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) {
+            return false;
+        }
+        m_running = true;
+        m_config = config;
+        m_config.minIntervalMs = std::max(1, m_config.minIntervalMs);
+        m_config.maxIntervalMs = std::max(m_config.minIntervalMs, m_config.maxIntervalMs);
+        m_config.backoff = std::max(1.0, m_config.backoff);
+        m_onEvent = std::move(onEvent);
+        m_slotFrame = ImageFrame();
+        m_slotFull = false;
+        m_missedRegion = Region();
+        m_stats = LiveScanStats();
+        m_stats.intervalMs = m_config.minIntervalMs;
+    }
+    m_detector = ChangeDetector(config.tileSize);
+    m_recent.clear();
+    m_reported.clear();
+    m_decodeThread = std::thread(&LiveScanner::DecodeLoop, this);
+    m_captureThread = std::thread(&LiveScanner::CaptureLoop, this);
+    return true;
+}
+
+void LiveScanner::Stop() {
+    std::lock_guard<std::mutex> control(m_controlMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_captureCv.notify_all();
+    m_decodeCv.notify_all();
+    if (m_captureThread.joinable()) {
+        m_captureThread.join();
+    }
+    if (m_decodeThread.joinable()) {
+        m_decodeThread.join();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_slotFrame = ImageFrame();
+    m_slotFull = false;
+}
+
+bool LiveScanner::IsRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+LiveScanStats LiveScanner::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void LiveScanner::CaptureLoop() {
+    double intervalMs = m_config.minIntervalMs;
+
+    for (;;) {
+        auto capturedAt = Clock::now();
+        ImageFrame frame;
+        std::string errorMsg;
+        bool captured = m_source.Capture(frame, errorMsg) && ValidateFrame(frame, errorMsg);
+
+        ChangeResult change;
+        if (captured) {
+            change = m_detector.Update(frame);
+        }
+        bool changed = change.changed;
+        // 画面变化时立即恢复最短间隔; 不变 (或抓取失败) 时逐步放慢
+        intervalMs = changed ? m_config.minIntervalMs
+                             : std::min((double)m_config.maxIntervalMs, intervalMs * m_config.backoff);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        if (captured) {
+            m_stats.captured++;
+        } else {
+            m_stats.captureErrors++;
+        }
+        m_stats.intervalMs = (int)intervalMs;
+        if (changed) {
+            m_stats.changed++;
+            Region region;
+            region.left = change.left;
+            region.top = change.top;
+            region.width = change.width;
+            region.height = change.height;
+            if (m_slotFull) {
+                // 被覆盖的帧未识别, 它的变化也要在新帧中识别
+                m_stats.superseded++;
+                region = change.reset ? region : Union(m_slotRegion, region);
+            }
+            // 上次只识别变化区域而未找到码的区域 (可能是只重绘了一部分的码) 一并识别
+            if (!change.reset) {
+                region = Union(m_missedRegion, region);
+            }
+            m_missedRegion = Region();
+            m_slotFrame = std::move(frame);
+            m_slotRegion = region;
+            m_slotIndex = m_stats.captured;
+            m_slotCapturedAt = capturedAt;
+            m_slotFull = true;
+            m_decodeCv.notify_one();
+        } else if (captured && !m_slotFull && m_missedRegion.width > 0 && m_missedRegion.height > 0) {
+            // 画面已静止而未找到的码仍未识别: 整帧再识别一次 (同一画面只重试一次)
+            m_stats.retried++;
+            m_missedRegion = Region();
+            Region region;
+            region.width = frame.width;
+            region.height = frame.height;
+            m_slotFrame = std::move(frame);
+            m_slotRegion = region;
+            m_slotIndex = m_stats.captured;
+            m_slotCapturedAt = capturedAt;
+            m_slotFull = true;
+            m_decodeCv.notify_one();
+        }
+
+        // 间隔从本次抓取开始计算, 抓取本身的耗时不累加到间隔上
+        auto next = capturedAt + std::chrono::microseconds((int64_t)(intervalMs * 1000));
+        m_captureCv.wait_until(lock, next, [this] { return !m_running; });
+        if (!m_running) {
+            return;
+        }
+    }
+}
+
+void LiveScanner::DecodeLoop() {
+    for (;;) {
+        ImageFrame frame;
+        uint64_t frameIndex = 0;
+        Clock::time_point capturedAt;
+        Region region;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_decodeCv.wait(lock, [this] { return !m_running || m_slotFull; });
+            if (!m_running) {
+                return;
+            }
+            frame = std::move(m_slotFrame);
+            m_slotFrame = ImageFrame();
+            frameIndex = m_slotIndex;
+            capturedAt = m_slotCapturedAt;
+            region = m_slotRegion;
+            m_slotFull = false;
+        }
+
+        // 变化区域向外扩展后仍明显小于整帧时只识别该区域
+        int left = std::max(0, region.left - m_config.roiMargin);
+        int top = std::max(0, region.top - m_config.roiMargin);
+        int right = std::min(frame.width, region.left + region.width + m_config.roiMargin);
+        int bottom = std::min(frame.height, region.top + region.height + m_config.roiMargin);
+        bool roi = (double)(right - left) * (bottom - top) < m_config.roiMaxFraction * frame.width * frame.height;
+        ImageFrame target = roi ? CropFrame(frame, left, top, right - left, bottom - top) : frame;
+        frame = ImageFrame();
+
+        auto start = Clock::now();
+        ScanResult result;
+        if (!target.empty()) {
+            if (m_decode) {
+                m_decode(target, m_config.cascade, result);
+            } else {
+                RunCascade(target, m_config.cascade, result);
+            }
+        }
+        target = ImageFrame(); // 尽早归还像素内存
+        if (roi) {
+            for (DecodedSymbol& symbol : result.symbols) {
+                symbol.position = symbol.position.transformed(1.0, left, top);
+            }
+        }
+        double decodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.decoded++;
+            m_stats.roiDecoded += roi ? 1 : 0;
+            m_stats.lastDecodeMs = decodeMs;
+            if (!m_running) {
+                return;
+            }
+            if (roi && !result.success) {
+                // 码可能只有一部分在变化区域内: 槽中已有新帧时并入它的变化区域,
+                // 否则留给抓取线程 (画面继续变化时并入下一帧, 静止时识别整帧)
+                if (m_slotFull) {
+                    m_slotRegion = Union(m_slotRegion, region);
+                } else {
+                    m_missedRegion = Union(m_missedRegion, region);
+                }
+            }
+        }
+        if (result.success) {
+            Report(result, frameIndex, capturedAt);
+        }
+    }
+}
+
+void LiveScanner::Report(const ScanResult& result, uint64_t frameIndex, Clock::time_point capturedAt) {
+    for (const DecodedSymbol& symbol : result.symbols) {
+        if (symbol.text.empty() || m_reported.count(symbol.text)) {
+            continue;
+        }
+        m_reported.insert(symbol.text);
+        m_recent.push_back(symbol.text);
+        while (m_recent.size() > std::max<size_t>(1, m_config.rememberCount)) {
+            m_reported.erase(m_recent.front());
+            m_recent.pop_front();
+        }
+
+        auto event = std::make_unique<LiveScanEvent>();
+        event->symbol = symbol;
+        event->tier = result.tier;
+        event->frameIndex = frameIndex;
+        event->latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - capturedAt).count();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.emitted++;
+        }
+        if (m_onEvent) {
+            m_onEvent(std::move(event));
+        }
+    }
+}
+
+} // namespace qrcore
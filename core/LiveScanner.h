@@ -0,0 +1,154 @@
+/*
+ * 固定区域的连续扫码
+ *
+ * 用户框选一次区域后, 反复抓取并识别该区域 (视频会议中的二维码、监控看板等)。
+ * 两个线程通过一个 "待识别" 槽 (双缓冲) 衔接:
+ *   - 抓取线程按自适应间隔从 IFrameSource 取帧, 用 ChangeDetector 与上一帧逐块比较。
+ *     完全相同则不识别, 间隔按 backoff 倍增直到 maxIntervalMs; 有变化则立即回到
+ *     minIntervalMs, 并把该帧连同变化区域放入槽中。
+ *   - 识别线程取走槽中的帧运行识别级联。变化区域较小时只识别该区域 (向外扩展 roiMargin),
+ *     区域外的内容上次已经识别过。识别较慢时, 新帧直接覆盖槽中尚未开始的旧帧
+ *     (变化区域取两者的并集), 抓取从不等待识别, 识别总是处理最新的画面。
+ *     只识别变化区域却没有找到码时 (如大码只有一部分重绘), 该区域留待下次识别: 画面继续变化
+ *     则并入下一帧的变化区域, 画面静止则在下一次抓取时识别整帧。
+ * 每个新出现的内容只通过回调报告一次 (记住最近 rememberCount 个已报告的内容)。
+ *
+ * 帧来源是接口, Win32 外壳实现为屏幕区域截图, 基准测试用合成帧序列代替。
+ */
+
+#pragma once
+
+#include "ChangeDetector.h"
+#include "DecodeCascade.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+namespace qrcore {
+
+// 帧来源; Capture 只在抓取线程上调用
+class IFrameSource {
+public:
+    virtual ~IFrameSource() = default;
+
+    // 抓取一帧; 返回的帧可被识别线程继续持有, 来源不得复用其像素内存
+    virtual bool Capture(ImageFrame& outFrame, std::string& outErrorMsg) = 0;
+};
+
+struct LiveScanConfig {
+    CascadeConfig cascade;
+    int minIntervalMs = 100;    // 画面变化时的抓取间隔
+    int maxIntervalMs = 1000;   // 画面长时间不变时的抓取间隔上限
+    double backoff = 2.0;       // 画面不变时每次抓取后间隔的倍数
+    size_t rememberCount = 256; // 记住的已报告内容数 (超出后最早的内容可再次报告)
+    int tileSize = 64;          // 变化检测的分块边长 (像素)
+    int roiMargin = 96;         // 只识别变化区域时向四周扩展的像素数 (容纳跨出变化区域的二维码)
+    double roiMaxFraction = 0.5; // 扩展后的区域超过整帧面积的该比例时识别整帧
+};
+
+// 一个新出现的内容
+struct LiveScanEvent {
+    DecodedSymbol symbol;
+    std::string tier;          // 识别成功的层级
+    uint64_t frameIndex = 0;   // 抓取序号 (从 1 开始)
+    double latencyMs = 0;      // 从抓取该帧到报告的耗时
+};
+
+struct LiveScanStats {
+    uint64_t captured = 0;      // 抓取的帧数
+    uint64_t changed = 0;       // 与上一帧不同 (放入待识别槽) 的帧数
+    uint64_t decoded = 0;       // 识别过的帧数
+    uint64_t roiDecoded = 0;    // 其中只识别了变化区域的帧数
+    uint64_t superseded = 0;    // 尚未识别就被新帧覆盖的帧数
+    uint64_t retried = 0;       // 变化区域未识别到码, 画面静止后重新识别整帧的次数
+    uint64_t emitted = 0;       // 报告的内容数
+    uint64_t captureErrors = 0;
+    int intervalMs = 0;         // 当前抓取间隔
+    double lastDecodeMs = 0;
+};
+
+// 回调运行在识别线程上
+using LiveScanCallback = std::function<void(std::unique_ptr<LiveScanEvent>)>;
+
+// 识别函数, 默认为 RunCascade (基准测试可替换为模拟的慢识别)
+using LiveDecodeFn = std::function<void(const ImageFrame& frame, const CascadeConfig& cascade, ScanResult& outResult)>;
+
+class LiveScanner {
+public:
+    explicit LiveScanner(IFrameSource& source) : m_source(source) {}
+    ~LiveScanner();
+
+    LiveScanner(const LiveScanner&) = delete;
+    LiveScanner& operator=(const LiveScanner&) = delete;
+
+    // 替换识别函数; 须在 Start 之前调用
+    void SetDecoder(LiveDecodeFn decode) { m_decode = std::move(decode); }
+
+    /**
+     * @brief 启动抓取和识别线程 (统计与已报告内容清零)
+     * @return 已在运行时返回 false
+     */
+    bool Start(const LiveScanConfig& config, LiveScanCallback onEvent);
+
+    // 停止并等待两个线程退出; 返回后不会再有回调。不得在回调中调用
+    void Stop();
+
+    bool IsRunning() const;
+
+    LiveScanStats GetStats() const;
+
+private:
+    void CaptureLoop();
+    void DecodeLoop();
+    void Report(const ScanResult& result, uint64_t frameIndex, std::chrono::steady_clock::time_point capturedAt);
+
+    // 帧内的矩形区域 (像素)
+    struct Region {
+        int left = 0;
+        int top = 0;
+        int width = 0;
+        int height = 0;
+    };
+    static Region Union(const Region& a, const Region& b);
+
+    IFrameSource& m_source;
+    LiveDecodeFn m_decode;
+    LiveScanConfig m_config;
+    LiveScanCallback m_onEvent;
+
+    std::mutex m_controlMutex; // 串行化 Start / Stop
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_captureCv; // 停止 (打断抓取间隔的等待)
+    std::condition_variable m_decodeCv;  // 槽中有新帧或停止
+    bool m_running = false;
+
+    // 待识别槽
+    ImageFrame m_slotFrame;
+    Region m_slotRegion; // 自上次识别的帧以来变化过的区域
+    uint64_t m_slotIndex = 0;
+    std::chrono::steady_clock::time_point m_slotCapturedAt;
+    bool m_slotFull = false;
+    Region m_missedRegion; // 只识别了变化区域但未找到码, 尚未并入槽中的区域
+
+    LiveScanStats m_stats;
+
+    ChangeDetector m_detector; // 只由抓取线程访问
+
+    // 只由识别线程访问
+    std::deque<std::string> m_recent;
+    std::unordered_set<std::string> m_reported;
+
+    std::thread m_captureThread;
+    std::thread m_decodeThread;
+};
+
+} // namespace qrcore
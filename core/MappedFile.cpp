@@ -0,0 +1,311 @@
+/*
+ * 文件映射与追加写入 (Windows / POSIX)
+ */
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace qrcore {
+
+#ifdef _WIN32
+
+static std::wstring WidePath(const std::string& path) {
+    int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), (int)path.size(), NULL, 0);
+    std::wstring wide(length, L'\0');
+    if (length > 0) {
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), (int)path.size(), &wide[0], length);
+    }
+    return wide;
+}
+
+static std::string LastErrorText() {
+    return "错误码 " + std::to_string((unsigned long)GetLastError());
+}
+
+// ---------------------------------------------------------------------------
+// Windows
+// ---------------------------------------------------------------------------
+
+MappedFile::~MappedFile() {
+    Unmap();
+}
+
+bool MappedFile::Map(const std::string& path, std::string& outErrorMsg) {
+    Unmap();
+    // 允许其他句柄继续追加写入
+    HANDLE file = CreateFileW(WidePath(path).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        outErrorMsg = "无法打开文件: " + path + " (" + LastErrorText() + ")";
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        outErrorMsg = "无法读取文件大小: " + path;
+        CloseHandle(file);
+        return false;
+    }
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    // 视图独立于文件与映射对象的句柄
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (!view) {
+        outErrorMsg = "映射文件失败: " + path + " (" + LastErrorText() + ")";
+        return false;
+    }
+    m_data = (const uint8_t*)view;
+    m_size = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::Unmap() {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+AppendFile::~AppendFile() {
+    Close();
+}
+
+bool AppendFile::Open(const std::string& path, bool truncate, std::string& outErrorMsg) {
+    Close();
+    HANDLE file = CreateFileW(WidePath(path).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              NULL, truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        outErrorMsg = "无法打开文件: " + path + " (" + LastErrorText() + ")";
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        outErrorMsg = "无法读取文件大小: " + path;
+        CloseHandle(file);
+        return false;
+    }
+    m_handle = file;
+    m_path = path;
+    m_size = (uint64_t)size.QuadPart;
+    return true;
+}
+
+void AppendFile::Close() {
+    if (m_handle) {
+        CloseHandle((HANDLE)m_handle);
+    }
+    m_handle = nullptr;
+    m_size = 0;
+}
+
+bool AppendFile::IsOpen() const {
+    return m_handle != nullptr;
+}
+
+bool AppendFile::Append(const void* data, size_t size, std::string& outErrorMsg) {
+    if (!m_handle) {
+        outErrorMsg = "文件未打开";
+        return false;
+    }
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t offset = m_size;
+    while (size > 0) {
+        // 按偏移写入 (不依赖文件指针位置)
+        OVERLAPPED overlapped = {0};
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD chunk = (DWORD)(size < (1u << 30) ? size : (1u << 30));
+        DWORD written = 0;
+        if (!WriteFile((HANDLE)m_handle, p, chunk, &written, &overlapped) || written == 0) {
+            outErrorMsg = "写入文件失败: " + m_path + " (" + LastErrorText() + ")";
+            return false;
+        }
+        p += written;
+        size -= written;
+        offset += written;
+        m_size = offset;
+    }
+    return true;
+}
+
+bool AppendFile::Truncate(uint64_t size, std::string& outErrorMsg) {
+    LARGE_INTEGER position;
+    position.QuadPart = (LONGLONG)size;
+    if (!m_handle || !SetFilePointerEx((HANDLE)m_handle, position, NULL, FILE_BEGIN) ||
+        !SetEndOfFile((HANDLE)m_handle)) {
+        outErrorMsg = "截断文件失败: " + m_path + " (" + LastErrorText() + ")";
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+bool AppendFile::Sync() {
+    return m_handle && FlushFileBuffers((HANDLE)m_handle);
+}
+
+bool ReplaceFileWith(const std::string& from, const std::string& to, std::string& outErrorMsg) {
+    if (!MoveFileExW(WidePath(from).c_str(), WidePath(to).c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        outErrorMsg = "替换文件失败: " + to + " (" + LastErrorText() + ")";
+        return false;
+    }
+    return true;
+}
+
+bool RemoveFile(const std::string& path) {
+    return DeleteFileW(WidePath(path).c_str()) || GetLastError() == ERROR_FILE_NOT_FOUND;
+}
+
+#else
+
+// ---------------------------------------------------------------------------
+// POSIX
+// ---------------------------------------------------------------------------
+
+MappedFile::~MappedFile() {
+    Unmap();
+}
+
+bool MappedFile::Map(const std::string& path, std::string& outErrorMsg) {
+    Unmap();
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        outErrorMsg = "无法打开文件: " + path + " (" + strerror(errno) + ")";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        outErrorMsg = "无法读取文件大小: " + path;
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // 映射独立于文件描述符
+    if (view == MAP_FAILED) {
+        outErrorMsg = "映射文件失败: " + path + " (" + strerror(errno) + ")";
+        return false;
+    }
+    m_data = (const uint8_t*)view;
+    m_size = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::Unmap() {
+    if (m_data) {
+        munmap((void*)m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+AppendFile::~AppendFile() {
+    Close();
+}
+
+bool AppendFile::Open(const std::string& path, bool truncate, std::string& outErrorMsg) {
+    Close();
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        outErrorMsg = "无法打开文件: " + path + " (" + strerror(errno) + ")";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        outErrorMsg = "无法读取文件大小: " + path;
+        close(fd);
+        return false;
+    }
+    m_fd = fd;
+    m_path = path;
+    m_size = (uint64_t)st.st_size;
+    return true;
+}
+
+void AppendFile::Close() {
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+    m_fd = -1;
+    m_size = 0;
+}
+
+bool AppendFile::IsOpen() const {
+    return m_fd >= 0;
+}
+
+bool AppendFile::Append(const void* data, size_t size, std::string& outErrorMsg) {
+    if (m_fd < 0) {
+        outErrorMsg = "文件未打开";
+        return false;
+    }
+    const uint8_t* p = (const uint8_t*)data;
+    while (size > 0) {
+        // 按偏移写入 (不依赖文件指针位置)
+        ssize_t written = pwrite(m_fd, p, size, (off_t)m_size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            outErrorMsg = "写入文件失败: " + m_path + " (" + strerror(errno) + ")";
+            return false;
+        }
+        p += written;
+        size -= (size_t)written;
+        m_size += (uint64_t)written;
+    }
+    return true;
+}
+
+bool AppendFile::Truncate(uint64_t size, std::string& outErrorMsg) {
+    if (m_fd < 0 || ftruncate(m_fd, (off_t)size) != 0) {
+        outErrorMsg = "截断文件失败: " + m_path + " (" + strerror(errno) + ")";
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+bool AppendFile::Sync() {
+    return m_fd >= 0 && fsync(m_fd) == 0;
+}
+
+bool ReplaceFileWith(const std::string& from, const std::string& to, std::string& outErrorMsg) {
+    if (rename(from.c_str(), to.c_str()) != 0) {
+        outErrorMsg = "替换文件失败: " + to + " (" + strerror(errno) + ")";
+        return false;
+    }
+    return true;
+}
+
+bool RemoveFile(const std::string& path) {
+    return unlink(path.c_str()) == 0 || errno == ENOENT;
+}
+
+#endif
+
+} // namespace qrcore
@@ -0,0 +1,87 @@
+/*
+ * 文件映射与追加写入 (Windows / POSIX)
+ *
+ * MappedFile 把整个文件只读映射到内存, 读取时不复制、不解析;
+ * AppendFile 在文件末尾追加写入 (可截断), 用于只追加的日志和重写索引的临时文件。
+ * 路径均为 UTF-8, Windows 上转为 UTF-16 调用宽字符 API。
+ *
+ * Windows 上已映射的文件不能被截断或替换: 截断、替换前须先 Unmap。
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace qrcore {
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief 只读映射整个文件 (先解除已有的映射); 空文件映射成功, size() 为 0
+     */
+    bool Map(const std::string& path, std::string& outErrorMsg);
+    void Unmap();
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool mapped() const { return m_data != nullptr; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+class AppendFile {
+public:
+    AppendFile() = default;
+    ~AppendFile();
+
+    AppendFile(const AppendFile&) = delete;
+    AppendFile& operator=(const AppendFile&) = delete;
+
+    /**
+     * @brief 打开 (不存在时创建) 文件用于追加
+     * @param truncate 为 true 时清空已有内容
+     */
+    bool Open(const std::string& path, bool truncate, std::string& outErrorMsg);
+    void Close();
+    bool IsOpen() const;
+
+    // 追加到文件末尾; 成功后 Size() 增加 size
+    bool Append(const void* data, size_t size, std::string& outErrorMsg);
+
+    // 截断到 size 字节 (丢弃日志末尾写了一半的记录)
+    bool Truncate(uint64_t size, std::string& outErrorMsg);
+
+    // 把已写入的内容刷到磁盘 (替换文件之前调用)
+    bool Sync();
+
+    uint64_t Size() const { return m_size; }
+
+private:
+#ifdef _WIN32
+    void* m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+    std::string m_path;
+    uint64_t m_size = 0;
+};
+
+/**
+ * @brief 以 from 替换 to (to 已存在时覆盖); 用于先写临时文件再替换, 中途失败不破坏原文件
+ */
+bool ReplaceFileWith(const std::string& from, const std::string& to, std::string& outErrorMsg);
+
+// 删除文件 (不存在时也返回 true)
+bool RemoveFile(const std::string& path);
+
+} // namespace qrcore
@@ -0,0 +1,458 @@
+/*
+ * 进程内指标
+ */
+
+#include "Metrics.h"
+#include "MappedFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace qrcore {
+
+// ---------------------------------------------------------------------------
+// 直方图
+// ---------------------------------------------------------------------------
+
+static int HighestBit(uint64_t value) {
+    int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+
+int MetricHistogram::BucketIndex(uint64_t value) {
+    if (value < (uint64_t)(2 * kSubBuckets)) {
+        return (int)value;
+    }
+    int exponent = HighestBit(value);
+    if (exponent >= kMaxExponent) {
+        return kBucketCount - 1;
+    }
+    int sub = (int)(value >> (exponent - kSubBucketBits)) - kSubBuckets;
+    return 2 * kSubBuckets + (exponent - kSubBucketBits - 1) * kSubBuckets + sub;
+}
+
+uint64_t MetricHistogram::BucketUpperBound(int index) {
+    if (index < 2 * kSubBuckets) {
+        return (uint64_t)index;
+    }
+    int group = (index - 2 * kSubBuckets) / kSubBuckets;
+    int sub = (index - 2 * kSubBuckets) % kSubBuckets;
+    int shift = group + 1; // 该区间每个桶的宽度为 2^shift
+    return ((uint64_t)(kSubBuckets + sub + 1) << shift) - 1;
+}
+
+void MetricHistogram::Record(uint64_t micros) {
+    m_buckets[BucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(micros, std::memory_order_relaxed);
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (micros > max && !m_max.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot MetricHistogram::Snapshot() const {
+    // 各字段分别读取, 与并发的记录之间可能差几个样本, 对统计无影响
+    HistogramSnapshot snapshot;
+    snapshot.buckets.resize(kBucketCount);
+    for (int i = 0; i < kBucketCount; i++) {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.sum = m_sum.load(std::memory_order_relaxed);
+    snapshot.max = m_max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t HistogramSnapshot::Percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    q = q < 0 ? 0 : (q > 1 ? 1 : q);
+    uint64_t rank = (uint64_t)(q * (double)count + 0.5);
+    rank = rank < 1 ? 1 : (rank > count ? count : rank);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t bound = MetricHistogram::BucketUpperBound((int)i);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+// ---------------------------------------------------------------------------
+// 注册表
+// ---------------------------------------------------------------------------
+
+MetricsRegistry::Entry& MetricsRegistry::Find(const std::string& name, const std::string& labels,
+                                              const std::string& help, bool histogram) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_entries) {
+        if (entry->name == name && entry->labels == labels && (entry->histogram != nullptr) == histogram) {
+            return *entry;
+        }
+    }
+    auto entry = std::make_unique<Entry>();
+    entry->name = name;
+    entry->labels = labels;
+    entry->help = help;
+    if (histogram) {
+        entry->histogram = std::make_unique<MetricHistogram>();
+    } else {
+        entry->counter = std::make_unique<MetricCounter>();
+    }
+    m_entries.push_back(std::move(entry));
+    return *m_entries.back();
+}
+
+MetricCounter& MetricsRegistry::GetCounter(const std::string& name, const std::string& labels, const std::string& help) {
+    return *Find(name, labels, help, false).counter;
+}
+
+MetricHistogram& MetricsRegistry::GetHistogram(const std::string& name, const std::string& labels, const std::string& help) {
+    return *Find(name, labels, help, true).histogram;
+}
+
+// 在已有标签后追加一个标签, 如 {reason="x",quantile="0.5"}
+static std::string JoinLabels(const std::string& labels, const std::string& extra) {
+    std::string joined = labels;
+    if (!extra.empty()) {
+        if (!joined.empty()) {
+            joined += ',';
+        }
+        joined += extra;
+    }
+    return joined.empty() ? std::string() : "{" + joined + "}";
+}
+
+static void AppendSample(std::string& out, const std::string& name, const std::string& labels, const char* value) {
+    out += name;
+    out += labels;
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+std::string MetricsRegistry::FormatPrometheus() const {
+    std::vector<const Entry*> entries;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& entry : m_entries) {
+            entries.push_back(entry.get());
+        }
+    }
+
+    static const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+    std::string out;
+    char value[64];
+    std::vector<bool> written(entries.size(), false);
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (written[i]) {
+            continue;
+        }
+        const Entry& family = *entries[i];
+        bool histogram = family.histogram != nullptr;
+        if (!family.help.empty()) {
+            out += "# HELP " + family.name + " " + family.help + "\n";
+        }
+        out += "# TYPE " + family.name + (histogram ? " summary\n" : " counter\n");
+
+        // 同名同类型的各标签组合
+        std::vector<HistogramSnapshot> snapshots;
+        std::vector<const Entry*> members;
+        for (size_t j = i; j < entries.size(); j++) {
+            if (written[j] || entries[j]->name != family.name || (entries[j]->histogram != nullptr) != histogram) {
+                continue;
+            }
+            written[j] = true;
+            members.push_back(entries[j]);
+            if (!histogram) {
+                snprintf(value, sizeof(value), "%llu", (unsigned long long)entries[j]->counter->Value());
+                AppendSample(out, family.name, JoinLabels(entries[j]->labels, ""), value);
+                continue;
+            }
+            HistogramSnapshot snapshot = entries[j]->histogram->Snapshot();
+            for (double q : kQuantiles) {
+                char quantile[32];
+                snprintf(quantile, sizeof(quantile), "quantile=\"%g\"", q);
+                snprintf(value, sizeof(value), "%.6f", snapshot.Percentile(q) / 1e6);
+                AppendSample(out, family.name, JoinLabels(entries[j]->labels, quantile), value);
+            }
+            snprintf(value, sizeof(value), "%.6f", snapshot.sum / 1e6);
+            AppendSample(out, family.name + "_sum", JoinLabels(entries[j]->labels, ""), value);
+            snprintf(value, sizeof(value), "%llu", (unsigned long long)snapshot.count);
+            AppendSample(out, family.name + "_count", JoinLabels(entries[j]->labels, ""), value);
+            snapshots.push_back(std::move(snapshot));
+        }
+        // 最大值不属于 summary, 单独作为一个 gauge 输出
+        if (histogram) {
+            out += "# TYPE " + family.name + "_max gauge\n";
+            for (size_t k = 0; k < members.size(); k++) {
+                snprintf(value, sizeof(value), "%.6f", snapshots[k].max / 1e6);
+                AppendSample(out, family.name + "_max", JoinLabels(members[k]->labels, ""), value);
+            }
+        }
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// 写到本地文件
+// ---------------------------------------------------------------------------
+
+bool SaveMetricsSnapshot(const MetricsRegistry& registry, const std::string& path, std::string& outErrorMsg) {
+    std::string text = registry.FormatPrometheus();
+    std::string tmpPath = path + ".tmp";
+    AppendFile file;
+    if (!file.Open(tmpPath, true, outErrorMsg) || !file.Append(text.data(), text.size(), outErrorMsg)) {
+        return false;
+    }
+    file.Close();
+    return ReplaceFileWith(tmpPath, path, outErrorMsg);
+}
+
+MetricsFileWriter::~MetricsFileWriter() {
+    Stop();
+}
+
+bool MetricsFileWriter::Start(const std::string& path, int intervalMs, std::string& outErrorMsg) {
+    Stop();
+    if (!SaveMetricsSnapshot(m_registry, path, outErrorMsg)) {
+        return false;
+    }
+    m_writes.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+    m_intervalMs = intervalMs < 100 ? 100 : intervalMs;
+    m_running = true;
+    m_thread = std::thread(&MetricsFileWriter::Run, this);
+    return true;
+}
+
+void MetricsFileWriter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void MetricsFileWriter::Run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool running = true;
+    while (running) {
+        running = !m_cv.wait_for(lock, std::chrono::milliseconds(m_intervalMs), [this] { return !m_running; });
+        lock.unlock();
+        std::string errorMsg;
+        if (SaveMetricsSnapshot(m_registry, m_path, errorMsg)) { // 写失败 (如文件被占用) 时等下一次
+            m_writes.fetch_add(1, std::memory_order_relaxed);
+        }
+        lock.lock();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 本机 HTTP 端点
+// ---------------------------------------------------------------------------
+
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+typedef int SocketLength;
+static const intptr_t kNoSocket = (intptr_t)INVALID_SOCKET;
+
+static void CloseSocket(intptr_t socket) {
+    closesocket((SOCKET)socket);
+}
+
+static std::string SocketErrorText() {
+    return "错误码 " + std::to_string(WSAGetLastError());
+}
+
+static void SetSocketTimeout(intptr_t socket, int ms) {
+    DWORD timeout = (DWORD)ms;
+    setsockopt((SOCKET)socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt((SOCKET)socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+#else
+typedef int SocketHandle;
+typedef socklen_t SocketLength;
+static const intptr_t kNoSocket = -1;
+
+static void CloseSocket(intptr_t socket) {
+    close((int)socket);
+}
+
+static std::string SocketErrorText() {
+    return strerror(errno);
+}
+
+static void SetSocketTimeout(intptr_t socket, int ms) {
+    timeval timeout = {ms / 1000, (ms % 1000) * 1000};
+    setsockopt((int)socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt((int)socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+#endif
+
+#ifdef MSG_NOSIGNAL
+static const int kSendFlags = MSG_NOSIGNAL; // 对方提前关闭时不产生 SIGPIPE
+#else
+static const int kSendFlags = 0;
+#endif
+
+MetricsHttpServer::~MetricsHttpServer() {
+    Stop();
+}
+
+bool MetricsHttpServer::Start(int port, std::string& outErrorMsg) {
+    Stop();
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        outErrorMsg = "初始化网络失败";
+        return false;
+    }
+#endif
+    SocketHandle listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if ((intptr_t)listenSocket == kNoSocket) {
+        outErrorMsg = "创建套接字失败: " + SocketErrorText();
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+    int on = 1;
+#ifdef _WIN32
+    // 不允许其他进程抢占同一端口
+    setsockopt(listenSocket, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char*)&on, sizeof(on));
+#else
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#endif
+
+    // 只绑定回环地址, 其他机器无法连接
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((uint16_t)port);
+    SocketLength length = sizeof(address);
+    if (bind(listenSocket, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 8) != 0 ||
+        getsockname(listenSocket, (sockaddr*)&address, &length) != 0) {
+        outErrorMsg = "监听 127.0.0.1:" + std::to_string(port) + " 失败: " + SocketErrorText();
+        CloseSocket((intptr_t)listenSocket);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+
+    m_listen = (intptr_t)listenSocket;
+    m_port = ntohs(address.sin_port);
+    m_stop.store(false);
+    m_thread = std::thread(&MetricsHttpServer::Run, this);
+    return true;
+}
+
+void MetricsHttpServer::Stop() {
+    if (m_listen == kNoSocket) {
+        return;
+    }
+    m_stop.store(true);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    CloseSocket(m_listen);
+    m_listen = kNoSocket;
+    m_port = 0;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void MetricsHttpServer::Run() {
+    // 每 200 毫秒检查一次停止标志 (关闭监听套接字并不能可靠地打断阻塞中的 accept)
+    while (!m_stop.load()) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET((SocketHandle)m_listen, &readSet);
+        timeval timeout = {0, 200 * 1000};
+        int ready = select((int)m_listen + 1, &readSet, NULL, NULL, &timeout);
+        if (ready <= 0) {
+            continue;
+        }
+        SocketHandle client = accept((SocketHandle)m_listen, NULL, NULL);
+        if ((intptr_t)client == kNoSocket) {
+            continue;
+        }
+        Serve((intptr_t)client);
+        CloseSocket((intptr_t)client);
+    }
+}
+
+void MetricsHttpServer::Serve(intptr_t client) {
+    SetSocketTimeout(client, 1000);
+
+    // 只需要请求行; 读到头部结束或 8 KB 为止
+    std::string request;
+    char buffer[1024];
+    while (request.size() < 8192 && request.find("\r\n\r\n") == std::string::npos) {
+        int received = (int)recv((SocketHandle)client, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            break;
+        }
+        request.append(buffer, received);
+    }
+    m_requests.fetch_add(1, std::memory_order_relaxed);
+
+    std::string status = "200 OK";
+    std::string body;
+    bool isGet = request.compare(0, 4, "GET ") == 0;
+    size_t pathEnd = request.find(' ', 4);
+    std::string path = isGet && pathEnd != std::string::npos ? request.substr(4, pathEnd - 4) : std::string();
+    if (!isGet) {
+        status = "405 Method Not Allowed";
+    } else if (path == "/metrics" || path == "/") {
+        body = m_registry.FormatPrometheus();
+    } else {
+        status = "404 Not Found";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        int written = (int)send((SocketHandle)client, response.data() + sent, (int)(response.size() - sent), kSendFlags);
+        if (written <= 0) {
+            break;
+        }
+        sent += written;
+    }
+}
+
+} // namespace qrcore
@@ -0,0 +1,174 @@
+/*
+ * 进程内指标: 计数器、对数线性延迟直方图 (HDR 风格) 与注册表
+ *
+ * 计数和直方图的记录都只是 relaxed 原子加法, 不加锁、不分配内存, 可在任意线程调用。
+ * 注册 (按名称和标签取得指标) 需要加锁, 调用方应保存返回的引用, 不要每次记录时查找;
+ * 指标注册后不会被删除, 引用在注册表的生存期内一直有效。
+ *
+ * 快照为 Prometheus 文本格式: 可由 MetricsFileWriter 定时写到本地文件
+ * (node_exporter 的 textfile 收集器可直接读取), 或由只监听 127.0.0.1 的
+ * MetricsHttpServer 提供给本机的采集程序。
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace qrcore {
+
+class MetricCounter {
+public:
+    void Add(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_value{0};
+};
+
+// 直方图某一时刻的副本 (值的单位为微秒)
+struct HistogramSnapshot {
+    uint64_t count = 0; // 各桶之和
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets;
+
+    /**
+     * @brief 分位数 (q 取 0~1), 返回所在桶的上界 (不超过 max); 无数据时返回 0
+     */
+    uint64_t Percentile(double q) const;
+};
+
+/**
+ * @brief 延迟直方图: 记录微秒值
+ *
+ * 小于 64 的值每个值一个桶; 之后每个 2 的幂区间等分为 32 个桶,
+ * 分位数的相对误差不超过 1/32 (约 3%)。可记录到约 2^40 微秒 (12 天), 更大的值计入最后一个桶。
+ */
+class MetricHistogram {
+public:
+    static const int kSubBucketBits = 5;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+    static const int kMaxExponent = 40;
+    static const int kBucketCount = 2 * kSubBuckets + (kMaxExponent - kSubBucketBits - 1) * kSubBuckets;
+
+    void Record(uint64_t micros);
+    void RecordMs(double ms) { Record(ms <= 0 ? 0 : (uint64_t)(ms * 1000.0 + 0.5)); }
+
+    HistogramSnapshot Snapshot() const;
+
+    static int BucketIndex(uint64_t value);
+    static uint64_t BucketUpperBound(int index); // 桶内最大的值
+
+private:
+    std::atomic<uint64_t> m_buckets[kBucketCount] = {};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+class MetricsRegistry {
+public:
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    /**
+     * @brief 取得 (不存在时注册) 计数器
+     * @param name 指标名, 如 "qr_scans_total"
+     * @param labels Prometheus 标签, 如 "reason=\"not_found\"" (可为空)
+     * @param help 说明文字, 同名指标取第一次注册时的
+     */
+    MetricCounter& GetCounter(const std::string& name, const std::string& labels = "", const std::string& help = "");
+
+    // 取得 (不存在时注册) 延迟直方图; 导出为以秒为单位的 summary (分位数 + _sum / _count) 和 _max
+    MetricHistogram& GetHistogram(const std::string& name, const std::string& labels = "", const std::string& help = "");
+
+    // Prometheus 文本格式快照 (同名指标按第一次注册的顺序放在一起)
+    std::string FormatPrometheus() const;
+
+private:
+    struct Entry {
+        std::string name;
+        std::string labels;
+        std::string help;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricHistogram> histogram;
+    };
+
+    Entry& Find(const std::string& name, const std::string& labels, const std::string& help, bool histogram);
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Entry>> m_entries;
+};
+
+// 写出快照到文件 (先写临时文件再替换, 读取方不会读到写了一半的文件; 路径为 UTF-8)
+bool SaveMetricsSnapshot(const MetricsRegistry& registry, const std::string& path, std::string& outErrorMsg);
+
+// 按固定间隔把快照写到本地文件的线程; 停止时再写一次
+class MetricsFileWriter {
+public:
+    explicit MetricsFileWriter(const MetricsRegistry& registry) : m_registry(registry) {}
+    ~MetricsFileWriter();
+
+    MetricsFileWriter(const MetricsFileWriter&) = delete;
+    MetricsFileWriter& operator=(const MetricsFileWriter&) = delete;
+
+    // 先同步写一次, 失败时不启动线程
+    bool Start(const std::string& path, int intervalMs, std::string& outErrorMsg);
+    void Stop();
+
+    uint64_t WriteCount() const { return m_writes.load(std::memory_order_relaxed); }
+
+private:
+    void Run();
+
+    const MetricsRegistry& m_registry;
+    std::string m_path;
+    int m_intervalMs = 60000;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_running = false;
+    std::atomic<uint64_t> m_writes{0};
+    std::thread m_thread;
+};
+
+/**
+ * @brief 只监听 127.0.0.1 的 HTTP 端点
+ *
+ * GET /metrics 返回 Prometheus 文本快照, 其他路径返回 404。
+ * 逐个处理连接 (采集间隔通常为秒级, 不需要并发), 每个连接读写各有 1 秒超时。
+ */
+class MetricsHttpServer {
+public:
+    explicit MetricsHttpServer(const MetricsRegistry& registry) : m_registry(registry) {}
+    ~MetricsHttpServer();
+
+    MetricsHttpServer(const MetricsHttpServer&) = delete;
+    MetricsHttpServer& operator=(const MetricsHttpServer&) = delete;
+
+    // port 为 0 时由系统分配, 实际端口见 Port()
+    bool Start(int port, std::string& outErrorMsg);
+    void Stop();
+
+    int Port() const { return m_port; }
+    uint64_t RequestCount() const { return m_requests.load(std::memory_order_relaxed); }
+
+private:
+    void Run();
+    void Serve(intptr_t client);
+
+    const MetricsRegistry& m_registry;
+    intptr_t m_listen = -1;
+    int m_port = 0;
+    std::atomic<bool> m_stop{false};
+    std::atomic<uint64_t> m_requests{0};
+    std::thread m_thread;
+};
+
+} // namespace qrcore
@@ -0,0 +1,304 @@
+/*
+ * 选区覆盖层的脏矩形合成
+ */
+
+#include "OverlayCompositor.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace qrcore {
+
+OverlayRect IntersectRects(const OverlayRect& a, const OverlayRect& b) {
+    OverlayRect r;
+    r.left = std::max(a.left, b.left);
+    r.top = std::max(a.top, b.top);
+    r.right = std::min(a.right, b.right);
+    r.bottom = std::min(a.bottom, b.bottom);
+    return r.empty() ? OverlayRect() : r;
+}
+
+OverlayRect BoundingRect(const OverlayRect& a, const OverlayRect& b) {
+    if (a.empty()) {
+        return b.empty() ? OverlayRect() : b;
+    }
+    if (b.empty()) {
+        return a;
+    }
+    OverlayRect r;
+    r.left = std::min(a.left, b.left);
+    r.top = std::min(a.top, b.top);
+    r.right = std::max(a.right, b.right);
+    r.bottom = std::max(a.bottom, b.bottom);
+    return r;
+}
+
+// ---------------------------------------------------------------------------
+// DirtyRegion
+// ---------------------------------------------------------------------------
+
+DirtyRegion::DirtyRegion(int maxRects, int64_t mergeSlack)
+    : m_maxRects(std::max(1, maxRects)), m_mergeSlack(std::max<int64_t>(0, mergeSlack)) {
+    m_rects.reserve(m_maxRects + 1);
+}
+
+void DirtyRegion::Add(const OverlayRect& rect) {
+    if (rect.empty()) {
+        return;
+    }
+    for (const OverlayRect& existing : m_rects) {
+        if (IntersectRects(existing, rect).area() == rect.area()) {
+            return; // 已被覆盖
+        }
+    }
+    m_rects.push_back(rect);
+    MergeFrom(m_rects.size() - 1);
+
+    while ((int)m_rects.size() > m_maxRects) {
+        // 合并外接面积增加最少的一对
+        size_t bestA = 0, bestB = 1;
+        int64_t bestCost = INT64_MAX;
+        for (size_t i = 0; i < m_rects.size(); i++) {
+            for (size_t j = i + 1; j < m_rects.size(); j++) {
+                int64_t cost = BoundingRect(m_rects[i], m_rects[j]).area() - m_rects[i].area() - m_rects[j].area();
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestA = i;
+                    bestB = j;
+                }
+            }
+        }
+        m_rects[bestA] = BoundingRect(m_rects[bestA], m_rects[bestB]);
+        m_rects.erase(m_rects.begin() + bestB);
+        MergeFrom(bestA);
+    }
+}
+
+void DirtyRegion::MergeFrom(size_t index) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < m_rects.size(); i++) {
+            if (i == index) {
+                continue;
+            }
+            const OverlayRect& a = m_rects[index];
+            const OverlayRect& b = m_rects[i];
+            OverlayRect bounds = BoundingRect(a, b);
+            int64_t covered = a.area() + b.area() - IntersectRects(a, b).area();
+            if (bounds.area() > covered + m_mergeSlack) {
+                continue;
+            }
+            m_rects[index] = bounds;
+            m_rects.erase(m_rects.begin() + i);
+            if (i < index) {
+                index--;
+            }
+            merged = true;
+            break;
+        }
+    }
+}
+
+int64_t DirtyRegion::Area() const {
+    int64_t area = 0;
+    for (const OverlayRect& rect : m_rects) {
+        area += rect.area();
+    }
+    return area;
+}
+
+// ---------------------------------------------------------------------------
+// OverlayCompositor
+// ---------------------------------------------------------------------------
+
+// 0xRRGGBB -> BGRX 像素 (按内存字节序 B G R X)
+static uint32_t ToBGRXPixel(uint32_t rgb) {
+    uint8_t bytes[4] = {(uint8_t)(rgb & 0xFF), (uint8_t)((rgb >> 8) & 0xFF), (uint8_t)((rgb >> 16) & 0xFF), 0};
+    uint32_t pixel;
+    memcpy(&pixel, bytes, sizeof(pixel));
+    return pixel;
+}
+
+OverlayCompositor::OverlayCompositor(const OverlayStyle& style) : m_style(style) {}
+
+bool OverlayCompositor::Attach(const ImageFrame& backBuffer, std::string& outErrorMsg) {
+    if (!ValidateFrame(backBuffer, outErrorMsg)) {
+        return false;
+    }
+    if (backBuffer.format != PixelFormat::BGRX || backBuffer.stride % 4 != 0 || ((uintptr_t)backBuffer.data % 4) != 0) {
+        outErrorMsg = "覆盖层后备缓冲区须为 4 字节对齐的 BGRX 帧";
+        return false;
+    }
+    m_back = backBuffer;
+    m_selection = OverlayRect();
+    m_visible = false;
+    InvalidateAll();
+    return true;
+}
+
+void OverlayCompositor::Detach() {
+    m_back = ImageFrame();
+    m_background = ImageFrame();
+    m_selection = OverlayRect();
+    m_visible = false;
+    m_dirty.Clear();
+}
+
+void OverlayCompositor::SetStyle(const OverlayStyle& style) {
+    m_style = style;
+    InvalidateAll();
+}
+
+bool OverlayCompositor::SetBackground(const ImageFrame& background, std::string& outErrorMsg) {
+    if (background.empty()) {
+        m_background = ImageFrame();
+        InvalidateAll();
+        return true;
+    }
+    if (!ValidateFrame(background, outErrorMsg)) {
+        return false;
+    }
+    if (background.format != PixelFormat::BGRX) {
+        outErrorMsg = "覆盖层背景图须为 BGRX 帧";
+        return false;
+    }
+    m_background = background;
+    InvalidateAll();
+    return true;
+}
+
+OverlayRect OverlayCompositor::Bounds() const {
+    OverlayRect bounds;
+    bounds.right = m_back.width;
+    bounds.bottom = m_back.height;
+    return bounds;
+}
+
+int OverlayCompositor::BorderStrips(const OverlayRect& selection, OverlayRect outStrips[4]) const {
+    if (selection.right < selection.left || selection.bottom < selection.top || m_style.borderWidth <= 0) {
+        return 0;
+    }
+    int width = m_style.borderWidth;
+    int half = width / 2;
+    OverlayRect outer;
+    outer.left = selection.left - half;
+    outer.top = selection.top - half;
+    outer.right = selection.right - half + width;
+    outer.bottom = selection.bottom - half + width;
+
+    outStrips[0] = {outer.left, outer.top, outer.right, outer.top + width};         // 上
+    outStrips[1] = {outer.left, outer.bottom - width, outer.right, outer.bottom};   // 下
+    outStrips[2] = {outer.left, outer.top + width, outer.left + width, outer.bottom - width}; // 左
+    outStrips[3] = {outer.right - width, outer.top + width, outer.right, outer.bottom - width}; // 右
+    return 4;
+}
+
+OverlayRect OverlayCompositor::LabelRectFor(const OverlayRect& selection) const {
+    if (selection.empty()) {
+        return OverlayRect();
+    }
+    OverlayRect label;
+    label.left = selection.left;
+    label.top = selection.top - m_style.labelHeight;
+    label.right = std::min(selection.right, selection.left + m_style.labelWidth);
+    label.bottom = selection.top;
+    return IntersectRects(label, Bounds());
+}
+
+OverlayRect OverlayCompositor::LabelRect() const {
+    return m_visible ? LabelRectFor(m_selection) : OverlayRect();
+}
+
+void OverlayCompositor::AddDecorations(const OverlayRect& selection) {
+    OverlayRect strips[4];
+    int count = BorderStrips(selection, strips);
+    for (int i = 0; i < count; i++) {
+        m_dirty.Add(IntersectRects(strips[i], Bounds()));
+    }
+    m_dirty.Add(LabelRectFor(selection));
+}
+
+void OverlayCompositor::SetSelection(const OverlayRect& selection, bool visible) {
+    if (visible == m_visible && (!visible || (selection.left == m_selection.left && selection.top == m_selection.top &&
+                                              selection.right == m_selection.right && selection.bottom == m_selection.bottom))) {
+        return;
+    }
+    if (m_visible) {
+        AddDecorations(m_selection);
+    }
+    m_selection = selection;
+    m_visible = visible;
+    if (m_visible) {
+        AddDecorations(m_selection);
+    }
+}
+
+void OverlayCompositor::Invalidate(const OverlayRect& rect) {
+    m_dirty.Add(IntersectRects(rect, Bounds()));
+}
+
+void OverlayCompositor::InvalidateAll() {
+    m_dirty.Clear();
+    m_dirty.Add(Bounds());
+}
+
+void OverlayCompositor::FillPixels(const OverlayRect& rect, uint32_t pixel) {
+    for (int y = rect.top; y < rect.bottom; y++) {
+        uint32_t* row = (uint32_t*)m_back.row(y) + rect.left;
+        std::fill(row, row + rect.width(), pixel);
+    }
+}
+
+void OverlayCompositor::CopyDimmed(const OverlayRect& rect) {
+    uint32_t scale = (uint32_t)std::min(std::max(m_style.backgroundDim, 0), 256);
+    size_t bytes = (size_t)rect.width() * 4;
+    for (int y = rect.top; y < rect.bottom; y++) {
+        const uint8_t* src = m_background.row(y) + (size_t)rect.left * 4;
+        uint8_t* dst = m_back.row(y) + (size_t)rect.left * 4;
+        for (size_t i = 0; i < bytes; i++) {
+            dst[i] = (uint8_t)((src[i] * scale) >> 8);
+        }
+    }
+}
+
+void OverlayCompositor::Render(const OverlayRect& area) {
+    OverlayRect clipped = IntersectRects(area, Bounds());
+    if (clipped.empty()) {
+        return;
+    }
+    OverlayRect backgroundBounds = {0, 0, m_background.width, m_background.height};
+    OverlayRect fromImage = IntersectRects(clipped, backgroundBounds);
+    if (fromImage.area() != clipped.area()) {
+        FillPixels(clipped, ToBGRXPixel(m_style.backgroundColor));
+    }
+    if (!fromImage.empty()) {
+        CopyDimmed(fromImage);
+    }
+    if (!m_visible) {
+        return;
+    }
+    OverlayRect strips[4];
+    int count = BorderStrips(m_selection, strips);
+    uint32_t border = ToBGRXPixel(m_style.borderColor);
+    for (int i = 0; i < count; i++) {
+        OverlayRect part = IntersectRects(strips[i], clipped);
+        if (!part.empty()) {
+            FillPixels(part, border);
+        }
+    }
+}
+
+void OverlayCompositor::Flush(std::vector<OverlayRect>& outRects) {
+    outRects.clear();
+    for (const OverlayRect& rect : m_dirty.Rects()) {
+        OverlayRect clipped = IntersectRects(rect, Bounds());
+        if (!clipped.empty()) {
+            Render(clipped);
+            outRects.push_back(clipped);
+        }
+    }
+    m_dirty.Clear();
+}
+
+} // namespace qrcore
@@ -0,0 +1,142 @@
+/*
+ * 选区覆盖层的脏矩形合成
+ *
+ * 覆盖层铺满整个屏幕, 鼠标每移动一次若整屏重绘 (新建全屏位图、填充、整屏 BitBlt),
+ * 4K / 5K 显示器上每帧要处理数千万像素, 选框明显落后于光标。
+ * 这里保留一块常驻的后备缓冲区 (BGRX, 可以是 DIB 节), 选区变化时只把新旧选框的
+ * 四条边和尺寸标签区域记为脏区域, 平台层只重绘、提交这些矩形。
+ *
+ * 合成器负责背景和选框边线的像素; 文字 (尺寸标签、提示) 由平台层在重绘的矩形内
+ * 用系统字体绘制到同一块后备缓冲区上, 标签区域由 LabelRect 给出。
+ * 背景可以是纯色, 也可以是覆盖层打开时定格的整屏截图 (按 backgroundDim 变暗后显示)。
+ */
+
+#pragma once
+
+#include "ImageFrame.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace qrcore {
+
+// 矩形 (像素, 右边和下边不含), 与 Win32 RECT 的约定一致
+struct OverlayRect {
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+
+    bool empty() const { return right <= left || bottom <= top; }
+    int width() const { return right - left; }
+    int height() const { return bottom - top; }
+    int64_t area() const { return empty() ? 0 : (int64_t)width() * height(); }
+};
+
+OverlayRect IntersectRects(const OverlayRect& a, const OverlayRect& b);
+OverlayRect BoundingRect(const OverlayRect& a, const OverlayRect& b); // 外接矩形 (空矩形不参与)
+
+/**
+ * @brief 由若干矩形组成的脏区域
+ *
+ * 新加入的矩形与已有矩形合并后几乎不多覆盖像素时 (外接矩形面积不超过两者并集加 mergeSlack)
+ * 合并为一个; 矩形数超过 maxRects 时合并外接面积增加最少的一对。
+ * 同一条边前后两次的位置通常重叠或相接, 会合并为一条。
+ */
+class DirtyRegion {
+public:
+    explicit DirtyRegion(int maxRects = 16, int64_t mergeSlack = 1024);
+
+    void Add(const OverlayRect& rect);
+    void Clear() { m_rects.clear(); }
+
+    bool empty() const { return m_rects.empty(); }
+    const std::vector<OverlayRect>& Rects() const { return m_rects; }
+    int64_t Area() const; // 各矩形面积之和 (重叠部分重复计算)
+
+private:
+    void MergeFrom(size_t index); // 把 m_rects[index] 与能合并的矩形反复合并
+
+    int m_maxRects;
+    int64_t m_mergeSlack;
+    std::vector<OverlayRect> m_rects;
+};
+
+struct OverlayStyle {
+    uint32_t backgroundColor = 0x000000; // 0xRRGGBB; 无背景图或背景图未覆盖的部分
+    int backgroundDim = 128; // 背景图亮度按 backgroundDim / 256 变暗 (256 为原样)
+    uint32_t borderColor = 0xFF0000;
+    int borderWidth = 2;   // 选框线宽, 以选区边界为中线
+    int labelWidth = 160;  // 尺寸标签区域 (选区左上角之上, 不超过选区宽度)
+    int labelHeight = 25;
+};
+
+class OverlayCompositor {
+public:
+    explicit OverlayCompositor(const OverlayStyle& style = OverlayStyle());
+
+    /**
+     * @brief 绑定后备缓冲区 (BGRX, 由调用方持有并在合成器使用期间保持有效)
+     *
+     * 清除选区, 并把整个缓冲区记为脏区域。
+     */
+    bool Attach(const ImageFrame& backBuffer, std::string& outErrorMsg);
+    void Detach();
+
+    void SetStyle(const OverlayStyle& style); // 整个缓冲区记为脏区域
+    const OverlayStyle& Style() const { return m_style; }
+
+    /**
+     * @brief 设置背景图 (BGRX, 左上角与后备缓冲区对齐; 传空帧恢复纯色背景)
+     *
+     * 只保留对帧的引用, 重绘时按需变暗复制, 不预先生成整幅变暗的副本。整个缓冲区记为脏区域。
+     */
+    bool SetBackground(const ImageFrame& background, std::string& outErrorMsg);
+
+    /**
+     * @brief 更新选区; visible 为 false 时不显示选框
+     *
+     * 选区或可见性有变化时, 把旧选框和新选框的边线、标签区域加入脏区域。
+     */
+    void SetSelection(const OverlayRect& selection, bool visible);
+
+    void Invalidate(const OverlayRect& rect);
+    void InvalidateAll();
+
+    const DirtyRegion& Dirty() const { return m_dirty; }
+    void ClearDirty() { m_dirty.Clear(); }
+
+    /**
+     * @brief 在后备缓冲区中重绘 area 范围内的背景与选框边线 (裁剪到缓冲区内)
+     *
+     * 不改变脏区域; 平台层按自己的重绘区域调用, 之后在同一范围内绘制文字再提交。
+     */
+    void Render(const OverlayRect& area);
+
+    // 重绘全部脏区域, 返回重绘的矩形 (已裁剪) 并清空脏区域
+    void Flush(std::vector<OverlayRect>& outRects);
+
+    // 当前选框的尺寸标签区域 (未显示选框时为空矩形, 已裁剪到缓冲区内)
+    OverlayRect LabelRect() const;
+
+    const ImageFrame& BackBuffer() const { return m_back; }
+
+private:
+    // 选框的四条边 (未裁剪); 返回条数, 选区为空时为 0
+    int BorderStrips(const OverlayRect& selection, OverlayRect outStrips[4]) const;
+    OverlayRect LabelRectFor(const OverlayRect& selection) const;
+    void AddDecorations(const OverlayRect& selection);
+    void FillPixels(const OverlayRect& rect, uint32_t pixel);
+    void CopyDimmed(const OverlayRect& rect); // 从背景图变暗复制 (rect 须在背景图范围内)
+    OverlayRect Bounds() const;
+
+    OverlayStyle m_style;
+    ImageFrame m_back;
+    ImageFrame m_background;
+    OverlayRect m_selection;
+    bool m_visible = false;
+    DirtyRegion m_dirty;
+};
+
+} // namespace qrcore
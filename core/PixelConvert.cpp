@@ -0,0 +1,299 @@
+/*
+ * 像素格式转换内核
+ */
+
+#include "PixelConvert.h"
+#include "FramePool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define QRCORE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang 需要为 AVX2 函数单独开启指令集; MSVC 无需任何标志
+#if defined(QRCORE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define QRCORE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define QRCORE_TARGET_AVX2
+#endif
+
+namespace qrcore {
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+// ---------------------------------------------------------------------------
+// 标量参考实现
+// ---------------------------------------------------------------------------
+
+static void RowToLumScalar(const uint8_t* src, PixelFormat format, uint8_t* dst, int width) {
+    switch (format) {
+        case PixelFormat::Lum:
+            memcpy(dst, src, (size_t)width);
+            break;
+        case PixelFormat::RGB:
+            for (int x = 0; x < width; x++, src += 3) {
+                dst[x] = RGBToLum(src[0], src[1], src[2]);
+            }
+            break;
+        case PixelFormat::BGR:
+            for (int x = 0; x < width; x++, src += 3) {
+                dst[x] = RGBToLum(src[2], src[1], src[0]);
+            }
+            break;
+        case PixelFormat::BGRX:
+            for (int x = 0; x < width; x++, src += 4) {
+                dst[x] = RGBToLum(src[2], src[1], src[0]);
+            }
+            break;
+    }
+}
+
+#ifdef QRCORE_X86
+
+// ---------------------------------------------------------------------------
+// SSE2: 每像素 4 字节, 按 16 位展开后用 madd 求加权和
+// ---------------------------------------------------------------------------
+
+// 权重按像素内字节顺序排列: 第 0、1、2 字节的权重, 第 3 字节 (X) 为 0
+static inline __m128i Weights128(PixelFormat format) {
+    return (format == PixelFormat::RGB) ? _mm_setr_epi16(306, 601, 117, 0, 306, 601, 117, 0)
+                                        : _mm_setr_epi16(117, 601, 306, 0, 117, 601, 306, 0);
+}
+
+// 4 个 32 位像素 → 4 个 int32 加权和 (未取整)
+static inline __m128i WeightedSum4(__m128i px, __m128i weights) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), weights); // [p0a p0b p1a p1b]
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), weights); // [p2a p2b p3a p3b]
+    lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));                    // [p0 - p1 -]
+    hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+    lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 2, 0));               // [p0 p1 - -]
+    hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 2, 0));
+    return _mm_unpacklo_epi64(lo, hi);                                 // [p0 p1 p2 p3]
+}
+
+// 8 个加权和 → 8 个灰度字节
+static inline void StoreLum8(__m128i a, __m128i b, uint8_t* dst) {
+    const __m128i round = _mm_set1_epi32(0x200);
+    a = _mm_srai_epi32(_mm_add_epi32(a, round), 10);
+    b = _mm_srai_epi32(_mm_add_epi32(b, round), 10);
+    __m128i packed = _mm_packs_epi32(a, b);
+    _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(packed, packed));
+}
+
+// 24 位像素: 把 16 字节中的前 4 个像素 (12 字节) 摊开到 4 个 32 位通道
+// 通道 k 需要字节 3k..3k+2, 即原数据左移 k 字节后的第 k 个通道
+static inline __m128i Expand24To32(__m128i v) {
+    const __m128i m0 = _mm_setr_epi32(0x00FFFFFF, 0, 0, 0);
+    const __m128i m1 = _mm_setr_epi32(0, 0x00FFFFFF, 0, 0);
+    const __m128i m2 = _mm_setr_epi32(0, 0, 0x00FFFFFF, 0);
+    const __m128i m3 = _mm_setr_epi32(0, 0, 0, 0x00FFFFFF);
+    __m128i r = _mm_and_si128(v, m0);
+    r = _mm_or_si128(r, _mm_and_si128(_mm_slli_si128(v, 1), m1));
+    r = _mm_or_si128(r, _mm_and_si128(_mm_slli_si128(v, 2), m2));
+    r = _mm_or_si128(r, _mm_and_si128(_mm_slli_si128(v, 3), m3));
+    return r;
+}
+
+static void RowToLumSSE2(const uint8_t* src, PixelFormat format, uint8_t* dst, int width) {
+    const __m128i weights = Weights128(format);
+    int x = 0;
+
+    if (format == PixelFormat::BGRX) {
+        for (; x + 8 <= width; x += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(src + x * 4));
+            __m128i b = _mm_loadu_si128((const __m128i*)(src + x * 4 + 16));
+            StoreLum8(WeightedSum4(a, weights), WeightedSum4(b, weights), dst + x);
+        }
+        RowToLumScalar(src + x * 4, format, dst + x, width - x);
+    } else if (format == PixelFormat::RGB || format == PixelFormat::BGR) {
+        // 每次读 16 字节只用其中 12 字节; 留足余量避免读出行尾
+        for (; x + 11 <= width; x += 8) {
+            __m128i a = Expand24To32(_mm_loadu_si128((const __m128i*)(src + x * 3)));
+            __m128i b = Expand24To32(_mm_loadu_si128((const __m128i*)(src + x * 3 + 12)));
+            StoreLum8(WeightedSum4(a, weights), WeightedSum4(b, weights), dst + x);
+        }
+        RowToLumScalar(src + x * 3, format, dst + x, width - x);
+    } else {
+        RowToLumScalar(src, format, dst, width);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: 同样的算法一次处理 16 像素; 24 位像素先用 pshufb 摊开为 32 位
+// ---------------------------------------------------------------------------
+
+QRCORE_TARGET_AVX2
+static inline __m256i WeightedSum8(__m256i px, __m256i weights) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(px, zero), weights);
+    __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(px, zero), weights);
+    lo = _mm256_add_epi32(lo, _mm256_srli_epi64(lo, 32));
+    hi = _mm256_add_epi32(hi, _mm256_srli_epi64(hi, 32));
+    lo = _mm256_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 2, 0));
+    hi = _mm256_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 2, 0));
+    return _mm256_unpacklo_epi64(lo, hi); // [p0..p3 | p4..p7]
+}
+
+QRCORE_TARGET_AVX2
+static inline void StoreLum16(__m256i a, __m256i b, uint8_t* dst) {
+    const __m256i round = _mm256_set1_epi32(0x200);
+    a = _mm256_srai_epi32(_mm256_add_epi32(a, round), 10);
+    b = _mm256_srai_epi32(_mm256_add_epi32(b, round), 10);
+    __m256i packed = _mm256_packs_epi32(a, b);                         // [a0-3 b0-3 | a4-7 b4-7]
+    packed = _mm256_packus_epi16(packed, _mm256_setzero_si256());      // 每通道低 8 字节有效
+    packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(packed));
+}
+
+QRCORE_TARGET_AVX2
+static inline __m256i Load24x8(const uint8_t* src) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), shuffle);
+    __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 12)), shuffle);
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1);
+}
+
+QRCORE_TARGET_AVX2
+static void RowToLumAVX2(const uint8_t* src, PixelFormat format, uint8_t* dst, int width) {
+    const __m256i weights = (format == PixelFormat::RGB)
+        ? _mm256_setr_epi16(306, 601, 117, 0, 306, 601, 117, 0, 306, 601, 117, 0, 306, 601, 117, 0)
+        : _mm256_setr_epi16(117, 601, 306, 0, 117, 601, 306, 0, 117, 601, 306, 0, 117, 601, 306, 0);
+    int x = 0;
+
+    if (format == PixelFormat::BGRX) {
+        for (; x + 16 <= width; x += 16) {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(src + x * 4));
+            __m256i b = _mm256_loadu_si256((const __m256i*)(src + x * 4 + 32));
+            StoreLum16(WeightedSum8(a, weights), WeightedSum8(b, weights), dst + x);
+        }
+    } else if (format == PixelFormat::RGB || format == PixelFormat::BGR) {
+        // 最后一次 16 字节读取起于 x*3+36, 需要 x*3+52 <= width*3
+        for (; x + 18 <= width; x += 16) {
+            __m256i a = Load24x8(src + x * 3);
+            __m256i b = Load24x8(src + x * 3 + 24);
+            StoreLum16(WeightedSum8(a, weights), WeightedSum8(b, weights), dst + x);
+        }
+    }
+    // 剩余像素交给 SSE2 (其内部再交给标量)
+    RowToLumSSE2(src + x * BytesPerPixel(format), format, dst + x, width - x);
+}
+
+#endif // QRCORE_X86
+
+// ---------------------------------------------------------------------------
+// 运行时分派
+// ---------------------------------------------------------------------------
+
+SimdLevel DetectSimdLevel() {
+#if defined(QRCORE_X86) && defined(_MSC_VER)
+    int info[4] = {0};
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    return avx2 ? SimdLevel::AVX2 : (sse2 ? SimdLevel::SSE2 : SimdLevel::Scalar);
+#elif defined(QRCORE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+    return SimdLevel::Scalar;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+static std::atomic<int> g_activeLevel{-1};
+static std::atomic<int> g_supportedLevel{-1};
+
+SimdLevel ClampSimdLevel(SimdLevel level) {
+    int supported = g_supportedLevel.load(std::memory_order_relaxed);
+    if (supported < 0) {
+        supported = (int)DetectSimdLevel();
+        g_supportedLevel.store(supported, std::memory_order_relaxed);
+    }
+    return std::min(level, (SimdLevel)supported);
+}
+
+SimdLevel ActiveSimdLevel() {
+    int level = g_activeLevel.load(std::memory_order_relaxed);
+    if (level < 0) {
+        level = (int)ClampSimdLevel(SimdLevel::AVX2);
+        g_activeLevel.store(level, std::memory_order_relaxed);
+    }
+    return (SimdLevel)level;
+}
+
+void SetSimdLevel(SimdLevel level) {
+    g_activeLevel.store((int)ClampSimdLevel(level), std::memory_order_relaxed);
+}
+
+void ConvertRowToLum(SimdLevel level, const uint8_t* src, PixelFormat format, uint8_t* dst, int width) {
+    if (width <= 0) {
+        return;
+    }
+    level = ClampSimdLevel(level); // 显式指定的级别也不能超出 CPU 支持, 否则会执行非法指令
+#ifdef QRCORE_X86
+    if (level == SimdLevel::AVX2) {
+        RowToLumAVX2(src, format, dst, width);
+        return;
+    }
+    if (level == SimdLevel::SSE2) {
+        RowToLumSSE2(src, format, dst, width);
+        return;
+    }
+#endif
+    RowToLumScalar(src, format, dst, width);
+}
+
+void ConvertRowToLum(const uint8_t* src, PixelFormat format, uint8_t* dst, int width) {
+    ConvertRowToLum(ActiveSimdLevel(), src, format, dst, width);
+}
+
+bool ConvertToLum(const ImageFrame& src, int left, int top, int width, int height, ImageFrame& outLum) {
+    if (src.empty()) {
+        return false;
+    }
+    int right = std::min(left + width, src.width);
+    int bottom = std::min(top + height, src.height);
+    left = std::max(left, 0);
+    top = std::max(top, 0);
+    if (right <= left || bottom <= top) {
+        return false;
+    }
+
+    ImageFrame lum = AcquireFrame(right - left, bottom - top, PixelFormat::Lum);
+    if (lum.empty()) {
+        return false;
+    }
+    SimdLevel level = ActiveSimdLevel();
+    int bpp = BytesPerPixel(src.format);
+    for (int y = 0; y < lum.height; y++) {
+        ConvertRowToLum(level, src.row(top + y) + left * bpp, src.format, lum.row(y), lum.width);
+    }
+    outLum = lum;
+    return true;
+}
+
+} // namespace qrcore
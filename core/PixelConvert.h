@@ -0,0 +1,57 @@
+/*
+ * 像素格式转换内核: BGRX / RGB / BGR 行 → 8 位灰度
+ *
+ * 提供标量、SSE2、AVX2 三种实现, 运行时按 CPU 能力选择。
+ * 所有实现与标量参考逐字节一致 (同 ZXing 内部的灰度权重),
+ * 因此把转换提前到识别之前不会改变识别结果,
+ * 只是 ZXing 收到的是 1 字节/像素的 ImageFormat::Lum。
+ */
+
+#pragma once
+
+#include "ImageFrame.h"
+
+namespace qrcore {
+
+// 与 ZXing 内部 RGB→灰度 一致的权重: (306 R + 601 G + 117 B + 512) >> 10
+inline uint8_t RGBToLum(unsigned r, unsigned g, unsigned b) {
+    return (uint8_t)((306 * r + 601 * g + 117 * b + 0x200) >> 10);
+}
+
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+const char* SimdLevelName(SimdLevel level);
+
+// CPU (及操作系统) 支持的最高级别
+SimdLevel DetectSimdLevel();
+
+// 当前使用的级别 (默认为 DetectSimdLevel())
+SimdLevel ActiveSimdLevel();
+
+// 强制使用指定级别 (超过 CPU 支持时取 CPU 支持的最高级别), 供测试和基准使用
+void SetSimdLevel(SimdLevel level);
+
+// 把 level 限制到 CPU 支持的最高级别 (检测结果只取一次); 按指定级别分派的内核都先经过这里
+SimdLevel ClampSimdLevel(SimdLevel level);
+
+/**
+ * @brief 转换一行像素为灰度 (使用当前级别)
+ * @param src 行首像素; format 为 Lum 时直接复制
+ */
+void ConvertRowToLum(const uint8_t* src, PixelFormat format, uint8_t* dst, int width);
+
+// 使用指定级别转换一行 (供测试与标量参考对比; 超过 CPU 支持的级别按支持的最高级别执行)
+void ConvertRowToLum(SimdLevel level, const uint8_t* src, PixelFormat format, uint8_t* dst, int width);
+
+/**
+ * @brief 截取并转换为灰度帧 (灰度帧取自 DefaultFramePool)
+ * @param left, top, width, height 源帧中的截取区域 (会裁剪到源帧范围内)
+ * @return 截取区域为空时返回 false
+ */
+bool ConvertToLum(const ImageFrame& src, int left, int top, int width, int height, ImageFrame& outLum);
+
+} // namespace qrcore
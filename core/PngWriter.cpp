@@ -0,0 +1,244 @@
+/*
+ * 二维码 PNG 写出
+ */
+
+#include "PngWriter.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+namespace qrcore {
+
+static const size_t kDeflateBufferSize = 64 * 1024; // 每个 IDAT 块的最大数据量
+
+static void PutBigEndian32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+// 写出一个块: 长度 + 类型 + 数据 + CRC (类型与数据)
+static bool WriteChunk(const PngSink& sink, const char* type, const uint8_t* data, size_t size) {
+    uint8_t header[8];
+    PutBigEndian32(header, (uint32_t)size);
+    memcpy(header + 4, type, 4);
+    uLong crc = crc32(0L, header + 4, 4);
+    if (size > 0) {
+        crc = crc32(crc, data, (uInt)size);
+    }
+    uint8_t trailer[4];
+    PutBigEndian32(trailer, (uint32_t)crc);
+    return sink(header, sizeof(header)) && (size == 0 || sink(data, size)) && sink(trailer, sizeof(trailer));
+}
+
+/*
+ * 逐行压缩并按 IDAT 块写出。输出缓冲区写满即成块, 因此不论图像多大,
+ * 压缩数据都不会整体留在内存中。
+ */
+class IdatStream {
+public:
+    IdatStream(const PngSink& sink) : m_sink(sink), m_buffer(kDeflateBufferSize) {}
+    ~IdatStream() {
+        if (m_initialized) {
+            deflateEnd(&m_stream);
+        }
+    }
+
+    bool Init(int level, std::string& outErrorMsg) {
+        memset(&m_stream, 0, sizeof(m_stream));
+        // 二维码扫描行中大段重复, 默认策略 (LZ77 + Huffman) 即可
+        if (deflateInit(&m_stream, level) != Z_OK) {
+            outErrorMsg = "zlib 初始化失败";
+            return false;
+        }
+        m_initialized = true;
+        m_stream.next_out = m_buffer.data();
+        m_stream.avail_out = (uInt)m_buffer.size();
+        return true;
+    }
+
+    bool Write(const uint8_t* data, size_t size, std::string& outErrorMsg) {
+        m_stream.next_in = const_cast<Bytef*>(data);
+        m_stream.avail_in = (uInt)size;
+        while (m_stream.avail_in > 0) {
+            if (deflate(&m_stream, Z_NO_FLUSH) == Z_STREAM_ERROR) {
+                outErrorMsg = "zlib 压缩失败";
+                return false;
+            }
+            if (m_stream.avail_out == 0 && !FlushChunk(outErrorMsg)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Finish(std::string& outErrorMsg) {
+        for (;;) {
+            int ret = deflate(&m_stream, Z_FINISH);
+            if (ret == Z_STREAM_ERROR) {
+                outErrorMsg = "zlib 压缩失败";
+                return false;
+            }
+            if (ret == Z_STREAM_END) {
+                return FlushChunk(outErrorMsg);
+            }
+            if (m_stream.avail_out == 0 && !FlushChunk(outErrorMsg)) {
+                return false;
+            }
+        }
+    }
+
+private:
+    bool FlushChunk(std::string& outErrorMsg) {
+        size_t size = m_buffer.size() - m_stream.avail_out;
+        if (size > 0 && !WriteChunk(m_sink, "IDAT", m_buffer.data(), size)) {
+            outErrorMsg = "写入 PNG 数据失败";
+            return false;
+        }
+        m_stream.next_out = m_buffer.data();
+        m_stream.avail_out = (uInt)m_buffer.size();
+        return true;
+    }
+
+    const PngSink& m_sink;
+    std::vector<uint8_t> m_buffer;
+    z_stream m_stream;
+    bool m_initialized = false;
+};
+
+// 把模块行 (含静区) 打包为一条扫描行 (不含过滤类型字节)
+static void PackScanline(const ModuleMatrix& matrix, int my, int scale, int border, int bitDepth,
+                         std::vector<uint8_t>& line) {
+    int total = matrix.size + 2 * border;
+    int width = total * scale;
+    bool quietRow = my < 0 || my >= matrix.size;
+
+    if (bitDepth == 8) {
+        for (int mx = 0; mx < total; mx++) {
+            int x = mx - border;
+            bool dark = !quietRow && x >= 0 && x < matrix.size && matrix.get(x, my);
+            memset(&line[(size_t)mx * scale], dark ? 0x00 : 0xFF, scale);
+        }
+        return;
+    }
+
+    // 1 位: 先铺浅色 (1), 再逐像素清零深色; 行尾不足一字节的填充位保持为 1
+    memset(line.data(), 0xFF, line.size());
+    if (quietRow) {
+        return;
+    }
+    for (int x = 0; x < matrix.size; x++) {
+        if (!matrix.get(x, my)) {
+            continue;
+        }
+        int px0 = (x + border) * scale;
+        for (int px = px0; px < px0 + scale && px < width; px++) {
+            line[px >> 3] &= (uint8_t)~(0x80 >> (px & 7));
+        }
+    }
+}
+
+bool WriteQrPng(const ModuleMatrix& matrix, int scale, int border, const PngOptions& options,
+                const PngSink& sink, std::string& outErrorMsg) {
+    if (matrix.empty() || scale <= 0 || border < 0) {
+        outErrorMsg = "二维码或尺寸参数无效";
+        return false;
+    }
+    if (options.bitDepth != 1 && options.bitDepth != 8) {
+        outErrorMsg = "PNG 位深只支持 1 或 8";
+        return false;
+    }
+    if (options.deflateLevel < 0 || options.deflateLevel > 9) {
+        outErrorMsg = "压缩级别应为 0~9";
+        return false;
+    }
+
+    int total = matrix.size + 2 * border;
+    uint32_t side = (uint32_t)total * (uint32_t)scale;
+    bool palette = options.colorMode == PngColorMode::Palette;
+
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    uint8_t ihdr[13];
+    PutBigEndian32(ihdr, side);
+    PutBigEndian32(ihdr + 4, side);
+    ihdr[8] = (uint8_t)options.bitDepth;
+    ihdr[9] = palette ? 3 : 0; // 颜色类型: 3 调色板, 0 灰度
+    ihdr[10] = 0;              // deflate
+    ihdr[11] = 0;              // 自适应过滤
+    ihdr[12] = 0;              // 不交错
+    if (!sink(kSignature, sizeof(kSignature)) || !WriteChunk(sink, "IHDR", ihdr, sizeof(ihdr))) {
+        outErrorMsg = "写入 PNG 头失败";
+        return false;
+    }
+    if (palette) {
+        uint8_t plte[6] = {
+            (uint8_t)(options.darkRgb >> 16), (uint8_t)(options.darkRgb >> 8), (uint8_t)options.darkRgb,
+            (uint8_t)(options.lightRgb >> 16), (uint8_t)(options.lightRgb >> 8), (uint8_t)options.lightRgb,
+        };
+        if (!WriteChunk(sink, "PLTE", plte, sizeof(plte))) {
+            outErrorMsg = "写入 PNG 调色板失败";
+            return false;
+        }
+    }
+
+    IdatStream idat(sink);
+    if (!idat.Init(options.deflateLevel, outErrorMsg)) {
+        return false;
+    }
+
+    // 调色板 8 位时像素值为索引 (0 / 1), 与灰度的 0x00 / 0xFF 不同
+    size_t lineBytes = options.bitDepth == 8 ? side : (side + 7) / 8;
+    std::vector<uint8_t> line(lineBytes);
+    std::vector<uint8_t> repeat(lineBytes + 1, 0);
+    repeat[0] = 2; // Up 过滤: 与上一行相同, 数据全为 0
+    uint8_t filterNone = 0;
+
+    for (int my = -border; my < matrix.size + border; my++) {
+        PackScanline(matrix, my, scale, border, options.bitDepth, line);
+        if (palette && options.bitDepth == 8) {
+            for (uint8_t& value : line) {
+                value = value ? 1 : 0;
+            }
+        }
+        if (!idat.Write(&filterNone, 1, outErrorMsg) || !idat.Write(line.data(), line.size(), outErrorMsg)) {
+            return false;
+        }
+        for (int i = 1; i < scale; i++) {
+            if (!idat.Write(repeat.data(), repeat.size(), outErrorMsg)) {
+                return false;
+            }
+        }
+    }
+    if (!idat.Finish(outErrorMsg)) {
+        return false;
+    }
+
+    if (!WriteChunk(sink, "IEND", nullptr, 0)) {
+        outErrorMsg = "写入 PNG 结尾失败";
+        return false;
+    }
+    return true;
+}
+
+bool SaveQrPngFile(const std::string& path, const ModuleMatrix& matrix, int scale, int border,
+                   const PngOptions& options, std::string& outErrorMsg) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        outErrorMsg = "无法创建文件: " + path;
+        return false;
+    }
+    bool ok = WriteQrPng(matrix, scale, border, options, [file](const uint8_t* data, size_t size) {
+        return fwrite(data, 1, size, file) == size;
+    }, outErrorMsg);
+    if (fclose(file) != 0 && ok) {
+        outErrorMsg = "写入文件失败: " + path;
+        ok = false;
+    }
+    return ok;
+}
+
+} // namespace qrcore
@@ -0,0 +1,51 @@
+/*
+ * 二维码 PNG 写出
+ *
+ * 二维码只有两种颜色, 直接从模块矩阵按行写出 1 位 (或 8 位) 灰度 / 调色板 PNG,
+ * 不经过整幅位图: 每个模块行只打包一条扫描行, 逐行送入 zlib 压缩,
+ * 压缩输出攒满缓冲区即作为一个 IDAT 块写出。内存占用与图像尺寸无关
+ * (一条扫描行 + 压缩缓冲区)。
+ *
+ * 同一模块行重复的像素行使用 PNG 的 Up 过滤 (全 0 字节), 压缩率接近最优。
+ */
+
+#pragma once
+
+#include "QrRaster.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace qrcore {
+
+enum class PngColorMode {
+    Gray,    // 灰度: 深色 0, 浅色最大值
+    Palette, // 调色板: 索引 0 为深色, 1 为浅色 (颜色见 PngOptions)
+};
+
+struct PngOptions {
+    int bitDepth = 1;                      // 1 或 8
+    PngColorMode colorMode = PngColorMode::Gray;
+    uint32_t darkRgb = 0x000000;           // 调色板模式的颜色 (0xRRGGBB)
+    uint32_t lightRgb = 0xFFFFFF;
+    int deflateLevel = 9;                  // zlib 压缩级别 0~9
+};
+
+// 输出回调; 返回 false 表示写入失败 (写出随即中止)
+using PngSink = std::function<bool(const uint8_t* data, size_t size)>;
+
+/**
+ * @brief 把二维码 (scale 倍, 含 border 个模块宽的静区) 写为 PNG 字节流
+ */
+bool WriteQrPng(const ModuleMatrix& matrix, int scale, int border, const PngOptions& options,
+                const PngSink& sink, std::string& outErrorMsg);
+
+/**
+ * @brief 写为 PNG 文件 (路径按本地编码传给 fopen)
+ */
+bool SaveQrPngFile(const std::string& path, const ModuleMatrix& matrix, int scale, int border,
+                   const PngOptions& options, std::string& outErrorMsg);
+
+} // namespace qrcore
@@ -0,0 +1,157 @@
+/*
+ * 二维码预览生成线程
+ */
+
+#include "PreviewWorker.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace qrcore {
+
+// 建议去抖间隔的上下限 (毫秒)
+static const int kMinDebounceMs = 30;
+static const int kMaxDebounceMs = 300;
+
+PreviewWorker::~PreviewWorker() {
+    Stop();
+}
+
+void PreviewWorker::Start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_thread = std::thread(&PreviewWorker::Run, this);
+}
+
+void PreviewWorker::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+        m_generation++;
+        m_hasPending = false;
+        m_pending = Task();
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+uint64_t PreviewWorker::Submit(PreviewRequest request, PreviewCallback onDone) {
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return 0;
+        }
+        generation = ++m_generation;
+        if (m_hasPending) {
+            m_stats.dropped++;
+        }
+        m_pending.generation = generation;
+        m_pending.request = std::move(request);
+        m_pending.onDone = std::move(onDone);
+        m_hasPending = true;
+        m_stats.submitted++;
+    }
+    m_cv.notify_one();
+    return generation;
+}
+
+void PreviewWorker::Cancel() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_generation++;
+    if (m_hasPending) {
+        m_stats.dropped++;
+        m_hasPending = false;
+        m_pending = Task();
+    }
+    m_idleCv.wait(lock, [this] { return !m_busy; });
+}
+
+int PreviewWorker::SuggestedDebounceMs() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int ms = (int)(m_lastJobMs + 0.5);
+    return std::max(kMinDebounceMs, std::min(kMaxDebounceMs, ms));
+}
+
+PreviewStats PreviewWorker::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void PreviewWorker::Run() {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return !m_running || m_hasPending; });
+            if (!m_running) {
+                return;
+            }
+            task = std::move(m_pending);
+            m_pending = Task();
+            m_hasPending = false;
+            m_busy = true;
+        }
+
+        std::unique_ptr<PreviewResult> result = Process(task.generation, task.request);
+
+        // 回调前最后检查一次; 回调在 m_busy 期间执行, Cancel() 会等它结束
+        if (result && IsCurrent(task.generation)) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stats.completed++;
+            }
+            if (task.onDone) {
+                task.onDone(std::move(result));
+            }
+        } else {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.aborted++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy = false;
+        }
+        m_idleCv.notify_all();
+    }
+}
+
+// 依次编码、生成预览; 两个阶段之间发现请求已过时即返回空
+// 原尺寸图像不在这里生成: 保存 PNG 时从模块矩阵逐行写出, JPEG 保存时才光栅化
+std::unique_ptr<PreviewResult> PreviewWorker::Process(uint64_t generation, const PreviewRequest& request) {
+    auto start = std::chrono::steady_clock::now();
+    auto result = std::make_unique<PreviewResult>();
+    result->generation = generation;
+    result->request = request;
+
+    try {
+        result->matrix = m_cache.GetMatrix(request.text, request.ecc);
+    } catch (const std::exception& e) {
+        result->errorMsg = e.what();
+        return result;
+    }
+    if (!IsCurrent(generation)) {
+        return nullptr;
+    }
+
+    result->preview = AllocateFrame(request.previewSize, request.previewSize, PixelFormat::BGRX);
+    RenderQrPreview(*result->matrix.matrix, request.scale, request.border, result->preview);
+
+    result->jobMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lastJobMs = result->jobMs;
+    }
+    return result;
+}
+
+} // namespace qrcore
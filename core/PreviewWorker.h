@@ -0,0 +1,116 @@
+/*
+ * 二维码预览生成线程
+ *
+ * 生成窗口在输入变化时提交 (文本, 纠错级别, 倍数), 编码与光栅化在后台线程完成,
+ * 不再阻塞对话框的消息线程。每次提交都分配一个递增的代号 (generation):
+ *   - 新的提交使之前的所有请求作废, 排队中的请求直接丢弃;
+ *   - 正在处理的请求在编码之后检查代号, 过时即放弃;
+ *   - 只有处理完仍是最新代号的结果才会交给回调。
+ * 回调运行在工作线程上, 与回调并发的新提交仍可能使结果过时,
+ * 接收方应再用 IsCurrent() 过滤。
+ */
+
+#pragma once
+
+#include "QrEncodeCache.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace qrcore {
+
+struct PreviewRequest {
+    std::string text;     // UTF-8
+    int ecc = 1;          // 0~3 (L/M/Q/H)
+    int scale = 8;        // 保存图像的缩放倍数 (预览按它决定是否缩小)
+    int border = 4;       // 静区模块数
+    int previewSize = 380; // 预览边长 (像素)
+};
+
+struct PreviewResult {
+    uint64_t generation = 0;
+    PreviewRequest request;
+    CachedMatrix matrix;  // 取自缓存, 只读
+    ImageFrame preview;   // previewSize 见方的预览 (BGRX)
+    std::string errorMsg; // 非空表示编码失败 (如内容过长)
+    double jobMs = 0;     // 从开始处理到结果就绪的耗时
+};
+
+struct PreviewStats {
+    uint64_t submitted = 0;
+    uint64_t completed = 0; // 交给回调的结果数
+    uint64_t dropped = 0;   // 排队中被新请求替换的
+    uint64_t aborted = 0;   // 处理中途发现过时而放弃的
+};
+
+using PreviewCallback = std::function<void(std::unique_ptr<PreviewResult>)>;
+
+class PreviewWorker {
+public:
+    explicit PreviewWorker(QrEncodeCache& cache) : m_cache(cache) {}
+    ~PreviewWorker();
+
+    PreviewWorker(const PreviewWorker&) = delete;
+    PreviewWorker& operator=(const PreviewWorker&) = delete;
+
+    void Start();
+    // 停止线程; 排队中的请求被丢弃 (不会调用回调)
+    void Stop();
+
+    /**
+     * @brief 提交请求并作废之前的所有请求
+     * @return 该请求的代号; 线程未启动时返回 0
+     */
+    uint64_t Submit(PreviewRequest request, PreviewCallback onDone);
+
+    /**
+     * @brief 作废所有请求, 并等待正在处理的请求 (含其回调) 结束
+     *
+     * 返回后不会再有回调被调用, 直到下一次 Submit。不得在回调中调用。
+     */
+    void Cancel();
+
+    bool IsCurrent(uint64_t generation) const { return generation == m_generation.load(); }
+
+    /**
+     * @brief 按最近的处理耗时建议输入去抖的间隔 (毫秒)
+     *
+     * 过时的请求会被取消, 去抖只用于少做注定作废的编码:
+     * 处理很快时几乎不等待, 处理较慢时约等一次处理的时间。
+     */
+    int SuggestedDebounceMs() const;
+
+    PreviewStats GetStats() const;
+
+private:
+    void Run();
+    std::unique_ptr<PreviewResult> Process(uint64_t generation, const PreviewRequest& request);
+
+    struct Task {
+        uint64_t generation = 0;
+        PreviewRequest request;
+        PreviewCallback onDone;
+    };
+
+    QrEncodeCache& m_cache;
+    std::atomic<uint64_t> m_generation{0};
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;     // 有新请求或停止
+    std::condition_variable m_idleCv; // 当前请求处理完毕
+    Task m_pending;                   // 只保留最新的一个请求
+    bool m_hasPending = false;
+    bool m_busy = false;
+    bool m_running = false;
+    std::thread m_thread;
+    double m_lastJobMs = 0;
+    PreviewStats m_stats;
+};
+
+} // namespace qrcore
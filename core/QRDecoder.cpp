@@ -0,0 +1,206 @@
+/*
+ * 识别核心 - 对 ZXing-CPP 的封装
+ */
+
+#include "QRDecoder.h"
+#include "Trace.h"
+
+#include <ZXing/ReadBarcode.h>
+#include <ZXing/BarcodeFormat.h>
+#include <ZXing/DecodeHints.h>
+#include <ZXing/ImageView.h>
+#include <ZXing/Barcode.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <set>
+#include <tuple>
+#include <utility>
+
+namespace qrcore {
+
+static ZXing::ImageFormat ToZXingFormat(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::Lum: return ZXing::ImageFormat::Lum;
+        case PixelFormat::RGB: return ZXing::ImageFormat::RGB;
+        case PixelFormat::BGR: return ZXing::ImageFormat::BGR;
+        case PixelFormat::BGRX: return ZXing::ImageFormat::BGRX;
+    }
+    return ZXing::ImageFormat::None;
+}
+
+PointI SymbolPosition::center() const {
+    PointI c;
+    c.x = (topLeft.x + topRight.x + bottomRight.x + bottomLeft.x) / 4;
+    c.y = (topLeft.y + topRight.y + bottomRight.y + bottomLeft.y) / 4;
+    return c;
+}
+
+void SymbolPosition::bounds(int& left, int& top, int& right, int& bottom) const {
+    left = std::min({topLeft.x, topRight.x, bottomRight.x, bottomLeft.x});
+    top = std::min({topLeft.y, topRight.y, bottomRight.y, bottomLeft.y});
+    right = std::max({topLeft.x, topRight.x, bottomRight.x, bottomLeft.x});
+    bottom = std::max({topLeft.y, topRight.y, bottomRight.y, bottomLeft.y});
+}
+
+SymbolPosition SymbolPosition::transformed(double scale, int offsetX, int offsetY) const {
+    auto map = [&](PointI p) {
+        PointI q;
+        q.x = (int)std::lround(p.x * scale) + offsetX;
+        q.y = (int)std::lround(p.y * scale) + offsetY;
+        return q;
+    };
+    SymbolPosition r;
+    r.topLeft = map(topLeft);
+    r.topRight = map(topRight);
+    r.bottomRight = map(bottomRight);
+    r.bottomLeft = map(bottomLeft);
+    return r;
+}
+
+static DecodedSymbol ToSymbol(const ZXing::Barcode& barcode) {
+    DecodedSymbol symbol;
+    symbol.text = barcode.text(); // text() 返回 UTF-8
+    symbol.format = ZXing::ToString(barcode.format());
+    const ZXing::Position& pos = barcode.position();
+    symbol.position.topLeft = {pos.topLeft().x, pos.topLeft().y};
+    symbol.position.topRight = {pos.topRight().x, pos.topRight().y};
+    symbol.position.bottomRight = {pos.bottomRight().x, pos.bottomRight().y};
+    symbol.position.bottomLeft = {pos.bottomLeft().x, pos.bottomLeft().y};
+    return symbol;
+}
+
+void DeduplicateSymbols(std::vector<DecodedSymbol>& symbols) {
+    std::set<std::pair<std::string, std::string>> seen;
+    std::vector<DecodedSymbol> unique;
+    for (DecodedSymbol& symbol : symbols) {
+        if (seen.insert({symbol.format, symbol.text}).second) {
+            unique.push_back(std::move(symbol));
+        }
+    }
+
+    // 阅读顺序: 先分行, 再按 (行号, 横坐标) 排序。
+    // "纵坐标相差不到半个码高" 不可传递, 不能直接作为比较函数 (不满足严格弱序), 所以先按中心纵坐标
+    // 排序后逐个分组: 与本行第一个码的中心纵坐标相差不超过两者中较小码高的一半时归入本行, 否则另起一行。
+    struct SortKey {
+        int row;
+        int x;
+        int y;
+        int height;
+        size_t index;
+    };
+    std::vector<SortKey> keys(unique.size());
+    for (size_t i = 0; i < unique.size(); i++) {
+        int left, top, right, bottom;
+        unique[i].position.bounds(left, top, right, bottom);
+        PointI c = unique[i].position.center();
+        keys[i] = {0, c.x, c.y, bottom - top, i};
+    }
+    std::sort(keys.begin(), keys.end(), [](const SortKey& a, const SortKey& b) {
+        return std::tie(a.y, a.x, a.index) < std::tie(b.y, b.x, b.index);
+    });
+    size_t rowStart = 0;
+    for (size_t i = 1; i < keys.size(); i++) {
+        const SortKey& anchor = keys[rowStart];
+        int rowTolerance = std::max(1, std::min(anchor.height, keys[i].height) / 2);
+        keys[i].row = keys[i - 1].row;
+        if (keys[i].y - anchor.y > rowTolerance) {
+            keys[i].row++;
+            rowStart = i;
+        }
+    }
+    std::sort(keys.begin(), keys.end(), [](const SortKey& a, const SortKey& b) {
+        return std::tie(a.row, a.x, a.index) < std::tie(b.row, b.x, b.index);
+    });
+
+    symbols.clear();
+    for (const SortKey& key : keys) {
+        symbols.push_back(std::move(unique[key.index]));
+    }
+}
+
+void FinishResult(ScanResult& result) {
+    result.success = !result.symbols.empty();
+    if (result.success) {
+        result.text = result.symbols.front().text;
+        result.format = result.symbols.front().format;
+        result.errorMsg.clear();
+    }
+}
+
+std::string JoinSymbolTexts(const ScanResult& result, const std::string& separator) {
+    std::string joined;
+    for (size_t i = 0; i < result.symbols.size(); i++) {
+        if (i > 0) {
+            joined += separator;
+        }
+        joined += result.symbols[i].text;
+    }
+    return joined;
+}
+
+ZXing::ImageView MakeImageView(const ImageFrame& frame) {
+    // 关键：传入帧的真实 stride, 32 位 BGRX 行无需任何重排
+    return ZXing::ImageView(frame.data, frame.width, frame.height, ToZXingFormat(frame.format), frame.stride);
+}
+
+bool DecodeFrame(const ImageFrame& frame, const ScanOptions& options, ScanResult& outResult) {
+    outResult = ScanResult();
+
+    try {
+        if (!ValidateFrame(frame, outResult.errorMsg)) {
+            return false;
+        }
+
+        // 1. 配置 ZXing
+        ZXing::DecodeHints hints;
+        hints.setFormats(ZXing::BarcodeFormat::QRCode);
+        hints.setTryHarder(options.tryHarder);
+        hints.setTryRotate(options.tryRotate);
+        hints.setTryInvert(options.tryInvert);
+        hints.setTryDownscale(options.tryDownscale);
+        hints.setMaxNumberOfSymbols((uint8_t)(options.maxSymbols <= 0 || options.maxSymbols > 255 ? 255 : options.maxSymbols));
+
+        // 2. 直接在帧内存上创建 ImageView (不复制像素)
+        ZXing::ImageView imageView = MakeImageView(frame);
+
+        // 3. 识别 (多码模式一次取出选区内的全部码)
+        auto start = std::chrono::steady_clock::now();
+        if (options.maxSymbols == 1) {
+            QRCORE_TRACE_SCOPE("ZXing::ReadBarcode");
+            ZXing::Barcode barcode = ZXing::ReadBarcode(imageView, hints);
+            if (barcode.isValid()) {
+                outResult.symbols.push_back(ToSymbol(barcode));
+            }
+        } else {
+            QRCORE_TRACE_SCOPE("ZXing::ReadBarcodes");
+            for (const ZXing::Barcode& barcode : ZXing::ReadBarcodes(imageView, hints)) {
+                if (barcode.isValid()) {
+                    outResult.symbols.push_back(ToSymbol(barcode));
+                }
+            }
+            DeduplicateSymbols(outResult.symbols);
+        }
+        outResult.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        FinishResult(outResult);
+        if (outResult.success) {
+            return true;
+        }
+
+        outResult.errorMsg = "未能在图像中识别到二维码。\n请确保截图清晰且完整。";
+        return false;
+
+    } catch (const std::exception& e) {
+        outResult.errorMsg = "识别异常: ";
+        outResult.errorMsg += e.what();
+        return false;
+    } catch (...) {
+        outResult.errorMsg = "识别过程中发生未知异常";
+        return false;
+    }
+}
+
+} // namespace qrcore
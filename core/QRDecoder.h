@@ -0,0 +1,93 @@
+/*
+ * 识别核心 - 对 ZXing-CPP 的封装
+ */
+
+#pragma once
+
+#include "ImageFrame.h"
+
+#include <ZXing/ImageView.h>
+
+#include <string>
+#include <vector>
+
+namespace qrcore {
+
+// 识别参数 (对应 ZXing::DecodeHints 中实际使用的选项)
+struct ScanOptions {
+    bool tryHarder = true;    // 启用更强的识别
+    bool tryRotate = true;    // 启用旋转识别
+    bool tryInvert = false;   // 同时尝试反色 (浅色码深色底)
+    bool tryDownscale = true; // 大图先缩小再识别 (ZXing 默认开启)
+    int maxSymbols = 1;       // 最多识别的码数; 1 为只取第一个, 0 为不限
+};
+
+struct PointI {
+    int x = 0;
+    int y = 0;
+};
+
+// 码在帧中的四个角 (左上、右上、右下、左下, 按码自身方向)
+struct SymbolPosition {
+    PointI topLeft, topRight, bottomRight, bottomLeft;
+
+    PointI center() const;
+    // 四角的外接矩形
+    void bounds(int& left, int& top, int& right, int& bottom) const;
+    // 平移 / 缩放到另一坐标系 (如从缩小图或分块映射回整帧)
+    SymbolPosition transformed(double scale, int offsetX, int offsetY) const;
+};
+
+struct DecodedSymbol {
+    std::string text;   // 识别内容 (UTF-8)
+    std::string format; // 码制名称, 如 "QRCode"
+    SymbolPosition position;
+};
+
+// 一次识别的结果, 由解码线程交回 UI 线程显示
+struct ScanResult {
+    bool success = false;
+    std::vector<DecodedSymbol> symbols; // 识别到的全部码 (去重, 按阅读顺序)
+    std::string text;     // 第一个码的内容 (UTF-8)
+    std::string format;   // 第一个码的码制名称
+    std::string errorMsg; // 失败原因 (仅 success == false 时有效)
+    double decodeMs = 0;  // ZXing 识别耗时 (毫秒, 多层级时为各层之和)
+
+    // 以下由分级识别 (DecodeCascade) 填写
+    std::string tier;     // 成功的层级名称
+    int tierIndex = -1;   // 成功的层级序号 (从 0 开始), 失败为 -1
+    int tiersTried = 0;   // 实际尝试的层级数
+    int scale = 1;        // 成功时所在金字塔层级的缩小倍数 (1 为原图)
+    double totalMs = 0;   // 含预处理在内的总耗时 (毫秒)
+    bool budgetExceeded = false; // 是否因超出时间预算而提前停止
+
+    bool cached = false;  // 结果取自识别结果缓存 (DecodeResultCache), 未实际识别
+};
+
+/**
+ * @brief 以帧内存为底创建 ZXing::ImageView, 不复制像素
+ */
+ZXing::ImageView MakeImageView(const ImageFrame& frame);
+
+/**
+ * @brief 识别图像帧中的二维码
+ *
+ * options.maxSymbols != 1 时使用 ZXing::ReadBarcodes 一次识别全部码。
+ * @return 识别成功返回 true; 失败时 outResult.errorMsg 给出原因
+ */
+bool DecodeFrame(const ImageFrame& frame, const ScanOptions& options, ScanResult& outResult);
+
+/**
+ * @brief 去除内容和码制相同的重复码 (保留先出现的), 再按阅读顺序 (自上而下、自左而右) 排列
+ *
+ * 先按中心纵坐标分行 (与行首码相差不超过半个码高的归入同一行), 行内按中心横坐标排列。
+ */
+void DeduplicateSymbols(std::vector<DecodedSymbol>& symbols);
+
+// 根据 symbols 填写 success / text / format
+void FinishResult(ScanResult& result);
+
+// 以 separator 连接全部码的内容, 用于复制到剪贴板
+std::string JoinSymbolTexts(const ScanResult& result, const std::string& separator);
+
+} // namespace qrcore
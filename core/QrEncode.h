@@ -0,0 +1,43 @@
+/*
+ * 用 qrcodegen 把文本编码为模块矩阵 (托盘程序生成窗口、qrgen、qrbench 共用)
+ *
+ * 识别核心的静态库不依赖编码库 (QrEncodeCache 通过回调注入编码函数),
+ * 这里只有内联函数, 只由链接了 nayuki-qr-code-generator 的目标包含。
+ */
+
+#pragma once
+
+#include "QrRaster.h"
+#include "qrcodegen.hpp"
+
+#include <cctype>
+#include <string>
+
+namespace qrcore {
+
+/**
+ * @brief 按 qrcodegen 的自动模式选择编码 UTF-8 文本
+ * @param ecc 0~3 (L/M/Q/H)
+ * @throws qrcodegen::data_too_long 内容超出版本 40 的容量
+ */
+inline ModuleMatrix EncodeQrText(const std::string& text, int ecc) {
+    return ToModuleMatrix(qrcodegen::QrCode::encodeText(text.c_str(), (qrcodegen::QrCode::Ecc)ecc));
+}
+
+/**
+ * @brief 解析纠错级别: L / M / Q / H (不区分大小写) 或 0~3
+ */
+inline bool ParseEccLevel(const std::string& text, int& outEcc) {
+    if (text.size() != 1) {
+        return false;
+    }
+    switch (std::toupper((unsigned char)text[0])) {
+        case 'L': case '0': outEcc = 0; return true;
+        case 'M': case '1': outEcc = 1; return true;
+        case 'Q': case '2': outEcc = 2; return true;
+        case 'H': case '3': outEcc = 3; return true;
+        default: return false;
+    }
+}
+
+} // namespace qrcore
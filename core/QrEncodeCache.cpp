@@ -0,0 +1,100 @@
+/*
+ * 二维码编码结果缓存
+ */
+
+#include "QrEncodeCache.h"
+
+namespace qrcore {
+
+QrEncodeCache::QrEncodeCache(Encoder encoder, size_t matrixCapacity, size_t rasterCapacity)
+    : m_encoder(std::move(encoder)),
+      m_matrixCapacity(matrixCapacity > 0 ? matrixCapacity : 1),
+      m_rasterCapacity(rasterCapacity > 0 ? rasterCapacity : 1) {}
+
+CachedMatrix QrEncodeCache::GetMatrix(const std::string& text, int ecc) {
+    // 纠错级别放在键首, 文本可含任意字节
+    std::string key = std::to_string(ecc) + ':' + text;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_matrixIndex.find(key);
+        if (it != m_matrixIndex.end()) {
+            m_matrices.splice(m_matrices.begin(), m_matrices, it->second);
+            m_stats.matrixHits++;
+            return it->second->value;
+        }
+        m_stats.matrixMisses++;
+    }
+
+    // 编码不持锁 (大版本编码需要数毫秒); 编码失败的异常直接抛给调用方
+    auto matrix = std::make_shared<const ModuleMatrix>(m_encoder(text, ecc));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_matrixIndex.find(key);
+    if (it != m_matrixIndex.end()) {
+        // 其他线程已先一步编码了相同内容
+        m_matrices.splice(m_matrices.begin(), m_matrices, it->second);
+        return it->second->value;
+    }
+    CachedMatrix value;
+    value.matrix = matrix;
+    value.id = m_nextId++;
+    m_matrices.push_front({key, value});
+    m_matrixIndex[key] = m_matrices.begin();
+    while (m_matrices.size() > m_matrixCapacity) {
+        m_matrixIndex.erase(m_matrices.back().key);
+        m_matrices.pop_back();
+    }
+    return value;
+}
+
+ImageFrame QrEncodeCache::GetRaster(const CachedMatrix& matrix, int scale, int border, PixelFormat format) {
+    if (matrix.empty()) {
+        return ImageFrame();
+    }
+    std::string key = std::to_string(matrix.id) + ':' + std::to_string(scale) + ':' +
+                      std::to_string(border) + ':' + std::to_string((int)format);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_rasterIndex.find(key);
+        if (it != m_rasterIndex.end()) {
+            m_rasters.splice(m_rasters.begin(), m_rasters, it->second);
+            m_stats.rasterHits++;
+            return it->second->frame;
+        }
+        m_stats.rasterMisses++;
+    }
+
+    ImageFrame frame;
+    if (!RasterizeQr(*matrix.matrix, scale, border, format, frame)) {
+        return ImageFrame();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_rasterIndex.find(key);
+    if (it != m_rasterIndex.end()) {
+        m_rasters.splice(m_rasters.begin(), m_rasters, it->second);
+        return it->second->frame;
+    }
+    m_rasters.push_front({key, frame});
+    m_rasterIndex[key] = m_rasters.begin();
+    while (m_rasters.size() > m_rasterCapacity) {
+        m_rasterIndex.erase(m_rasters.back().key);
+        m_rasters.pop_back();
+    }
+    return frame;
+}
+
+EncodeCacheStats QrEncodeCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void QrEncodeCache::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_matrices.clear();
+    m_matrixIndex.clear();
+    m_rasters.clear();
+    m_rasterIndex.clear();
+}
+
+} // namespace qrcore
@@ -0,0 +1,87 @@
+/*
+ * 二维码编码结果缓存
+ *
+ * 生成窗口里切换尺寸、重新复制或保存时内容没有变化, 不应重新编码。
+ * 两层 LRU 缓存:
+ *   1. 模块矩阵, 按 (UTF-8 文本, 纠错级别) 索引
+ *   2. 光栅图像, 按 (模块矩阵, 缩放倍数, 静区, 像素格式) 索引
+ * 编码本身由调用方提供 (如 qrcodegen), 核心不依赖编码库。
+ *
+ * 缓存的矩阵与图像为只读共享, 调用方不得修改其内容。线程安全。
+ */
+
+#pragma once
+
+#include "QrRaster.h"
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace qrcore {
+
+// 缓存中的模块矩阵; id 在缓存内唯一, 用作光栅层的索引
+struct CachedMatrix {
+    std::shared_ptr<const ModuleMatrix> matrix;
+    uint64_t id = 0;
+
+    bool empty() const { return !matrix; }
+};
+
+struct EncodeCacheStats {
+    uint64_t matrixHits = 0;
+    uint64_t matrixMisses = 0;
+    uint64_t rasterHits = 0;
+    uint64_t rasterMisses = 0;
+};
+
+class QrEncodeCache {
+public:
+    // 编码函数: ecc 为 0~3 (L/M/Q/H); 失败时可抛出异常 (如内容过长), 异常原样传给调用方
+    using Encoder = std::function<ModuleMatrix(const std::string& text, int ecc)>;
+
+    explicit QrEncodeCache(Encoder encoder, size_t matrixCapacity = 32, size_t rasterCapacity = 16);
+
+    /**
+     * @brief 取得 (text, ecc) 的模块矩阵, 未命中时调用编码函数并缓存
+     */
+    CachedMatrix GetMatrix(const std::string& text, int ecc);
+
+    /**
+     * @brief 取得模块矩阵按 scale 倍光栅化 (含 border 模块静区) 的图像, 未命中时光栅化并缓存
+     * @return 参数无效时返回空帧
+     */
+    ImageFrame GetRaster(const CachedMatrix& matrix, int scale, int border, PixelFormat format);
+
+    EncodeCacheStats GetStats() const;
+    void Clear();
+
+private:
+    struct MatrixEntry {
+        std::string key;
+        CachedMatrix value;
+    };
+    struct RasterEntry {
+        std::string key;
+        ImageFrame frame;
+    };
+
+    Encoder m_encoder;
+    size_t m_matrixCapacity;
+    size_t m_rasterCapacity;
+    uint64_t m_nextId = 1;
+
+    mutable std::mutex m_mutex;
+    // 链表头为最近使用; 索引指向链表节点
+    std::list<MatrixEntry> m_matrices;
+    std::unordered_map<std::string, std::list<MatrixEntry>::iterator> m_matrixIndex;
+    std::list<RasterEntry> m_rasters;
+    std::unordered_map<std::string, std::list<RasterEntry>::iterator> m_rasterIndex;
+    EncodeCacheStats m_stats;
+};
+
+} // namespace qrcore
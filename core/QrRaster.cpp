@@ -0,0 +1,122 @@
+/*
+ * 二维码模块矩阵光栅化
+ */
+
+#include "QrRaster.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace qrcore {
+
+static const uint8_t kDark = 0x00;
+static const uint8_t kLight = 0xFF;
+
+int QrImageSize(const ModuleMatrix& matrix, int scale, int border) {
+    return (matrix.size + 2 * border) * scale;
+}
+
+// 填充一行中 [x0, x1) 像素 (字节值相同的颜色)
+static void FillSpan(uint8_t* row, int bpp, int x0, int x1, uint8_t value) {
+    if (x1 > x0) {
+        memset(row + (size_t)x0 * bpp, value, (size_t)(x1 - x0) * bpp);
+    }
+}
+
+/*
+ * 按模块边界表绘制: edges[i] 为第 i 个模块 (含静区) 左/上边界相对 (left, top) 的像素偏移,
+ * edges[total] 为总边长。
+ */
+static void DrawWithEdges(const ModuleMatrix& matrix, int border, const std::vector<int>& edges,
+                          int left, int top, ImageFrame& target) {
+    int bpp = BytesPerPixel(target.format);
+    int total = matrix.size + 2 * border;
+    int x0 = left, x1 = left + edges[total];
+    size_t spanBytes = (size_t)(x1 - x0) * bpp;
+
+    // 上下静区
+    for (int y = top; y < top + edges[border]; y++) {
+        FillSpan(target.row(y), bpp, x0, x1, kLight);
+    }
+    for (int y = top + edges[border + matrix.size]; y < top + edges[total]; y++) {
+        FillSpan(target.row(y), bpp, x0, x1, kLight);
+    }
+
+    for (int my = 0; my < matrix.size; my++) {
+        int y0 = top + edges[border + my];
+        int y1 = top + edges[border + my + 1];
+        if (y1 <= y0) {
+            continue; // 缩小时被合并掉的模块行
+        }
+
+        // 生成该模块行的第一条像素行: 先铺白, 再按深色游程填充
+        uint8_t* row = target.row(y0);
+        FillSpan(row, bpp, x0, x1, kLight);
+        const uint8_t* modules = &matrix.modules[(size_t)my * matrix.size];
+        for (int mx = 0; mx < matrix.size;) {
+            if (!modules[mx]) {
+                mx++;
+                continue;
+            }
+            int runStart = mx;
+            while (mx < matrix.size && modules[mx]) {
+                mx++;
+            }
+            FillSpan(row, bpp, left + edges[border + runStart], left + edges[border + mx], kDark);
+        }
+
+        // 其余像素行整行复制
+        for (int y = y0 + 1; y < y1; y++) {
+            memcpy(target.row(y) + (size_t)x0 * bpp, row + (size_t)x0 * bpp, spanBytes);
+        }
+    }
+}
+
+bool RasterizeQr(const ModuleMatrix& matrix, int scale, int border, PixelFormat format, ImageFrame& outFrame) {
+    if (matrix.empty() || scale <= 0 || border < 0) {
+        return false;
+    }
+
+    int total = matrix.size + 2 * border;
+    ImageFrame frame = AllocateFrame(total * scale, total * scale, format);
+    std::vector<int> edges(total + 1);
+    for (int i = 0; i <= total; i++) {
+        edges[i] = i * scale;
+    }
+    DrawWithEdges(matrix, border, edges, 0, 0, frame);
+    outFrame = frame;
+    return true;
+}
+
+bool DrawQrScaled(const ModuleMatrix& matrix, int border, int left, int top, int sizePx, ImageFrame& target) {
+    if (matrix.empty() || border < 0 || sizePx <= 0 || target.empty() ||
+        left < 0 || top < 0 || left + sizePx > target.width || top + sizePx > target.height) {
+        return false;
+    }
+
+    int total = matrix.size + 2 * border;
+    std::vector<int> edges(total + 1);
+    for (int i = 0; i <= total; i++) {
+        edges[i] = (int)(((int64_t)i * sizePx + total / 2) / total);
+    }
+    DrawWithEdges(matrix, border, edges, left, top, target);
+    return true;
+}
+
+bool RenderQrPreview(const ModuleMatrix& matrix, int scale, int border, ImageFrame& target) {
+    if (matrix.empty() || target.empty()) {
+        return false;
+    }
+
+    int bpp = BytesPerPixel(target.format);
+    for (int y = 0; y < target.height; y++) {
+        FillSpan(target.row(y), bpp, 0, target.width, kLight);
+    }
+
+    // 只缩小不放大
+    int fullSize = QrImageSize(matrix, scale, border);
+    int sizePx = std::min(fullSize, std::min(target.width, target.height));
+    return DrawQrScaled(matrix, border, (target.width - sizePx) / 2, (target.height - sizePx) / 2, sizePx, target);
+}
+
+} // namespace qrcore
@@ -0,0 +1,69 @@
+/*
+ * 二维码模块矩阵光栅化
+ *
+ * 把模块矩阵直接写成像素行: 同一行中相邻的深色模块合并为一段连续填充,
+ * 一个模块行只生成一次像素行, 其余像素行按缩放倍数整行复制。
+ * 黑白两色在各像素格式下都是全 0 / 全 0xFF 字节, 因此任意格式都只需 memset / memcpy。
+ *
+ * 预览可直接按最终尺寸生成 (模块边界按比例取整), 不必先画原尺寸再缩放。
+ */
+
+#pragma once
+
+#include "ImageFrame.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace qrcore {
+
+// 二维码模块矩阵 (与编码库无关)
+struct ModuleMatrix {
+    int size = 0;                 // 每边模块数
+    std::vector<uint8_t> modules; // 行优先, 1 为深色
+
+    bool empty() const { return size <= 0; }
+    bool get(int x, int y) const { return modules[(size_t)y * size + x] != 0; }
+};
+
+/**
+ * @brief 从编码库的结果复制模块矩阵
+ *
+ * Code 需提供 getSize() 与 getModule(x, y) (如 qrcodegen::QrCode)。
+ */
+template <class Code>
+ModuleMatrix ToModuleMatrix(const Code& code) {
+    ModuleMatrix matrix;
+    matrix.size = code.getSize();
+    matrix.modules.resize((size_t)matrix.size * matrix.size);
+    for (int y = 0; y < matrix.size; y++) {
+        for (int x = 0; x < matrix.size; x++) {
+            matrix.modules[(size_t)y * matrix.size + x] = code.getModule(x, y) ? 1 : 0;
+        }
+    }
+    return matrix;
+}
+
+// 含静区的图像边长 (像素)
+int QrImageSize(const ModuleMatrix& matrix, int scale, int border);
+
+/**
+ * @brief 按整数倍缩放光栅化为新帧 (含 border 个模块宽的白色静区)
+ */
+bool RasterizeQr(const ModuleMatrix& matrix, int scale, int border, PixelFormat format, ImageFrame& outFrame);
+
+/**
+ * @brief 把二维码 (含静区) 缩放到 sizePx 见方, 绘制到 target 的 (left, top) 处
+ *
+ * 模块边界按比例取整, sizePx 可以不是模块数的整数倍; 只写入该正方形区域。
+ */
+bool DrawQrScaled(const ModuleMatrix& matrix, int border, int left, int top, int sizePx, ImageFrame& target);
+
+/**
+ * @brief 按最终尺寸生成预览: 白底, 二维码居中
+ *
+ * 原尺寸 (scale 倍) 放得下时按原尺寸绘制, 否则等比缩小到 target 的短边。
+ */
+bool RenderQrPreview(const ModuleMatrix& matrix, int scale, int border, ImageFrame& target);
+
+} // namespace qrcore
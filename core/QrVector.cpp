@@ -0,0 +1,179 @@
+/*
+ * 二维码矢量导出 (SVG / PDF)
+ */
+
+#include "QrVector.h"
+
+#include <cstdio>
+#include <map>
+#include <utility>
+
+#include <zlib.h>
+
+namespace qrcore {
+
+std::vector<ModuleRect> MergeModuleRects(const ModuleMatrix& matrix) {
+    std::vector<ModuleRect> rects;
+    // 上一行仍可向下延伸的矩形: (起点, 终点) -> rects 下标
+    std::map<std::pair<int, int>, size_t> open, next;
+
+    for (int y = 0; y < matrix.size; y++) {
+        next.clear();
+        for (int x = 0; x < matrix.size;) {
+            if (!matrix.get(x, y)) {
+                x++;
+                continue;
+            }
+            int start = x;
+            while (x < matrix.size && matrix.get(x, y)) {
+                x++;
+            }
+            auto key = std::make_pair(start, x);
+            auto it = open.find(key);
+            if (it != open.end()) {
+                rects[it->second].height++;
+                next[key] = it->second;
+            } else {
+                ModuleRect rect;
+                rect.x = start;
+                rect.y = y;
+                rect.width = x - start;
+                rect.height = 1;
+                next[key] = rects.size();
+                rects.push_back(rect);
+            }
+        }
+        open.swap(next);
+    }
+    return rects;
+}
+
+static bool CheckOptions(const ModuleMatrix& matrix, const VectorOptions& options, std::string& outErrorMsg) {
+    if (matrix.empty()) {
+        outErrorMsg = "二维码为空";
+        return false;
+    }
+    if (!(options.sizeMm > 0) || options.border < 0) {
+        outErrorMsg = "尺寸或静区参数无效";
+        return false;
+    }
+    return true;
+}
+
+static std::string HexColor(uint32_t rgb) {
+    char buffer[8];
+    snprintf(buffer, sizeof(buffer), "#%06x", (unsigned)(rgb & 0xFFFFFF));
+    return buffer;
+}
+
+bool BuildQrSvg(const ModuleMatrix& matrix, const VectorOptions& options, std::string& outSvg,
+                std::string& outErrorMsg) {
+    if (!CheckOptions(matrix, options, outErrorMsg)) {
+        return false;
+    }
+    int total = matrix.size + 2 * options.border;
+    char buffer[256];
+
+    std::string svg = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    snprintf(buffer, sizeof(buffer),
+             "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" width=\"%.3fmm\" height=\"%.3fmm\" "
+             "viewBox=\"0 0 %d %d\" shape-rendering=\"crispEdges\">\n",
+             options.sizeMm, options.sizeMm, total, total);
+    svg += buffer;
+    if (options.background) {
+        snprintf(buffer, sizeof(buffer), "<rect width=\"%d\" height=\"%d\" fill=\"%s\"/>\n", total, total,
+                 HexColor(options.lightRgb).c_str());
+        svg += buffer;
+    }
+
+    // 每个矩形: M x y h w v h h -w z (整数模块坐标)
+    svg += "<path fill=\"" + HexColor(options.darkRgb) + "\" d=\"";
+    for (const ModuleRect& rect : MergeModuleRects(matrix)) {
+        snprintf(buffer, sizeof(buffer), "M%d %dh%dv%dh-%dz", rect.x + options.border, rect.y + options.border,
+                 rect.width, rect.height, rect.width);
+        svg += buffer;
+    }
+    svg += "\"/>\n</svg>\n";
+
+    outSvg.swap(svg);
+    return true;
+}
+
+static void AppendPdfColor(std::string& out, uint32_t rgb) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.3f %.3f %.3f rg\n", ((rgb >> 16) & 0xFF) / 255.0,
+             ((rgb >> 8) & 0xFF) / 255.0, (rgb & 0xFF) / 255.0);
+    out += buffer;
+}
+
+bool BuildQrPdf(const ModuleMatrix& matrix, const VectorOptions& options, std::string& outPdf,
+                std::string& outErrorMsg) {
+    if (!CheckOptions(matrix, options, outErrorMsg)) {
+        return false;
+    }
+    int total = matrix.size + 2 * options.border;
+    double side = options.sizeMm * 72.0 / 25.4; // 毫米 -> 点
+    double unit = side / total;
+    char buffer[256];
+
+    // 内容流: 先画背景, 再把坐标系变换为以模块为单位、原点在左上角
+    std::string content = "q\n";
+    if (options.background) {
+        AppendPdfColor(content, options.lightRgb);
+        snprintf(buffer, sizeof(buffer), "0 0 %.4f %.4f re f\n", side, side);
+        content += buffer;
+    }
+    snprintf(buffer, sizeof(buffer), "%.6f 0 0 %.6f 0 %.4f cm\n", unit, -unit, side);
+    content += buffer;
+    AppendPdfColor(content, options.darkRgb);
+    for (const ModuleRect& rect : MergeModuleRects(matrix)) {
+        snprintf(buffer, sizeof(buffer), "%d %d %d %d re\n", rect.x + options.border, rect.y + options.border,
+                 rect.width, rect.height);
+        content += buffer;
+    }
+    content += "f\nQ\n";
+
+    std::vector<uint8_t> compressed(compressBound((uLong)content.size()));
+    uLongf compressedSize = (uLongf)compressed.size();
+    if (compress2(compressed.data(), &compressedSize, (const Bytef*)content.data(), (uLong)content.size(),
+                  Z_DEFAULT_COMPRESSION) != Z_OK) {
+        outErrorMsg = "压缩 PDF 内容失败";
+        return false;
+    }
+
+    // 对象 1 目录, 2 页面树, 3 页面, 4 内容流; 交叉引用表记录各对象的字节偏移
+    std::string pdf = "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n";
+    std::vector<size_t> offsets;
+    offsets.push_back(pdf.size());
+    pdf += "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n";
+    offsets.push_back(pdf.size());
+    pdf += "2 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n";
+    offsets.push_back(pdf.size());
+    snprintf(buffer, sizeof(buffer),
+             "3 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %.4f %.4f] /Resources << >> "
+             "/Contents 4 0 R >>\nendobj\n",
+             side, side);
+    pdf += buffer;
+    offsets.push_back(pdf.size());
+    snprintf(buffer, sizeof(buffer), "4 0 obj\n<< /Length %lu /Filter /FlateDecode >>\nstream\n",
+             (unsigned long)compressedSize);
+    pdf += buffer;
+    pdf.append((const char*)compressed.data(), compressedSize);
+    pdf += "\nendstream\nendobj\n";
+
+    size_t xref = pdf.size();
+    snprintf(buffer, sizeof(buffer), "xref\n0 %zu\n0000000000 65535 f \n", offsets.size() + 1);
+    pdf += buffer;
+    for (size_t offset : offsets) {
+        snprintf(buffer, sizeof(buffer), "%010zu 00000 n \n", offset);
+        pdf += buffer;
+    }
+    snprintf(buffer, sizeof(buffer), "trailer\n<< /Size %zu /Root 1 0 R >>\nstartxref\n%zu\n%%%%EOF\n",
+             offsets.size() + 1, xref);
+    pdf += buffer;
+
+    outPdf.swap(pdf);
+    return true;
+}
+
+} // namespace qrcore
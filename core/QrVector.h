@@ -0,0 +1,52 @@
+/*
+ * 二维码矢量导出 (SVG / PDF)
+ *
+ * 模块矩阵先合并为矩形: 行内相邻的深色模块合并为一段, 上下行中起止相同的段
+ * 再合并为一个更高的矩形。坐标以模块为单位写出, 由 SVG 的 viewBox /
+ * PDF 的变换矩阵缩放到物理尺寸, 因此文件大小与打印尺寸无关。
+ */
+
+#pragma once
+
+#include "QrRaster.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace qrcore {
+
+// 以模块为单位的矩形 (不含静区偏移)
+struct ModuleRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+struct VectorOptions {
+    double sizeMm = 50.0;         // 含静区的边长 (毫米)
+    int border = 4;               // 静区模块数
+    uint32_t darkRgb = 0x000000;  // 0xRRGGBB
+    uint32_t lightRgb = 0xFFFFFF;
+    bool background = true;       // 是否绘制浅色背景 (含静区)
+};
+
+/**
+ * @brief 把深色模块合并为矩形 (按行优先的顺序)
+ */
+std::vector<ModuleRect> MergeModuleRects(const ModuleMatrix& matrix);
+
+/**
+ * @brief 生成 SVG 文档 (单个 path, 尺寸以毫米标注)
+ */
+bool BuildQrSvg(const ModuleMatrix& matrix, const VectorOptions& options, std::string& outSvg,
+                std::string& outErrorMsg);
+
+/**
+ * @brief 生成单页 PDF (页面即二维码含静区的尺寸, 内容流 Flate 压缩)
+ */
+bool BuildQrPdf(const ModuleMatrix& matrix, const VectorOptions& options, std::string& outPdf,
+                std::string& outErrorMsg);
+
+} // namespace qrcore
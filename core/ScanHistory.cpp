@@ -0,0 +1,736 @@
+/*
+ * 扫描历史: 只追加的日志 + 三元组索引
+ */
+
+#include "ScanHistory.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace qrcore {
+
+// 日志: 头 "QRHL" | 版本 u16 | 保留 u16 | 保留 u64, 之后为记录:
+//   正文长度 u32 | 正文 CRC32 u32 | 正文: 时间 i64 | 来源 u8 | 码制长度 u8 | 保留 u16 | 内容长度 u32 | 码制 | 内容
+// 索引: 头 "QRHI" | 版本 u16 | 保留 u16 | 覆盖的日志字节数 u64 | 记录数 u32 | 三元组数 u32
+//       | 记录号总数 u64 | 最后一条记录的 CRC32 u32 | 以上各字段的 CRC32 u32,
+//       之后为 记录偏移 u64 × 记录数 | (三元组 u32, 个数 u32, 起始 u64) × 三元组数 | 记录号 u32 × 总数
+// 整数均为小端
+static const char kLogMagic[4] = {'Q', 'R', 'H', 'L'};
+static const char kIndexMagic[4] = {'Q', 'R', 'H', 'I'};
+static const uint16_t kVersion = 1;
+static const size_t kLogHeaderSize = 16;
+static const size_t kRecordHeaderSize = 8;
+static const size_t kBodyFixedSize = 16;
+static const size_t kIndexHeaderSize = 40;
+static const size_t kTrigramEntrySize = 16;
+static const uint32_t kMaxBodySize = 1u << 24; // 单条记录上限, 超出视为损坏
+
+static inline uint32_t GetU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t GetU64(const uint8_t* p) {
+    return (uint64_t)GetU32(p) | ((uint64_t)GetU32(p + 4) << 32);
+}
+
+static inline void PutU32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static inline void PutU64(uint8_t* p, uint64_t value) {
+    PutU32(p, (uint32_t)value);
+    PutU32(p + 4, (uint32_t)(value >> 32));
+}
+
+static inline uint8_t FoldAscii(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+// 内容中不同的三元组 (ASCII 转小写后), 升序
+static void ExtractTrigrams(const uint8_t* text, size_t size, std::vector<uint32_t>& outTrigrams) {
+    outTrigrams.clear();
+    if (size < 3) {
+        return;
+    }
+    uint32_t gram = ((uint32_t)FoldAscii(text[0]) << 8) | FoldAscii(text[1]);
+    for (size_t i = 2; i < size; i++) {
+        gram = ((gram << 8) | FoldAscii(text[i])) & 0xFFFFFF;
+        outTrigrams.push_back(gram);
+    }
+    std::sort(outTrigrams.begin(), outTrigrams.end());
+    outTrigrams.erase(std::unique(outTrigrams.begin(), outTrigrams.end()), outTrigrams.end());
+}
+
+// text 中是否含 foldedQuery (已转小写, ASCII 不区分大小写)
+static bool ContainsFolded(const uint8_t* text, size_t size, const std::string& foldedQuery) {
+    if (foldedQuery.empty()) {
+        return true;
+    }
+    const uint8_t* end = text + size;
+    const uint8_t* found = std::search(text, end, foldedQuery.begin(), foldedQuery.end(),
+                                       [](uint8_t a, char b) { return FoldAscii(a) == (uint8_t)b; });
+    return found != end;
+}
+
+// 三元组表中的 (起始, 个数) 是否位于记录号列表内
+static inline bool PostingRangeValid(uint64_t start, uint32_t count, uint64_t postingCount) {
+    return start <= postingCount && count <= postingCount - start;
+}
+
+// 解析 data[offset] 处的记录; 成功时给出正文位置、长度和 CRC
+static bool ParseRecord(const uint8_t* data, uint64_t size, uint64_t offset, const uint8_t*& outBody,
+                        uint32_t& outBodySize, uint32_t& outCrc) {
+    if (offset + kRecordHeaderSize > size) {
+        return false;
+    }
+    uint32_t bodySize = GetU32(data + offset);
+    uint32_t crc = GetU32(data + offset + 4);
+    if (bodySize < kBodyFixedSize || bodySize > kMaxBodySize || offset + kRecordHeaderSize + bodySize > size) {
+        return false;
+    }
+    const uint8_t* body = data + offset + kRecordHeaderSize;
+    uint32_t formatSize = body[9];
+    uint32_t textSize = GetU32(body + 12);
+    if ((uint64_t)kBodyFixedSize + formatSize + textSize != bodySize) {
+        return false;
+    }
+    if ((uint32_t)crc32(0L, body, bodySize) != crc) {
+        return false;
+    }
+    outBody = body;
+    outBodySize = bodySize;
+    outCrc = crc;
+    return true;
+}
+
+static void DecodeBody(const uint8_t* body, HistoryEntry& outEntry) {
+    outEntry.timeMs = (int64_t)GetU64(body);
+    outEntry.source = (HistorySource)body[8];
+    uint32_t formatSize = body[9];
+    uint32_t textSize = GetU32(body + 12);
+    outEntry.format.assign((const char*)body + kBodyFixedSize, formatSize);
+    outEntry.text.assign((const char*)body + kBodyFixedSize + formatSize, textSize);
+}
+
+const char* HistorySourceName(HistorySource source) {
+    switch (source) {
+        case HistorySource::Region:
+            return "region";
+        case HistorySource::FullScreen:
+            return "fullscreen";
+        case HistorySource::Live:
+            return "live";
+        case HistorySource::File:
+            return "file";
+    }
+    return "unknown";
+}
+
+// ---------------------------------------------------------------------------
+
+ScanHistory::ScanHistory(const ScanHistoryOptions& options) : m_options(options) {
+    m_options.compactRecords = std::max<size_t>(1, m_options.compactRecords);
+}
+
+ScanHistory::~ScanHistory() {
+    Close();
+}
+
+bool ScanHistory::Open(const std::string& logPath, const std::string& indexPath, std::string& outErrorMsg) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CloseLocked();
+    m_logPath = logPath;
+    m_indexPath = indexPath;
+    m_stats = ScanHistoryStats();
+
+    if (!m_log.Open(logPath, false, outErrorMsg)) {
+        return false;
+    }
+    if (m_log.Size() == 0) {
+        uint8_t header[kLogHeaderSize] = {0};
+        memcpy(header, kLogMagic, 4);
+        header[4] = (uint8_t)kVersion;
+        header[5] = (uint8_t)(kVersion >> 8);
+        if (!m_log.Append(header, sizeof(header), outErrorMsg)) {
+            m_log.Close();
+            return false;
+        }
+    }
+    if (!m_logMap.Map(logPath, outErrorMsg)) {
+        m_log.Close();
+        return false;
+    }
+    if (m_logMap.size() < kLogHeaderSize || memcmp(m_logMap.data(), kLogMagic, 4) != 0 ||
+        (m_logMap.data()[4] | (m_logMap.data()[5] << 8)) != kVersion) {
+        outErrorMsg = "不是扫描历史文件或版本不符: " + logPath;
+        CloseLocked();
+        return false;
+    }
+
+    // 索引无效时从头重建 (只丢弃索引, 日志保持不变)
+    std::string indexError;
+    uint64_t tailFrom = kLogHeaderSize;
+    if (LoadIndexLocked(indexError)) {
+        tailFrom = GetU64(m_indexMap.data() + 8);
+    } else {
+        m_indexMap.Unmap();
+        m_indexedCount = 0;
+        m_trigramCount = 0;
+        m_postingCount = 0;
+        m_stats.rebuiltIndex = m_logMap.size() > kLogHeaderSize;
+    }
+    if (!ScanTailLocked(tailFrom, outErrorMsg)) {
+        CloseLocked();
+        return false;
+    }
+    m_stats.tailRecords = m_tail.size();
+    if (m_stats.rebuiltIndex || m_tail.size() >= m_options.compactRecords) {
+        std::string compactError;
+        CompactLocked(compactError); // 失败时记录仍在增量部分, 下次打开再合并
+    }
+    return true;
+}
+
+bool ScanHistory::LoadIndexLocked(std::string& outErrorMsg) {
+    if (!m_indexMap.Map(m_indexPath, outErrorMsg)) {
+        return false;
+    }
+    const uint8_t* data = m_indexMap.data();
+    size_t size = m_indexMap.size();
+    if (size < kIndexHeaderSize || memcmp(data, kIndexMagic, 4) != 0 || (data[4] | (data[5] << 8)) != kVersion ||
+        (uint32_t)crc32(0L, data, kIndexHeaderSize - 4) != GetU32(data + kIndexHeaderSize - 4)) {
+        outErrorMsg = "索引头无效";
+        return false;
+    }
+    uint64_t logBytes = GetU64(data + 8);
+    uint32_t records = GetU32(data + 16);
+    uint32_t trigrams = GetU32(data + 20);
+    uint64_t postings = GetU64(data + 24);
+    uint32_t lastCrc = GetU32(data + 32);
+    uint64_t expected = kIndexHeaderSize + (uint64_t)records * 8 + (uint64_t)trigrams * kTrigramEntrySize + postings * 4;
+    if (expected != size || logBytes > m_logMap.size() || logBytes < kLogHeaderSize) {
+        outErrorMsg = "索引大小与日志不符";
+        return false;
+    }
+
+    // 只核对最后一条记录: 它的位置、CRC 与索引记录的一致, 说明日志在此之前没有被替换或截断
+    const uint8_t* offsets = data + kIndexHeaderSize;
+    if (records > 0) {
+        uint64_t offset = GetU64(offsets + (size_t)(records - 1) * 8);
+        const uint8_t* body;
+        uint32_t bodySize, crc;
+        if (!ParseRecord(m_logMap.data(), logBytes, offset, body, bodySize, crc) || crc != lastCrc ||
+            offset + kRecordHeaderSize + bodySize != logBytes) {
+            outErrorMsg = "索引与日志不符";
+            return false;
+        }
+    } else if (logBytes != kLogHeaderSize) {
+        outErrorMsg = "索引与日志不符";
+        return false;
+    }
+
+    m_indexedCount = records;
+    m_trigramCount = trigrams;
+    m_postingCount = postings;
+    m_offsets = offsets;
+    m_trigrams = offsets + (size_t)records * 8;
+    m_postings = m_trigrams + (size_t)trigrams * kTrigramEntrySize;
+    return true;
+}
+
+bool ScanHistory::ScanTailLocked(uint64_t from, std::string& outErrorMsg) {
+    const uint8_t* data = m_logMap.data();
+    uint64_t size = m_logMap.size();
+    uint64_t offset = from;
+    while (offset < size) {
+        const uint8_t* body;
+        uint32_t bodySize, crc;
+        if (!ParseRecord(data, size, offset, body, bodySize, crc)) {
+            break;
+        }
+        HistoryEntry entry;
+        DecodeBody(body, entry);
+        m_tail.push_back(std::move(entry));
+        m_tailOffsets.push_back(offset);
+        m_tailLastCrc = crc;
+        offset += kRecordHeaderSize + bodySize;
+    }
+    if (offset < size) {
+        // 末尾是写了一半的记录 (写入时进程退出): 截掉, 之后的追加从完整记录之后开始。
+        // Windows 上映射中的文件不能截断, 先解除映射
+        m_logMap.Unmap();
+        if (!m_log.Truncate(offset, outErrorMsg) || !m_logMap.Map(m_logPath, outErrorMsg)) {
+            return false;
+        }
+        m_stats.truncatedTail = true;
+    }
+    return true;
+}
+
+void ScanHistory::Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CloseLocked();
+}
+
+void ScanHistory::CloseLocked() {
+    if (m_log.IsOpen() && !m_tail.empty()) {
+        std::string errorMsg;
+        CompactLocked(errorMsg);
+    }
+    m_indexMap.Unmap();
+    m_logMap.Unmap();
+    m_log.Close();
+    m_indexedCount = 0;
+    m_trigramCount = 0;
+    m_postingCount = 0;
+    m_offsets = m_trigrams = m_postings = nullptr;
+    m_tail.clear();
+    m_tailOffsets.clear();
+}
+
+bool ScanHistory::IsOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_log.IsOpen();
+}
+
+bool ScanHistory::Append(const HistoryEntry& entry, std::string& outErrorMsg) {
+    HistoryEntry stored = entry;
+    if (stored.timeMs == 0) {
+        stored.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    if (stored.format.size() > 255) {
+        stored.format.resize(255);
+    }
+    if (stored.text.size() > kMaxBodySize - kBodyFixedSize - stored.format.size()) {
+        outErrorMsg = "内容过长";
+        return false;
+    }
+
+    uint32_t bodySize = (uint32_t)(kBodyFixedSize + stored.format.size() + stored.text.size());
+    std::vector<uint8_t> record(kRecordHeaderSize + bodySize, 0);
+    uint8_t* body = record.data() + kRecordHeaderSize;
+    PutU64(body, (uint64_t)stored.timeMs);
+    body[8] = (uint8_t)stored.source;
+    body[9] = (uint8_t)stored.format.size();
+    PutU32(body + 12, (uint32_t)stored.text.size());
+    memcpy(body + kBodyFixedSize, stored.format.data(), stored.format.size());
+    memcpy(body + kBodyFixedSize + stored.format.size(), stored.text.data(), stored.text.size());
+    PutU32(record.data(), bodySize);
+    uint32_t crc = (uint32_t)crc32(0L, body, bodySize);
+    PutU32(record.data() + 4, crc);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_log.IsOpen()) {
+        outErrorMsg = "扫描历史未打开";
+        return false;
+    }
+    uint64_t offset = m_log.Size();
+    if (!m_log.Append(record.data(), record.size(), outErrorMsg)) {
+        // 写了一部分时截回原长度, 保持日志由完整记录组成
+        std::string truncateError;
+        m_log.Truncate(offset, truncateError);
+        return false;
+    }
+    m_tail.push_back(std::move(stored));
+    m_tailOffsets.push_back(offset);
+    m_tailLastCrc = crc;
+    if (m_tail.size() >= m_options.compactRecords) {
+        std::string compactError;
+        CompactLocked(compactError); // 失败时记录仍在增量部分
+    }
+    return true;
+}
+
+size_t ScanHistory::Count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_indexedCount + m_tail.size();
+}
+
+bool ScanHistory::Get(size_t index, HistoryEntry& outEntry) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (ReadRecordLocked(index, outEntry)) {
+        return true;
+    }
+    if (index >= m_indexedCount) {
+        return false;
+    }
+    // 索引中的偏移越界: 从日志重建后再读 (重建失败时记录都在增量部分)
+    std::string errorMsg;
+    RebuildIndexLocked(errorMsg);
+    return ReadRecordLocked(index, outEntry);
+}
+
+const uint8_t* ScanHistory::IndexedBodyLocked(size_t index) const {
+    // 打开时只核对了索引头和最后一条记录, 偏移表本身未经校验: 每次使用前确认记录完整位于日志映射内
+    // (不计算 CRC, 记录内容在合并时已校验过)
+    uint64_t offset = GetU64(m_offsets + index * 8);
+    uint64_t size = m_logMap.size();
+    if (offset < kLogHeaderSize || offset > size || size - offset < kRecordHeaderSize + kBodyFixedSize) {
+        return nullptr;
+    }
+    const uint8_t* body = m_logMap.data() + offset + kRecordHeaderSize;
+    uint64_t formatSize = body[9];
+    uint64_t textSize = GetU32(body + 12);
+    if (size - offset - kRecordHeaderSize - kBodyFixedSize < formatSize + textSize) {
+        return nullptr;
+    }
+    return body;
+}
+
+bool ScanHistory::ReadRecordLocked(size_t index, HistoryEntry& outEntry) const {
+    if (index < m_indexedCount) {
+        const uint8_t* body = IndexedBodyLocked(index);
+        if (!body) {
+            return false;
+        }
+        DecodeBody(body, outEntry);
+        return true;
+    }
+    index -= m_indexedCount;
+    if (index < m_tail.size()) {
+        outEntry = m_tail[index];
+        return true;
+    }
+    return false;
+}
+
+bool ScanHistory::FindTrigramLocked(uint32_t trigram, TrigramRange& outRange) const {
+    outRange = TrigramRange();
+    size_t lo = 0, hi = m_trigramCount;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        uint32_t value = GetU32(m_trigrams + mid * kTrigramEntrySize);
+        if (value < trigram) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < m_trigramCount && GetU32(m_trigrams + lo * kTrigramEntrySize) == trigram) {
+        const uint8_t* entry = m_trigrams + lo * kTrigramEntrySize;
+        uint32_t count = GetU32(entry + 4);
+        uint64_t start = GetU64(entry + 8);
+        if (!PostingRangeValid(start, count, m_postingCount)) {
+            return false;
+        }
+        outRange.count = count;
+        outRange.ids = m_postings + start * 4;
+    }
+    return true;
+}
+
+bool ScanHistory::MatchLocked(size_t index, const std::string& foldedQuery, bool& outMatch) const {
+    if (index < m_indexedCount) {
+        const uint8_t* body = IndexedBodyLocked(index);
+        if (!body) {
+            return false;
+        }
+        uint32_t formatSize = body[9];
+        uint32_t textSize = GetU32(body + 12);
+        outMatch = ContainsFolded(body + kBodyFixedSize + formatSize, textSize, foldedQuery);
+        return true;
+    }
+    if (index - m_indexedCount >= m_tail.size()) {
+        return false;
+    }
+    const std::string& text = m_tail[index - m_indexedCount].text;
+    outMatch = ContainsFolded((const uint8_t*)text.data(), text.size(), foldedQuery);
+    return true;
+}
+
+// 升序记录号列表中是否有 id
+static bool ContainsId(const uint8_t* ids, uint32_t count, uint32_t id) {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        uint32_t value = GetU32(ids + mid * 4);
+        if (value == id) {
+            return true;
+        }
+        if (value < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return false;
+}
+
+std::vector<size_t> ScanHistory::Search(const std::string& query, size_t limit) {
+    std::string folded = query;
+    for (char& c : folded) {
+        c = (char)FoldAscii((uint8_t)c);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<size_t> results;
+    if (limit == 0) {
+        return results;
+    }
+    if (!SearchLocked(folded, limit, results)) {
+        // 索引中的偏移或记录号越界: 从日志重建后重新查询
+        std::string errorMsg;
+        RebuildIndexLocked(errorMsg);
+        results.clear();
+        SearchLocked(folded, limit, results);
+    }
+    return results;
+}
+
+bool ScanHistory::SearchLocked(const std::string& folded, size_t limit, std::vector<size_t>& outResults) const {
+    // 增量部分较新, 先逐条比较
+    bool match = false;
+    for (size_t i = m_tail.size(); i-- > 0 && outResults.size() < limit;) {
+        if (MatchLocked(m_indexedCount + i, folded, match) && match) {
+            outResults.push_back(m_indexedCount + i);
+        }
+    }
+    if (outResults.size() >= limit || m_indexedCount == 0) {
+        return true;
+    }
+
+    if (folded.size() < 3) {
+        for (size_t i = m_indexedCount; i-- > 0 && outResults.size() < limit;) {
+            if (!MatchLocked(i, folded, match)) {
+                return false;
+            }
+            if (match) {
+                outResults.push_back(i);
+            }
+        }
+        return true;
+    }
+
+    // 查询的每个三元组都必须出现: 从最短的记录号列表出发 (从新到旧), 在其余列表中二分查找
+    std::vector<uint32_t> grams;
+    ExtractTrigrams((const uint8_t*)folded.data(), folded.size(), grams);
+    std::vector<TrigramRange> ranges;
+    for (uint32_t gram : grams) {
+        TrigramRange range;
+        if (!FindTrigramLocked(gram, range)) {
+            return false;
+        }
+        if (range.count == 0) {
+            return true;
+        }
+        ranges.push_back(range);
+    }
+    std::sort(ranges.begin(), ranges.end(),
+              [](const TrigramRange& a, const TrigramRange& b) { return a.count < b.count; });
+
+    const TrigramRange& shortest = ranges.front();
+    for (uint32_t i = shortest.count; i-- > 0 && outResults.size() < limit;) {
+        uint32_t id = GetU32(shortest.ids + (size_t)i * 4);
+        if (id >= m_indexedCount) {
+            return false; // 索引只含它覆盖的记录
+        }
+        bool all = true;
+        for (size_t r = 1; r < ranges.size() && all; r++) {
+            all = ContainsId(ranges[r].ids, ranges[r].count, id);
+        }
+        // 三元组都出现不代表连续出现, 再核对子串
+        if (!all) {
+            continue;
+        }
+        if (!MatchLocked(id, folded, match)) {
+            return false;
+        }
+        if (match) {
+            outResults.push_back(id);
+        }
+    }
+    return true;
+}
+
+bool ScanHistory::Compact(std::string& outErrorMsg) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_log.IsOpen()) {
+        outErrorMsg = "扫描历史未打开";
+        return false;
+    }
+    return CompactLocked(outErrorMsg);
+}
+
+bool ScanHistory::RebuildIndexLocked(std::string& outErrorMsg) {
+    // 丢弃索引, 全部记录从日志重新解析到增量部分后合并写出新索引。
+    // 日志重新映射, 包含打开之后追加的记录
+    if (!m_logMap.Map(m_logPath, outErrorMsg)) {
+        return false;
+    }
+    m_indexMap.Unmap();
+    m_offsets = m_trigrams = m_postings = nullptr;
+    m_indexedCount = 0;
+    m_trigramCount = 0;
+    m_postingCount = 0;
+    m_tail.clear();
+    m_tailOffsets.clear();
+    m_stats.rebuiltIndex = true;
+    return ScanTailLocked(kLogHeaderSize, outErrorMsg) && CompactLocked(outErrorMsg);
+}
+
+bool ScanHistory::CompactLocked(std::string& outErrorMsg) {
+    // 原有的三元组表须整张复制到新索引, 先核对记录号范围; 越界时丢弃索引从日志重建
+    // (重建时索引为空, 不会再回到这里)
+    for (size_t i = 0; i < m_trigramCount; i++) {
+        const uint8_t* entry = m_trigrams + i * kTrigramEntrySize;
+        if (!PostingRangeValid(GetU64(entry + 8), GetU32(entry + 4), m_postingCount)) {
+            return RebuildIndexLocked(outErrorMsg);
+        }
+    }
+
+    // 增量部分的 (三元组, 记录号), 按三元组、记录号排序
+    std::vector<Posting> added;
+    std::vector<uint32_t> grams;
+    for (size_t i = 0; i < m_tail.size(); i++) {
+        const std::string& text = m_tail[i].text;
+        ExtractTrigrams((const uint8_t*)text.data(), text.size(), grams);
+        for (uint32_t gram : grams) {
+            added.push_back({gram, (uint32_t)(m_indexedCount + i)});
+        }
+    }
+    std::sort(added.begin(), added.end(), [](const Posting& a, const Posting& b) {
+        return a.trigram != b.trigram ? a.trigram < b.trigram : a.record < b.record;
+    });
+
+    uint32_t records = (uint32_t)(m_indexedCount + m_tail.size());
+    uint64_t logBytes = m_log.Size();
+    uint32_t lastCrc = 0;
+    if (!m_tail.empty()) {
+        lastCrc = m_tailLastCrc;
+    } else if (m_indexedCount > 0) {
+        lastCrc = GetU32(m_indexMap.data() + 32);
+    }
+
+    // 合并两个按三元组排序的序列, 写出新的三元组表和记录号 (原有记录号都小于新增的)
+    std::vector<uint8_t> table;
+    std::vector<uint8_t> postings;
+    postings.reserve((size_t)(m_postingCount + added.size()) * 4);
+    uint64_t postingCount = 0;
+    uint32_t trigramCount = 0;
+    auto appendId = [&](uint32_t id) {
+        uint8_t bytes[4];
+        PutU32(bytes, id);
+        postings.insert(postings.end(), bytes, bytes + 4);
+        postingCount++;
+    };
+    size_t a = 0, b = 0;
+    while (a < m_trigramCount || b < added.size()) {
+        uint32_t baseGram = a < m_trigramCount ? GetU32(m_trigrams + a * kTrigramEntrySize) : UINT32_MAX;
+        uint32_t addGram = b < added.size() ? added[b].trigram : UINT32_MAX;
+        uint32_t gram = std::min(baseGram, addGram);
+        uint64_t start = postingCount;
+        if (baseGram == gram) {
+            TrigramRange range;
+            const uint8_t* entry = m_trigrams + a * kTrigramEntrySize;
+            range.count = GetU32(entry + 4);
+            range.ids = m_postings + GetU64(entry + 8) * 4;
+            postings.insert(postings.end(), range.ids, range.ids + (size_t)range.count * 4);
+            postingCount += range.count;
+            a++;
+        }
+        while (b < added.size() && added[b].trigram == gram) {
+            appendId(added[b].record);
+            b++;
+        }
+        uint8_t entry[kTrigramEntrySize];
+        PutU32(entry, gram);
+        PutU32(entry + 4, (uint32_t)(postingCount - start));
+        PutU64(entry + 8, start);
+        table.insert(table.end(), entry, entry + kTrigramEntrySize);
+        trigramCount++;
+    }
+
+    std::vector<uint8_t> header(kIndexHeaderSize, 0);
+    memcpy(header.data(), kIndexMagic, 4);
+    header[4] = (uint8_t)kVersion;
+    header[5] = (uint8_t)(kVersion >> 8);
+    PutU64(header.data() + 8, logBytes);
+    PutU32(header.data() + 16, records);
+    PutU32(header.data() + 20, trigramCount);
+    PutU64(header.data() + 24, postingCount);
+    PutU32(header.data() + 32, lastCrc);
+    PutU32(header.data() + 36, (uint32_t)crc32(0L, header.data(), kIndexHeaderSize - 4));
+
+    std::vector<uint8_t> offsets((size_t)records * 8);
+    if (m_indexedCount > 0) {
+        memcpy(offsets.data(), m_offsets, (size_t)m_indexedCount * 8);
+    }
+    for (size_t i = 0; i < m_tailOffsets.size(); i++) {
+        PutU64(offsets.data() + (m_indexedCount + i) * 8, m_tailOffsets[i]);
+    }
+
+    // 写临时文件并刷盘, 再替换; Windows 上映射中的索引不能被替换, 先解除映射
+    std::string tempPath = m_indexPath + ".tmp";
+    AppendFile out;
+    bool ok = out.Open(tempPath, true, outErrorMsg) && out.Append(header.data(), header.size(), outErrorMsg) &&
+              out.Append(offsets.data(), offsets.size(), outErrorMsg) &&
+              out.Append(table.data(), table.size(), outErrorMsg) &&
+              out.Append(postings.data(), postings.size(), outErrorMsg) && out.Sync();
+    out.Close();
+    if (!ok) {
+        RemoveFile(tempPath);
+        if (outErrorMsg.empty()) {
+            outErrorMsg = "写入索引失败: " + tempPath;
+        }
+        return false;
+    }
+    m_indexMap.Unmap();
+    m_offsets = m_trigrams = m_postings = nullptr;
+    m_indexedCount = 0;
+    m_trigramCount = 0;
+    m_postingCount = 0;
+    bool replaced = ReplaceFileWith(tempPath, m_indexPath, outErrorMsg);
+    if (!replaced) {
+        RemoveFile(tempPath);
+    }
+
+    // 重新映射日志 (包含增量记录) 与索引; 替换失败时旧索引仍在, 重新加载后增量部分照旧保留
+    std::vector<HistoryEntry> tail;
+    std::vector<uint64_t> tailOffsets;
+    tail.swap(m_tail);
+    tailOffsets.swap(m_tailOffsets);
+    std::string loadError;
+    if (!m_logMap.Map(m_logPath, loadError) || !LoadIndexLocked(loadError)) {
+        m_indexMap.Unmap();
+        m_indexedCount = 0;
+        m_trigramCount = 0;
+        m_postingCount = 0;
+        m_offsets = m_trigrams = m_postings = nullptr;
+        // 索引不可用: 全部记录回到增量部分 (从日志重新解析)
+        m_tail.clear();
+        m_tailOffsets.clear();
+        if (m_logMap.mapped()) {
+            ScanTailLocked(kLogHeaderSize, loadError);
+        }
+        outErrorMsg = loadError;
+        return false;
+    }
+    // 未被新索引覆盖的记录 (替换失败时) 留在增量部分
+    for (size_t i = 0; i < tail.size(); i++) {
+        if (tailOffsets[i] >= GetU64(m_indexMap.data() + 8)) {
+            m_tail.push_back(std::move(tail[i]));
+            m_tailOffsets.push_back(tailOffsets[i]);
+        }
+    }
+    return replaced;
+}
+
+ScanHistoryStats ScanHistory::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ScanHistoryStats stats = m_stats;
+    stats.records = m_indexedCount + m_tail.size();
+    stats.indexedRecords = m_indexedCount;
+    stats.trigrams = m_trigramCount;
+    stats.logBytes = m_log.Size();
+    stats.indexBytes = m_indexMap.size();
+    return stats;
+}
+
+} // namespace qrcore
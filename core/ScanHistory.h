@@ -0,0 +1,147 @@
+/*
+ * 扫描历史: 只追加的日志 + 三元组索引
+ *
+ * 每个识别出的内容 (时间、码制、来源、内容) 作为一条记录追加到日志文件,
+ * 记录带长度和 CRC32, 写了一半的末尾记录在下次打开时截掉。
+ * 索引文件保存每条记录在日志中的偏移, 以及按三元组 (连续 3 字节, ASCII 不区分大小写)
+ * 排序的记录号列表。两个文件都只读映射, 打开时只校验索引头并解析索引未覆盖的日志末尾,
+ * 不读取全部记录。索引正文 (偏移表、三元组表) 在使用时核对范围, 越界说明索引损坏,
+ * 丢弃索引并从日志重建。
+ *
+ * 新追加的记录先放在内存中的增量部分, 增量达到 compactRecords 条或 Close 时
+ * 合并写出新的索引文件 (先写临时文件再替换)。
+ *
+ * 查询: 长度不少于 3 字节时取查询中各三元组的记录号列表求交集, 再逐条核对子串;
+ * 更短的查询逐条比较 (记录本身已映射, 不需要解析)。结果按时间从新到旧。线程安全。
+ */
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace qrcore {
+
+enum class HistorySource : uint8_t {
+    Region = 0,     // 截图选区
+    FullScreen = 1, // 全屏扫码
+    Live = 2,       // 连续扫码
+    File = 3,       // 图像文件 (命令行工具)
+};
+
+const char* HistorySourceName(HistorySource source);
+
+struct HistoryEntry {
+    int64_t timeMs = 0; // Unix 时间 (毫秒)
+    HistorySource source = HistorySource::Region;
+    std::string format; // 码制名称
+    std::string text;   // 内容 (UTF-8)
+};
+
+struct ScanHistoryOptions {
+    size_t compactRecords = 4096; // 增量记录达到该条数时重写索引
+};
+
+struct ScanHistoryStats {
+    size_t records = 0;
+    size_t indexedRecords = 0; // 索引文件覆盖的记录数 (其余在增量部分)
+    size_t tailRecords = 0;    // 打开时从日志末尾解析的记录数
+    size_t trigrams = 0;       // 索引中不同三元组的个数
+    uint64_t logBytes = 0;
+    uint64_t indexBytes = 0;
+    bool truncatedTail = false; // 打开时截掉了不完整的末尾记录
+    bool rebuiltIndex = false;  // 打开时索引无效, 已从日志重建
+};
+
+class ScanHistory {
+public:
+    explicit ScanHistory(const ScanHistoryOptions& options = ScanHistoryOptions());
+    ~ScanHistory();
+
+    ScanHistory(const ScanHistory&) = delete;
+    ScanHistory& operator=(const ScanHistory&) = delete;
+
+    /**
+     * @brief 打开 (不存在时创建) 日志与索引 (路径为 UTF-8)
+     *
+     * 索引缺失或与日志不符时从日志重建; 日志头无效时返回 false。
+     */
+    bool Open(const std::string& logPath, const std::string& indexPath, std::string& outErrorMsg);
+
+    // 合并增量部分写出索引后关闭
+    void Close();
+    bool IsOpen() const;
+
+    /**
+     * @brief 追加一条记录 (日志立即写入, 索引在合并时写入)
+     */
+    bool Append(const HistoryEntry& entry, std::string& outErrorMsg);
+
+    // 记录数 (序号 0 为最早的记录)
+    size_t Count() const;
+    // 发现索引损坏时先从日志重建 (因此 Get / Search 不是 const)
+    bool Get(size_t index, HistoryEntry& outEntry);
+
+    /**
+     * @brief 查找内容含 query 的记录 (ASCII 不区分大小写); 空查询返回最近的记录
+     * @return 记录序号, 按时间从新到旧, 最多 limit 条
+     */
+    std::vector<size_t> Search(const std::string& query, size_t limit);
+
+    // 立即合并增量部分, 重写索引文件
+    bool Compact(std::string& outErrorMsg);
+
+    ScanHistoryStats GetStats() const;
+
+private:
+    struct Posting {
+        uint32_t trigram;
+        uint32_t record;
+    };
+    struct TrigramRange {
+        const uint8_t* ids = nullptr; // 索引文件中的 u32 记录号 (升序)
+        uint32_t count = 0;
+    };
+
+    bool LoadIndexLocked(std::string& outErrorMsg);
+    bool ScanTailLocked(uint64_t from, std::string& outErrorMsg);
+    bool CompactLocked(std::string& outErrorMsg);
+    bool RebuildIndexLocked(std::string& outErrorMsg);
+    const uint8_t* IndexedBodyLocked(size_t index) const;
+    bool ReadRecordLocked(size_t index, HistoryEntry& outEntry) const;
+    // 以下在索引损坏 (越界) 时返回 false
+    bool FindTrigramLocked(uint32_t trigram, TrigramRange& outRange) const;
+    bool MatchLocked(size_t index, const std::string& foldedQuery, bool& outMatch) const;
+    bool SearchLocked(const std::string& folded, size_t limit, std::vector<size_t>& outResults) const;
+    void CloseLocked();
+
+    ScanHistoryOptions m_options;
+    std::string m_logPath;
+    std::string m_indexPath;
+
+    mutable std::mutex m_mutex;
+    AppendFile m_log;
+    MappedFile m_logMap;   // 覆盖索引中的记录 (合并后重新映射)
+    MappedFile m_indexMap;
+
+    // 索引文件各部分 (指向 m_indexMap)
+    uint32_t m_indexedCount = 0;
+    uint32_t m_trigramCount = 0;
+    const uint8_t* m_offsets = nullptr;  // u64 × m_indexedCount
+    const uint8_t* m_trigrams = nullptr; // (u32 三元组, u32 个数, u64 起始) × m_trigramCount
+    const uint8_t* m_postings = nullptr; // u32 记录号
+    uint64_t m_postingCount = 0;
+
+    // 增量部分: 索引之后追加的记录
+    std::vector<HistoryEntry> m_tail;
+    std::vector<uint64_t> m_tailOffsets;
+    uint32_t m_tailLastCrc = 0; // 最后一条增量记录的 CRC (写入索引头, 用于打开时核对)
+
+    ScanHistoryStats m_stats;
+};
+
+} // namespace qrcore
@@ -0,0 +1,139 @@
+/*
+ * 分块并行识别 (全屏扫码)
+ */
+
+#include "TileScanner.h"
+#include "ImageFilters.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace qrcore {
+
+// 一维划分: 起点步长为 tileSize - overlap, 末块对齐到末尾
+static std::vector<int> PartitionAxis(int length, int tileSize, int overlap) {
+    std::vector<int> starts;
+    if (length <= tileSize) {
+        starts.push_back(0);
+        return starts;
+    }
+    int step = std::max(1, tileSize - overlap);
+    for (int start = 0;; start += step) {
+        if (start + tileSize >= length) {
+            starts.push_back(length - tileSize);
+            break;
+        }
+        starts.push_back(start);
+    }
+    return starts;
+}
+
+std::vector<Tile> PartitionTiles(int width, int height, int tileSize, int overlap) {
+    std::vector<Tile> tiles;
+    if (width <= 0 || height <= 0 || tileSize <= 0) {
+        return tiles;
+    }
+    overlap = std::max(0, std::min(overlap, tileSize - 1));
+
+    std::vector<int> xs = PartitionAxis(width, tileSize, overlap);
+    std::vector<int> ys = PartitionAxis(height, tileSize, overlap);
+    for (int y : ys) {
+        for (int x : xs) {
+            Tile tile;
+            tile.left = x;
+            tile.top = y;
+            tile.width = std::min(tileSize, width);
+            tile.height = std::min(tileSize, height);
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+bool ScanTiles(const ImageFrame& frame, const TileScanConfig& config, ScanResult& outResult) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    // 全部分块共用一个截止时间; 各分块各自从 0 计时的话, 分块越多整屏扫描越没有上限
+    Clock::time_point deadline = Clock::time_point::max();
+    if (config.cascade.budgetMs > 0) {
+        deadline = start + std::chrono::milliseconds(config.cascade.budgetMs);
+    }
+
+    outResult = ScanResult();
+    if (!ValidateFrame(frame, outResult.errorMsg)) {
+        return false;
+    }
+
+    // 整帧只转换一次灰度; 各分块是灰度帧上的零复制视图
+    ImageFrame lum;
+    {
+        QRCORE_TRACE_SCOPE("ToLuminance");
+        lum = ToLuminance(frame);
+    }
+    std::vector<Tile> tiles = PartitionTiles(lum.width, lum.height, config.tileSize, config.overlap);
+    std::vector<ScanResult> tileResults(tiles.size());
+
+    int threadCount = config.threads > 0 ? config.threads : (int)std::thread::hardware_concurrency();
+    threadCount = std::max(1, std::min(threadCount, (int)tiles.size()));
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> expired{false}; // 有分块因到达截止时间而未识别
+    auto work = [&]() {
+        for (size_t i = next++; i < tiles.size(); i = next++) {
+            if (Clock::now() >= deadline) {
+                expired = true;
+                break;
+            }
+            const Tile& tile = tiles[i];
+            ImageFrame view = CropFrame(lum, tile.left, tile.top, tile.width, tile.height);
+            QRCORE_TRACE_SCOPE("tile");
+            RunCascadeUntil(view, config.cascade, deadline, tileResults[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threadCount; t++) {
+        workers.emplace_back([&work]() {
+            if (IsTraceEnabled()) {
+                SetTraceThreadName("tile");
+            }
+            work();
+        });
+    }
+    work(); // 当前线程也参与
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // 合并: 坐标映射回整帧, 重叠区域内被多个分块识别到的码只保留一次
+    for (size_t i = 0; i < tiles.size(); i++) {
+        ScanResult& tileResult = tileResults[i];
+        outResult.decodeMs += tileResult.decodeMs;
+        outResult.tiersTried += tileResult.tiersTried;
+        outResult.budgetExceeded = outResult.budgetExceeded || tileResult.budgetExceeded;
+        for (DecodedSymbol& symbol : tileResult.symbols) {
+            symbol.position = symbol.position.transformed(1.0, tiles[i].left, tiles[i].top);
+            outResult.symbols.push_back(std::move(symbol));
+        }
+        // 有分块因异常失败时保留其原因, 全部失败时作为错误信息
+        if (!tileResult.success && !tileResult.errorMsg.empty()) {
+            outResult.errorMsg = tileResult.errorMsg;
+        }
+    }
+    outResult.budgetExceeded = outResult.budgetExceeded || expired;
+    DeduplicateSymbols(outResult.symbols);
+    FinishResult(outResult);
+
+    outResult.tier = "tiles";
+    outResult.tierIndex = outResult.success ? 0 : -1;
+    outResult.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (!outResult.success && outResult.errorMsg.empty()) {
+        outResult.errorMsg = "未能在屏幕上识别到二维码。";
+    }
+    return outResult.success;
+}
+
+} // namespace qrcore
@@ -0,0 +1,47 @@
+/*
+ * 分块并行识别 (全屏扫码)
+ *
+ * 整屏截图一次, 切成相互重叠的分块, 在所有核心上并行识别,
+ * 再把各分块的结果映射回整屏坐标并去重合并。
+ * 重叠宽度不小于屏幕上最大二维码的边长时, 任何一个码都会完整落在某个分块内。
+ */
+
+#pragma once
+
+#include "DecodeCascade.h"
+
+#include <vector>
+
+namespace qrcore {
+
+struct Tile {
+    int left = 0;
+    int top = 0;
+    int width = 0;
+    int height = 0;
+};
+
+struct TileScanConfig {
+    int tileSize = 1024; // 分块边长 (像素)
+    int overlap = 384;   // 相邻分块的重叠宽度 (像素), 应不小于最大二维码边长
+    int threads = 0;     // 并行线程数; 0 表示使用全部硬件线程
+    CascadeConfig cascade; // 每个分块使用的识别级联; 其 budgetMs 是整次扫描 (全部分块) 共用的时间预算
+};
+
+/**
+ * @brief 把 width x height 的区域划分为相互重叠的分块
+ *
+ * 分块按行优先排列; 最后一行/列向内对齐, 不会超出区域, 也不会出现过窄的分块。
+ */
+std::vector<Tile> PartitionTiles(int width, int height, int tileSize, int overlap);
+
+/**
+ * @brief 分块并行识别整帧
+ *
+ * 各分块的级联共用一个截止时间 (开始时刻 + cascade.budgetMs): 到期后已开始的分块不再开始新的层级,
+ * 尚未开始的分块不再识别, outResult.budgetExceeded 置为 true。
+ * @return 任一分块识别成功返回 true; outResult.symbols 为整帧坐标下去重后的全部码
+ */
+bool ScanTiles(const ImageFrame& frame, const TileScanConfig& config, ScanResult& outResult);
+
+} // namespace qrcore
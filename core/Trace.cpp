@@ -0,0 +1,295 @@
+/*
+ * 扫描过程跟踪
+ */
+
+#include "Trace.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+namespace qrcore {
+
+namespace detail {
+std::atomic<bool> g_traceEnabled(false);
+}
+
+namespace {
+
+// 槽位按序号校验 (seqlock): 写入前序号置 0, 写完再置为 事件序号 + 1;
+// 导出时前后两次读到同一序号才采用, 避免读到被覆盖一半的事件
+struct TraceSlot {
+    std::atomic<uint64_t> seq{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> startNs{0};
+    std::atomic<uint64_t> durNs{0};
+    std::atomic<uint64_t> id{0};
+    std::atomic<uint32_t> tid{0};
+    std::atomic<uint8_t> phase{0};
+};
+
+struct TraceBuffer {
+    explicit TraceBuffer(size_t capacity) : slots(new TraceSlot[capacity]), mask(capacity - 1) {}
+
+    std::unique_ptr<TraceSlot[]> slots;
+    size_t mask;
+    std::atomic<uint64_t> head{0}; // 已写入的事件总数 (只由所属线程写)
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer*> freeBuffers; // 线程已退出, 可复用
+    std::map<uint32_t, std::string> threadNames;
+    uint32_t nextTid = 1;
+    size_t capacity = 4096;
+    std::unordered_set<std::string> interned;
+    std::atomic<uint64_t> nextId{1};
+    std::atomic<uint64_t> clearedNs{0}; // ClearTrace 的时刻, 之前的事件不再导出
+};
+
+// 不析构: 线程局部状态在进程退出时仍可能归还缓冲区
+TraceRegistry& Registry() {
+    static TraceRegistry* registry = new TraceRegistry();
+    return *registry;
+}
+
+struct ThreadTraceState {
+    TraceBuffer* buffer = nullptr;
+    uint32_t tid = 0;
+
+    ~ThreadTraceState() {
+        if (buffer) {
+            TraceRegistry& registry = Registry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.freeBuffers.push_back(buffer);
+        }
+    }
+};
+
+thread_local ThreadTraceState t_traceState;
+
+void AttachThread(ThreadTraceState& state) {
+    TraceRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (state.tid == 0) {
+        state.tid = registry.nextTid++;
+    }
+    // 复用容量相同的空闲缓冲区 (其中旧线程的事件仍按旧线程序号导出, 直到被覆盖)
+    for (size_t i = 0; i < registry.freeBuffers.size(); i++) {
+        if (registry.freeBuffers[i]->mask + 1 == registry.capacity) {
+            state.buffer = registry.freeBuffers[i];
+            registry.freeBuffers.erase(registry.freeBuffers.begin() + i);
+            return;
+        }
+    }
+    registry.buffers.push_back(std::make_unique<TraceBuffer>(registry.capacity));
+    state.buffer = registry.buffers.back().get();
+}
+
+} // namespace
+
+uint64_t TraceNow() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SetTraceEnabled(bool enabled) {
+    detail::g_traceEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void SetTraceBufferCapacity(size_t events) {
+    size_t capacity = 64;
+    while (capacity < events && capacity < ((size_t)1 << 20)) {
+        capacity <<= 1;
+    }
+    TraceRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.capacity = capacity;
+}
+
+void SetTraceThreadName(const char* name) {
+    ThreadTraceState& state = t_traceState;
+    if (!state.buffer) {
+        AttachThread(state);
+    }
+    TraceRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threadNames[state.tid] = name;
+}
+
+uint64_t NewTraceId() {
+    return Registry().nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+const char* TraceIntern(const std::string& name) {
+    TraceRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    return registry.interned.insert(name).first->c_str();
+}
+
+void TraceRecord(TracePhase phase, const char* name, uint64_t startNs, uint64_t durNs, uint64_t id) {
+    if (!IsTraceEnabled()) {
+        return;
+    }
+    ThreadTraceState& state = t_traceState;
+    if (!state.buffer) {
+        AttachThread(state);
+    }
+    TraceBuffer& buffer = *state.buffer;
+    uint64_t index = buffer.head.load(std::memory_order_relaxed);
+    TraceSlot& slot = buffer.slots[index & buffer.mask];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startNs.store(startNs, std::memory_order_relaxed);
+    slot.durNs.store(durNs, std::memory_order_relaxed);
+    slot.id.store(id, std::memory_order_relaxed);
+    slot.tid.store(state.tid, std::memory_order_relaxed);
+    slot.phase.store((uint8_t)phase, std::memory_order_relaxed);
+    slot.seq.store(index + 1, std::memory_order_release);
+    buffer.head.store(index + 1, std::memory_order_release);
+}
+
+std::vector<TraceEvent> CollectTrace() {
+    TraceRegistry& registry = Registry();
+    std::vector<TraceBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto& buffer : registry.buffers) {
+            buffers.push_back(buffer.get());
+        }
+    }
+    uint64_t clearedNs = registry.clearedNs.load(std::memory_order_relaxed);
+
+    // 缓冲区只增不减, 复制时不需要持锁
+    std::vector<TraceEvent> events;
+    for (TraceBuffer* buffer : buffers) {
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t capacity = buffer->mask + 1;
+        for (uint64_t i = head > capacity ? head - capacity : 0; i < head; i++) {
+            const TraceSlot& slot = buffer->slots[i & buffer->mask];
+            uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != i + 1) {
+                continue; // 已被覆盖或正在写入
+            }
+            TraceEvent event;
+            event.name = slot.name.load(std::memory_order_relaxed);
+            event.startNs = slot.startNs.load(std::memory_order_relaxed);
+            event.durNs = slot.durNs.load(std::memory_order_relaxed);
+            event.id = slot.id.load(std::memory_order_relaxed);
+            event.tid = slot.tid.load(std::memory_order_relaxed);
+            event.phase = (TracePhase)slot.phase.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != seq || event.startNs < clearedNs) {
+                continue;
+            }
+            events.push_back(event);
+        }
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const TraceEvent& a, const TraceEvent& b) { return a.startNs < b.startNs; });
+    return events;
+}
+
+void ClearTrace() {
+    Registry().clearedNs.store(TraceNow() + 1, std::memory_order_relaxed);
+}
+
+static void AppendJsonString(std::string& out, const char* text) {
+    out += '"';
+    for (const char* p = text ? text : ""; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+std::string FormatChromeTrace(const std::vector<TraceEvent>& events) {
+    std::map<uint32_t, std::string> threadNames;
+    {
+        TraceRegistry& registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        threadNames = registry.threadNames;
+    }
+    uint64_t originNs = events.empty() ? 0 : events.front().startNs;
+
+    std::string out;
+    out.reserve(64 + events.size() * 110);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    char buffer[160];
+    for (const auto& entry : threadNames) {
+        out += first ? "\n" : ",\n";
+        first = false;
+        snprintf(buffer, sizeof(buffer), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                 entry.first);
+        out += buffer;
+        AppendJsonString(out, entry.second.c_str());
+        out += "}}";
+    }
+    static const char* const kPhases[] = {"X", "i", "b", "e"};
+    for (const TraceEvent& event : events) {
+        out += first ? "\n" : ",\n";
+        first = false;
+        out += "{\"name\":";
+        AppendJsonString(out, event.name);
+        // ts / dur 为微秒, 保留到纳秒
+        snprintf(buffer, sizeof(buffer), ",\"cat\":\"qr\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u",
+                 kPhases[(int)event.phase & 3], (event.startNs - originNs) / 1000.0, event.tid);
+        out += buffer;
+        switch (event.phase) {
+            case TracePhase::Complete:
+                snprintf(buffer, sizeof(buffer), ",\"dur\":%.3f", event.durNs / 1000.0);
+                out += buffer;
+                break;
+            case TracePhase::Instant:
+                out += ",\"s\":\"t\"";
+                break;
+            case TracePhase::AsyncBegin:
+            case TracePhase::AsyncEnd:
+                snprintf(buffer, sizeof(buffer), ",\"id\":%llu", (unsigned long long)event.id);
+                out += buffer;
+                break;
+        }
+        if (event.id != 0) {
+            snprintf(buffer, sizeof(buffer), ",\"args\":{\"scan\":%llu}", (unsigned long long)event.id);
+            out += buffer;
+        }
+        out += '}';
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+bool SaveChromeTrace(const std::string& path, std::string& outErrorMsg) {
+    std::string json = FormatChromeTrace(CollectTrace());
+    AppendFile file;
+    if (!file.Open(path, true, outErrorMsg) || !file.Append(json.data(), json.size(), outErrorMsg)) {
+        return false;
+    }
+    file.Close();
+    return true;
+}
+
+size_t TraceBufferCount() {
+    TraceRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    return registry.buffers.size();
+}
+
+} // namespace qrcore
@@ -0,0 +1,132 @@
+/*
+ * 扫描过程跟踪: 每线程环形缓冲区 + Chrome / Perfetto 跟踪格式导出
+ *
+ * 每个线程第一次记录时分配一个固定容量的环形缓冲区, 写满后覆盖最早的事件;
+ * 记录只写本线程的缓冲区, 不加锁、不分配内存。导出时逐个缓冲区复制快照
+ * (按序号校验, 跳过正在被覆盖的槽位), 可与记录并发进行。
+ * 线程退出后缓冲区保留 (事件仍可导出), 并由之后新建的线程复用,
+ * 缓冲区个数不超过同时存在的线程数。
+ *
+ * 事件名须为静态存储期的字符串 (字面量或 TraceIntern 的返回值)。
+ * 关闭跟踪时每个跟踪点只有一次原子读取。
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace qrcore {
+
+enum class TracePhase : uint8_t {
+    Complete = 0,   // 一段耗时 (同一线程上开始和结束)
+    Instant = 1,    // 时刻
+    AsyncBegin = 2, // 跨线程的一段: 按 id 配对开始与结束 (如从快捷键到显示结果)
+    AsyncEnd = 3,
+};
+
+struct TraceEvent {
+    const char* name = nullptr;
+    TracePhase phase = TracePhase::Complete;
+    uint32_t tid = 0;     // 线程序号 (从 1 开始, 按线程第一次记录的顺序)
+    uint64_t startNs = 0; // TraceNow 时间
+    uint64_t durNs = 0;   // 仅 Complete
+    uint64_t id = 0;      // 关联的扫描序号 (0 为无)
+};
+
+// 单调时钟 (纳秒)
+uint64_t TraceNow();
+
+namespace detail {
+extern std::atomic<bool> g_traceEnabled;
+}
+
+inline bool IsTraceEnabled() {
+    return detail::g_traceEnabled.load(std::memory_order_relaxed);
+}
+void SetTraceEnabled(bool enabled);
+
+// 之后新建的线程缓冲区的事件容量 (取 2 的幂, 默认 4096)
+void SetTraceBufferCapacity(size_t events);
+
+// 当前线程在导出文件中显示的名称
+void SetTraceThreadName(const char* name);
+
+// 新的扫描序号, 用于把各线程上的事件关联到同一次扫描
+uint64_t NewTraceId();
+
+// 把动态字符串 (如识别层级名称) 转为可作为事件名的静态字符串; 同一内容返回同一指针
+const char* TraceIntern(const std::string& name);
+
+// 记录一个事件到当前线程的缓冲区 (跟踪关闭时忽略)
+void TraceRecord(TracePhase phase, const char* name, uint64_t startNs, uint64_t durNs, uint64_t id);
+
+inline void TraceInstant(const char* name, uint64_t id = 0) {
+    if (IsTraceEnabled()) {
+        TraceRecord(TracePhase::Instant, name, TraceNow(), 0, id);
+    }
+}
+
+inline void TraceAsyncBegin(const char* name, uint64_t id) {
+    if (IsTraceEnabled()) {
+        TraceRecord(TracePhase::AsyncBegin, name, TraceNow(), 0, id);
+    }
+}
+
+inline void TraceAsyncEnd(const char* name, uint64_t id) {
+    if (IsTraceEnabled()) {
+        TraceRecord(TracePhase::AsyncEnd, name, TraceNow(), 0, id);
+    }
+}
+
+// 作用域内的一段耗时
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, uint64_t id = 0) : m_name(name), m_id(id) {
+        m_start = IsTraceEnabled() ? TraceNow() : 0;
+    }
+    ~TraceScope() {
+        if (m_start != 0) {
+            TraceRecord(TracePhase::Complete, m_name, m_start, TraceNow() - m_start, m_id);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_id;
+    uint64_t m_start;
+};
+
+#define QRCORE_TRACE_CONCAT2(a, b) a##b
+#define QRCORE_TRACE_CONCAT(a, b) QRCORE_TRACE_CONCAT2(a, b)
+// 用法: QRCORE_TRACE_SCOPE("decode"); 或 QRCORE_TRACE_SCOPE("decode", scanId);
+#define QRCORE_TRACE_SCOPE(...) ::qrcore::TraceScope QRCORE_TRACE_CONCAT(qrcoreTraceScope, __LINE__)(__VA_ARGS__)
+
+/**
+ * @brief 复制全部线程缓冲区中的事件, 按开始时间排序
+ */
+std::vector<TraceEvent> CollectTrace();
+
+// 此前记录的事件不再导出 (缓冲区由记录线程继续覆盖, 不在这里改写)
+void ClearTrace();
+
+/**
+ * @brief 导出为 Chrome 跟踪格式 JSON (chrome://tracing、ui.perfetto.dev 可直接打开)
+ *
+ * 时间单位为微秒, 以最早的事件为 0; 线程名作为元数据事件输出。
+ */
+std::string FormatChromeTrace(const std::vector<TraceEvent>& events);
+
+// 收集并写入文件 (路径为 UTF-8)
+bool SaveChromeTrace(const std::string& path, std::string& outErrorMsg);
+
+// 已分配的线程缓冲区个数 (含已退出线程留下、等待复用的)
+size_t TraceBufferCount();
+
+} // namespace qrcore
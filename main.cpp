@@ -13,17 +13,27 @@
 #include <windows.h>
 #include <shellapi.h>
 #include <gdiplus.h>
+#include <atomic>
 #include <thread>
+#include <chrono>
 #include <string>
 #include <vector>
+#include <memory>
 #include <commctrl.h> // for WC_STATICW etc.
 
-// ZXing-CPP 头文件 
-#include <ZXing/ReadBarcode.h>
-#include <ZXing/BarcodeFormat.h>
-#include <ZXing/DecodeHints.h>
-#include <ZXing/ImageView.h>
-#include <ZXing/Barcode.h>  // 使用新的 Barcode 替代 Result
+// 识别核心 (平台无关, 内部封装 ZXing-CPP)
+#include "core/DecodeResultCache.h"
+#include "core/DecodeWorker.h"
+#include "core/FramePool.h"
+#include "core/LiveScanner.h"
+#include "core/Metrics.h"
+#include "core/OverlayCompositor.h"
+#include "core/PngWriter.h"
+#include "core/PreviewWorker.h"
+#include "core/QrEncode.h"
+#include "core/QrVector.h"
+#include "core/ScanHistory.h"
+#include "core/Trace.h"
 
 // nayuki QR code generator 头文件
 #include "qrcodegen.hpp" 
@@ -37,9 +47,12 @@
 const char* CLASS_NAME = "MinimalQRTrayApp";
 const char* OVERLAY_CLASS_NAME = "QRScreenshotOverlay";
 const UINT WM_APP_TRAYMSG = WM_APP + 1;
-const UINT WM_APP_SHOW_RESULT = WM_APP + 2;
-const UINT WM_APP_DO_RECOGNITION = WM_APP + 3;
+const UINT WM_APP_SHOW_RESULT = WM_APP + 2; // lParam: qrcore::ScanResult* (接收方负责释放)
+const UINT WM_APP_QRGEN_PREVIEW = WM_APP + 3; // 发往生成窗口, lParam: qrcore::PreviewResult* (接收方负责释放)
+const UINT WM_APP_LIVE_RESULT = WM_APP + 4; // lParam: qrcore::LiveScanEvent* (接收方负责释放)
 const UINT HOTKEY_ID = 1;
+const UINT TIMER_SAVE_RESULT_CACHE = 1; // 主窗口: 延迟写回识别结果缓存
+const UINT RESULT_CACHE_SAVE_DELAY_MS = 30000; // 新结果加入缓存后最多延迟这么久写回 (其间的结果一并写出)
 const UINT MENU_SCAN_QR = 1001;
 const UINT MENU_GENERATE_QR = 1002;
 const UINT MENU_SETTINGS = 1003;
@@ -47,6 +60,10 @@ const UINT MENU_EXIT = 1004;
 const UINT MENU_SETTINGS_HOTKEY_SCAN = 1005;
 const UINT MENU_SETTINGS_HOTKEY_GENERATE = 1006;
 const UINT MENU_SETTINGS_AUTOSTART = 1007;
+const UINT MENU_SCAN_FULLSCREEN = 1008;
+const UINT MENU_LIVE_SCAN = 1009;
+const UINT MENU_HISTORY = 1010;
+const UINT MENU_EXPORT_TRACE = 1011;
 
 // QR Generation Dialog IDs
 const int IDC_EDIT_TEXT = 2001;
@@ -57,6 +74,8 @@ const int IDC_BTN_SAVE_PNG = 2005;
 const int IDC_BTN_SAVE_JPG = 2006;
 const int IDC_BTN_COPY = 2007;
 const int IDC_BTN_GENERATE = 2008;
+const int IDC_BTN_SAVE_SVG = 2009;
+const int IDC_BTN_SAVE_PDF = 2010;
 
 // Settings Dialog IDs
 const int IDC_HOTKEY_CTRL = 3001;
@@ -78,12 +97,17 @@ const int IDC_BTN_GEN_APPLY = 3106;
 const int IDC_BTN_GEN_RESET = 3107;
 const int IDC_CHECK_GEN_ENABLE = 3108;
 
+// Scan History Dialog IDs
+const int IDC_EDIT_HISTORY_SEARCH = 3201;
+const int IDC_LIST_HISTORY = 3202;
+const int IDC_BTN_HISTORY_COPY = 3203;
+const int IDC_STATIC_HISTORY_STATUS = 3204;
+
 HWND g_hwnd;
 HINSTANCE g_hinstance;
-bool g_is_scanning = false;
+std::atomic<bool> g_is_scanning{false}; // 扫码线程、解码线程回调与 UI 线程共用
 std::thread g_scanThread;
-std::string g_qr_result; // 存储识别结果
-HBITMAP g_captured_bitmap = nullptr; // 存储截图位图
+qrcore::DecodeWorker g_decodeWorker; // 解码工作线程, ZXing 识别不再占用主消息线程
 
 // 热键配置
 struct HotkeyConfig {
@@ -95,6 +119,27 @@ HotkeyConfig g_hotkeyConfig = {MOD_CONTROL | MOD_ALT, 'Q'}; // 默认 Ctrl+Alt+Q
 HotkeyConfig g_hotkeyGenConfig = {MOD_CONTROL, 'Q'}; // 默认 Ctrl+Q
 bool g_hotkeyGenEnabled = false; // 默认禁用生成快捷键
 bool g_autoStartEnabled = false; // 开机自启
+qrcore::CascadeConfig g_cascadeConfig = qrcore::DefaultCascade(); // 分级识别配置 ([Scan] 节)
+qrcore::TileScanConfig g_tileConfig; // 全屏扫码的分块配置 ([Scan] 节)
+// 提交给解码线程的只读配置副本 (加载配置后由 UpdateScanJobConfig 生成), 各次扫码共用, 提交时不复制
+std::shared_ptr<const qrcore::CascadeConfig> g_jobCascade;
+std::shared_ptr<const qrcore::TileScanConfig> g_jobTiles;
+qrcore::PngOptions g_pngOptions; // 生成二维码保存 PNG 的位深、颜色类型和压缩级别 ([Generate] 节)
+qrcore::VectorOptions g_vectorOptions; // 导出 SVG / PDF 的物理尺寸 ([Generate] 节)
+bool g_resultCacheEnabled = true; // 同一画面再次扫描时直接取缓存的结果 ([Scan] ResultCache)
+qrcore::DecodeResultCache g_resultCache; // 识别结果缓存, 保存在 config.ini 旁的 scancache.bin
+bool g_resultCacheSavePending = false; // 已安排延迟写回识别结果缓存 (主窗口定时器)
+qrcore::ScanHistory g_scanHistory; // 扫描历史, 保存在 config.ini 旁的 history.log / history.idx
+qrcore::HistorySource g_scanSource = qrcore::HistorySource::Region; // 当前一次扫码的来源 (同一时间只有一次扫码)
+bool g_traceEnabled = true; // 记录扫码各阶段的跟踪事件 ([Scan] Trace), 可从菜单导出
+int g_traceEvents = 4096; // 每个线程的跟踪缓冲区容量 ([Scan] TraceEvents)
+uint64_t g_scanTraceId = 0; // 当前一次扫码的跟踪序号 (同一时间只有一次扫码)
+qrcore::DecodeCacheKey g_scanCacheKey; // 当前一次扫码的识别结果缓存键 (解码线程回调中写入缓存)
+bool g_scanUseCache = false; // 当前一次扫码的结果是否写入识别结果缓存
+std::chrono::steady_clock::time_point g_scanStartTime; // 当前一次扫码开始截图的时刻 (不含框选)
+int g_metricsFileIntervalSec = 60; // 指标快照写到 config.ini 旁 metrics.prom 的间隔, 0 为不写 ([Metrics] FileIntervalSec)
+int g_metricsPort = 0; // 本机指标端点 http://127.0.0.1:<Port>/metrics, 0 为不开启 ([Metrics] Port)
+int g_framePoolMB = 64; // 截图与识别帧缓冲池各自保留的空闲内存上限, 0 为不复用 ([Scan] FramePoolMB)
 const UINT HOTKEY_GEN_ID = 2;
 
 struct OverlayData {
@@ -103,15 +148,25 @@ struct OverlayData {
     bool isSelecting;
     bool isCompleted;
     bool isCancelled;
-    HBITMAP hScreenshot;
 };
 
 OverlayData g_overlayData = {0};
+qrcore::ImageFrame g_overlayScreenshot; // 覆盖层打开时定格的整屏截图 (截图失败时为空, 退回半透明黑色覆盖层)
+
+// 覆盖层的常驻后备缓冲区 (DIB 节, 窗口存在期间保留); 选区变化时只重绘新旧选框的边线和标签
+struct OverlayBackBuffer {
+    HDC memDC;
+    HBITMAP hBitmap;
+    HBITMAP hOldBitmap;
+};
+
+OverlayBackBuffer g_overlayBuffer = {0};
+qrcore::OverlayCompositor g_overlayCompositor;
 
 // QR Generation Dialog Data
 struct QRGenData {
     HBITMAP hPreviewBitmap;
-    Gdiplus::Bitmap* pGdiplusBitmap;
+    qrcore::CachedMatrix matrix; // 当前预览对应的模块矩阵; 保存时从它逐行写出, 不保留原尺寸位图
     std::string currentText; // 存储 UTF-8 文本
     int scale;
     qrcodegen::QrCode::Ecc eccLevel;
@@ -119,6 +174,58 @@ struct QRGenData {
 
 QRGenData g_qrGenData = {0};
 
+// 扫码失败的原因 (qr_scan_failures_total 的 reason 标签)
+enum class ScanFailure {
+    CaptureFailed,  // 截图失败
+    InvalidFrame,   // 截图帧无效 (ValidateFrame)
+    WorkerStopped,  // 解码线程未运行
+    Exception,      // 截图或提交过程中的异常
+    NotFound,       // 各层级都未识别到
+    BudgetExceeded, // 超出时间预算仍未识别到
+    Count,
+};
+
+// 预先注册的指标, 记录时只做原子加法, 不再查找注册表
+struct AppMetrics {
+    explicit AppMetrics(qrcore::MetricsRegistry& registry);
+
+    qrcore::MetricCounter* scans[2]; // 按来源: 选区 / 全屏
+    qrcore::MetricCounter* successes;
+    qrcore::MetricCounter* failures[(int)ScanFailure::Count];
+    qrcore::MetricCounter* cancelled;
+    qrcore::MetricCounter* cacheHits;
+    qrcore::MetricHistogram* decodeTime;
+    qrcore::MetricHistogram* scanTime;
+    qrcore::MetricCounter* liveResults;
+    qrcore::MetricHistogram* liveLatency;
+    qrcore::MetricCounter* previews;
+    qrcore::MetricCounter* encodeErrors;
+    qrcore::MetricHistogram* encodeTime;
+    qrcore::MetricHistogram* previewTime;
+    qrcore::MetricCounter* saves[4]; // PNG / JPEG / SVG / PDF
+    qrcore::MetricCounter* imageCopies;
+};
+
+// 扫码与生成的指标, 可定时写到本地文件或由本机端点提供 ([Metrics] 节)
+qrcore::MetricsRegistry g_metrics;
+AppMetrics g_appMetrics(g_metrics);
+qrcore::MetricsFileWriter g_metricsFile(g_metrics);
+qrcore::MetricsHttpServer g_metricsServer(g_metrics);
+
+// 编码缓存未命中时才调用, 记录实际的编码耗时
+qrcore::ModuleMatrix TimedEncodeQrText(const std::string& text, int ecc) {
+    auto start = std::chrono::steady_clock::now();
+    qrcore::ModuleMatrix matrix = qrcore::EncodeQrText(text, ecc);
+    g_appMetrics.encodeTime->RecordMs(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return matrix;
+}
+
+// 生成窗口的编码与光栅化缓存 (切换尺寸、重新生成相同内容时不再重新编码)
+qrcore::QrEncodeCache g_encodeCache(TimedEncodeQrText);
+
+// 预览生成线程: 编码与光栅化不占用生成窗口的消息线程, 新的输入使旧的请求作废
+qrcore::PreviewWorker g_previewWorker(g_encodeCache);
+
 // --- 函数声明 ---
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 LRESULT CALLBACK OverlayWindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -129,6 +236,9 @@ void AddTrayIcon(HWND hwnd);
 void RemoveTrayIcon(HWND hwnd);
 void ShowContextMenu(HWND hwnd);
 void TriggerScanProcess(HWND hwnd);
+void TriggerFullScreenScan(HWND hwnd);
+void ToggleLiveScan(HWND hwnd);
+void ShowTrayBalloon(HWND hwnd, const std::wstring& title, const std::wstring& text);
 void ShowQRGenerationWindow(HWND hwnd);
 void ShowSettingsWindow(HWND hwnd);
 void ShowScanHotkeySettings(HWND hwnd);
@@ -137,23 +247,98 @@ bool RegisterCurrentHotkey(HWND hwnd);
 bool RegisterGenerateHotkey(HWND hwnd);
 void SaveHotkeyConfig();
 void LoadHotkeyConfig();
+void UpdateScanJobConfig();
 void SaveAutoStartConfig();
 void LoadAutoStartConfig();
 bool SetAutoStart(bool enable);
 bool IsAutoStartEnabled();
+void LoadResultCache();
+void SaveResultCache();
+void ScheduleSaveResultCache(HWND hwnd);
+std::wstring GetAppFilePath(const wchar_t* fileName);
+void OpenScanHistory();
+void AppendScanHistory(qrcore::HistorySource source, const qrcore::DecodedSymbol& symbol);
+void ShowHistoryWindow(HWND hwnd);
+void ExportScanTrace(HWND hwnd);
+void StartMetrics();
+void ConfigureFramePools();
+void CountScanFailure(ScanFailure reason);
+LRESULT CALLBACK HistoryDialogProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam);
 std::wstring GetKeyName(UINT vkCode);
-bool ShowScreenshotOverlay(RECT* outRect);
-bool ScanImageForQR(HBITMAP hBitmap, std::string& outErrorMsg); // 声明
+bool ShowScreenshotOverlay(RECT* outRect, qrcore::ImageFrame* outSelection = nullptr);
+bool ScanImageForQR(HWND hwnd, const qrcore::ImageFrame& frame, bool fullScreen, std::string& outErrorMsg); // 声明
+void PostScanResult(HWND hwnd, std::unique_ptr<qrcore::ScanResult> result);
+void PostScanError(HWND hwnd, const std::string& errorMsg);
 std::string GenerateQRCode(const std::string& text);
 void UpdateQRPreview(HWND hwndDlg);
+void RequestQRPreview(HWND hwndDlg);
+void ApplyQRPreview(HWND hwndDlg, std::unique_ptr<qrcore::PreviewResult> result);
+int GetSelectedQRScale(HWND hwndDlg);
 void SaveQRCodeImage(HWND hwndDlg, bool asPNG);
+void SaveQRCodeVector(HWND hwndDlg, bool asPDF);
 void CopyQRToClipboard(HWND hwndDlg);
 void CopyToClipboard(const std::string& text);
 void CopyBitmapToClipboard(HBITMAP hBitmap);
 int GetEncoderClsid(const WCHAR* format, CLSID* pClsid);
-HBITMAP CaptureScreen();
-HBITMAP CaptureScreenRegion(const RECT& rect);
+bool CaptureScreen(qrcore::ImageFrame& outFrame);
+bool CaptureScreenRegion(const RECT& rect, qrcore::ImageFrame& outFrame);
+HBITMAP CreateFrameDIB(int width, int height, qrcore::ImageFrame& outFrame, bool frameOwnsBitmap);
 std::string WideToUTF8(const std::wstring& wideString); // 新增
+std::wstring UTF8ToWide(const std::string& utf8String);
+
+// 连续扫码的帧来源: 每次抓取固定的屏幕区域 (区域只在扫码停止时修改)
+class ScreenRegionSource : public qrcore::IFrameSource {
+public:
+    void SetRegion(const RECT& rect) { m_rect = rect; }
+
+    bool Capture(qrcore::ImageFrame& outFrame, std::string& outErrorMsg) override {
+        if (!CaptureScreenRegion(m_rect, outFrame)) {
+            outErrorMsg = "截图失败";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    RECT m_rect = {0};
+};
+
+// 截图用的 DIB 节: 32 位自上而下, 宽度取 16 的倍数使行字节数按 64 字节对齐
+class DibFrameAllocator : public qrcore::IFrameAllocator {
+public:
+    bool Allocate(int width, int height, qrcore::PixelFormat format, qrcore::FrameBuffer& outBuffer) override {
+        if (format != qrcore::PixelFormat::BGRX) {
+            return false;
+        }
+        width = (width + 15) & ~15;
+        qrcore::ImageFrame frame;
+        HBITMAP hBitmap = CreateFrameDIB(width, height, frame, false);
+        if (!hBitmap) {
+            return false;
+        }
+        outBuffer.data = frame.data;
+        outBuffer.width = width;
+        outBuffer.height = height;
+        outBuffer.stride = frame.stride;
+        outBuffer.format = format;
+        outBuffer.handle = hBitmap;
+        return true;
+    }
+
+    void Free(qrcore::FrameBuffer& buffer) override {
+        DeleteObject((HBITMAP)buffer.handle);
+        buffer.data = nullptr;
+    }
+};
+
+// 截图帧缓冲池: 选区大小每次不同, 新的 DIB 节宽高取 128 的倍数, 并允许取用面积至多 4 倍的已有 DIB 节;
+// 整屏截图和连续扫码的固定区域在稳定状态下总是复用同一个 DIB 节
+DibFrameAllocator g_dibAllocator;
+qrcore::FramePool g_capturePool(g_dibAllocator, qrcore::FramePoolConfig{(size_t)64 << 20, 128, 4.0});
+
+ScreenRegionSource g_liveSource;
+qrcore::LiveScanner g_liveScanner(g_liveSource); // 连续扫码 (抓取与识别各一个线程)
+qrcore::LiveScanConfig g_liveConfig; // 抓取间隔 ([Live] 节); 识别级联取 g_cascadeConfig
 
 // --- GDI+ 初始化 ---
 ULONG_PTR g_gdiplusToken;
@@ -193,8 +378,17 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     }
 
     InitializeGDIPlus();
+    g_decodeWorker.Start();
+    g_previewWorker.Start();
     LoadHotkeyConfig(); // 加载快捷键配置
     LoadAutoStartConfig(); // 加载开机自启配置
+    LoadResultCache(); // 加载识别结果缓存 (依赖 [Scan] 中的缓存设置)
+    OpenScanHistory(); // 只读取索引头和索引之后追加的记录
+    qrcore::SetTraceBufferCapacity(g_traceEvents);
+    qrcore::SetTraceEnabled(g_traceEnabled);
+    qrcore::SetTraceThreadName("main");
+    ConfigureFramePools();
+    StartMetrics(); // 依赖 [Metrics] 中的间隔和端口
 
     // 注册窗口类
     WNDCLASSA wc = {0};
@@ -277,11 +471,28 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             if (g_scanThread.joinable()) {
                 g_scanThread.join();
             }
+            g_liveScanner.Stop();
+            g_decodeWorker.Stop();
+            g_previewWorker.Stop();
+            KillTimer(hwnd, TIMER_SAVE_RESULT_CACHE);
+            SaveResultCache(); // 写出尚未写回的缓存结果
+            g_scanHistory.Close(); // 合并新记录写出索引
+            g_metricsServer.Stop();
+            g_metricsFile.Stop(); // 退出前再写一次快照
             PostQuitMessage(0);
             break;
 
+        case WM_TIMER:
+            if (wParam == TIMER_SAVE_RESULT_CACHE) {
+                KillTimer(hwnd, TIMER_SAVE_RESULT_CACHE);
+                g_resultCacheSavePending = false;
+                SaveResultCache();
+            }
+            break;
+
         case WM_HOTKEY:
             if (wParam == HOTKEY_ID) {
+                qrcore::TraceInstant("WM_HOTKEY");
                 TriggerScanProcess(hwnd);
             } else if (wParam == HOTKEY_GEN_ID) {
                 ShowQRGenerationWindow(hwnd);
@@ -304,9 +515,21 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 case MENU_SCAN_QR:
                     TriggerScanProcess(hwnd);
                     break;
+                case MENU_SCAN_FULLSCREEN:
+                    TriggerFullScreenScan(hwnd);
+                    break;
+                case MENU_LIVE_SCAN:
+                    ToggleLiveScan(hwnd);
+                    break;
                 case MENU_GENERATE_QR:
                     ShowQRGenerationWindow(hwnd);
                     break;
+                case MENU_HISTORY:
+                    ShowHistoryWindow(hwnd);
+                    break;
+                case MENU_EXPORT_TRACE:
+                    ExportScanTrace(hwnd);
+                    break;
                 case MENU_SETTINGS:
                     ShowSettingsWindow(hwnd);
                     break;
@@ -327,37 +550,87 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             }
             break;
             
-        case WM_APP_SHOW_RESULT:
-            // 在主线程中显示识别结果
+        case WM_APP_SHOW_RESULT: {
+            // 在主线程中显示识别结果 (识别本身已在解码线程完成)
+            std::unique_ptr<qrcore::ScanResult> result((qrcore::ScanResult*)lParam);
+            qrcore::TraceAsyncEnd("WM_APP_SHOW_RESULT dispatch", g_scanTraceId);
             try {
                 
                 // 确保消息框在最顶层
                 SetForegroundWindow(hwnd);
                 
-                if (wParam == 1) { // 成功
+                if (result) {
+                    // 记录每次扫描的层级和耗时, 用于调整级联顺序 (DebugView 可见)
+                    char logLine[256];
+                    sprintf_s(logLine, "[QRScan] success=%d codes=%d tier=%s tried=%d decode=%.1fms total=%.1fms budgetExceeded=%d cached=%d\n",
+                        result->success ? 1 : 0, (int)result->symbols.size(), result->success ? result->tier.c_str() : "-",
+                        result->tiersTried, result->decodeMs, result->totalMs, result->budgetExceeded ? 1 : 0,
+                        result->cached ? 1 : 0);
+                    OutputDebugStringA(logLine);
+
+                    // 识别失败的结果 (尝试过层级) 在这里计数; 截图、提交阶段的失败已在发生处计数
+                    if (result->success) {
+                        g_appMetrics.successes->Add();
+                    } else if (result->tiersTried > 0) {
+                        CountScanFailure(result->budgetExceeded ? ScanFailure::BudgetExceeded : ScanFailure::NotFound);
+                    }
+                    if (result->cached) {
+                        g_appMetrics.cacheHits->Add();
+                    } else if (result->tiersTried > 0) {
+                        g_appMetrics.decodeTime->RecordMs(result->decodeMs);
+                    }
+                    g_appMetrics.scanTime->RecordMs(
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - g_scanStartTime).count());
+                }
+                
+                // 消息框等待用户关闭, 不计入扫码耗时
+                qrcore::TraceAsyncEnd("scan", g_scanTraceId);
+
+                if (!result) {
+                    MessageBoxA(hwnd, "内部错误：识别结果丢失", "扫描结果", MB_OK | MB_ICONINFORMATION | MB_TOPMOST | MB_SETFOREGROUND);
+                } else if (result->success) { // 成功
+                    // 多个码时每行一个复制到剪贴板 (CopyToClipboard 内部处理 UTF-8 到 UTF-16)
+                    CopyToClipboard(qrcore::JoinSymbolTexts(*result, "\r\n"));
+                    
                     // 转换为 WCHAR (UTF-16) 来显示中文
-                    std::wstring wResult;
-                    int wideLen = MultiByteToWideChar(CP_UTF8, 0, g_qr_result.c_str(), -1, NULL, 0);
-                    if (wideLen > 0) {
-                        wResult.resize(wideLen - 1);
-                        MultiByteToWideChar(CP_UTF8, 0, g_qr_result.c_str(), -1, &wResult[0], wideLen);
+                    std::wstring successMsg;
+                    if (result->symbols.size() <= 1) {
+                        std::wstring wResult = UTF8ToWide(result->text);
+                        successMsg = L"识别成功！已复制到剪贴板:\n\n" + wResult;
+                        successMsg += L"\n\n格式: " + std::wstring(result->format.begin(), result->format.end());
+                        successMsg += L"\n长度: " + std::to_wstring(wResult.length()) + L" 字符";
                     } else {
-                        wResult = L"[转换结果失败]";
+                        successMsg = L"识别到 " + std::to_wstring(result->symbols.size()) + L" 个二维码，已全部复制到剪贴板 (每行一个):\n";
+                        for (size_t i = 0; i < result->symbols.size(); i++) {
+                            successMsg += L"\n[" + std::to_wstring(i + 1) + L"] " + UTF8ToWide(result->symbols[i].text);
+                        }
+                        successMsg += L"\n\n格式: " + std::wstring(result->format.begin(), result->format.end());
+                    }
+                    successMsg += L"\n耗时: " + std::to_wstring((int)(result->totalMs + 0.5)) + L" ms";
+                    if (result->cached) {
+                        successMsg += L"\n识别层级: 缓存 (此前识别过相同画面)";
+                    } else {
+                        successMsg += L"\n识别层级: " + std::wstring(result->tier.begin(), result->tier.end()) +
+                            L" (" + std::to_wstring(result->tierIndex + 1) + L"/" + std::to_wstring(g_cascadeConfig.tiers.size()) + L")";
+                    }
+                    // 新识别的结果已由解码线程加入缓存; 稍后在定时器中批量写回, 不在每次扫码后同步写磁盘
+                    ScheduleSaveResultCache(hwnd);
+                    {
+                        QRCORE_TRACE_SCOPE("AppendScanHistory", g_scanTraceId);
+                        for (const qrcore::DecodedSymbol& symbol : result->symbols) {
+                            AppendScanHistory(g_scanSource, symbol);
+                        }
                     }
-
-                    std::wstring successMsg = L"识别成功！已复制到剪贴板:\n\n" + wResult;
-                    successMsg += L"\n\n格式: QR Code"; // TODO: result.formatString()
-                    successMsg += L"\n长度: " + std::to_wstring(wResult.length()) + L" 字符";
                     
                     MessageBoxW(hwnd, successMsg.c_str(), L"二维码扫描 (ZXing)", MB_OK | MB_ICONINFORMATION | MB_TOPMOST | MB_SETFOREGROUND);
                     
                 } else { // 失败
                     // 失败消息通常是 ANSI (英文)，但也转为 WCHAR
                     std::wstring wErrorMsg;
-                    int wideLen = MultiByteToWideChar(CP_ACP, 0, g_qr_result.c_str(), -1, NULL, 0);
+                    int wideLen = MultiByteToWideChar(CP_ACP, 0, result->errorMsg.c_str(), -1, NULL, 0);
                      if (wideLen > 0) {
                         wErrorMsg.resize(wideLen - 1);
-                        MultiByteToWideChar(CP_ACP, 0, g_qr_result.c_str(), -1, &wErrorMsg[0], wideLen);
+                        MultiByteToWideChar(CP_ACP, 0, result->errorMsg.c_str(), -1, &wErrorMsg[0], wideLen);
                     } else {
                         wErrorMsg = L"[转换错误信息失败]";
                     }
@@ -374,47 +647,27 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 MessageBoxA(hwnd, "显示结果时发生未知错误", "错误", MB_OK | MB_ICONERROR | MB_TOPMOST);
             }
             break;
-            
-        case WM_APP_DO_RECOGNITION:
-            // 在主线程中执行ZXing识别
-            try {
-                
-                if (g_captured_bitmap) {
-                    std::string errorMsg;
-                    bool success = ScanImageForQR(g_captured_bitmap, errorMsg);
-                    
-                    // 清理位图
-                    DeleteObject(g_captured_bitmap);
-                    g_captured_bitmap = nullptr;
-                    
-                    if (success) {
-                        // 成功消息已由 ScanImageForQR (通过PostMessage) 处理
-                    } else {
-                        g_qr_result = errorMsg;
-                        PostMessage(hwnd, WM_APP_SHOW_RESULT, 0, 0);
-                    }
-                } else {
-                    g_qr_result = "内部错误：位图数据丢失";
-                    PostMessage(hwnd, WM_APP_SHOW_RESULT, 0, 0);
-                }
-                
-            } catch (const std::exception& e) {
-                if (g_captured_bitmap) {
-                    DeleteObject(g_captured_bitmap);
-                    g_captured_bitmap = nullptr;
-                }
-                g_qr_result = "识别过程异常: ";
-                g_qr_result += e.what();
-                PostMessage(hwnd, WM_APP_SHOW_RESULT, 0, 0);
-            } catch (...) {
-                if (g_captured_bitmap) {
-                    DeleteObject(g_captured_bitmap);
-                    g_captured_bitmap = nullptr;
-                }
-                g_qr_result = "识别过程发生未知异常";
-                PostMessage(hwnd, WM_APP_SHOW_RESULT, 0, 0);
+        }
+
+        case WM_APP_LIVE_RESULT: {
+            // 连续扫码的新内容: 复制到剪贴板并以托盘气泡提示, 不弹出消息框打断用户
+            std::unique_ptr<qrcore::LiveScanEvent> event((qrcore::LiveScanEvent*)lParam);
+            if (event && g_liveScanner.IsRunning()) { // 停止后才送达的结果丢弃
+                qrcore::LiveScanStats stats = g_liveScanner.GetStats();
+                char logLine[256];
+                sprintf_s(logLine, "[QRLive] frame=%llu tier=%s latency=%.1fms interval=%dms captured=%llu decoded=%llu superseded=%llu\n",
+                    (unsigned long long)event->frameIndex, event->tier.c_str(), event->latencyMs, stats.intervalMs,
+                    (unsigned long long)stats.captured, (unsigned long long)stats.decoded, (unsigned long long)stats.superseded);
+                OutputDebugStringA(logLine);
+                g_appMetrics.liveResults->Add();
+                g_appMetrics.liveLatency->RecordMs(event->latencyMs);
+
+                CopyToClipboard(event->symbol.text);
+                AppendScanHistory(qrcore::HistorySource::Live, event->symbol);
+                ShowTrayBalloon(hwnd, L"连续扫码: 识别到新内容 (已复制)", UTF8ToWide(event->symbol.text));
             }
             break;
+        }
 
         default:
             return DefWindowProc(hwnd, uMsg, wParam, lParam);
@@ -423,52 +676,135 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 }
 
 // --- 覆盖层窗口消息处理函数 ---
+
+static qrcore::OverlayRect ToOverlayRect(const RECT& rect) {
+    qrcore::OverlayRect result;
+    result.left = (int)rect.left;
+    result.top = (int)rect.top;
+    result.right = (int)rect.right;
+    result.bottom = (int)rect.bottom;
+    return result;
+}
+
+// 创建与客户区同尺寸的后备缓冲区并交给合成器; 尺寸标签区域按最长的尺寸文字估算
+static bool CreateOverlayBackBuffer(HWND hwnd) {
+    RECT clientRect;
+    GetClientRect(hwnd, &clientRect);
+    qrcore::ImageFrame frame;
+    HBITMAP hBitmap = CreateFrameDIB(clientRect.right, clientRect.bottom, frame, false);
+    if (!hBitmap) {
+        return false;
+    }
+    HDC hdc = GetDC(hwnd);
+    g_overlayBuffer.memDC = CreateCompatibleDC(hdc);
+    ReleaseDC(hwnd, hdc);
+    g_overlayBuffer.hBitmap = hBitmap;
+    g_overlayBuffer.hOldBitmap = (HBITMAP)SelectObject(g_overlayBuffer.memDC, hBitmap);
+    SetTextColor(g_overlayBuffer.memDC, RGB(255, 255, 255));
+    SetBkMode(g_overlayBuffer.memDC, TRANSPARENT);
+
+    qrcore::OverlayStyle style;
+    SIZE textSize = {0};
+    if (GetTextExtentPoint32A(g_overlayBuffer.memDC, "00000 x 00000", 13, &textSize)) {
+        style.labelWidth = textSize.cx + 8;
+    }
+    g_overlayCompositor.SetStyle(style);
+    std::string errorMsg;
+    return g_overlayCompositor.Attach(frame, errorMsg);
+}
+
+static void DestroyOverlayBackBuffer() {
+    g_overlayCompositor.Detach();
+    if (g_overlayBuffer.memDC) {
+        SelectObject(g_overlayBuffer.memDC, g_overlayBuffer.hOldBitmap);
+        DeleteDC(g_overlayBuffer.memDC);
+    }
+    if (g_overlayBuffer.hBitmap) {
+        DeleteObject(g_overlayBuffer.hBitmap);
+    }
+    memset(&g_overlayBuffer, 0, sizeof(g_overlayBuffer));
+}
+
+// 选区变化后只使新旧选框的边线和标签区域失效
+static void InvalidateOverlaySelection(HWND hwnd) {
+    g_overlayCompositor.SetSelection(ToOverlayRect(g_overlayData.selection),
+                                     g_overlayData.isSelecting || g_overlayData.isCompleted);
+    for (const qrcore::OverlayRect& dirty : g_overlayCompositor.Dirty().Rects()) {
+        RECT rect = {dirty.left, dirty.top, dirty.right, dirty.bottom};
+        InvalidateRect(hwnd, &rect, FALSE);
+    }
+    g_overlayCompositor.ClearDirty();
+}
+
+// 取更新区域的各个矩形; 区域过碎时退回外接矩形
+static void GetUpdateRects(HRGN updateRgn, const RECT& paintRect, std::vector<RECT>& outRects) {
+    outRects.clear();
+    DWORD size = GetRegionData(updateRgn, 0, NULL);
+    std::vector<char> buffer(size);
+    if (size > 0 && GetRegionData(updateRgn, size, (RGNDATA*)buffer.data()) == size) {
+        const RGNDATA* data = (const RGNDATA*)buffer.data();
+        const RECT* rects = (const RECT*)data->Buffer;
+        if (data->rdh.nCount <= 64) {
+            outRects.assign(rects, rects + data->rdh.nCount);
+            return;
+        }
+    }
+    outRects.push_back(paintRect);
+}
+
 LRESULT CALLBACK OverlayWindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
     switch (uMsg) {
-        case WM_CREATE:
-            SetLayeredWindowAttributes(hwnd, 0, 128, LWA_ALPHA);
+        case WM_CREATE: {
+            if (!CreateOverlayBackBuffer(hwnd)) {
+                DestroyOverlayBackBuffer();
+                return -1;
+            }
+            // 有定格截图时以变暗的截图为不透明背景; 否则仍是半透明的黑色覆盖层
+            const qrcore::ImageFrame& back = g_overlayCompositor.BackBuffer();
+            std::string errorMsg;
+            bool frozen = g_overlayScreenshot.width == back.width && g_overlayScreenshot.height == back.height &&
+                          g_overlayCompositor.SetBackground(g_overlayScreenshot, errorMsg);
+            SetLayeredWindowAttributes(hwnd, 0, frozen ? 255 : 128, LWA_ALPHA);
             return 0;
+        }
 
         case WM_PAINT: {
+            // 只重绘更新区域: 合成器在后备缓冲区中补背景和选框边线, 再在同一区域内画文字, 逐个矩形提交
+            HRGN updateRgn = CreateRectRgn(0, 0, 0, 0);
+            GetUpdateRgn(hwnd, updateRgn, FALSE);
             PAINTSTRUCT ps;
             HDC hdc = BeginPaint(hwnd, &ps);
+            std::vector<RECT> rects;
+            GetUpdateRects(updateRgn, ps.rcPaint, rects);
+            HDC memDC = g_overlayBuffer.memDC;
+
+            GdiFlush(); // 直接写 DIB 节像素之前, 先完成此前排队的 GDI 绘制
+            for (const RECT& rect : rects) {
+                g_overlayCompositor.Render(ToOverlayRect(rect));
+            }
+            SelectClipRgn(memDC, updateRgn);
+            qrcore::OverlayRect label = g_overlayCompositor.LabelRect();
+            if (!label.empty()) {
+                int width = g_overlayData.selection.right - g_overlayData.selection.left;
+                int height = g_overlayData.selection.bottom - g_overlayData.selection.top;
+                char sizeText[64];
+                sprintf_s(sizeText, "%d x %d", width, height);
+                RECT textRect = {g_overlayData.selection.left, g_overlayData.selection.top - g_overlayCompositor.Style().labelHeight,
+                                 label.right, g_overlayData.selection.top};
+                DrawTextA(memDC, sizeText, -1, &textRect, DT_LEFT | DT_TOP);
+            }
             RECT clientRect;
             GetClientRect(hwnd, &clientRect);
-            HDC memDC = CreateCompatibleDC(hdc);
-            HBITMAP memBitmap = CreateCompatibleBitmap(hdc, clientRect.right, clientRect.bottom);
-            HBITMAP oldBitmap = (HBITMAP)SelectObject(memDC, memBitmap);
-            HBRUSH bgBrush = CreateSolidBrush(RGB(0, 0, 0));
-            FillRect(memDC, &clientRect, bgBrush);
-            DeleteObject(bgBrush);
-            if (g_overlayData.isSelecting || g_overlayData.isCompleted) {
-                HPEN pen = CreatePen(PS_SOLID, 2, RGB(255, 0, 0));
-                HPEN oldPen = (HPEN)SelectObject(memDC, pen);
-                HBRUSH oldBrush = (HBRUSH)SelectObject(memDC, GetStockObject(NULL_BRUSH));
-                Rectangle(memDC, g_overlayData.selection.left, g_overlayData.selection.top, g_overlayData.selection.right, g_overlayData.selection.bottom);
-                SelectObject(memDC, oldPen);
-                SelectObject(memDC, oldBrush);
-                DeleteObject(pen);
-                if (g_overlayData.selection.right > g_overlayData.selection.left && g_overlayData.selection.bottom > g_overlayData.selection.top) {
-                    int width = g_overlayData.selection.right - g_overlayData.selection.left;
-                    int height = g_overlayData.selection.bottom - g_overlayData.selection.top;
-                    char sizeText[64];
-                    sprintf_s(sizeText, "%d x %d", width, height);
-                    SetTextColor(memDC, RGB(255, 255, 255));
-                    SetBkMode(memDC, TRANSPARENT);
-                    RECT textRect = {g_overlayData.selection.left, g_overlayData.selection.top - 25, g_overlayData.selection.right, g_overlayData.selection.top};
-                    DrawTextA(memDC, sizeText, -1, &textRect, DT_LEFT | DT_TOP);
-                }
-            }
-            SetTextColor(memDC, RGB(255, 255, 255));
-            SetBkMode(memDC, TRANSPARENT);
             const char* helpText = "拖拽鼠标选择区域，按 ESC 取消 (ZXing版)";
             RECT helpRect = {10, 10, clientRect.right - 10, 50};
             DrawTextA(memDC, helpText, -1, &helpRect, DT_LEFT | DT_TOP);
-            BitBlt(hdc, 0, 0, clientRect.right, clientRect.bottom, memDC, 0, 0, SRCCOPY);
-            SelectObject(memDC, oldBitmap);
-            DeleteObject(memBitmap);
-            DeleteDC(memDC);
+            SelectClipRgn(memDC, NULL);
+
+            for (const RECT& rect : rects) {
+                BitBlt(hdc, rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top, memDC, rect.left, rect.top, SRCCOPY);
+            }
             EndPaint(hwnd, &ps);
+            DeleteObject(updateRgn);
             return 0;
         }
 
@@ -483,7 +819,7 @@ LRESULT CALLBACK OverlayWindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM l
             g_overlayData.selection.bottom = y;
             g_overlayData.isSelecting = true;
             SetCapture(hwnd);
-            InvalidateRect(hwnd, NULL, FALSE);
+            InvalidateOverlaySelection(hwnd);
             return 0;
         }
 
@@ -495,7 +831,7 @@ LRESULT CALLBACK OverlayWindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM l
                 g_overlayData.selection.top = (g_overlayData.startPoint.y < y) ? g_overlayData.startPoint.y : y;
                 g_overlayData.selection.right = (g_overlayData.startPoint.x > x) ? g_overlayData.startPoint.x : x;
                 g_overlayData.selection.bottom = (g_overlayData.startPoint.y > y) ? g_overlayData.startPoint.y : y;
-                InvalidateRect(hwnd, NULL, FALSE);
+                InvalidateOverlaySelection(hwnd);
             }
             return 0;
         }
@@ -513,7 +849,7 @@ LRESULT CALLBACK OverlayWindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM l
                     PostMessage(hwnd, WM_CLOSE, 0, 0);
                 } else {
                     g_overlayData.isCompleted = false;
-                    InvalidateRect(hwnd, NULL, FALSE);
+                    InvalidateOverlaySelection(hwnd);
                 }
             }
             return 0;
@@ -532,6 +868,7 @@ LRESULT CALLBACK OverlayWindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM l
             return 0;
 
         case WM_DESTROY:
+            DestroyOverlayBackBuffer();
             return 0;
 
         default:
@@ -560,10 +897,30 @@ void RemoveTrayIcon(HWND hwnd) {
     Shell_NotifyIconA(NIM_DELETE, &nid);
 }
 
+// 托盘气泡提示 (文本过长时截断)
+void ShowTrayBalloon(HWND hwnd, const std::wstring& title, const std::wstring& text) {
+    NOTIFYICONDATAW nid = {0};
+    nid.cbSize = sizeof(NOTIFYICONDATAW);
+    nid.hWnd = hwnd;
+    nid.uID = 1;
+    nid.uFlags = NIF_INFO;
+    nid.dwInfoFlags = NIIF_INFO | NIIF_NOSOUND;
+    wcsncpy_s(nid.szInfoTitle, title.c_str(), _TRUNCATE);
+    wcsncpy_s(nid.szInfo, text.c_str(), _TRUNCATE);
+    Shell_NotifyIconW(NIM_MODIFY, &nid);
+}
+
 void ShowContextMenu(HWND hwnd) {
     HMENU hMenu = CreatePopupMenu();
     InsertMenuA(hMenu, -1, MF_BYPOSITION, MENU_SCAN_QR, "截图扫码 (ZXing)");
+    InsertMenuA(hMenu, -1, MF_BYPOSITION, MENU_SCAN_FULLSCREEN, "全屏扫码");
+    if (g_liveScanner.IsRunning()) {
+        InsertMenuA(hMenu, -1, MF_BYPOSITION | MF_CHECKED, MENU_LIVE_SCAN, "停止连续扫码");
+    } else {
+        InsertMenuA(hMenu, -1, MF_BYPOSITION, MENU_LIVE_SCAN, "连续扫码 (固定区域)");
+    }
     InsertMenuA(hMenu, -1, MF_BYPOSITION, MENU_GENERATE_QR, "生成二维码");
+    InsertMenuA(hMenu, -1, MF_BYPOSITION, MENU_HISTORY, "扫描历史");
     
     // 创建设置子菜单
     HMENU hSettingsMenu = CreatePopupMenu();
@@ -577,6 +934,8 @@ void ShowContextMenu(HWND hwnd) {
         autoStartFlags |= MF_CHECKED;
     }
     InsertMenuA(hSettingsMenu, -1, autoStartFlags, MENU_SETTINGS_AUTOSTART, "开机自启");
+    InsertMenuA(hSettingsMenu, -1, MF_BYPOSITION | MF_SEPARATOR, 0, NULL);
+    InsertMenuA(hSettingsMenu, -1, MF_BYPOSITION | (g_traceEnabled ? 0 : MF_GRAYED), MENU_EXPORT_TRACE, "导出扫码跟踪 (Chrome 格式)");
     
     // 添加设置子菜单到主菜单
     InsertMenuA(hMenu, -1, MF_BYPOSITION | MF_POPUP, (UINT_PTR)hSettingsMenu, "设置");
@@ -606,6 +965,9 @@ void TriggerScanProcess(HWND hwnd) {
     
     g_is_scanning = true;
     
+    // 从触发到显示结果为一次扫码, 各线程上的事件以同一序号关联
+    g_scanTraceId = qrcore::NewTraceId();
+    qrcore::TraceAsyncBegin("scan", g_scanTraceId);
 
     if (g_scanThread.joinable()) {
         g_scanThread.join();
@@ -613,53 +975,175 @@ void TriggerScanProcess(HWND hwnd) {
     
     g_scanThread = std::thread([hwnd]() {
         try {
+            qrcore::SetTraceThreadName("scan");
             
             RECT selectionRect;
-            bool success = ShowScreenshotOverlay(&selectionRect);
+            qrcore::ImageFrame frame;
+            bool success;
+            {
+                QRCORE_TRACE_SCOPE("ShowScreenshotOverlay", g_scanTraceId);
+                success = ShowScreenshotOverlay(&selectionRect, &frame);
+            }
             
             if (!success) {
+                qrcore::TraceAsyncEnd("scan", g_scanTraceId);
+                g_appMetrics.cancelled->Add();
                 g_is_scanning = false;
                 return;
             }
 
-            HBITMAP hBitmap = CaptureScreenRegion(selectionRect);
+            g_appMetrics.scans[0]->Add();
+            g_scanStartTime = std::chrono::steady_clock::now();
             
-            if (hBitmap) {
-                
-                g_captured_bitmap = hBitmap;
-                BOOL postResult = PostMessage(hwnd, WM_APP_DO_RECOGNITION, 0, 0);
+            // 选区帧是覆盖层定格截图的截取视图 (不复制像素); 定格截图失败时才在这里重新截取
+            if (!frame.empty() || CaptureScreenRegion(selectionRect, frame)) {
+                // 截图线程只负责取像素, 识别交给解码线程
+                // (帧直接引用 DIB 节内存, 由解码线程用完后释放)
+                std::string errorMsg;
+                bool submitted = ScanImageForQR(hwnd, frame, false, errorMsg);
+                frame = qrcore::ImageFrame();
                 
-                if (!postResult) {
-                    DeleteObject(hBitmap);
-                    g_captured_bitmap = nullptr;
-                    g_is_scanning = false;
+                if (!submitted) {
+                    PostScanError(hwnd, errorMsg);
                 }
             } else {
-                g_qr_result = "截图失败，请重试";
-                PostMessage(hwnd, WM_APP_SHOW_RESULT, 0, 0);
+                CountScanFailure(ScanFailure::CaptureFailed);
+                PostScanError(hwnd, "截图失败，请重试");
             }
         } catch (const std::exception& e) {
             
             std::string errorMsg = "扫描过程中发生异常: ";
             errorMsg += e.what();
             
-            g_qr_result = errorMsg;
-            PostMessage(hwnd, WM_APP_SHOW_RESULT, 0, 0); 
+            CountScanFailure(ScanFailure::Exception);
+            PostScanError(hwnd, errorMsg);
         } catch (...) {
             
-            g_qr_result = "扫描过程中发生未知错误";
-            PostMessage(hwnd, WM_APP_SHOW_RESULT, 0, 0);
+            CountScanFailure(ScanFailure::Exception);
+            PostScanError(hwnd, "扫描过程中发生未知错误");
         }
     }); 
 }
 
-// 显示全屏覆盖窗口让用户选择区域
-bool ShowScreenshotOverlay(RECT* outRect) {
+// 全屏扫码: 不拖拽选区, 整屏截图后分块并行识别
+void TriggerFullScreenScan(HWND hwnd) {
+    if (g_is_scanning) {
+        return;
+    }
+    
+    if (g_scanThread.joinable()) {
+        g_scanThread.join();
+    }
+    
+    g_is_scanning = true;
+    g_scanTraceId = qrcore::NewTraceId();
+    qrcore::TraceAsyncBegin("scan", g_scanTraceId);
+    
+    g_scanThread = std::thread([hwnd]() {
+        try {
+            qrcore::SetTraceThreadName("scan");
+            g_appMetrics.scans[1]->Add();
+            g_scanStartTime = std::chrono::steady_clock::now();
+            qrcore::ImageFrame frame;
+            
+            if (CaptureScreen(frame)) {
+                std::string errorMsg;
+                bool submitted = ScanImageForQR(hwnd, frame, true, errorMsg);
+                frame = qrcore::ImageFrame();
+                
+                if (!submitted) {
+                    PostScanError(hwnd, errorMsg);
+                }
+            } else {
+                CountScanFailure(ScanFailure::CaptureFailed);
+                PostScanError(hwnd, "截图失败，请重试");
+            }
+        } catch (const std::exception& e) {
+            std::string errorMsg = "扫描过程中发生异常: ";
+            errorMsg += e.what();
+            CountScanFailure(ScanFailure::Exception);
+            PostScanError(hwnd, errorMsg);
+        } catch (...) {
+            CountScanFailure(ScanFailure::Exception);
+            PostScanError(hwnd, "扫描过程中发生未知错误");
+        }
+    });
+}
+
+// 连续扫码: 框选一次区域后持续抓取识别, 再次选择菜单项停止
+void ToggleLiveScan(HWND hwnd) {
+    if (g_liveScanner.IsRunning()) {
+        g_liveScanner.Stop();
+        qrcore::LiveScanStats stats = g_liveScanner.GetStats();
+        char logLine[256];
+        sprintf_s(logLine, "[QRLive] stopped captured=%llu changed=%llu decoded=%llu superseded=%llu emitted=%llu errors=%llu\n",
+            (unsigned long long)stats.captured, (unsigned long long)stats.changed, (unsigned long long)stats.decoded,
+            (unsigned long long)stats.superseded, (unsigned long long)stats.emitted, (unsigned long long)stats.captureErrors);
+        OutputDebugStringA(logLine);
+        qrcore::FramePoolStats capturePool = g_capturePool.GetStats();
+        qrcore::FramePoolStats framePool = qrcore::DefaultFramePool().GetStats();
+        sprintf_s(logLine, "[QRLive] capture pool acquired=%llu reused=%llu allocated=%llu, frame pool acquired=%llu reused=%llu allocated=%llu\n",
+            (unsigned long long)capturePool.acquired, (unsigned long long)capturePool.reused, (unsigned long long)capturePool.allocated,
+            (unsigned long long)framePool.acquired, (unsigned long long)framePool.reused, (unsigned long long)framePool.allocated);
+        OutputDebugStringA(logLine);
+        ShowTrayBalloon(hwnd, L"连续扫码", L"已停止 (共识别到 " + std::to_wstring(stats.emitted) + L" 个内容)");
+        return;
+    }
+    if (g_is_scanning) {
+        return;
+    }
+    
+    if (g_scanThread.joinable()) {
+        g_scanThread.join();
+    }
+    
+    g_is_scanning = true;
+    
+    // 框选在扫码线程上进行 (覆盖层有自己的消息循环), 选定后启动连续扫码;
+    // 只取区域, 不定格截图 (之后按区域持续抓取)
+    g_scanThread = std::thread([hwnd]() {
+        RECT selectionRect;
+        bool selected = ShowScreenshotOverlay(&selectionRect);
+        g_is_scanning = false;
+        if (!selected) {
+            return;
+        }
+        
+        g_liveSource.SetRegion(selectionRect);
+        qrcore::LiveScanConfig config = g_liveConfig;
+        config.cascade = g_cascadeConfig;
+        bool started = g_liveScanner.Start(config, [hwnd](std::unique_ptr<qrcore::LiveScanEvent> event) {
+            if (PostMessage(hwnd, WM_APP_LIVE_RESULT, 0, (LPARAM)event.get())) {
+                event.release();
+            }
+        });
+        if (started) {
+            ShowTrayBalloon(hwnd, L"连续扫码", L"已开始, 新出现的二维码会自动复制到剪贴板。再次选择菜单项停止。");
+        }
+    });
+}
+
+/**
+ * @brief 显示全屏覆盖窗口让用户选择区域
+ *
+ * outSelection 非空时, 打开前整屏截图一次并定格为覆盖层背景, 用户看到的就是将被识别的画面
+ * (动画、视频不会在选定后变化), 并返回选区在这一帧上的截取视图 (与整屏帧共用 DIB 节, 不复制、不再次截图);
+ * 定格截图失败时 outSelection 为空帧, 由调用方按 outRect 重新截取。
+ * outSelection 为空时 (如连续扫码只需要区域) 不截图, 显示半透明覆盖层, 框选时仍能看到变化的画面。
+ */
+bool ShowScreenshotOverlay(RECT* outRect, qrcore::ImageFrame* outSelection) {
     
     memset(&g_overlayData, 0, sizeof(g_overlayData));
     
     int screenWidth = GetSystemMetrics(SM_CXSCREEN);
     int screenHeight = GetSystemMetrics(SM_CYSCREEN);
+
+    // 只需要区域时不截图: 整屏截图 (4K / 5K 上数十 MB) 和不透明的定格背景都用不上
+    qrcore::ImageFrame screenshot;
+    if (outSelection && !CaptureScreen(screenshot)) {
+        screenshot = qrcore::ImageFrame();
+    }
+    g_overlayScreenshot = screenshot;
     
     HWND overlayWnd = CreateWindowExA(
         WS_EX_TOPMOST | WS_EX_LAYERED | WS_EX_TOOLWINDOW,
@@ -671,6 +1155,7 @@ bool ShowScreenshotOverlay(RECT* outRect) {
     );
     
     if (!overlayWnd) {
+        g_overlayScreenshot = qrcore::ImageFrame();
         MessageBoxA(NULL, "创建覆盖层窗口失败!", "错误", MB_OK | MB_ICONERROR);
         return false;
     }
@@ -698,9 +1183,14 @@ bool ShowScreenshotOverlay(RECT* outRect) {
     if (IsWindow(overlayWnd)) {
         DestroyWindow(overlayWnd);
     }
+    g_overlayScreenshot = qrcore::ImageFrame();
     
     if (g_overlayData.isCompleted && !g_overlayData.isCancelled) {
         *outRect = g_overlayData.selection;
+        if (outSelection) {
+            const RECT& sel = g_overlayData.selection;
+            *outSelection = qrcore::CropFrame(screenshot, sel.left, sel.top, sel.right - sel.left, sel.bottom - sel.top);
+        }
         return true;
     } else {
         return false;
@@ -708,87 +1198,96 @@ bool ShowScreenshotOverlay(RECT* outRect) {
 }
 
 /**
- * @brief 使用 ZXing-CPP 库扫描 HBITMAP (已修复 Stride 问题)
+ * @brief 提交截图帧到解码线程识别, 结果通过 WM_APP_SHOW_RESULT 送回 hwnd
+ *
+ * 帧是 32 位 BGRX 的 DIB 节内存, 以 ImageFormat::BGRX 直接交给 ZXing,
+ * 不再经过 GetDIBits 重排为 24 位缓冲区。
+ * fullScreen 为 true 时按分块并行识别整屏。
+ * 识别过的画面命中识别结果缓存时不提交, 直接送回缓存的结果。
  */
-bool ScanImageForQR(HBITMAP hBitmap, std::string& outErrorMsg) {
+bool ScanImageForQR(HWND hwnd, const qrcore::ImageFrame& frame, bool fullScreen, std::string& outErrorMsg) {
     
     try {
-        BITMAP bmp;
-        if (!GetObject(hBitmap, sizeof(BITMAP), &bmp)) {
-            outErrorMsg = "无法获取位图信息";
+        qrcore::DecodeJob job;
+        if (!qrcore::ValidateFrame(frame, outErrorMsg)) {
+            CountScanFailure(ScanFailure::InvalidFrame);
             return false;
         }
-
-        if (bmp.bmWidth <= 0 || bmp.bmHeight <= 0) {
-            outErrorMsg = "位图尺寸无效";
-            return false;
+        g_scanSource = fullScreen ? qrcore::HistorySource::FullScreen : qrcore::HistorySource::Region;
+        QRCORE_TRACE_SCOPE("ScanImageForQR", g_scanTraceId);
+
+        // 同一画面此前识别过时直接返回缓存的结果; 感知命中 (选区略有不同) 只在码所在的小区域内确认。
+        // 单码 / 多码、选区 / 全屏的结果互不命中
+        qrcore::DecodeCacheKey cacheKey;
+        uint32_t cacheMode = (g_cascadeConfig.maxSymbols == 1 ? 0u : 1u) | (fullScreen ? 2u : 0u);
+        bool useCache = g_resultCacheEnabled && qrcore::MakeDecodeCacheKey(frame, cacheMode, cacheKey);
+        if (useCache) {
+            QRCORE_TRACE_SCOPE("cache_lookup", g_scanTraceId);
+            auto start = std::chrono::steady_clock::now();
+            auto cached = std::make_unique<qrcore::ScanResult>();
+            qrcore::DecodeCacheHit hit;
+            if (g_resultCache.Lookup(cacheKey, *cached, &hit) &&
+                (!hit.fuzzy || qrcore::VerifyCachedResult(frame, hit.tier, g_cascadeConfig, *cached))) {
+                cached->totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                PostScanResult(hwnd, std::move(cached));
+                return true;
+            }
         }
 
-        // 1. 计算正确的 Stride (行字节数)
-        int bytesPerPixel = 3;
-        int stride = ((bmp.bmWidth * bytesPerPixel + 3) / 4) * 4;
-
-        BITMAPINFOHEADER bi = {0};
-        bi.biSize = sizeof(BITMAPINFOHEADER);
-        bi.biWidth = bmp.bmWidth;
-        bi.biHeight = -bmp.bmHeight; // Top-down DIB
-        bi.biPlanes = 1;
-        bi.biBitCount = 24; // Request 24-bit RGB
-        bi.biCompression = BI_RGB;
-
-        HDC hdc = GetDC(NULL);
-        if (!hdc) {
-            outErrorMsg = "无法获取设备上下文 (GetDC)";
-            return false;
-        }
-        
-        // 2. 分配正确大小的缓冲区 (stride * height)
-        std::vector<uint8_t> rgbBuffer(stride * bmp.bmHeight);
-        int dibResult = GetDIBits(hdc, hBitmap, 0, bmp.bmHeight, rgbBuffer.data(), (BITMAPINFO*)&bi, DIB_RGB_COLORS);
-        ReleaseDC(NULL, hdc);
+        job.frame = frame;
 
-        if (dibResult == 0) {
-            outErrorMsg = "图像数据转换失败 (GetDIBits)";
-            return false;
+        // 分级识别: 先快速识别, 失败再逐级加强 (见 config.ini [Scan]); 配置共用只读副本, 不逐次复制
+        job.cascade = g_jobCascade;
+        if (fullScreen) {
+            job.tiles = g_jobTiles;
         }
-        
-        // 3. 配置 ZXing
-        ZXing::DecodeHints hints;
-        hints.setFormats(ZXing::BarcodeFormat::QRCode);
-        hints.setTryHarder(true); // 启用更强的识别
-        hints.setTryRotate(true); // 启用旋转识别
-
-        
-        // 4. 创建 ImageView, 关键：传入正确的 stride
-        ZXing::ImageView imageView(rgbBuffer.data(), bmp.bmWidth, bmp.bmHeight, ZXing::ImageFormat::RGB, stride);
-        
-        // 5. 识别
-        ZXing::Barcode result = ZXing::ReadBarcode(imageView, hints);
-
-        if (result.isValid()) {
-            std::string qrText = result.text(); // text() 返回 UTF-8
-            
-            CopyToClipboard(qrText); // CopyToClipboard 内部处理 UTF-8 到 UTF-16
-            
-            g_qr_result = qrText; // 主线程将使用这个
-            PostMessage(g_hwnd, WM_APP_SHOW_RESULT, 1, 0); // 发送成功消息
-            
-            return true;
-        } else {
-            outErrorMsg = "未能在图像中识别到二维码。\n请确保截图清晰且完整。";
+        job.traceId = g_scanTraceId;
+
+        // 缓存键放在全局 (同一时间只有一次扫码), 回调只捕获窗口句柄, std::function 不必分配
+        g_scanCacheKey = cacheKey;
+        g_scanUseCache = useCache;
+        bool submitted = g_decodeWorker.Submit(std::move(job), [hwnd](std::unique_ptr<qrcore::ScanResult> result) {
+            if (g_scanUseCache) {
+                g_resultCache.Insert(g_scanCacheKey, *result); // 只记录成功的结果
+            }
+            PostScanResult(hwnd, std::move(result));
+        });
+        if (!submitted) {
+            CountScanFailure(ScanFailure::WorkerStopped);
+            outErrorMsg = "解码线程未运行";
             return false;
         }
+        return true;
         
     } catch (const std::exception& e) {
+        CountScanFailure(ScanFailure::Exception);
         outErrorMsg = "识别异常: ";
         outErrorMsg += e.what();
         return false;
     } catch (...) {
+        CountScanFailure(ScanFailure::Exception);
         outErrorMsg = "识别过程中发生未知异常";
         return false;
     }
 }
 
+// 将识别结果交给主线程; 投递失败时由这里释放
+void PostScanResult(HWND hwnd, std::unique_ptr<qrcore::ScanResult> result) {
+    // 从投递到主线程取出消息 (主线程忙于其他消息时的等待)
+    qrcore::TraceAsyncBegin("WM_APP_SHOW_RESULT dispatch", g_scanTraceId);
+    if (PostMessage(hwnd, WM_APP_SHOW_RESULT, 0, (LPARAM)result.get())) {
+        result.release();
+    } else {
+        g_is_scanning = false;
+    }
+}
+
+void PostScanError(HWND hwnd, const std::string& errorMsg) {
+    auto result = std::make_unique<qrcore::ScanResult>();
+    result->errorMsg = errorMsg;
+    PostScanResult(hwnd, std::move(result));
+}
+
 
 // --- 二维码生成功能 ---
 
@@ -806,6 +1305,22 @@ std::string WideToUTF8(const std::wstring& wideString) {
     return utf8String;
 }
 
+// UTF-8 (std::string) 转 Wide (UTF-16), 用于显示识别结果
+std::wstring UTF8ToWide(const std::string& utf8String) {
+    if (utf8String.empty()) {
+        return std::wstring();
+    }
+
+    int wideLen = MultiByteToWideChar(CP_UTF8, 0, utf8String.c_str(), (int)utf8String.length(), NULL, 0);
+    if (wideLen <= 0) {
+        return L"[转换结果失败]";
+    }
+
+    std::wstring wideString(wideLen, 0);
+    MultiByteToWideChar(CP_UTF8, 0, utf8String.c_str(), (int)utf8String.length(), &wideString[0], wideLen);
+    return wideString;
+}
+
 
 void ShowQRGenerationWindow(HWND hwnd) {
     
@@ -834,7 +1349,7 @@ void ShowQRGenerationWindow(HWND hwnd) {
     
     // 初始化数据
     g_qrGenData.hPreviewBitmap = NULL;
-    g_qrGenData.pGdiplusBitmap = NULL;
+    g_qrGenData.matrix = qrcore::CachedMatrix();
     g_qrGenData.currentText = "";
     g_qrGenData.scale = 8;
     g_qrGenData.eccLevel = qrcodegen::QrCode::Ecc::MEDIUM;
@@ -911,6 +1426,17 @@ void ShowQRGenerationWindow(HWND hwnd) {
         btnX, btnY, btnWidth, 35, hDlg, (HMENU)IDC_BTN_SAVE_JPG, g_hinstance, NULL);
     btnY += 45;
     
+    // 矢量格式: 任意打印尺寸 (见 [Generate] VectorSizeMm)
+    CreateWindowExW(0, WC_BUTTONW, L"保存为 SVG",
+        WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+        btnX, btnY, btnWidth, 35, hDlg, (HMENU)IDC_BTN_SAVE_SVG, g_hinstance, NULL);
+    btnY += 45;
+    
+    CreateWindowExW(0, WC_BUTTONW, L"保存为 PDF",
+        WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+        btnX, btnY, btnWidth, 35, hDlg, (HMENU)IDC_BTN_SAVE_PDF, g_hinstance, NULL);
+    btnY += 45;
+    
     CreateWindowExW(0, WC_BUTTONW, L"复制到剪贴板",
         WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
         btnX, btnY, btnWidth, 35, hDlg, (HMENU)IDC_BTN_COPY, g_hinstance, NULL);
@@ -935,19 +1461,44 @@ void ShowQRGenerationWindow(HWND hwnd) {
 // 更改：必须是 LRESULT CALLBACK 并调用 DefWindowProcW 才能拖动
 LRESULT CALLBACK QRGenDialogProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam) {
     switch (uMsg) {
-        case WM_CLOSE:
+        case WM_CLOSE: {
+            // 作废未完成的预览请求, 并释放已投递但尚未处理的结果
+            KillTimer(hwndDlg, 1);
+            g_previewWorker.Cancel();
+            MSG pending;
+            while (PeekMessage(&pending, hwndDlg, WM_APP_QRGEN_PREVIEW, WM_APP_QRGEN_PREVIEW, PM_REMOVE)) {
+                delete (qrcore::PreviewResult*)pending.lParam;
+            }
+
+            // 关闭时输出一次预览任务与编码缓存的累计计数 (每次预览的耗时由指标注册表导出)
+            {
+                qrcore::EncodeCacheStats stats = g_encodeCache.GetStats();
+                qrcore::PreviewStats jobs = g_previewWorker.GetStats();
+                char logMsg[256];
+                sprintf_s(logMsg, "[QRGen] debounce=%dms submitted=%llu completed=%llu dropped=%llu aborted=%llu, "
+                          "matrix hit=%llu miss=%llu, raster hit=%llu miss=%llu\n",
+                          g_previewWorker.SuggestedDebounceMs(),
+                          (unsigned long long)jobs.submitted, (unsigned long long)jobs.completed,
+                          (unsigned long long)jobs.dropped, (unsigned long long)jobs.aborted,
+                          (unsigned long long)stats.matrixHits, (unsigned long long)stats.matrixMisses,
+                          (unsigned long long)stats.rasterHits, (unsigned long long)stats.rasterMisses);
+                OutputDebugStringA(logMsg);
+            }
+            
             // 清理资源
             if (g_qrGenData.hPreviewBitmap) {
                 DeleteObject(g_qrGenData.hPreviewBitmap);
                 g_qrGenData.hPreviewBitmap = NULL;
             }
-            if (g_qrGenData.pGdiplusBitmap) {
-                delete g_qrGenData.pGdiplusBitmap;
-                g_qrGenData.pGdiplusBitmap = NULL;
-            }
+            g_qrGenData.matrix = qrcore::CachedMatrix();
             DestroyWindow(hwndDlg);
             PostQuitMessage(0);
             return 0;
+        }
+        
+        case WM_APP_QRGEN_PREVIEW:
+            ApplyQRPreview(hwndDlg, std::unique_ptr<qrcore::PreviewResult>((qrcore::PreviewResult*)lParam));
+            return 0;
             
         case WM_COMMAND:
             switch (LOWORD(wParam)) {
@@ -955,12 +1506,8 @@ LRESULT CALLBACK QRGenDialogProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM
                     // 修复：实现输入内容变化时自动生成
                     if (HIWORD(wParam) == EN_CHANGE) {
                         // 延迟自动生成，避免每次按键都生成
-                        static UINT_PTR timerId = 0;
-                        if (timerId) {
-                            KillTimer(hwndDlg, timerId);
-                        }
-                        // 500ms 后自动生成
-                        timerId = SetTimer(hwndDlg, 1, 500, NULL);
+                        // 生成在后台进行且过时的请求会被取消, 去抖间隔按最近的生成耗时自适应 (30~300ms)
+                        SetTimer(hwndDlg, 1, g_previewWorker.SuggestedDebounceMs(), NULL);
                     }
                     return 0;
                     
@@ -976,6 +1523,14 @@ LRESULT CALLBACK QRGenDialogProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM
                     SaveQRCodeImage(hwndDlg, false);
                     return 0;
                     
+                case IDC_BTN_SAVE_SVG:
+                    SaveQRCodeVector(hwndDlg, false);
+                    return 0;
+                    
+                case IDC_BTN_SAVE_PDF:
+                    SaveQRCodeVector(hwndDlg, true);
+                    return 0;
+                    
                 case IDC_BTN_COPY:
                     CopyQRToClipboard(hwndDlg);
                     return 0;
@@ -983,8 +1538,10 @@ LRESULT CALLBACK QRGenDialogProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM
                 case IDC_COMBO_SIZE:
                     if (HIWORD(wParam) == CBN_SELCHANGE) {
                         // 修复：尺寸改变时自动更新预览
+                        // 只有缩放倍数变化: 不重新读取文本, 模块矩阵直接取自缓存
                         if (!g_qrGenData.currentText.empty()) {
-                            UpdateQRPreview(hwndDlg);
+                            g_qrGenData.scale = GetSelectedQRScale(hwndDlg);
+                            RequestQRPreview(hwndDlg);
                         }
                     }
                     return 0;
@@ -1083,77 +1640,9 @@ void UpdateQRPreview(HWND hwndDlg) {
         }
         
         // 获取尺寸设置
-        HWND hComboSize = GetDlgItem(hwndDlg, IDC_COMBO_SIZE);
-        int sizeIdx = SendMessageA(hComboSize, CB_GETCURSEL, 0, 0);
-        switch (sizeIdx) {
-            case 0: g_qrGenData.scale = 4; break;
-            case 1: g_qrGenData.scale = 8; break;
-            case 2: g_qrGenData.scale = 12; break;
-            case 3: g_qrGenData.scale = 16; break;
-            default: g_qrGenData.scale = 8; break;
-        }
-        
-        // 生成二维码
-        qrcodegen::QrCode qr = qrcodegen::QrCode::encodeText(g_qrGenData.currentText.c_str(), g_qrGenData.eccLevel);
-        int size = qr.getSize();
-        int border = 4;
-        int imageSize = (size + border * 2) * g_qrGenData.scale;
-        
-        // 清理旧的位图
-        if (g_qrGenData.pGdiplusBitmap) {
-            delete g_qrGenData.pGdiplusBitmap;
-        }
-        
-        // 创建新的 GDI+ 位图（用于保存）
-        g_qrGenData.pGdiplusBitmap = new Gdiplus::Bitmap(imageSize, imageSize, PixelFormat24bppRGB);
-        Gdiplus::Graphics graphics(g_qrGenData.pGdiplusBitmap);
-        graphics.Clear(Gdiplus::Color(255, 255, 255));
-        
-        Gdiplus::SolidBrush blackBrush(Gdiplus::Color(0, 0, 0));
-        for (int y = 0; y < size; y++) {
-            for (int x = 0; x < size; x++) {
-                if (qr.getModule(x, y)) {
-                    int rectX = (x + border) * g_qrGenData.scale;
-                    int rectY = (y + border) * g_qrGenData.scale;
-                    graphics.FillRectangle(&blackBrush, rectX, rectY, g_qrGenData.scale, g_qrGenData.scale);
-                }
-            }
-        }
+        g_qrGenData.scale = GetSelectedQRScale(hwndDlg);
         
-        // 修复：创建固定尺寸的预览位图（400x400）
-        const int previewSize = 380; // 预览固定尺寸
-        Gdiplus::Bitmap previewBitmap(previewSize, previewSize, PixelFormat24bppRGB);
-        Gdiplus::Graphics previewGraphics(&previewBitmap);
-        previewGraphics.Clear(Gdiplus::Color(255, 255, 255));
-        
-        // 计算缩放比例以适应预览区域
-        float scale = (float)previewSize / (float)imageSize;
-        if (scale > 1.0f) scale = 1.0f; // 不放大，只缩小
-        
-        int scaledSize = (int)(imageSize * scale);
-        int offsetX = (previewSize - scaledSize) / 2;
-        int offsetY = (previewSize - scaledSize) / 2;
-        
-        // 使用高质量插值绘制缩放后的二维码
-        previewGraphics.SetInterpolationMode(Gdiplus::InterpolationModeNearestNeighbor);
-        previewGraphics.DrawImage(g_qrGenData.pGdiplusBitmap, 
-            offsetX, offsetY, scaledSize, scaledSize);
-        
-        // 清理旧的预览位图
-        if (g_qrGenData.hPreviewBitmap) {
-            DeleteObject(g_qrGenData.hPreviewBitmap);
-            g_qrGenData.hPreviewBitmap = NULL;
-        }
-        
-        previewBitmap.GetHBITMAP(Gdiplus::Color(255, 255, 255), &g_qrGenData.hPreviewBitmap);
-        
-        // 更新预览控件
-        HWND hPreview = GetDlgItem(hwndDlg, IDC_STATIC_PREVIEW);
-        SendMessageA(hPreview, STM_SETIMAGE, IMAGE_BITMAP, (LPARAM)g_qrGenData.hPreviewBitmap);
-        
-        // 强制重绘预览区域
-        InvalidateRect(hPreview, NULL, TRUE);
-        UpdateWindow(hPreview);
+        RequestQRPreview(hwndDlg);
         
     } catch (const std::exception& e) {
         std::string errorMsg = "生成二维码时发生错误: ";
@@ -1162,9 +1651,86 @@ void UpdateQRPreview(HWND hwndDlg) {
     }
 }
 
+// 尺寸下拉框对应的缩放倍数
+int GetSelectedQRScale(HWND hwndDlg) {
+    HWND hComboSize = GetDlgItem(hwndDlg, IDC_COMBO_SIZE);
+    int sizeIdx = SendMessageA(hComboSize, CB_GETCURSEL, 0, 0);
+    switch (sizeIdx) {
+        case 0: return 4;
+        case 1: return 8;
+        case 2: return 12;
+        case 3: return 16;
+        default: return 8;
+    }
+}
+
+// 按当前内容、纠错级别和尺寸提交预览请求; 结果由 WM_APP_QRGEN_PREVIEW 送回 ApplyQRPreview
+void RequestQRPreview(HWND hwndDlg) {
+    qrcore::PreviewRequest request;
+    request.text = g_qrGenData.currentText;
+    request.ecc = (int)g_qrGenData.eccLevel;
+    request.scale = g_qrGenData.scale;
+    request.border = 4;
+    request.previewSize = 380; // 预览固定尺寸
+    
+    g_previewWorker.Submit(std::move(request), [hwndDlg](std::unique_ptr<qrcore::PreviewResult> result) {
+        // 投递失败 (窗口已关闭) 时由 unique_ptr 释放
+        if (PostMessage(hwndDlg, WM_APP_QRGEN_PREVIEW, 0, (LPARAM)result.get())) {
+            result.release();
+        }
+    });
+}
+
+// 在生成窗口的消息线程中换上新的图像与预览; 已被更新输入作废的结果直接丢弃
+void ApplyQRPreview(HWND hwndDlg, std::unique_ptr<qrcore::PreviewResult> result) {
+    if (!result || !g_previewWorker.IsCurrent(result->generation)) {
+        return;
+    }
+    g_appMetrics.previews->Add();
+    g_appMetrics.previewTime->RecordMs(result->jobMs);
+    if (!result->errorMsg.empty()) {
+        g_appMetrics.encodeErrors->Add();
+        std::string errorMsg = "生成二维码时发生错误: ";
+        errorMsg += result->errorMsg;
+        MessageBoxA(hwndDlg, errorMsg.c_str(), "错误", MB_OK | MB_ICONERROR);
+        return;
+    }
+    
+    // 保存时按当前尺寸从模块矩阵生成图像, 这里只记下矩阵
+    g_qrGenData.matrix = result->matrix;
+    
+    // 预览已在生成线程按最终尺寸画好, 这里只复制进 DIB 节
+    const qrcore::ImageFrame& preview = result->preview;
+    qrcore::ImageFrame previewFrame;
+    HBITMAP hNewPreview = CreateFrameDIB(preview.width, preview.height, previewFrame, false);
+    if (!hNewPreview) {
+        return;
+    }
+    size_t rowBytes = (size_t)preview.width * 4;
+    for (int y = 0; y < preview.height; y++) {
+        memcpy(previewFrame.row(y), preview.row(y), rowBytes);
+    }
+    
+    // 清理旧的预览位图
+    if (g_qrGenData.hPreviewBitmap) {
+        DeleteObject(g_qrGenData.hPreviewBitmap);
+    }
+    g_qrGenData.hPreviewBitmap = hNewPreview;
+    
+    // 更新预览控件
+    HWND hPreview = GetDlgItem(hwndDlg, IDC_STATIC_PREVIEW);
+    SendMessageA(hPreview, STM_SETIMAGE, IMAGE_BITMAP, (LPARAM)g_qrGenData.hPreviewBitmap);
+    
+    // 强制重绘预览区域
+    InvalidateRect(hPreview, NULL, TRUE);
+    UpdateWindow(hPreview);
+}
+
 // 保存二维码图片
+// PNG 由 qrcore::WriteQrPng 从模块矩阵逐行写出 (1 位灰度等, 见 [Generate] 节);
+// JPEG 仍经 GDI+ 编码, 原尺寸图像临时取自编码缓存
 void SaveQRCodeImage(HWND hwndDlg, bool asPNG) {
-    if (!g_qrGenData.pGdiplusBitmap) {
+    if (g_qrGenData.matrix.empty()) {
         MessageBoxW(hwndDlg, L"请先生成二维码", L"提示", MB_OK | MB_ICONINFORMATION); // 更改：使用 W
         return;
     }
@@ -1186,23 +1752,110 @@ void SaveQRCodeImage(HWND hwndDlg, bool asPNG) {
         wcscpy_s(wFilename, defaultName.c_str());
         
         if (GetSaveFileNameW(&ofn)) { // 更改：使用 W
-            CLSID encoderClsid;
-            const WCHAR* mimeType = asPNG ? L"image/png" : L"image/jpeg";
+            const int border = 4;
+            bool saved = false;
+            std::string errorMsg;
             
-            if (GetEncoderClsid(mimeType, &encoderClsid) >= 0) {
-                
-                if (g_qrGenData.pGdiplusBitmap->Save(wFilename, &encoderClsid) == Gdiplus::Ok) {
-                    std::wstring msg = L"二维码已保存: " + std::wstring(wFilename) + L"\n是否打开它？";
-                    if (MessageBoxW(hwndDlg, msg.c_str(), L"保存成功", MB_YESNO | MB_ICONINFORMATION) == IDYES) {
-                        ShellExecuteW(NULL, L"open", wFilename, NULL, NULL, SW_SHOWNORMAL); // 更改：使用 W
+            if (asPNG) {
+                FILE* file = NULL;
+                if (_wfopen_s(&file, wFilename, L"wb") == 0 && file) {
+                    saved = qrcore::WriteQrPng(*g_qrGenData.matrix.matrix, g_qrGenData.scale, border, g_pngOptions,
+                        [file](const uint8_t* data, size_t size) { return fwrite(data, 1, size, file) == size; },
+                        errorMsg);
+                    if (fclose(file) != 0) {
+                        saved = false;
+                    }
+                    if (!saved) {
+                        DeleteFileW(wFilename);
+                    }
+                }
+            } else {
+                CLSID encoderClsid;
+                if (GetEncoderClsid(L"image/jpeg", &encoderClsid) >= 0) {
+                    qrcore::ImageFrame image = g_encodeCache.GetRaster(g_qrGenData.matrix, g_qrGenData.scale, border,
+                                                                       qrcore::PixelFormat::BGRX);
+                    if (!image.empty()) {
+                        Gdiplus::Bitmap bitmap(image.width, image.height, image.stride, PixelFormat32bppRGB, image.data);
+                        saved = bitmap.Save(wFilename, &encoderClsid) == Gdiplus::Ok;
                     }
                 } else {
-                    MessageBoxW(hwndDlg, L"保存文件失败", L"错误", MB_OK | MB_ICONERROR); // 更改：使用 W
+                    MessageBoxW(hwndDlg, L"获取图像编码器失败", L"错误", MB_OK | MB_ICONERROR); // 更改：使用 W
+                    return;
+                }
+            }
+            
+            if (saved) {
+                g_appMetrics.saves[asPNG ? 0 : 1]->Add();
+                std::wstring msg = L"二维码已保存: " + std::wstring(wFilename) + L"\n是否打开它？";
+                if (MessageBoxW(hwndDlg, msg.c_str(), L"保存成功", MB_YESNO | MB_ICONINFORMATION) == IDYES) {
+                    ShellExecuteW(NULL, L"open", wFilename, NULL, NULL, SW_SHOWNORMAL); // 更改：使用 W
                 }
             } else {
-                MessageBoxW(hwndDlg, L"获取图像编码器失败", L"错误", MB_OK | MB_ICONERROR); // 更改：使用 W
+                std::wstring msg = L"保存文件失败";
+                if (!errorMsg.empty()) {
+                    msg += L": " + UTF8ToWide(errorMsg);
+                }
+                MessageBoxW(hwndDlg, msg.c_str(), L"错误", MB_OK | MB_ICONERROR); // 更改：使用 W
+            }
+        }
+    } catch (const std::exception& e) {
+        std::string errorMsg = "保存图片时发生错误: ";
+        errorMsg += e.what();
+        MessageBoxA(hwndDlg, errorMsg.c_str(), "错误", MB_OK | MB_ICONERROR);
+    }
+}
+
+// 导出矢量二维码 (SVG / PDF): 模块合并为矩形, 与保存的倍数无关, 物理尺寸取自 [Generate] VectorSizeMm
+void SaveQRCodeVector(HWND hwndDlg, bool asPDF) {
+    if (g_qrGenData.matrix.empty()) {
+        MessageBoxW(hwndDlg, L"请先生成二维码", L"提示", MB_OK | MB_ICONINFORMATION);
+        return;
+    }
+    
+    try {
+        wchar_t wFilename[MAX_PATH] = {0};
+        OPENFILENAMEW ofn = {0};
+        ofn.lStructSize = sizeof(OPENFILENAMEW);
+        ofn.hwndOwner = hwndDlg;
+        ofn.lpstrFilter = asPDF ? L"PDF 文档\0*.pdf\0所有文件\0*.*\0" : L"SVG 矢量图\0*.svg\0所有文件\0*.*\0";
+        ofn.lpstrFile = wFilename;
+        ofn.nMaxFile = MAX_PATH;
+        ofn.lpstrDefExt = asPDF ? L"pdf" : L"svg";
+        ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+        
+        std::wstring defaultName = L"qrcode_" + std::to_wstring(GetTickCount()) + (asPDF ? L".pdf" : L".svg");
+        wcscpy_s(wFilename, defaultName.c_str());
+        
+        if (!GetSaveFileNameW(&ofn)) {
+            return;
+        }
+        
+        std::string document;
+        std::string errorMsg;
+        bool built = asPDF ? qrcore::BuildQrPdf(*g_qrGenData.matrix.matrix, g_vectorOptions, document, errorMsg)
+                           : qrcore::BuildQrSvg(*g_qrGenData.matrix.matrix, g_vectorOptions, document, errorMsg);
+        bool saved = false;
+        if (built) {
+            FILE* file = NULL;
+            if (_wfopen_s(&file, wFilename, L"wb") == 0 && file) {
+                saved = fwrite(document.data(), 1, document.size(), file) == document.size();
+                saved = (fclose(file) == 0) && saved;
             }
         }
+        
+        if (saved) {
+            g_appMetrics.saves[asPDF ? 3 : 2]->Add();
+            std::wstring msg = L"二维码已保存: " + std::wstring(wFilename) + L"\n是否打开它？";
+            if (MessageBoxW(hwndDlg, msg.c_str(), L"保存成功", MB_YESNO | MB_ICONINFORMATION) == IDYES) {
+                ShellExecuteW(NULL, L"open", wFilename, NULL, NULL, SW_SHOWNORMAL);
+            }
+        } else {
+            std::wstring msg = L"保存文件失败";
+            if (!errorMsg.empty()) {
+                msg += L": " + UTF8ToWide(errorMsg);
+            }
+            MessageBoxW(hwndDlg, msg.c_str(), L"错误", MB_OK | MB_ICONERROR);
+        }
     } catch (const std::exception& e) {
         std::string errorMsg = "保存图片时发生错误: ";
         errorMsg += e.what();
@@ -1219,6 +1872,7 @@ void CopyQRToClipboard(HWND hwndDlg) {
     
     try {
         CopyBitmapToClipboard(g_qrGenData.hPreviewBitmap);
+        g_appMetrics.imageCopies->Add();
         MessageBoxW(hwndDlg, L"二维码图片已复制到剪贴板！", L"成功", MB_OK | MB_ICONINFORMATION); // 更改：使用 W
     } catch (const std::exception& e) {
         std::string errorMsg = "复制到剪贴板时发生错误: ";
@@ -1231,6 +1885,7 @@ void CopyQRToClipboard(HWND hwndDlg) {
 
 // 复制 UTF-8 文本到剪贴板 (转换为 UTF-16)
 void CopyToClipboard(const std::string& text) {
+    QRCORE_TRACE_SCOPE("CopyToClipboard");
     
     if (!OpenClipboard(g_hwnd)) {
         return;
@@ -1322,37 +1977,75 @@ void CopyBitmapToClipboard(HBITMAP hBitmap) {
 }
 
 // --- 屏幕截图函数 ---
-HBITMAP CaptureScreen() {
-    HDC hScreenDC = GetDC(NULL);
-    HDC hMemDC = CreateCompatibleDC(hScreenDC);
-    int screenWidth = GetSystemMetrics(SM_CXSCREEN);
-    int screenHeight = GetSystemMetrics(SM_CYSCREEN);
-    HBITMAP hBitmap = CreateCompatibleBitmap(hScreenDC, screenWidth, screenHeight);
-    HBITMAP hOldBitmap = (HBITMAP)SelectObject(hMemDC, hBitmap);
-    BitBlt(hMemDC, 0, 0, screenWidth, screenHeight, hScreenDC, 0, 0, SRCCOPY);
-    SelectObject(hMemDC, hOldBitmap);
-    DeleteDC(hMemDC);
-    ReleaseDC(NULL, hScreenDC);
+// 截取整个主屏幕
+bool CaptureScreen(qrcore::ImageFrame& outFrame) {
+    RECT screenRect = {0, 0, GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN)};
+    return CaptureScreenRegion(screenRect, outFrame);
+}
+
+// 创建 32 位自上而下的 DIB 节, 并用帧描述其像素内存
+// frameOwnsBitmap 为 true 时帧持有 HBITMAP 的引用, 最后一个副本释放时 DeleteObject;
+// 为 false 时帧只借用像素内存, 由调用方 DeleteObject
+HBITMAP CreateFrameDIB(int width, int height, qrcore::ImageFrame& outFrame, bool frameOwnsBitmap) {
+    BITMAPINFO bmi = {0};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height; // Top-down DIB
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32; // 内存字节序为 B G R X, 每行天然 4 字节对齐
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    void* bits = nullptr;
+    HBITMAP hBitmap = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+    if (!hBitmap || !bits) {
+        return NULL;
+    }
+
+    std::shared_ptr<void> owner;
+    if (frameOwnsBitmap) {
+        owner.reset(hBitmap, [](void* h) { DeleteObject((HBITMAP)h); });
+    }
+    outFrame = qrcore::WrapFrame((uint8_t*)bits, width, height, width * 4, qrcore::PixelFormat::BGRX, owner);
     return hBitmap;
 }
 
-HBITMAP CaptureScreenRegion(const RECT& rect) {
-    HDC hScreenDC = GetDC(NULL);
-    HDC hMemDC = CreateCompatibleDC(hScreenDC);
+// 截取屏幕区域, 像素直接落在 32 位 DIB 节中 (无中间复制)
+// DIB 节取自截图帧缓冲池, 可能大于选区: 像素写在其左上角, 帧的行字节数为 DIB 节的行字节数
+bool CaptureScreenRegion(const RECT& rect, qrcore::ImageFrame& outFrame) {
+    QRCORE_TRACE_SCOPE("CaptureScreenRegion");
     int width = rect.right - rect.left;
     int height = rect.bottom - rect.top;
     if (width <= 0 || height <= 0) {
-        DeleteDC(hMemDC);
-        ReleaseDC(NULL, hScreenDC);
-        return NULL;
+        return false;
+    }
+
+    void* handle = nullptr;
+    qrcore::ImageFrame frame = g_capturePool.Acquire(width, height, qrcore::PixelFormat::BGRX, &handle);
+    HBITMAP hBitmap = (HBITMAP)handle;
+    if (frame.empty() || !hBitmap) {
+        return false;
     }
-    HBITMAP hBitmap = CreateCompatibleBitmap(hScreenDC, width, height);
+
+    HDC hScreenDC = GetDC(NULL);
+    HDC hMemDC = CreateCompatibleDC(hScreenDC);
     HBITMAP hOldBitmap = (HBITMAP)SelectObject(hMemDC, hBitmap);
-    BitBlt(hMemDC, 0, 0, width, height, hScreenDC, rect.left, rect.top, SRCCOPY);
+    BOOL copied;
+    {
+        QRCORE_TRACE_SCOPE("BitBlt");
+        copied = BitBlt(hMemDC, 0, 0, width, height, hScreenDC, rect.left, rect.top, SRCCOPY);
+    }
     SelectObject(hMemDC, hOldBitmap);
     DeleteDC(hMemDC);
     ReleaseDC(NULL, hScreenDC);
-    return hBitmap;
+
+    // 确保 GDI 已把像素写入 DIB 内存, 之后其他线程才可直接读取
+    GdiFlush();
+
+    if (!copied) {
+        return false;
+    }
+    outFrame = std::move(frame);
+    return true;
 }
 
 // GDI+ 辅助函数
@@ -1428,7 +2121,9 @@ void SaveHotkeyConfig() {
     
     HANDLE hFile = CreateFileW(configPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
     if (hFile != INVALID_HANDLE_VALUE) {
-        char buffer[512];
+        std::string cascadeSpec = qrcore::CascadeToString(g_cascadeConfig);
+        qrcore::DecodeCacheConfig cacheConfig = g_resultCache.GetConfig();
+        char buffer[1024];
         sprintf_s(buffer, 
             "[Hotkeys]\n"
             "ScanModifiers=%u\n"
@@ -1438,11 +2133,59 @@ void SaveHotkeyConfig() {
             "GenerateEnabled=%d\n"
             "\n"
             "[Settings]\n"
-            "AutoStart=%d\n",
+            "AutoStart=%d\n"
+            "\n"
+            "[Scan]\n"
+            "Cascade=%s\n"
+            "BudgetMs=%d\n"
+            "MultiCode=%d\n"
+            "TileSize=%d\n"
+            "TileOverlap=%d\n"
+            "PyramidLevels=%d\n"
+            "ResultCache=%d\n"
+            "ResultCacheSize=%d\n"
+            "ResultCacheFuzzyBits=%d\n"
+            "Trace=%d\n"
+            "TraceEvents=%d\n"
+            "FramePoolMB=%d\n"
+            "\n"
+            "[Generate]\n"
+            "PngBitDepth=%d\n"
+            "PngPalette=%d\n"
+            "PngDeflateLevel=%d\n"
+            "VectorSizeMm=%d\n"
+            "\n"
+            "[Live]\n"
+            "MinIntervalMs=%d\n"
+            "MaxIntervalMs=%d\n"
+            "\n"
+            "[Metrics]\n"
+            "FileIntervalSec=%d\n"
+            "Port=%d\n",
             g_hotkeyConfig.modifiers, g_hotkeyConfig.vkCode,
             g_hotkeyGenConfig.modifiers, g_hotkeyGenConfig.vkCode,
             g_hotkeyGenEnabled ? 1 : 0,
-            g_autoStartEnabled ? 1 : 0);
+            g_autoStartEnabled ? 1 : 0,
+            cascadeSpec.c_str(),
+            g_cascadeConfig.budgetMs,
+            g_cascadeConfig.maxSymbols == 1 ? 0 : 1,
+            g_tileConfig.tileSize,
+            g_tileConfig.overlap,
+            g_cascadeConfig.pyramid.maxLevels,
+            g_resultCacheEnabled ? 1 : 0,
+            (int)cacheConfig.capacity,
+            cacheConfig.maxDistance,
+            g_traceEnabled ? 1 : 0,
+            g_traceEvents,
+            g_framePoolMB,
+            g_pngOptions.bitDepth,
+            g_pngOptions.colorMode == qrcore::PngColorMode::Palette ? 1 : 0,
+            g_pngOptions.deflateLevel,
+            (int)g_vectorOptions.sizeMm,
+            g_liveConfig.minIntervalMs,
+            g_liveConfig.maxIntervalMs,
+            g_metricsFileIntervalSec,
+            g_metricsPort);
         DWORD written;
         WriteFile(hFile, buffer, (DWORD)strlen(buffer), &written, NULL);
         CloseHandle(hFile);
@@ -1462,9 +2205,15 @@ void LoadHotkeyConfig() {
     
     HANDLE hFile = CreateFileW(configPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     if (hFile != INVALID_HANDLE_VALUE) {
-        char buffer[1024] = {0};
+        char buffer[2048] = {0};
         DWORD read;
         if (ReadFile(hFile, buffer, sizeof(buffer) - 1, &read, NULL)) {
+            std::string cascadeSpec = qrcore::CascadeToString(g_cascadeConfig);
+            int budgetMs = g_cascadeConfig.budgetMs;
+            int maxSymbols = g_cascadeConfig.maxSymbols;
+            int pyramidLevels = g_cascadeConfig.pyramid.maxLevels;
+            qrcore::DecodeCacheConfig cacheConfig = g_resultCache.GetConfig();
+
             // 解析 INI 格式
             char* line = strtok(buffer, "\n");
             while (line != NULL) {
@@ -1486,13 +2235,85 @@ void LoadHotkeyConfig() {
                     g_hotkeyGenEnabled = (atoi(line + 16) == 1);
                 } else if (strncmp(line, "AutoStart=", 10) == 0) {
                     g_autoStartEnabled = (atoi(line + 10) == 1);
+                } else if (strncmp(line, "Cascade=", 8) == 0) {
+                    cascadeSpec = line + 8;
+                } else if (strncmp(line, "BudgetMs=", 9) == 0) {
+                    budgetMs = atoi(line + 9);
+                } else if (strncmp(line, "MultiCode=", 10) == 0) {
+                    maxSymbols = (atoi(line + 10) == 1) ? 0 : 1; // 0 = 不限数量
+                } else if (strncmp(line, "TileSize=", 9) == 0) {
+                    int tileSize = atoi(line + 9);
+                    if (tileSize >= 256) g_tileConfig.tileSize = tileSize;
+                } else if (strncmp(line, "TileOverlap=", 12) == 0) {
+                    int overlap = atoi(line + 12);
+                    if (overlap >= 0) g_tileConfig.overlap = overlap;
+                } else if (strncmp(line, "PyramidLevels=", 14) == 0) {
+                    pyramidLevels = atoi(line + 14);
+                } else if (strncmp(line, "ResultCache=", 12) == 0) {
+                    g_resultCacheEnabled = (atoi(line + 12) == 1);
+                } else if (strncmp(line, "ResultCacheSize=", 16) == 0) {
+                    int capacity = atoi(line + 16);
+                    if (capacity >= 1) cacheConfig.capacity = capacity;
+                } else if (strncmp(line, "ResultCacheFuzzyBits=", 21) == 0) {
+                    int bits = atoi(line + 21);
+                    if (bits >= 0 && bits <= 16) cacheConfig.maxDistance = bits;
+                } else if (strncmp(line, "TraceEvents=", 12) == 0) {
+                    int events = atoi(line + 12);
+                    if (events >= 64 && events <= (1 << 20)) g_traceEvents = events;
+                } else if (strncmp(line, "FramePoolMB=", 12) == 0) {
+                    int megabytes = atoi(line + 12);
+                    if (megabytes >= 0 && megabytes <= 4096) g_framePoolMB = megabytes;
+                } else if (strncmp(line, "Trace=", 6) == 0) {
+                    g_traceEnabled = (atoi(line + 6) == 1);
+                } else if (strncmp(line, "PngBitDepth=", 12) == 0) {
+                    int bitDepth = atoi(line + 12);
+                    if (bitDepth == 1 || bitDepth == 8) g_pngOptions.bitDepth = bitDepth;
+                } else if (strncmp(line, "PngPalette=", 11) == 0) {
+                    g_pngOptions.colorMode = (atoi(line + 11) == 1) ? qrcore::PngColorMode::Palette : qrcore::PngColorMode::Gray;
+                } else if (strncmp(line, "PngDeflateLevel=", 16) == 0) {
+                    int level = atoi(line + 16);
+                    if (level >= 0 && level <= 9) g_pngOptions.deflateLevel = level;
+                } else if (strncmp(line, "VectorSizeMm=", 13) == 0) {
+                    int sizeMm = atoi(line + 13);
+                    if (sizeMm > 0) g_vectorOptions.sizeMm = sizeMm;
+                } else if (strncmp(line, "MinIntervalMs=", 14) == 0) {
+                    int intervalMs = atoi(line + 14);
+                    if (intervalMs >= 10) g_liveConfig.minIntervalMs = intervalMs;
+                } else if (strncmp(line, "MaxIntervalMs=", 14) == 0) {
+                    int intervalMs = atoi(line + 14);
+                    if (intervalMs >= 10) g_liveConfig.maxIntervalMs = intervalMs;
+                } else if (strncmp(line, "FileIntervalSec=", 16) == 0) {
+                    int seconds = atoi(line + 16);
+                    if (seconds >= 0) g_metricsFileIntervalSec = seconds;
+                } else if (strncmp(line, "Port=", 5) == 0) {
+                    int port = atoi(line + 5);
+                    if (port >= 0 && port <= 65535) g_metricsPort = port;
                 }
                 
                 line = strtok(NULL, "\n");
             }
+            
+            // 层级列表无效时保留默认级联
+            std::string errorMsg;
+            qrcore::CascadeConfig cascade;
+            if (qrcore::ParseCascade(cascadeSpec, budgetMs, cascade, errorMsg)) {
+                g_cascadeConfig = cascade;
+            }
+            g_cascadeConfig.maxSymbols = maxSymbols;
+            g_cascadeConfig.pyramid.maxLevels = pyramidLevels;
+            g_resultCache.Configure(cacheConfig);
         }
         CloseHandle(hFile);
     }
+    UpdateScanJobConfig();
+}
+
+// 由当前识别配置生成提交给解码线程的只读副本; 全屏分块使用同一级联
+void UpdateScanJobConfig() {
+    g_jobCascade = std::make_shared<const qrcore::CascadeConfig>(g_cascadeConfig);
+    auto tiles = std::make_shared<qrcore::TileScanConfig>(g_tileConfig);
+    tiles->cascade = g_cascadeConfig;
+    g_jobTiles = tiles;
 }
 
 // 显示设置窗口
@@ -1816,6 +2637,337 @@ void LoadAutoStartConfig() {
     }
 }
 
+// 加载识别结果缓存 (config.ini 同目录的 scancache.bin); 文件不存在或已损坏时从空缓存开始
+void LoadResultCache() {
+    if (!g_resultCacheEnabled) {
+        return;
+    }
+    std::wstring cachePath = GetAppFilePath(L"scancache.bin");
+    if (GetFileAttributesW(cachePath.c_str()) == INVALID_FILE_ATTRIBUTES) {
+        return;
+    }
+    std::string errorMsg;
+    if (!g_resultCache.LoadFile(WideToUTF8(cachePath), errorMsg)) {
+        OutputDebugStringA(("[QRScan] 识别结果缓存未加载: " + errorMsg + "\n").c_str());
+    }
+}
+
+// 有新内容时写回识别结果缓存: 先写临时文件再替换, 写入中途失败不破坏原文件
+void SaveResultCache() {
+    if (!g_resultCacheEnabled || !g_resultCache.IsDirty()) {
+        return;
+    }
+    QRCORE_TRACE_SCOPE("SaveResultCache", g_scanTraceId);
+    std::string errorMsg;
+    if (!g_resultCache.SaveFile(WideToUTF8(GetAppFilePath(L"scancache.bin")), errorMsg)) {
+        OutputDebugStringA(("[QRScan] 识别结果缓存未保存: " + errorMsg + "\n").c_str());
+    }
+}
+
+// 安排稍后写回识别结果缓存; 已安排时不重新计时, 连续扫码期间的新结果在同一次写回中写出
+void ScheduleSaveResultCache(HWND hwnd) {
+    if (g_resultCacheSavePending || !g_resultCacheEnabled || !g_resultCache.IsDirty()) {
+        return;
+    }
+    g_resultCacheSavePending = SetTimer(hwnd, TIMER_SAVE_RESULT_CACHE, RESULT_CACHE_SAVE_DELAY_MS, NULL) != 0;
+    if (!g_resultCacheSavePending) {
+        SaveResultCache(); // 无法创建定时器时立即写回
+    }
+}
+
+// 导出扫码跟踪: 写到 config.ini 同目录的 qrtrace-<时间>.json (chrome://tracing 或 ui.perfetto.dev 打开)
+void ExportScanTrace(HWND hwnd) {
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    wchar_t fileName[64];
+    swprintf_s(fileName, L"qrtrace-%04d%02d%02d-%02d%02d%02d.json", st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+    std::wstring tracePath = GetAppFilePath(fileName);
+
+    std::string errorMsg;
+    if (qrcore::SaveChromeTrace(WideToUTF8(tracePath), errorMsg)) {
+        ShowTrayBalloon(hwnd, L"扫码跟踪已导出", tracePath);
+    } else {
+        MessageBoxW(hwnd, (L"导出扫码跟踪失败: " + UTF8ToWide(errorMsg)).c_str(), L"错误", MB_OK | MB_ICONERROR);
+    }
+}
+
+// --- 指标 ---
+
+AppMetrics::AppMetrics(qrcore::MetricsRegistry& registry) {
+    scans[0] = &registry.GetCounter("qr_scans_total", "source=\"region\"", "开始截图识别的扫码次数");
+    scans[1] = &registry.GetCounter("qr_scans_total", "source=\"fullscreen\"");
+    successes = &registry.GetCounter("qr_scan_successes_total", "", "识别成功的扫码次数 (含取自缓存的)");
+    static const char* const kReasons[] = {
+        "capture_failed", "invalid_frame", "worker_stopped", "exception", "not_found", "budget_exceeded",
+    };
+    for (int i = 0; i < (int)ScanFailure::Count; i++) {
+        failures[i] = &registry.GetCounter("qr_scan_failures_total", std::string("reason=\"") + kReasons[i] + "\"",
+                                           "扫码失败次数, 按失败的环节");
+    }
+    cancelled = &registry.GetCounter("qr_scan_cancelled_total", "", "框选时按 ESC 取消的次数");
+    cacheHits = &registry.GetCounter("qr_scan_cache_hits_total", "", "直接取自识别结果缓存的次数");
+    decodeTime = &registry.GetHistogram("qr_decode_seconds", "", "ZXing 识别耗时 (各层级之和, 不含缓存命中)");
+    scanTime = &registry.GetHistogram("qr_scan_seconds", "", "从开始截图到主线程取到结果的耗时 (不含框选和消息框)");
+    liveResults = &registry.GetCounter("qr_live_results_total", "", "连续扫码识别到的新内容个数");
+    liveLatency = &registry.GetHistogram("qr_live_latency_seconds", "", "连续扫码从抓取到报告新内容的耗时");
+    previews = &registry.GetCounter("qr_generate_previews_total", "", "生成窗口完成的预览次数");
+    encodeErrors = &registry.GetCounter("qr_generate_errors_total", "", "生成失败 (如内容过长) 的次数");
+    encodeTime = &registry.GetHistogram("qr_encode_seconds", "", "二维码编码耗时 (编码缓存未命中时)");
+    previewTime = &registry.GetHistogram("qr_generate_preview_seconds", "", "预览生成耗时 (编码 + 光栅化)");
+    static const char* const kFormats[] = {"png", "jpeg", "svg", "pdf"};
+    for (int i = 0; i < 4; i++) {
+        saves[i] = &registry.GetCounter("qr_generate_saves_total", std::string("format=\"") + kFormats[i] + "\"",
+                                        "保存生成的二维码的次数");
+    }
+    imageCopies = &registry.GetCounter("qr_generate_copies_total", "", "复制生成的二维码图片的次数");
+}
+
+void CountScanFailure(ScanFailure reason) {
+    g_appMetrics.failures[(int)reason]->Add();
+}
+
+// 按 [Scan] FramePoolMB 设置截图与识别帧缓冲池保留的空闲内存
+void ConfigureFramePools() {
+    qrcore::FramePoolConfig captureConfig = {(size_t)g_framePoolMB << 20, 128, 4.0};
+    g_capturePool.Configure(captureConfig);
+    qrcore::FramePoolConfig frameConfig;
+    frameConfig.maxIdleBytes = (size_t)g_framePoolMB << 20;
+    qrcore::DefaultFramePool().Configure(frameConfig);
+}
+
+// 按 [Metrics] 节开启快照文件和本机端点; 失败时只记录日志, 不影响其他功能
+void StartMetrics() {
+    std::string errorMsg;
+    if (g_metricsFileIntervalSec > 0 &&
+        !g_metricsFile.Start(WideToUTF8(GetAppFilePath(L"metrics.prom")), g_metricsFileIntervalSec * 1000, errorMsg)) {
+        OutputDebugStringA(("[QRMetrics] 快照文件未开启: " + errorMsg + "\n").c_str());
+    }
+    if (g_metricsPort > 0 && !g_metricsServer.Start(g_metricsPort, errorMsg)) {
+        OutputDebugStringA(("[QRMetrics] 本机端点未开启: " + errorMsg + "\n").c_str());
+    }
+}
+
+// --- 扫描历史 ---
+
+// config.ini 同目录下的文件 (扫描历史、识别结果缓存、跟踪导出、指标快照)
+std::wstring GetAppFilePath(const wchar_t* fileName) {
+    wchar_t exePath[MAX_PATH];
+    GetModuleFileNameW(NULL, exePath, MAX_PATH);
+    std::wstring historyPath = exePath;
+    size_t pos = historyPath.find_last_of(L"\\/");
+    if (pos != std::wstring::npos) {
+        historyPath = historyPath.substr(0, pos + 1);
+    }
+    return historyPath + fileName;
+}
+
+// 打开扫描历史; 失败时不记录历史, 不影响扫码
+void OpenScanHistory() {
+    std::string errorMsg;
+    if (!g_scanHistory.Open(WideToUTF8(GetAppFilePath(L"history.log")), WideToUTF8(GetAppFilePath(L"history.idx")), errorMsg)) {
+        OutputDebugStringA(("[QRHistory] 扫描历史未打开: " + errorMsg + "\n").c_str());
+        return;
+    }
+    qrcore::ScanHistoryStats stats = g_scanHistory.GetStats();
+    char logLine[256];
+    sprintf_s(logLine, "[QRHistory] records=%zu indexed=%zu tail=%zu truncated=%d rebuilt=%d\n",
+        stats.records, stats.indexedRecords, stats.tailRecords, stats.truncatedTail ? 1 : 0, stats.rebuiltIndex ? 1 : 0);
+    OutputDebugStringA(logLine);
+}
+
+// 记录一个识别出的内容
+void AppendScanHistory(qrcore::HistorySource source, const qrcore::DecodedSymbol& symbol) {
+    if (!g_scanHistory.IsOpen()) {
+        return;
+    }
+    qrcore::HistoryEntry entry;
+    entry.source = source;
+    entry.format = symbol.format;
+    entry.text = symbol.text;
+    std::string errorMsg;
+    if (!g_scanHistory.Append(entry, errorMsg)) {
+        OutputDebugStringA(("[QRHistory] 记录失败: " + errorMsg + "\n").c_str());
+    }
+}
+
+// 列表中的一行: 时间、来源、码制和内容的第一行
+static std::wstring FormatHistoryLine(const qrcore::HistoryEntry& entry) {
+    // Unix 毫秒 → FILETIME (自 1601 年起的 100 纳秒) → 本地时间
+    ULARGE_INTEGER ticks;
+    ticks.QuadPart = (ULONGLONG)entry.timeMs * 10000ULL + 116444736000000000ULL;
+    FILETIME utc = {ticks.LowPart, ticks.HighPart}, local;
+    SYSTEMTIME st = {0};
+    FileTimeToLocalFileTime(&utc, &local);
+    FileTimeToSystemTime(&local, &st);
+
+    wchar_t prefix[96];
+    swprintf_s(prefix, L"%04d-%02d-%02d %02d:%02d  [%hs/%hs]  ", st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute,
+        qrcore::HistorySourceName(entry.source), entry.format.c_str());
+    std::wstring text = UTF8ToWide(entry.text);
+    size_t lineEnd = text.find_first_of(L"\r\n");
+    if (lineEnd != std::wstring::npos) {
+        text = text.substr(0, lineEnd) + L" …";
+    }
+    if (text.length() > 200) {
+        text = text.substr(0, 200) + L"…";
+    }
+    return prefix + text;
+}
+
+// 按搜索框内容刷新列表 (最新的在前)
+static void RefreshHistoryList(HWND hwndDlg) {
+    const size_t maxItems = 500;
+    int length = GetWindowTextLengthW(GetDlgItem(hwndDlg, IDC_EDIT_HISTORY_SEARCH));
+    std::wstring query(length + 1, L'\0');
+    GetWindowTextW(GetDlgItem(hwndDlg, IDC_EDIT_HISTORY_SEARCH), &query[0], length + 1);
+    query.resize(length);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<size_t> found = g_scanHistory.Search(WideToUTF8(query), maxItems);
+    double searchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    HWND hList = GetDlgItem(hwndDlg, IDC_LIST_HISTORY);
+    SendMessageW(hList, WM_SETREDRAW, FALSE, 0);
+    SendMessageW(hList, LB_RESETCONTENT, 0, 0);
+    qrcore::HistoryEntry entry;
+    for (size_t index : found) {
+        if (g_scanHistory.Get(index, entry)) {
+            int item = (int)SendMessageW(hList, LB_ADDSTRING, 0, (LPARAM)FormatHistoryLine(entry).c_str());
+            SendMessageW(hList, LB_SETITEMDATA, item, (LPARAM)index);
+        }
+    }
+    SendMessageW(hList, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(hList, NULL, TRUE);
+
+    wchar_t status[128];
+    swprintf_s(status, L"共 %zu 条记录, 显示 %zu 条%s (%.2f ms)", g_scanHistory.Count(), found.size(),
+        found.size() >= maxItems ? L" (仅最新的)" : L"", searchMs);
+    SetWindowTextW(GetDlgItem(hwndDlg, IDC_STATIC_HISTORY_STATUS), status);
+}
+
+// 复制选中记录的完整内容
+static void CopySelectedHistory(HWND hwndDlg) {
+    HWND hList = GetDlgItem(hwndDlg, IDC_LIST_HISTORY);
+    int item = (int)SendMessageW(hList, LB_GETCURSEL, 0, 0);
+    qrcore::HistoryEntry entry;
+    if (item == LB_ERR || !g_scanHistory.Get((size_t)SendMessageW(hList, LB_GETITEMDATA, item, 0), entry)) {
+        MessageBoxW(hwndDlg, L"请先选择一条记录", L"提示", MB_OK | MB_ICONWARNING);
+        return;
+    }
+    CopyToClipboard(entry.text);
+}
+
+LRESULT CALLBACK HistoryDialogProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam) {
+    switch (uMsg) {
+        case WM_CLOSE:
+            DestroyWindow(hwndDlg);
+            PostQuitMessage(0);
+            return 0;
+
+        case WM_COMMAND:
+            switch (LOWORD(wParam)) {
+                case IDC_EDIT_HISTORY_SEARCH:
+                    // 每次输入都重新查询 (索引查询在毫秒以内, 不需要延迟)
+                    if (HIWORD(wParam) == EN_CHANGE) {
+                        RefreshHistoryList(hwndDlg);
+                    }
+                    return 0;
+                case IDC_LIST_HISTORY:
+                    if (HIWORD(wParam) == LBN_DBLCLK) {
+                        CopySelectedHistory(hwndDlg);
+                    }
+                    return 0;
+                case IDC_BTN_HISTORY_COPY:
+                    CopySelectedHistory(hwndDlg);
+                    return 0;
+                case IDCANCEL:
+                    PostMessage(hwndDlg, WM_CLOSE, 0, 0);
+                    return 0;
+            }
+            break;
+    }
+    return DefWindowProcW(hwndDlg, uMsg, wParam, lParam);
+}
+
+// --- 扫描历史窗口 ---
+void ShowHistoryWindow(HWND hwnd) {
+    if (!g_scanHistory.IsOpen()) {
+        MessageBoxW(hwnd, L"扫描历史未能打开 (详见调试输出)", L"扫描历史", MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    int winWidth = 720;
+    int winHeight = 520;
+    int screenWidth = GetSystemMetrics(SM_CXSCREEN);
+    int screenHeight = GetSystemMetrics(SM_CYSCREEN);
+    int x = (screenWidth - winWidth) / 2;
+    int y = (screenHeight - winHeight) / 2;
+
+    HWND hDlg = CreateWindowExW(
+        WS_EX_DLGMODALFRAME | WS_EX_TOPMOST,
+        WC_STATICW,
+        L"扫描历史",
+        WS_POPUP | WS_CAPTION | WS_SYSMENU | WS_VISIBLE,
+        x, y, winWidth, winHeight,
+        hwnd, NULL, g_hinstance, NULL
+    );
+
+    if (!hDlg) {
+        MessageBoxW(hwnd, L"创建扫描历史窗口失败", L"错误", MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    int margin = 15;
+    int yPos = margin;
+
+    // 搜索框
+    CreateWindowExW(0, WC_STATICW, L"搜索内容:",
+        WS_CHILD | WS_VISIBLE,
+        margin, yPos + 3, 80, 20, hDlg, NULL, g_hinstance, NULL);
+
+    HWND hSearch = CreateWindowExW(WS_EX_CLIENTEDGE, WC_EDITW, L"",
+        WS_CHILD | WS_VISIBLE | WS_TABSTOP | ES_AUTOHSCROLL,
+        margin + 85, yPos, winWidth - margin * 2 - 95, 24, hDlg, (HMENU)IDC_EDIT_HISTORY_SEARCH, g_hinstance, NULL);
+    yPos += 35;
+
+    // 记录列表
+    CreateWindowExW(WS_EX_CLIENTEDGE, WC_LISTBOXW, L"",
+        WS_CHILD | WS_VISIBLE | WS_TABSTOP | WS_VSCROLL | WS_HSCROLL | LBS_NOTIFY | LBS_NOINTEGRALHEIGHT,
+        margin, yPos, winWidth - margin * 2 - 10, 360, hDlg, (HMENU)IDC_LIST_HISTORY, g_hinstance, NULL);
+    yPos += 368;
+
+    CreateWindowExW(0, WC_STATICW, L"",
+        WS_CHILD | WS_VISIBLE,
+        margin, yPos, winWidth - margin * 2, 20, hDlg, (HMENU)IDC_STATIC_HISTORY_STATUS, g_hinstance, NULL);
+    yPos += 28;
+
+    // 按钮
+    CreateWindowExW(0, WC_BUTTONW, L"复制内容",
+        WS_CHILD | WS_VISIBLE | WS_TABSTOP | BS_PUSHBUTTON,
+        margin, yPos, 100, 30, hDlg, (HMENU)IDC_BTN_HISTORY_COPY, g_hinstance, NULL);
+
+    CreateWindowExW(0, WC_BUTTONW, L"关闭",
+        WS_CHILD | WS_VISIBLE | WS_TABSTOP | BS_PUSHBUTTON,
+        margin + 120, yPos, 100, 30, hDlg, (HMENU)IDCANCEL, g_hinstance, NULL);
+
+    // 设置窗口过程
+    SetWindowLongPtrW(hDlg, GWLP_WNDPROC, (LONG_PTR)HistoryDialogProc);
+    RefreshHistoryList(hDlg);
+    SetFocus(hSearch);
+
+    // 消息循环
+    MSG msg;
+    while (GetMessage(&msg, NULL, 0, 0)) {
+        if (msg.message == WM_QUIT || !IsWindow(hDlg)) {
+            break;
+        }
+        if (!IsDialogMessage(hDlg, &msg)) {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+    }
+}
+
 // --- 扫码快捷键设置窗口 ---
 void ShowScanHotkeySettings(HWND hwnd) {
     ShowSettingsWindow(hwnd);
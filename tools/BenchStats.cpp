@@ -0,0 +1,43 @@
+/*
+ * 基准测试的延迟统计
+ */
+
+#include "BenchStats.h"
+
+#include <algorithm>
+
+namespace qrtools {
+
+double ElapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double Percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+    rank = std::min(std::max(rank, (size_t)1), sorted.size());
+    return sorted[rank - 1];
+}
+
+LatencyStats Summarize(std::vector<double> samples) {
+    LatencyStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double v : samples) {
+        sum += v;
+    }
+    stats.count = samples.size();
+    stats.mean = sum / samples.size();
+    stats.p50 = Percentile(samples, 50);
+    stats.p95 = Percentile(samples, 95);
+    stats.p99 = Percentile(samples, 99);
+    stats.max = samples.back();
+    return stats;
+}
+
+} // namespace qrtools
@@ -0,0 +1,32 @@
+/*
+ * 基准测试的延迟统计 (qrbench、qrsweep 共用)
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace qrtools {
+
+using Clock = std::chrono::steady_clock;
+
+struct LatencyStats {
+    size_t count = 0;
+    double mean = 0;
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+// 自 start 起经过的毫秒数
+double ElapsedMs(Clock::time_point start);
+
+// 最近秩法求分位数 (sorted 须已升序排列, p 为 0~100)
+double Percentile(const std::vector<double>& sorted, double p);
+
+LatencyStats Summarize(std::vector<double> samples);
+
+} // namespace qrtools
@@ -0,0 +1,231 @@
+/*
+ * 合成测试图像的失真处理
+ */
+
+#include "Distortions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace qrtools {
+
+static const double kPi = 3.14159265358979323846;
+
+static uint8_t Clamp(double v) {
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v + 0.5));
+}
+
+static qrcore::ImageFrame NewLike(const qrcore::ImageFrame& lum) {
+    return qrcore::AllocateFrame(lum.width, lum.height, qrcore::PixelFormat::Lum);
+}
+
+// 一维盒式模糊 (边缘像素重复), horizontal 为 false 时按列处理
+static void BoxPass(const qrcore::ImageFrame& src, qrcore::ImageFrame& dst, int radius, bool horizontal) {
+    int outer = horizontal ? src.height : src.width;
+    int inner = horizontal ? src.width : src.height;
+    auto at = [&](const qrcore::ImageFrame& f, int o, int i) -> uint8_t& {
+        return horizontal ? f.row(o)[i] : f.row(i)[o];
+    };
+    int window = 2 * radius + 1;
+    for (int o = 0; o < outer; o++) {
+        int sum = 0;
+        for (int k = -radius; k <= radius; k++) {
+            sum += at(src, o, std::min(std::max(k, 0), inner - 1));
+        }
+        for (int i = 0; i < inner; i++) {
+            at(dst, o, i) = (uint8_t)((sum + window / 2) / window);
+            sum += at(src, o, std::min(i + radius + 1, inner - 1));
+            sum -= at(src, o, std::max(i - radius, 0));
+        }
+    }
+}
+
+qrcore::ImageFrame GaussianBlur(const qrcore::ImageFrame& lum, double sigma) {
+    // 三次半径为 r 的盒式模糊的方差为 r(r+1), 取最接近 sigma^2 的 r
+    int radius = std::max(1, (int)std::lround((std::sqrt(4 * sigma * sigma + 1) - 1) / 2));
+    qrcore::ImageFrame a = NewLike(lum);
+    qrcore::ImageFrame b = NewLike(lum);
+    const qrcore::ImageFrame* src = &lum;
+    for (int pass = 0; pass < 3; pass++) {
+        BoxPass(*src, a, radius, true);
+        BoxPass(a, b, radius, false);
+        src = &b;
+    }
+    return b;
+}
+
+qrcore::ImageFrame JpegArtifacts(const qrcore::ImageFrame& lum, int quality) {
+    // ITU-T T.81 附录 K 的亮度量化表
+    static const int kLumaTable[64] = {
+        16, 11, 10, 16, 24, 40, 51, 61,   12, 12, 14, 19, 26, 58, 60, 55,
+        14, 13, 16, 24, 40, 57, 69, 56,   14, 17, 22, 29, 51, 87, 80, 62,
+        18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+        49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+    };
+    quality = std::min(std::max(quality, 1), 100);
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    double q[64];
+    for (int i = 0; i < 64; i++) {
+        q[i] = std::min(std::max((kLumaTable[i] * scale + 50) / 100, 1), 255);
+    }
+
+    double basis[8][8]; // basis[u][x] = c(u) cos((2x+1)u pi / 16)
+    for (int u = 0; u < 8; u++) {
+        for (int x = 0; x < 8; x++) {
+            basis[u][x] = (u == 0 ? std::sqrt(0.125) : 0.5) * std::cos((2 * x + 1) * u * kPi / 16);
+        }
+    }
+
+    qrcore::ImageFrame dst = NewLike(lum);
+    double block[8][8], tmp[8][8], coef[8][8];
+    for (int by = 0; by < lum.height; by += 8) {
+        for (int bx = 0; bx < lum.width; bx += 8) {
+            // 取块 (越界部分重复边缘像素), 电平偏移 -128
+            for (int y = 0; y < 8; y++) {
+                const uint8_t* s = lum.row(std::min(by + y, lum.height - 1));
+                for (int x = 0; x < 8; x++) {
+                    block[y][x] = s[std::min(bx + x, lum.width - 1)] - 128.0;
+                }
+            }
+            // 可分离的二维 DCT: 先行后列
+            for (int y = 0; y < 8; y++) {
+                for (int u = 0; u < 8; u++) {
+                    double sum = 0;
+                    for (int x = 0; x < 8; x++) sum += basis[u][x] * block[y][x];
+                    tmp[y][u] = sum;
+                }
+            }
+            for (int v = 0; v < 8; v++) {
+                for (int u = 0; u < 8; u++) {
+                    double sum = 0;
+                    for (int y = 0; y < 8; y++) sum += basis[v][y] * tmp[y][u];
+                    coef[v][u] = std::round(sum / q[v * 8 + u]) * q[v * 8 + u];
+                }
+            }
+            // 反变换
+            for (int y = 0; y < 8; y++) {
+                for (int u = 0; u < 8; u++) {
+                    double sum = 0;
+                    for (int v = 0; v < 8; v++) sum += basis[v][y] * coef[v][u];
+                    tmp[y][u] = sum;
+                }
+            }
+            for (int y = 0; y < 8 && by + y < lum.height; y++) {
+                uint8_t* d = dst.row(by + y);
+                for (int x = 0; x < 8 && bx + x < lum.width; x++) {
+                    double sum = 0;
+                    for (int u = 0; u < 8; u++) sum += basis[u][x] * tmp[y][u];
+                    d[bx + x] = Clamp(sum + 128.0);
+                }
+            }
+        }
+    }
+    return dst;
+}
+
+// 双线性采样; 超出范围返回 background
+static double Sample(const qrcore::ImageFrame& lum, double fx, double fy, double background) {
+    int x0 = (int)std::floor(fx);
+    int y0 = (int)std::floor(fy);
+    double ax = fx - x0, ay = fy - y0;
+    auto pixel = [&](int x, int y) -> double {
+        if (x < 0 || y < 0 || x >= lum.width || y >= lum.height) {
+            return background;
+        }
+        return lum.row(y)[x];
+    };
+    double top = pixel(x0, y0) * (1 - ax) + pixel(x0 + 1, y0) * ax;
+    double bottom = pixel(x0, y0 + 1) * (1 - ax) + pixel(x0 + 1, y0 + 1) * ax;
+    return top * (1 - ay) + bottom * ay;
+}
+
+qrcore::ImageFrame Resample(const qrcore::ImageFrame& lum, double factor) {
+    int width = std::max(1, (int)std::lround(lum.width * factor));
+    int height = std::max(1, (int)std::lround(lum.height * factor));
+    qrcore::ImageFrame dst = qrcore::AllocateFrame(width, height, qrcore::PixelFormat::Lum);
+    for (int y = 0; y < height; y++) {
+        uint8_t* d = dst.row(y);
+        // 像素中心对齐
+        double fy = (y + 0.5) / factor - 0.5;
+        for (int x = 0; x < width; x++) {
+            d[x] = Clamp(Sample(lum, (x + 0.5) / factor - 0.5, fy, 255));
+        }
+    }
+    return dst;
+}
+
+qrcore::ImageFrame AddNoise(const qrcore::ImageFrame& lum, double sigma, uint32_t seed) {
+    uint32_t state = seed ? seed : 0x6C078965u;
+    auto uniform = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state + 0.5) / 4294967296.0;
+    };
+
+    qrcore::ImageFrame dst = NewLike(lum);
+    for (int y = 0; y < lum.height; y++) {
+        const uint8_t* s = lum.row(y);
+        uint8_t* d = dst.row(y);
+        for (int x = 0; x < lum.width; x++) {
+            // Box-Muller
+            double n = std::sqrt(-2 * std::log(uniform())) * std::cos(2 * kPi * uniform());
+            d[x] = Clamp(s[x] + sigma * n);
+        }
+    }
+    return dst;
+}
+
+qrcore::ImageFrame ReduceContrast(const qrcore::ImageFrame& lum, int low, int high) {
+    qrcore::ImageFrame dst = NewLike(lum);
+    for (int y = 0; y < lum.height; y++) {
+        const uint8_t* s = lum.row(y);
+        uint8_t* d = dst.row(y);
+        for (int x = 0; x < lum.width; x++) {
+            d[x] = Clamp(low + (high - low) * s[x] / 255.0);
+        }
+    }
+    return dst;
+}
+
+qrcore::ImageFrame Invert(const qrcore::ImageFrame& lum) {
+    qrcore::ImageFrame dst = NewLike(lum);
+    for (int y = 0; y < lum.height; y++) {
+        const uint8_t* s = lum.row(y);
+        uint8_t* d = dst.row(y);
+        for (int x = 0; x < lum.width; x++) {
+            d[x] = (uint8_t)(255 - s[x]);
+        }
+    }
+    return dst;
+}
+
+qrcore::ImageFrame Rotate(const qrcore::ImageFrame& lum, double degrees) {
+    double rad = degrees * kPi / 180;
+    double c = std::cos(rad), s = std::sin(rad);
+    int width = (int)std::ceil(std::fabs(lum.width * c) + std::fabs(lum.height * s));
+    int height = (int)std::ceil(std::fabs(lum.width * s) + std::fabs(lum.height * c));
+
+    qrcore::ImageFrame dst = qrcore::AllocateFrame(width, height, qrcore::PixelFormat::Lum);
+    double cx = lum.width / 2.0, cy = lum.height / 2.0;
+    double dcx = width / 2.0, dcy = height / 2.0;
+    for (int y = 0; y < height; y++) {
+        uint8_t* d = dst.row(y);
+        for (int x = 0; x < width; x++) {
+            // 目标像素反向旋转回源图
+            double dx = x + 0.5 - dcx, dy = y + 0.5 - dcy;
+            double sx = c * dx - s * dy + cx - 0.5;
+            double sy = s * dx + c * dy + cy - 0.5;
+            d[x] = Clamp(Sample(lum, sx, sy, 255));
+        }
+    }
+    return dst;
+}
+
+qrcore::ImageFrame ClipQuietZone(const qrcore::ImageFrame& lum, int moduleSize, int quietModules, int keepModules) {
+    int cut = std::max(0, quietModules - keepModules) * moduleSize;
+    return qrcore::CropFrame(lum, cut, cut, lum.width - 2 * cut, lum.height - 2 * cut);
+}
+
+} // namespace qrtools
@@ -0,0 +1,47 @@
+/*
+ * 合成测试图像的失真处理
+ *
+ * 模拟截图、聊天软件转发、拍屏等场景中常见的画质损失,
+ * 供 qrsweep 测量不同识别参数的成功率。所有处理都作用于灰度帧并返回新帧,
+ * 结果只由参数 (及 seed) 决定。
+ */
+
+#pragma once
+
+#include "core/ImageFrame.h"
+
+#include <cstdint>
+
+namespace qrtools {
+
+// 近似高斯模糊 (三次盒式模糊)
+qrcore::ImageFrame GaussianBlur(const qrcore::ImageFrame& lum, double sigma);
+
+/**
+ * @brief 模拟 JPEG 压缩: 8x8 DCT 后按 IJG 标准亮度量化表 (按 quality 缩放) 量化再反变换
+ * @param quality 1~100, 与 libjpeg 的质量参数含义相同
+ */
+qrcore::ImageFrame JpegArtifacts(const qrcore::ImageFrame& lum, int quality);
+
+// 双线性缩放 (factor 可为非整数)
+qrcore::ImageFrame Resample(const qrcore::ImageFrame& lum, double factor);
+
+// 加性高斯噪声
+qrcore::ImageFrame AddNoise(const qrcore::ImageFrame& lum, double sigma, uint32_t seed);
+
+// 把灰度范围 [0, 255] 线性压缩到 [low, high]
+qrcore::ImageFrame ReduceContrast(const qrcore::ImageFrame& lum, int low, int high);
+
+// 反色 (深色背景上的浅色码)
+qrcore::ImageFrame Invert(const qrcore::ImageFrame& lum);
+
+// 绕中心旋转 (角度), 画布扩大到容纳整个图像, 空白处填白色
+qrcore::ImageFrame Rotate(const qrcore::ImageFrame& lum, double degrees);
+
+/**
+ * @brief 裁掉静区: 只保留 keepModules 个模块宽的白边
+ * @param quietModules 原图的静区宽度 (模块)
+ */
+qrcore::ImageFrame ClipQuietZone(const qrcore::ImageFrame& lum, int moduleSize, int quietModules, int keepModules);
+
+} // namespace qrtools
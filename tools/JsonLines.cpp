@@ -0,0 +1,238 @@
+/*
+ * JSON Lines 输入输出辅助
+ */
+
+#include "JsonLines.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace qrtools {
+
+std::string JsonQuote(const std::string& text) {
+    std::string out;
+    out.reserve(text.size() + 2);
+    out += '"';
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += (char)c; // UTF-8 多字节序列原样输出
+                }
+                break;
+        }
+    }
+    out += '"';
+    return out;
+}
+
+static void AppendUtf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += (char)code;
+    } else if (code < 0x800) {
+        out += (char)(0xC0 | (code >> 6));
+        out += (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += (char)(0xE0 | (code >> 12));
+        out += (char)(0x80 | ((code >> 6) & 0x3F));
+        out += (char)(0x80 | (code & 0x3F));
+    } else {
+        out += (char)(0xF0 | (code >> 18));
+        out += (char)(0x80 | ((code >> 12) & 0x3F));
+        out += (char)(0x80 | ((code >> 6) & 0x3F));
+        out += (char)(0x80 | (code & 0x3F));
+    }
+}
+
+// 逐字符扫描的简单解析器; pos 始终指向下一个未读字符
+class FlatJsonParser {
+public:
+    explicit FlatJsonParser(const std::string& text) : m_text(text) {}
+
+    bool Parse(std::map<std::string, std::string>& outFields, std::string& outErrorMsg) {
+        SkipSpace();
+        if (!Consume('{')) {
+            return Fail("应为 '{'", outErrorMsg);
+        }
+        SkipSpace();
+        if (Consume('}')) {
+            return AtEnd(outErrorMsg);
+        }
+        for (;;) {
+            std::string key, value;
+            SkipSpace();
+            if (!ParseString(key)) {
+                return Fail("键应为字符串", outErrorMsg);
+            }
+            SkipSpace();
+            if (!Consume(':')) {
+                return Fail("应为 ':'", outErrorMsg);
+            }
+            SkipSpace();
+            if (!ParseValue(value)) {
+                return Fail("值无效 (只支持字符串、数字、布尔和 null)", outErrorMsg);
+            }
+            outFields[key] = value;
+            SkipSpace();
+            if (Consume(',')) {
+                continue;
+            }
+            if (Consume('}')) {
+                return AtEnd(outErrorMsg);
+            }
+            return Fail("应为 ',' 或 '}'", outErrorMsg);
+        }
+    }
+
+private:
+    void SkipSpace() {
+        while (m_pos < m_text.size() && isspace((unsigned char)m_text[m_pos])) {
+            m_pos++;
+        }
+    }
+
+    bool Consume(char c) {
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool AtEnd(std::string& outErrorMsg) {
+        SkipSpace();
+        return m_pos == m_text.size() || Fail("对象之后有多余内容", outErrorMsg);
+    }
+
+    bool Fail(const char* what, std::string& outErrorMsg) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), " (第 %zu 个字符)", m_pos + 1);
+        outErrorMsg = std::string("JSON 格式错误: ") + what + buffer;
+        return false;
+    }
+
+    bool ParseHex4(uint32_t& out) {
+        if (m_pos + 4 > m_text.size()) {
+            return false;
+        }
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = m_text[m_pos++];
+            out <<= 4;
+            if (c >= '0' && c <= '9') {
+                out |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                out |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                out |= c - 'A' + 10;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ParseString(std::string& out) {
+        if (!Consume('"')) {
+            return false;
+        }
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos++];
+            if (c == '"') {
+                return true;
+            }
+            if ((unsigned char)c < 0x20) {
+                return false;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_pos >= m_text.size()) {
+                return false;
+            }
+            switch (m_text[m_pos++]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t code = 0;
+                    if (!ParseHex4(code)) {
+                        return false;
+                    }
+                    // 高代理后必须紧跟低代理
+                    if (code >= 0xD800 && code < 0xDC00) {
+                        uint32_t low = 0;
+                        if (!Consume('\\') || !Consume('u') || !ParseHex4(low) || low < 0xDC00 || low >= 0xE000) {
+                            return false;
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (code >= 0xDC00 && code < 0xE000) {
+                        return false;
+                    }
+                    AppendUtf8(out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    bool ParseValue(std::string& out) {
+        if (m_pos >= m_text.size()) {
+            return false;
+        }
+        char c = m_text[m_pos];
+        if (c == '"') {
+            return ParseString(out);
+        }
+        for (const char* literal : {"true", "false", "null"}) {
+            size_t length = strlen(literal);
+            if (m_text.compare(m_pos, length, literal) == 0) {
+                m_pos += length;
+                out = c == 'n' ? "" : literal;
+                return true;
+            }
+        }
+        // 数字: 交给 strtod 校验格式, 原文保存
+        const char* begin = m_text.c_str() + m_pos;
+        char* end = nullptr;
+        strtod(begin, &end);
+        if (end == begin || !(c == '-' || isdigit((unsigned char)c))) {
+            return false;
+        }
+        out.assign(begin, end - begin);
+        m_pos += end - begin;
+        return true;
+    }
+
+    const std::string& m_text;
+    size_t m_pos = 0;
+};
+
+bool ParseFlatJsonObject(const std::string& line, std::map<std::string, std::string>& outFields,
+                         std::string& outErrorMsg) {
+    outFields.clear();
+    return FlatJsonParser(line).Parse(outFields, outErrorMsg);
+}
+
+} // namespace qrtools
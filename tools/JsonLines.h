@@ -0,0 +1,29 @@
+/*
+ * JSON Lines 输入输出辅助 (供无界面工具使用)
+ *
+ * 工具每处理一项输出一行 JSON 对象, 便于用 jq 等工具流式处理。
+ * 输入只需要扁平对象 (值为字符串、数字、布尔或 null), 不引入完整的 JSON 库。
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace qrtools {
+
+/**
+ * @brief 把 UTF-8 字符串写成带引号的 JSON 字符串 (转义引号、反斜杠和控制字符)
+ */
+std::string JsonQuote(const std::string& text);
+
+/**
+ * @brief 解析一行扁平 JSON 对象
+ *
+ * 字符串值反转义为 UTF-8 (含 \uXXXX 代理对); 数字、true / false 按原文保存,
+ * null 保存为空字符串。嵌套的对象或数组视为错误。
+ */
+bool ParseFlatJsonObject(const std::string& line, std::map<std::string, std::string>& outFields,
+                         std::string& outErrorMsg);
+
+} // namespace qrtools
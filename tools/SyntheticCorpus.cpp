@@ -0,0 +1,180 @@
+/*
+ * 合成测试图像
+ */
+
+#include "SyntheticCorpus.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace qrtools {
+
+static const int kQuietZone = 4; // 静区宽度 (模块)
+
+// xorshift32: 结果只由 seed 决定, 便于不同构建之间对比
+static uint32_t NextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+const char* EccName(qrcodegen::QrCode::Ecc ecc) {
+    switch (ecc) {
+        case qrcodegen::QrCode::Ecc::LOW: return "L";
+        case qrcodegen::QrCode::Ecc::MEDIUM: return "M";
+        case qrcodegen::QrCode::Ecc::QUARTILE: return "Q";
+        case qrcodegen::QrCode::Ecc::HIGH: return "H";
+    }
+    return "?";
+}
+
+std::string MakePayload(size_t length, uint32_t seed) {
+    static const char kChars[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-._~:/?#=&";
+    uint32_t state = seed ? seed : 0x9E3779B9u;
+    std::string text(length, ' ');
+    for (size_t i = 0; i < length; i++) {
+        text[i] = kChars[NextRandom(state) % (sizeof(kChars) - 1)];
+    }
+    return text;
+}
+
+// 只允许 minVersion..maxVersion 范围内编码; 放不下返回空指针
+static std::shared_ptr<qrcodegen::QrCode> TryEncode(const std::string& text, qrcodegen::QrCode::Ecc ecc,
+                                                    int minVersion, int maxVersion) {
+    try {
+        std::vector<uint8_t> bytes(text.begin(), text.end());
+        std::vector<qrcodegen::QrSegment> segs = {qrcodegen::QrSegment::makeBytes(bytes)};
+        return std::make_shared<qrcodegen::QrCode>(
+            qrcodegen::QrCode::encodeSegments(segs, ecc, minVersion, maxVersion, -1, false));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+bool EncodeForVersion(int version, qrcodegen::QrCode::Ecc ecc, uint32_t seed, SyntheticCode& outCode) {
+    if (version < qrcodegen::QrCode::MIN_VERSION || version > qrcodegen::QrCode::MAX_VERSION) {
+        return false;
+    }
+
+    // 二分查找该版本能容纳的最长内容 (字节模式最多 2953 字节)
+    std::string full = MakePayload(2953, seed);
+    size_t lo = 1, hi = full.size();
+    std::shared_ptr<qrcodegen::QrCode> best;
+    size_t bestLength = 0;
+    while (lo <= hi) {
+        size_t mid = (lo + hi) / 2;
+        auto qr = TryEncode(full.substr(0, mid), ecc, version, version);
+        if (qr) {
+            best = qr;
+            bestLength = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (!best) {
+        return false;
+    }
+
+    outCode.text = full.substr(0, bestLength);
+    outCode.version = best->getVersion();
+    outCode.ecc = ecc;
+    outCode.qr = best;
+    return true;
+}
+
+bool EncodeText(const std::string& text, qrcodegen::QrCode::Ecc ecc, SyntheticCode& outCode) {
+    auto qr = TryEncode(text, ecc, qrcodegen::QrCode::MIN_VERSION, qrcodegen::QrCode::MAX_VERSION);
+    if (!qr) {
+        return false;
+    }
+    outCode.text = text;
+    outCode.version = qr->getVersion();
+    outCode.ecc = ecc;
+    outCode.qr = qr;
+    return true;
+}
+
+qrcore::ImageFrame MakeCanvas(int width, int height, uint8_t background) {
+    qrcore::ImageFrame canvas = qrcore::AllocateFrame(width, height, qrcore::PixelFormat::Lum);
+    for (int y = 0; y < canvas.height; y++) {
+        memset(canvas.row(y), background, canvas.width);
+    }
+    return canvas;
+}
+
+// 填充矩形 (裁剪到画布)
+static void FillRect(qrcore::ImageFrame& canvas, int left, int top, int width, int height, uint8_t value) {
+    int x0 = std::max(left, 0);
+    int y0 = std::max(top, 0);
+    int x1 = std::min(left + width, canvas.width);
+    int y1 = std::min(top + height, canvas.height);
+    for (int y = y0; y < y1; y++) {
+        if (x1 > x0) {
+            memset(canvas.row(y) + x0, value, x1 - x0);
+        }
+    }
+}
+
+void FillClutter(qrcore::ImageFrame& canvas, uint32_t seed) {
+    uint32_t state = seed ? seed : 0x2545F491u;
+    // 大致每 4000 像素一个"字符", 尺寸与常见界面字号相当
+    size_t count = (size_t)canvas.width * canvas.height / 4000;
+    for (size_t i = 0; i < count; i++) {
+        int w = 2 + (int)(NextRandom(state) % 10);
+        int h = 2 + (int)(NextRandom(state) % 14);
+        int x = (int)(NextRandom(state) % (uint32_t)canvas.width);
+        int y = (int)(NextRandom(state) % (uint32_t)canvas.height);
+        FillRect(canvas, x, y, w, h, (uint8_t)(NextRandom(state) % 160));
+    }
+}
+
+void DrawQrCode(const qrcodegen::QrCode& qr, int moduleSize, int left, int top, qrcore::ImageFrame& canvas) {
+    int size = qr.getSize();
+    int total = (size + 2 * kQuietZone) * moduleSize;
+    FillRect(canvas, left, top, total, total, 255);
+
+    int originX = left + kQuietZone * moduleSize;
+    int originY = top + kQuietZone * moduleSize;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            if (qr.getModule(x, y)) {
+                FillRect(canvas, originX + x * moduleSize, originY + y * moduleSize, moduleSize, moduleSize, 0);
+            }
+        }
+    }
+}
+
+qrcore::ImageFrame RenderSample(const SyntheticCode& code, int moduleSize,
+                                int canvasWidth, int canvasHeight, bool clutter) {
+    int total = (code.qr->getSize() + 2 * kQuietZone) * moduleSize;
+    if (canvasWidth <= 0 || canvasHeight <= 0) {
+        canvasWidth = total;
+        canvasHeight = total;
+    }
+
+    qrcore::ImageFrame canvas = MakeCanvas(canvasWidth, canvasHeight);
+    if (clutter) {
+        FillClutter(canvas, (uint32_t)code.text.size() * 2654435761u + 1);
+    }
+    DrawQrCode(*code.qr, moduleSize, (canvasWidth - total) / 2, (canvasHeight - total) / 2, canvas);
+    return canvas;
+}
+
+qrcore::ImageFrame ToBGRX(const qrcore::ImageFrame& lum) {
+    qrcore::ImageFrame frame = qrcore::AllocateFrame(lum.width, lum.height, qrcore::PixelFormat::BGRX);
+    for (int y = 0; y < lum.height; y++) {
+        const uint8_t* s = lum.row(y);
+        uint8_t* d = frame.row(y);
+        for (int x = 0; x < lum.width; x++, d += 4) {
+            d[0] = d[1] = d[2] = s[x];
+            d[3] = 0;
+        }
+    }
+    return frame;
+}
+
+} // namespace qrtools
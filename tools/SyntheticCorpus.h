@@ -0,0 +1,70 @@
+/*
+ * 合成测试图像
+ *
+ * 用 qrcodegen 生成指定版本、纠错级别的二维码, 按给定模块像素数
+ * 绘制到指定尺寸的灰度画布上, 供 Linux 上的基准测试和调优工具使用,
+ * 不依赖截图或外部图像文件。
+ */
+
+#pragma once
+
+#include "core/ImageFrame.h"
+#include "qrcodegen.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace qrtools {
+
+struct SyntheticCode {
+    std::string text;                      // 编码的内容
+    int version = 0;                       // 实际版本 (1~40)
+    qrcodegen::QrCode::Ecc ecc = qrcodegen::QrCode::Ecc::MEDIUM;
+    std::shared_ptr<qrcodegen::QrCode> qr; // 模块矩阵
+};
+
+// 纠错级别名称 (L/M/Q/H)
+const char* EccName(qrcodegen::QrCode::Ecc ecc);
+
+/**
+ * @brief 生成由 seed 决定的可打印 ASCII 内容
+ */
+std::string MakePayload(size_t length, uint32_t seed);
+
+/**
+ * @brief 生成恰好为指定版本、且该版本容量尽量填满的二维码
+ */
+bool EncodeForVersion(int version, qrcodegen::QrCode::Ecc ecc, uint32_t seed, SyntheticCode& outCode);
+
+/**
+ * @brief 编码任意文本 (自动选择版本)
+ */
+bool EncodeText(const std::string& text, qrcodegen::QrCode::Ecc ecc, SyntheticCode& outCode);
+
+// 分配纯色灰度画布
+qrcore::ImageFrame MakeCanvas(int width, int height, uint8_t background = 255);
+
+/**
+ * @brief 在画布上铺满由 seed 决定的灰色矩形, 模拟屏幕上的文字和界面元素
+ */
+void FillClutter(qrcore::ImageFrame& canvas, uint32_t seed);
+
+/**
+ * @brief 把二维码绘制到画布 (左上角为 left, top; 含 4 模块白色静区), 超出画布的部分被裁掉
+ */
+void DrawQrCode(const qrcodegen::QrCode& qr, int moduleSize, int left, int top, qrcore::ImageFrame& canvas);
+
+/**
+ * @brief 生成居中绘制了二维码的灰度图
+ * @param canvasWidth, canvasHeight 画布尺寸; <= 0 时画布恰好容纳二维码和静区
+ */
+qrcore::ImageFrame RenderSample(const SyntheticCode& code, int moduleSize,
+                                int canvasWidth = 0, int canvasHeight = 0, bool clutter = false);
+
+/**
+ * @brief 把灰度图扩展为 32 位 BGRX 帧, 与截图得到的 DIB 节内存布局相同
+ */
+qrcore::ImageFrame ToBGRX(const qrcore::ImageFrame& lum);
+
+} // namespace qrtools
@@ -0,0 +1,4336 @@
+/*
+ * qrbench - 识别流水线基准测试
+ *
+ * 在 Linux 上无界面运行, 图像全部由 qrcodegen 合成 (SyntheticCorpus),
+ * 每个用例输出一行 JSON (p50/p95/p99 延迟等) 到标准输出, 便于对比不同构建;
+ * 可读的汇总表输出到标准错误。
+ *
+ * 用法: qrbench [--iterations N] [--quick] [--clipboard] [基准名...]
+ *   stages   扫描流水线各阶段 (截图复制、重排、灰度、识别、UTF-16、剪贴板) 的独立耗时
+ *   pyramid  选区尺寸 - 识别延迟 (默认配置), 对比启用/不启用图像金字塔, 以及多码模式下大码与小码都能识别
+ *   raster   二维码光栅化: 游程光栅化对比逐模块填充, 以及按最终尺寸直接生成预览
+ *   encodecache  生成窗口切换尺寸: 每次重新编码 / 编码缓存命中, 并检查缓存的正确性
+ *   preview  生成窗口连续输入: 同步生成 / 后台生成并取消过时请求, 并检查取消的正确性
+ *   png      二维码 PNG 写出: 整幅 24 位位图对比逐行 1 位 / 8 位写出, 并用独立解码器逐像素校验
+ *   vector   SVG / PDF 导出: 耗时与大小, 并经光栅化和 ZXing 识别往返校验
+ *   live     固定区域连续扫码: 合成帧序列下的自适应抓取间隔、去重报告, 以及慢识别不阻塞抓取
+ *   change   分块哈希变化检测: 1080p / 4K 每帧检测耗时 (各 SIMD 级别), 对比逐字节比较与识别耗时
+ *   cache    识别结果缓存: 键的正确性、感知距离、持久化与容量上限, 对比完整识别与命中缓存的耗时
+ *   history  扫描历史: 追加、有索引打开 / 重建索引, 三元组索引查询对比逐条比较, 以及截断与重建的正确性
+ *   trace    扫码跟踪: 每个跟踪点的开销 (关闭 / 开启 / 多线程), 以及环形缓冲区、并发导出和 JSON 的正确性
+ *   metrics  运行指标: 计数 / 直方图记录的开销, 以及并发计数、分位数误差、快照文件和本机端点 (本地采集程序) 的正确性
+ *   framepool  帧缓冲池: 截图到识别前处理的耗时与堆分配次数 (复用 / 不复用), 以及复用、淘汰和池销毁后帧的正确性
+ *   overlay  选区覆盖层: 拖拽选框时整屏重绘与脏矩形重绘的每帧耗时和像素数, 以及增量重绘与整幅重绘的一致性
+ *   freeze   定格截图: 选区截取视图与再次截图的耗时, 覆盖层首次绘制变暗截图的耗时, 以及截取视图的正确性
+ *   worker   解码工作线程: 提交到回调的延迟与吞吐, 以及提交顺序、停止时丢弃排队任务和重新启动的正确性
+ *   convert  灰度转换内核: 各 SIMD 级别整帧转换的吞吐, 以及与标量参考逐字节一致 (各格式、奇数宽度、行首偏移)
+ *   multicode  多码识别: 画布上码数 - 识别耗时 (每多一个码增加的耗时), 以及去重和阅读顺序的正确性
+ *   tiling   全屏分块识别: 4K / 5K 屏幕的整屏识别耗时 (共用预算 / 不限预算), 以及跨分块的码和共用截止时间的正确性
+ *
+ * 基准中的正确性检查失败时退出码为 1。
+ */
+
+#include "BenchStats.h"
+#include "SyntheticCorpus.h"
+#include "core/ChangeDetector.h"
+#include "core/DecodeCascade.h"
+#include "core/DecodeResultCache.h"
+#include "core/DecodeWorker.h"
+#include "core/FramePool.h"
+#include "core/ImageFilters.h"
+#include "core/ImageIO.h"
+#include "core/ImagePyramid.h"
+#include "core/LiveScanner.h"
+#include "core/Metrics.h"
+#include "core/OverlayCompositor.h"
+#include "core/PixelConvert.h"
+#include "core/PngWriter.h"
+#include "core/PreviewWorker.h"
+#include "core/QrEncode.h"
+#include "core/QrRaster.h"
+#include "core/QrVector.h"
+#include "core/ScanHistory.h"
+#include "core/TileScanner.h"
+#include "core/Trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using qrtools::Clock;
+using qrtools::ElapsedMs;
+using qrtools::LatencyStats;
+using qrtools::Summarize;
+
+static int g_checkFailures = 0; // 正确性检查失败次数
+
+static void Check(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "检查失败: %s\n", what);
+        g_checkFailures++;
+    }
+}
+
+struct BenchOptions {
+    int iterations = 20;
+    bool quick = false;     // 只取部分版本, 用于快速对比
+    bool clipboard = false; // 测量剪贴板阶段 (仅 Windows, 会覆盖剪贴板内容)
+};
+
+// 输出一行 JSON; extra 为已格式化的附加字段 (以逗号开头)
+static void EmitRecord(const char* bench, const std::string& caseName, const LatencyStats& stats,
+                       const std::string& extra) {
+    printf("{\"bench\":\"%s\",\"case\":\"%s\",\"n\":%zu,\"mean_ms\":%.4f,"
+           "\"p50_ms\":%.4f,\"p95_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f%s}\n",
+           bench, caseName.c_str(), stats.count, stats.mean,
+           stats.p50, stats.p95, stats.p99, stats.max, extra.c_str());
+    fflush(stdout);
+}
+
+// ---------------------------------------------------------------------------
+// stages: 扫描流水线各阶段的独立耗时
+//
+// 语料: 版本 1~40 × 纠错级别 L/M/Q/H × 模块 2/4/8 像素 × 画布 (恰好容纳二维码 / 1920x1080),
+// 放不下的组合跳过。每张图先扩展为 BGRX 帧 (截图 DIB 节的布局), 再分别计时:
+//   capture_copy  复制整帧像素, 即 BitBlt 写入 DIB 节的内存带宽下限 (真实截图需要桌面, 不在此测量)
+//   repack        原先的 GetDIBits 路径: 32 位自上而下 → 24 位自下而上 (行按 4 字节对齐)
+//   luma          灰度转换 (当前 SIMD 级别)
+//   decode        ZXing 单次识别 (级联第一层的参数)
+//   cascade       默认级联全程 (ScanImageForQR 提交给解码线程的部分)
+//   utf16         识别结果 UTF-8 → UTF-16 (Windows 上与 UTF8ToWide 一样用 MultiByteToWideChar)
+//   clipboard     与 CopyToClipboard 相同的写剪贴板流程 (仅 Windows 且指定 --clipboard)
+// 计时前先检查截图帧交给 ZXing 的路径 (包装、截取、ImageView) 不复制像素。
+// ---------------------------------------------------------------------------
+
+// 帧描述不复制像素: BGRX 帧经包装、截取和创建 ZXing::ImageView 后仍指向同一块内存, 行字节数不变
+static void CheckFrameViews() {
+    const int width = 333, height = 101, stride = 333 * 4 + 60; // 带行尾填充, 模拟 DIB 节 / 池中的缓冲区
+    std::vector<uint8_t> memory((size_t)stride * height);
+    for (size_t i = 0; i < memory.size(); i++) {
+        memory[i] = (uint8_t)(i * 31);
+    }
+    auto owner = std::make_shared<int>(0);
+    qrcore::ImageFrame frame = qrcore::WrapFrame(memory.data(), width, height, stride, qrcore::PixelFormat::BGRX, owner);
+    Check(frame.data == memory.data() && frame.stride == stride && frame.width == width && frame.height == height &&
+              frame.owner == owner,
+          "WrapFrame 不复制像素, 保留行字节数和 owner");
+
+    ZXing::ImageView view = qrcore::MakeImageView(frame);
+    Check(view.data(0, 0) == memory.data() && view.rowStride() == stride && view.width() == width &&
+              view.height() == height && view.format() == ZXing::ImageFormat::BGRX && view.data(1, 0) - view.data(0, 0) == 4,
+          "MakeImageView 直接引用帧内存 (BGRX, 行字节数不变)");
+
+    const int left = 17, top = 9;
+    qrcore::ImageFrame crop = qrcore::CropFrame(frame, left, top, 200, 50);
+    Check(crop.data == memory.data() + (size_t)top * stride + (size_t)left * 4 && crop.stride == stride &&
+              crop.owner == owner,
+          "CropFrame 以行列偏移指向原内存, 行字节数不变");
+    ZXing::ImageView cropView = qrcore::MakeImageView(crop);
+    Check(cropView.data(0, 0) == crop.data && cropView.rowStride() == stride && cropView.width() == 200 &&
+              cropView.data(5, 7) == memory.data() + (size_t)(top + 7) * stride + (size_t)(left + 5) * 4,
+          "截取帧的 ImageView 按原行字节数寻址");
+    Check(owner.use_count() == 3, "包装与截取只增加 owner 的引用计数");
+}
+
+// 旧的 GetDIBits(24 位) 重排: 每行按 4 字节对齐, 行序上下颠倒
+static void LegacyRepack(const qrcore::ImageFrame& bgrx, std::vector<uint8_t>& out) {
+    int stride = (bgrx.width * 3 + 3) & ~3;
+    out.resize((size_t)stride * bgrx.height);
+    for (int y = 0; y < bgrx.height; y++) {
+        const uint8_t* s = bgrx.row(y);
+        uint8_t* d = out.data() + (size_t)stride * (bgrx.height - 1 - y);
+        for (int x = 0; x < bgrx.width; x++, s += 4, d += 3) {
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
+        }
+    }
+}
+
+// UTF-8 → UTF-16; 非法序列替换为 U+FFFD
+static void Utf8ToUtf16(const std::string& text, std::u16string& out) {
+#ifdef _WIN32
+    int length = MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), NULL, 0);
+    out.resize(length);
+    MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), (wchar_t*)&out[0], length);
+#else
+    out.clear();
+    const unsigned char* s = (const unsigned char*)text.data();
+    size_t n = text.size();
+    for (size_t i = 0; i < n;) {
+        unsigned c = s[i];
+        int extra = c < 0x80 ? 0 : (c >> 5) == 0x6 ? 1 : (c >> 4) == 0xE ? 2 : (c >> 3) == 0x1E ? 3 : -1;
+        if (extra < 0 || (extra > 0 && i + extra >= n)) {
+            out += (char16_t)0xFFFD;
+            i++;
+            continue;
+        }
+        unsigned cp = extra == 0 ? c : c & (0x3F >> extra);
+        bool valid = true;
+        for (int k = 1; k <= extra; k++) {
+            valid = valid && (s[i + k] & 0xC0) == 0x80;
+            cp = (cp << 6) | (s[i + k] & 0x3F);
+        }
+        if (!valid) {
+            out += (char16_t)0xFFFD;
+            i++;
+            continue;
+        }
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            out += (char16_t)(0xD800 + (cp >> 10));
+            out += (char16_t)(0xDC00 + (cp & 0x3FF));
+        } else {
+            out += (char16_t)cp;
+        }
+        i += extra + 1;
+    }
+#endif
+}
+
+#ifdef _WIN32
+// 与 main.cpp 中 CopyToClipboard 相同的流程
+static bool WriteClipboard(const std::u16string& text) {
+    if (!OpenClipboard(NULL)) {
+        return false;
+    }
+    EmptyClipboard();
+    size_t bytes = (text.size() + 1) * sizeof(char16_t);
+    HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, bytes);
+    if (hMem) {
+        memcpy(GlobalLock(hMem), text.c_str(), bytes);
+        GlobalUnlock(hMem);
+        if (!SetClipboardData(CF_UNICODETEXT, hMem)) {
+            GlobalFree(hMem);
+        }
+    }
+    CloseClipboard();
+    return hMem != NULL;
+}
+#endif
+
+static void BenchStages(const BenchOptions& options) {
+    CheckFrameViews();
+
+    struct Canvas { int width, height; };
+    const Canvas canvases[] = {{0, 0}, {1920, 1080}};
+    const int moduleSizes[] = {2, 4, 8};
+    const qrcodegen::QrCode::Ecc eccs[] = {
+        qrcodegen::QrCode::Ecc::LOW, qrcodegen::QrCode::Ecc::MEDIUM,
+        qrcodegen::QrCode::Ecc::QUARTILE, qrcodegen::QrCode::Ecc::HIGH,
+    };
+    std::vector<int> versions;
+    if (options.quick) {
+        versions = {1, 2, 4, 7, 10, 15, 20, 25, 30, 40};
+    } else {
+        for (int v = 1; v <= 40; v++) {
+            versions.push_back(v);
+        }
+    }
+
+    const char* stageNames[] = {"capture_copy", "repack", "luma", "decode", "cascade", "utf16", "clipboard"};
+    std::map<std::string, std::vector<double>> allSamples;
+    qrcore::CascadeConfig cascade = qrcore::DefaultCascade();
+    qrcore::ScanOptions decodeOptions = cascade.tiers[0].options;
+    decodeOptions.maxSymbols = cascade.maxSymbols;
+    int cases = 0, decoded = 0;
+
+    fprintf(stderr, "\n[stages] SIMD: %s, %d 次/用例%s\n", qrcore::SimdLevelName(qrcore::ActiveSimdLevel()),
+            options.iterations, options.quick ? ", 部分版本" : "");
+
+    for (int version : versions) {
+        for (qrcodegen::QrCode::Ecc ecc : eccs) {
+            qrtools::SyntheticCode code;
+            if (!qrtools::EncodeForVersion(version, ecc, (uint32_t)(version * 4 + (int)ecc + 1), code)) {
+                continue;
+            }
+            for (int moduleSize : moduleSizes) {
+                for (const Canvas& canvas : canvases) {
+                    int side = (code.qr->getSize() + 8) * moduleSize;
+                    if (canvas.width > 0 && (side > canvas.width || side > canvas.height)) {
+                        continue; // 放不下
+                    }
+                    qrcore::ImageFrame bgrx = qrtools::ToBGRX(
+                        qrtools::RenderSample(code, moduleSize, canvas.width, canvas.height, canvas.width > 0));
+                    char caseName[96];
+                    snprintf(caseName, sizeof(caseName), "v%d-%s/m%d/%dx%d", version, qrtools::EccName(ecc),
+                             moduleSize, bgrx.width, bgrx.height);
+                    cases++;
+
+                    std::map<std::string, std::vector<double>> samples;
+                    qrcore::ImageFrame copy = qrcore::AllocateFrame(bgrx.width, bgrx.height, qrcore::PixelFormat::BGRX);
+                    std::vector<uint8_t> packed;
+                    qrcore::ImageFrame lum;
+                    std::string text;
+                    std::u16string wide;
+
+                    for (int i = 0; i < options.iterations; i++) {
+                        auto start = Clock::now();
+                        for (int y = 0; y < bgrx.height; y++) {
+                            memcpy(copy.row(y), bgrx.row(y), (size_t)bgrx.width * 4);
+                        }
+                        samples["capture_copy"].push_back(ElapsedMs(start));
+
+                        start = Clock::now();
+                        LegacyRepack(bgrx, packed);
+                        samples["repack"].push_back(ElapsedMs(start));
+
+                        start = Clock::now();
+                        qrcore::ConvertToLum(bgrx, 0, 0, bgrx.width, bgrx.height, lum);
+                        samples["luma"].push_back(ElapsedMs(start));
+
+                        qrcore::ScanResult result;
+                        start = Clock::now();
+                        qrcore::DecodeFrame(lum, decodeOptions, result);
+                        samples["decode"].push_back(ElapsedMs(start));
+
+                        start = Clock::now();
+                        bool ok = qrcore::RunCascade(bgrx, cascade, result);
+                        samples["cascade"].push_back(ElapsedMs(start));
+                        if (i == 0 && ok && result.text == code.text) {
+                            decoded++;
+                        }
+                        text = ok ? qrcore::JoinSymbolTexts(result, "\r\n") : code.text;
+
+                        start = Clock::now();
+                        Utf8ToUtf16(text, wide);
+                        samples["utf16"].push_back(ElapsedMs(start));
+
+#ifdef _WIN32
+                        if (options.clipboard) {
+                            start = Clock::now();
+                            WriteClipboard(wide);
+                            samples["clipboard"].push_back(ElapsedMs(start));
+                        }
+#endif
+                    }
+
+                    double megapixels = (double)bgrx.width * bgrx.height / 1e6;
+                    for (const char* stage : stageNames) {
+                        auto it = samples.find(stage);
+                        if (it == samples.end()) {
+                            continue;
+                        }
+                        LatencyStats stats = Summarize(it->second);
+                        char extra[160];
+                        snprintf(extra, sizeof(extra), ",\"stage\":\"%s\",\"per_s\":%.1f,\"mpix_per_s\":%.1f",
+                                 stage, stats.mean > 0 ? 1000.0 / stats.mean : 0.0,
+                                 stats.mean > 0 ? megapixels * 1000.0 / stats.mean : 0.0);
+                        EmitRecord("stages", caseName, stats, extra);
+                        allSamples[stage].insert(allSamples[stage].end(), it->second.begin(), it->second.end());
+                    }
+                }
+            }
+        }
+    }
+
+    fprintf(stderr, "%d 个用例, 默认级联识别成功 %d 个\n", cases, decoded);
+    fprintf(stderr, "%-13s %10s %10s %10s %10s\n", "阶段", "p50(ms)", "p95(ms)", "p99(ms)", "次/秒");
+    for (const char* stage : stageNames) {
+        auto it = allSamples.find(stage);
+        if (it == allSamples.end()) {
+            fprintf(stderr, "%-13s %10s\n", stage, "n/a");
+            continue;
+        }
+        LatencyStats stats = Summarize(it->second);
+        char extra[96];
+        snprintf(extra, sizeof(extra), ",\"stage\":\"%s\",\"per_s\":%.1f", stage,
+                 stats.mean > 0 ? 1000.0 / stats.mean : 0.0);
+        EmitRecord("stages", "all", stats, extra);
+        fprintf(stderr, "%-13s %10.3f %10.3f %10.3f %10.1f\n", stage, stats.p50, stats.p95, stats.p99,
+                stats.mean > 0 ? 1000.0 / stats.mean : 0.0);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// pyramid: 选区尺寸 - 识别延迟
+//
+// 每种选区尺寸放一个大模块码 (8 像素, 高 DPI 屏幕上的常见情形) 和
+// 一个小模块码 (2 像素, 缩小后无法识别, 必须回退到原图),
+// 分别在不使用金字塔和使用两级金字塔时按默认配置 (多码模式、默认时间预算) 识别。
+// 先检查多码模式下同一选区内的大码和小码都能识别 (粗层级成功后仍回到原图),
+// 以及金字塔各级之间遵守截止时间。
+// ---------------------------------------------------------------------------
+
+static void CheckPyramid() {
+    qrtools::SyntheticCode large, small;
+    if (!qrtools::EncodeForVersion(4, qrcodegen::QrCode::Ecc::MEDIUM, 71, large) ||
+        !qrtools::EncodeForVersion(4, qrcodegen::QrCode::Ecc::MEDIUM, 72, small)) {
+        Check(false, "生成二维码");
+        return;
+    }
+    qrcore::ImageFrame canvas = qrtools::MakeCanvas(2560, 1440);
+    qrtools::DrawQrCode(*large.qr, 8, 200, 200, canvas);
+    qrtools::DrawQrCode(*small.qr, 2, 1800, 900, canvas);
+    qrcore::CascadeConfig cascade = qrcore::DefaultCascade();
+    qrcore::ScanResult result;
+    qrcore::RunCascade(qrtools::ToBGRX(canvas), cascade, result);
+    bool foundLarge = false, foundSmall = false;
+    for (const qrcore::DecodedSymbol& symbol : result.symbols) {
+        foundLarge = foundLarge || symbol.text == large.text;
+        foundSmall = foundSmall || symbol.text == small.text;
+    }
+    Check(foundLarge && foundSmall, "多码模式使用金字塔时同一选区内的大模块码和小模块码都能识别");
+
+    // 5K 无码画布, 预算 1 毫秒: 第一级之后不再继续金字塔, 原图只执行第一层
+    qrcore::ImageFrame blank = qrtools::ToBGRX(qrtools::MakeCanvas(5120, 2880));
+    cascade.budgetMs = 1;
+    qrcore::ScanResult bounded;
+    qrcore::RunCascade(blank, cascade, bounded);
+    Check(bounded.budgetExceeded && bounded.tiersTried <= 1, "金字塔各级之间检查截止时间");
+}
+
+static void BenchPyramid(const BenchOptions& options) {
+    CheckPyramid();
+
+    struct Size { int width, height; };
+    const Size sizes[] = {
+        {640, 480}, {1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160}, {5120, 2880},
+    };
+    const int moduleSizes[] = {8, 2};
+
+    qrtools::SyntheticCode code;
+    if (!qrtools::EncodeForVersion(4, qrcodegen::QrCode::Ecc::MEDIUM, 7, code)) {
+        fprintf(stderr, "pyramid: 生成二维码失败\n");
+        return;
+    }
+
+    fprintf(stderr, "\n[pyramid] 默认配置 (多码模式, 默认级联与时间预算), %d 次/用例 (p50 毫秒)\n", options.iterations);
+    fprintf(stderr, "%-11s %6s %12s %12s %8s  %s\n", "选区", "模块", "原图", "金字塔", "加速", "成功层级");
+
+    for (const Size& size : sizes) {
+        for (int moduleSize : moduleSizes) {
+            qrcore::ImageFrame image = qrtools::RenderSample(code, moduleSize, size.width, size.height, true);
+            std::string caseName = std::to_string(size.width) + "x" + std::to_string(size.height) +
+                                   "/m" + std::to_string(moduleSize);
+
+            double p50[2] = {0, 0};
+            std::string tier[2];
+            for (int mode = 0; mode < 2; mode++) {
+                qrcore::CascadeConfig cascade = qrcore::DefaultCascade();
+                if (mode == 0) {
+                    cascade.pyramid.maxLevels = 0;
+                }
+
+                std::vector<double> samples;
+                int successes = 0;
+                for (int i = 0; i < options.iterations; i++) {
+                    qrcore::ScanResult result;
+                    auto start = Clock::now();
+                    bool ok = qrcore::RunCascade(image, cascade, result);
+                    samples.push_back(ElapsedMs(start));
+                    if (ok && result.text == code.text) {
+                        successes++;
+                        tier[mode] = result.tier;
+                    }
+                }
+
+                LatencyStats stats = Summarize(samples);
+                p50[mode] = stats.p50;
+                if (successes == 0) {
+                    tier[mode] = "FAIL";
+                }
+                char extra[160];
+                snprintf(extra, sizeof(extra), ",\"pyramid_levels\":%d,\"success_rate\":%.3f,\"tier\":\"%s\"",
+                         cascade.pyramid.maxLevels, (double)successes / options.iterations, tier[mode].c_str());
+                EmitRecord("pyramid", caseName, stats, extra);
+            }
+
+            fprintf(stderr, "%-11s %6d %12.2f %12.2f %7.2fx  %s / %s\n",
+                    (std::to_string(size.width) + "x" + std::to_string(size.height)).c_str(),
+                    moduleSize, p50[0], p50[1], p50[1] > 0 ? p50[0] / p50[1] : 0.0,
+                    tier[0].c_str(), tier[1].c_str());
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// raster: 二维码光栅化
+//
+// reference 模拟原先的做法: 整图铺白后对每个深色模块单独填充一个 scale x scale 的矩形
+// (对应每个模块一次 FillRectangle), 预览再由原尺寸图像最近邻缩小到 380 像素。
+// runlength 为 QrRaster: 行内深色游程合并、模块行整行复制, 预览按最终尺寸直接生成。
+// 两种做法的原尺寸输出逐字节比较, 不一致时报告。
+// ---------------------------------------------------------------------------
+
+static void ReferenceRasterize(const qrcore::ModuleMatrix& matrix, int scale, int border, qrcore::ImageFrame& out) {
+    int imageSize = qrcore::QrImageSize(matrix, scale, border);
+    out = qrcore::AllocateFrame(imageSize, imageSize, qrcore::PixelFormat::BGRX);
+    for (int y = 0; y < out.height; y++) {
+        uint32_t* row = (uint32_t*)out.row(y);
+        for (int x = 0; x < out.width; x++) {
+            row[x] = 0xFFFFFFFFu;
+        }
+    }
+    for (int my = 0; my < matrix.size; my++) {
+        for (int mx = 0; mx < matrix.size; mx++) {
+            if (!matrix.get(mx, my)) {
+                continue;
+            }
+            for (int y = 0; y < scale; y++) {
+                uint32_t* row = (uint32_t*)out.row((my + border) * scale + y);
+                for (int x = 0; x < scale; x++) {
+                    row[(mx + border) * scale + x] = 0;
+                }
+            }
+        }
+    }
+}
+
+// 最近邻缩小到 previewSize 见方 (居中, 白底, 不放大)
+static void ReferencePreview(const qrcore::ImageFrame& image, int previewSize, qrcore::ImageFrame& out) {
+    out = qrcore::AllocateFrame(previewSize, previewSize, qrcore::PixelFormat::BGRX);
+    int scaled = std::min(image.width, previewSize);
+    int offset = (previewSize - scaled) / 2;
+    for (int y = 0; y < previewSize; y++) {
+        uint32_t* row = (uint32_t*)out.row(y);
+        for (int x = 0; x < previewSize; x++) {
+            row[x] = 0xFFFFFFFFu;
+        }
+    }
+    for (int y = 0; y < scaled; y++) {
+        const uint32_t* src = (const uint32_t*)image.row((int)((int64_t)y * image.height / scaled));
+        uint32_t* row = (uint32_t*)out.row(offset + y);
+        for (int x = 0; x < scaled; x++) {
+            row[offset + x] = src[(int64_t)x * image.width / scaled];
+        }
+    }
+}
+
+static bool SameFrame(const qrcore::ImageFrame& a, const qrcore::ImageFrame& b) {
+    if (a.width != b.width || a.height != b.height || a.format != b.format) {
+        return false;
+    }
+    size_t rowBytes = (size_t)a.width * qrcore::BytesPerPixel(a.format);
+    for (int y = 0; y < a.height; y++) {
+        if (memcmp(a.row(y), b.row(y), rowBytes) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void BenchRaster(const BenchOptions& options) {
+    const int versions[] = {1, 5, 10, 20, 30, 40};
+    const int scales[] = {4, 8, 12, 16};
+    const int border = 4;
+    const int previewSize = 380;
+
+    fprintf(stderr, "\n[raster] BGRX, %d 次/用例 (p50 毫秒)\n", options.iterations);
+    fprintf(stderr, "%-8s %5s %11s %11s %8s %11s %11s %8s  %s\n", "版本", "倍数",
+            "逐模块", "游程", "加速", "预览(旧)", "预览(新)", "加速", "一致");
+
+    for (int version : versions) {
+        qrtools::SyntheticCode code;
+        if (!qrtools::EncodeForVersion(version, qrcodegen::QrCode::Ecc::MEDIUM, (uint32_t)version, code)) {
+            continue;
+        }
+        qrcore::ModuleMatrix matrix = qrcore::ToModuleMatrix(*code.qr);
+
+        for (int scale : scales) {
+            std::vector<double> samples[4];
+            qrcore::ImageFrame reference, fast, previewOld;
+            qrcore::ImageFrame previewNew = qrcore::AllocateFrame(previewSize, previewSize, qrcore::PixelFormat::BGRX);
+            for (int i = 0; i < options.iterations; i++) {
+                auto start = Clock::now();
+                ReferenceRasterize(matrix, scale, border, reference);
+                samples[0].push_back(ElapsedMs(start));
+
+                start = Clock::now();
+                qrcore::RasterizeQr(matrix, scale, border, qrcore::PixelFormat::BGRX, fast);
+                samples[1].push_back(ElapsedMs(start));
+
+                // 旧预览包含先画原尺寸图像的耗时
+                start = Clock::now();
+                ReferenceRasterize(matrix, scale, border, reference);
+                ReferencePreview(reference, previewSize, previewOld);
+                samples[2].push_back(ElapsedMs(start));
+
+                start = Clock::now();
+                qrcore::RenderQrPreview(matrix, scale, border, previewNew);
+                samples[3].push_back(ElapsedMs(start));
+            }
+            bool same = SameFrame(reference, fast);
+
+            const char* names[] = {"reference", "runlength", "preview_reference", "preview_direct"};
+            double p50[4];
+            char caseName[32];
+            snprintf(caseName, sizeof(caseName), "v%d/x%d", version, scale);
+            for (int k = 0; k < 4; k++) {
+                LatencyStats stats = Summarize(samples[k]);
+                p50[k] = stats.p50;
+                char extra[96];
+                snprintf(extra, sizeof(extra), ",\"method\":\"%s\",\"image_px\":%d,\"identical\":%s",
+                         names[k], k < 2 ? reference.width : previewSize, same ? "true" : "false");
+                EmitRecord("raster", caseName, stats, extra);
+            }
+            fprintf(stderr, "%-8d %5d %11.3f %11.3f %7.1fx %11.3f %11.3f %7.1fx  %s\n", version, scale,
+                    p50[0], p50[1], p50[1] > 0 ? p50[0] / p50[1] : 0.0,
+                    p50[2], p50[3], p50[3] > 0 ? p50[2] / p50[3] : 0.0, same ? "是" : "否");
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// encodecache: 生成窗口的编码缓存
+//
+// 模拟在生成窗口中反复切换尺寸 (4/8/12/16 倍): uncached 每次重新编码并光栅化,
+// cached 经由 QrEncodeCache。先检查 LRU 淘汰与命中计数, 再比较两条路径的图像是否一致。
+// ---------------------------------------------------------------------------
+
+static void CheckEncodeCache() {
+    int encodes = 0;
+    qrcore::QrEncodeCache cache([&encodes](const std::string& text, int ecc) {
+        encodes++;
+        return qrcore::EncodeQrText(text, ecc);
+    }, 2, 2);
+
+    qrcore::CachedMatrix a = cache.GetMatrix("a", 1);
+    qrcore::CachedMatrix a2 = cache.GetMatrix("a", 1);
+    Check(a.id == a2.id && encodes == 1, "相同 (文本, 纠错级别) 命中缓存");
+    Check(cache.GetMatrix("a", 2).id != a.id && encodes == 2, "纠错级别不同时重新编码");
+    cache.GetMatrix("b", 1); // 容量 2: 淘汰最久未用的 ("a", 1)
+    cache.GetMatrix("a", 1);
+    Check(encodes == 4, "超出容量时淘汰最久未用的矩阵");
+
+    qrcore::CachedMatrix b = cache.GetMatrix("b", 1);
+    qrcore::ImageFrame r1 = cache.GetRaster(b, 4, 4, qrcore::PixelFormat::BGRX);
+    qrcore::ImageFrame r2 = cache.GetRaster(b, 4, 4, qrcore::PixelFormat::BGRX);
+    qrcore::ImageFrame r3 = cache.GetRaster(b, 4, 4, qrcore::PixelFormat::Lum);
+    Check(r1.data == r2.data && r1.data != r3.data, "光栅图按 (矩阵, 倍数, 格式) 索引");
+
+    qrcore::EncodeCacheStats stats = cache.GetStats();
+    Check(stats.matrixHits == 2 && stats.matrixMisses == 4, "矩阵命中计数");
+    Check(stats.rasterHits == 1 && stats.rasterMisses == 2, "光栅命中计数");
+
+    bool threw = false;
+    try {
+        cache.GetMatrix(std::string(4000, 'x'), 3);
+    } catch (const std::exception&) {
+        threw = true;
+    }
+    Check(threw, "编码失败的异常传给调用方");
+}
+
+static void BenchEncodeCache(const BenchOptions& options) {
+    CheckEncodeCache();
+
+    const size_t lengths[] = {20, 300, 1200};
+    const int scales[] = {4, 8, 12, 16, 8, 4};
+    const int border = 4;
+    const int ecc = 1;
+
+    fprintf(stderr, "\n[encodecache] 切换尺寸一次的耗时 (p50 毫秒)\n");
+    fprintf(stderr, "%-8s %12s %12s %8s\n", "字节数", "每次编码", "缓存", "加速");
+
+    qrcore::QrEncodeCache cache(qrcore::EncodeQrText);
+    for (size_t length : lengths) {
+        std::string text = qrtools::MakePayload(length, (uint32_t)length);
+        std::vector<double> uncached, cached;
+        for (int i = 0; i < options.iterations; i++) {
+            for (int scale : scales) {
+                auto start = Clock::now();
+                qrcore::ModuleMatrix matrix = qrcore::EncodeQrText(text, ecc);
+                qrcore::ImageFrame fresh;
+                qrcore::RasterizeQr(matrix, scale, border, qrcore::PixelFormat::BGRX, fresh);
+                uncached.push_back(ElapsedMs(start));
+
+                start = Clock::now();
+                qrcore::ImageFrame hit = cache.GetRaster(cache.GetMatrix(text, ecc), scale, border,
+                                                         qrcore::PixelFormat::BGRX);
+                cached.push_back(ElapsedMs(start));
+
+                if (i == 0) {
+                    Check(SameFrame(fresh, hit), "缓存的光栅图与重新生成的一致");
+                }
+            }
+        }
+
+        LatencyStats u = Summarize(uncached);
+        LatencyStats c = Summarize(cached);
+        std::string caseName = std::to_string(length) + "B";
+        EmitRecord("encodecache", caseName, u, ",\"method\":\"uncached\"");
+        EmitRecord("encodecache", caseName, c, ",\"method\":\"cached\"");
+        fprintf(stderr, "%-8zu %12.4f %12.4f %7.0fx\n", length, u.p50, c.p50, c.p50 > 0 ? u.p50 / c.p50 : 0.0);
+    }
+
+    qrcore::EncodeCacheStats stats = cache.GetStats();
+    char extra[160];
+    snprintf(extra, sizeof(extra), ",\"matrix_hits\":%llu,\"matrix_misses\":%llu,"
+             "\"raster_hits\":%llu,\"raster_misses\":%llu",
+             (unsigned long long)stats.matrixHits, (unsigned long long)stats.matrixMisses,
+             (unsigned long long)stats.rasterHits, (unsigned long long)stats.rasterMisses);
+    EmitRecord("encodecache", "counters", LatencyStats(), extra);
+    fprintf(stderr, "矩阵 命中 %llu / 未命中 %llu; 光栅 命中 %llu / 未命中 %llu\n",
+            (unsigned long long)stats.matrixHits, (unsigned long long)stats.matrixMisses,
+            (unsigned long long)stats.rasterHits, (unsigned long long)stats.rasterMisses);
+}
+
+// ---------------------------------------------------------------------------
+// preview: 生成窗口连续输入时的预览延迟
+//
+// 模拟以固定间隔逐字输入 (不去抖, 最坏情况), 对比:
+//   sync   每次输入都在消息线程上编码 + 光栅化 + 生成预览 (原实现)
+//   async  PreviewWorker 在后台生成, 新输入作废旧请求
+// ui 为每次输入占用消息线程的时间; final 为最后一次输入到最终预览就绪的时间。
+// ---------------------------------------------------------------------------
+
+// 收集预览结果, 像生成窗口一样只保留仍是最新代号的结果
+struct PreviewCollector {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::unique_ptr<qrcore::PreviewResult>> results;
+    Clock::time_point lastAt;
+
+    qrcore::PreviewCallback Callback() {
+        return [this](std::unique_ptr<qrcore::PreviewResult> result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            lastAt = Clock::now();
+            results.push_back(std::move(result));
+            cv.notify_all();
+        };
+    }
+
+    // 等待代号为 generation 的结果, 超时返回 nullptr
+    const qrcore::PreviewResult* WaitFor(uint64_t generation, int timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        const qrcore::PreviewResult* found = nullptr;
+        cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] {
+            for (const auto& result : results) {
+                if (result->generation == generation) {
+                    found = result.get();
+                }
+            }
+            return found != nullptr;
+        });
+        return found;
+    }
+};
+
+static qrcore::PreviewRequest MakePreviewRequest(const std::string& text, int ecc, int scale) {
+    qrcore::PreviewRequest request;
+    request.text = text;
+    request.ecc = ecc;
+    request.scale = scale;
+    return request;
+}
+
+static void CheckPreviewWorker() {
+    qrcore::QrEncodeCache cache(qrcore::EncodeQrText);
+    qrcore::PreviewWorker worker(cache);
+    Check(worker.Submit(MakePreviewRequest("a", 1, 4), nullptr) == 0, "线程未启动时拒绝请求");
+    worker.Start();
+
+    // 连续提交: 只有最后一个请求的结果是最新的, 且每个结果与其请求对应
+    PreviewCollector collector;
+    std::string text = qrtools::MakePayload(1200, 7);
+    uint64_t last = 0;
+    for (int i = 0; i < 20; i++) {
+        last = worker.Submit(MakePreviewRequest(text.substr(0, 1000 + i * 10), 3, 16), collector.Callback());
+    }
+    const qrcore::PreviewResult* final = collector.WaitFor(last, 10000);
+    Check(final != nullptr, "最后一个请求的结果送达");
+    if (final) {
+        Check(final->errorMsg.empty() && final->request.text.size() == 1190, "最终结果对应最后一次输入");
+        Check(!final->matrix.empty() && final->preview.width == final->request.previewSize, "结果含模块矩阵与预览");
+    }
+    {
+        std::lock_guard<std::mutex> lock(collector.mutex);
+        Check(collector.results.size() < 20, "过时的请求被取消而不是全部完成");
+        for (const auto& result : collector.results) {
+            Check(result->request.text.size() == 1000 + (result->generation - (last - 19)) * 10, "结果与请求的代号一致");
+        }
+    }
+
+    // Cancel() 返回后不再有回调
+    std::atomic<bool> cancelled(false);
+    std::atomic<int> lateCallbacks(0);
+    for (int i = 0; i < 5; i++) {
+        worker.Submit(MakePreviewRequest(text.substr(0, 1100 + i), 3, 16), [&](std::unique_ptr<qrcore::PreviewResult>) {
+            if (cancelled) {
+                lateCallbacks++;
+            }
+        });
+    }
+    worker.Cancel();
+    cancelled = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Check(lateCallbacks == 0, "Cancel() 之后没有回调");
+
+    // 编码失败以错误信息返回
+    PreviewCollector errors;
+    uint64_t bad = worker.Submit(MakePreviewRequest(std::string(4000, 'x'), 3, 8), errors.Callback());
+    const qrcore::PreviewResult* failed = errors.WaitFor(bad, 10000);
+    Check(failed != nullptr && !failed->errorMsg.empty(), "内容过长时返回错误信息");
+    worker.Stop();
+}
+
+static void BenchPreview(const BenchOptions& options) {
+    CheckPreviewWorker();
+
+    struct Case {
+        const char* name;
+        size_t length;
+        int ecc;
+    };
+    const Case cases[] = {{"1200B-H", 1200, 3}, {"2800B-L", 2800, 0}};
+    const int keystrokes = options.quick ? 15 : 40;
+    const int intervalMs = 50; // 约每秒 20 个字符的连续输入
+    const int scale = 16;      // 最大尺寸, 光栅化最慢
+
+    fprintf(stderr, "\n[preview] 连续输入 %d 次, 间隔 %d ms, %dx, 不去抖 (毫秒)\n", keystrokes, intervalMs, scale);
+    fprintf(stderr, "%-9s %-6s %10s %10s %10s %8s %8s\n", "用例", "方式", "ui p50", "ui max", "final", "完成", "取消");
+
+    for (const Case& c : cases) {
+        std::string text = qrtools::MakePayload(c.length, (uint32_t)c.length);
+        auto typed = [&](int i) { return text.substr(0, c.length - keystrokes + 1 + i); };
+
+        // sync: 输入落后于生成时, 后续输入排队等待
+        {
+            qrcore::QrEncodeCache cache(qrcore::EncodeQrText);
+            std::vector<double> ui;
+            auto start = Clock::now();
+            Clock::time_point lastKey;
+            for (int i = 0; i < keystrokes; i++) {
+                lastKey = start + std::chrono::milliseconds(i * intervalMs);
+                std::this_thread::sleep_until(lastKey);
+                auto begin = Clock::now();
+                qrcore::CachedMatrix matrix = cache.GetMatrix(typed(i), c.ecc);
+                qrcore::ImageFrame image = cache.GetRaster(matrix, scale, 4, qrcore::PixelFormat::BGRX);
+                qrcore::ImageFrame preview = qrcore::AllocateFrame(380, 380, qrcore::PixelFormat::BGRX);
+                qrcore::RenderQrPreview(*matrix.matrix, scale, 4, preview);
+                ui.push_back(ElapsedMs(begin));
+            }
+            double finalMs = ElapsedMs(lastKey);
+            LatencyStats stats = Summarize(ui);
+            char extra[160];
+            snprintf(extra, sizeof(extra), ",\"method\":\"sync\",\"final_ms\":%.3f,\"completed\":%d,\"cancelled\":0",
+                     finalMs, keystrokes);
+            EmitRecord("preview", c.name, stats, extra);
+            fprintf(stderr, "%-9s %-6s %10.3f %10.3f %10.2f %8d %8d\n", c.name, "sync", stats.p50, stats.max,
+                    finalMs, keystrokes, 0);
+        }
+
+        // async: 提交即返回, 只有最新的结果会送达
+        {
+            qrcore::QrEncodeCache cache(qrcore::EncodeQrText);
+            qrcore::PreviewWorker worker(cache);
+            worker.Start();
+            PreviewCollector collector;
+            std::vector<double> ui;
+            auto start = Clock::now();
+            Clock::time_point lastKey;
+            uint64_t last = 0;
+            for (int i = 0; i < keystrokes; i++) {
+                lastKey = start + std::chrono::milliseconds(i * intervalMs);
+                std::this_thread::sleep_until(lastKey);
+                auto begin = Clock::now();
+                last = worker.Submit(MakePreviewRequest(typed(i), c.ecc, scale), collector.Callback());
+                ui.push_back(ElapsedMs(begin));
+            }
+            const qrcore::PreviewResult* final = collector.WaitFor(last, 30000);
+            Check(final != nullptr && final->request.text == typed(keystrokes - 1), "最终预览对应最后一次输入");
+            double finalMs = 0;
+            {
+                std::lock_guard<std::mutex> lock(collector.mutex);
+                finalMs = std::chrono::duration<double, std::milli>(collector.lastAt - lastKey).count();
+            }
+            worker.Stop();
+
+            qrcore::PreviewStats jobs = worker.GetStats();
+            LatencyStats stats = Summarize(ui);
+            unsigned long long cancelledJobs = (unsigned long long)(jobs.dropped + jobs.aborted);
+            char extra[200];
+            snprintf(extra, sizeof(extra), ",\"method\":\"async\",\"final_ms\":%.3f,\"completed\":%llu,\"cancelled\":%llu,"
+                     "\"debounce_ms\":%d", finalMs, (unsigned long long)jobs.completed, cancelledJobs,
+                     worker.SuggestedDebounceMs());
+            EmitRecord("preview", c.name, stats, extra);
+            fprintf(stderr, "%-9s %-6s %10.3f %10.3f %10.2f %8llu %8llu\n", c.name, "async", stats.p50, stats.max,
+                    finalMs, (unsigned long long)jobs.completed, cancelledJobs);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// png: 二维码 PNG 写出
+//
+// 对比原方式 (整幅 24 位位图 + 压缩, 相当于 GDI+ 的 PNG 编码) 与逐行写出的
+// 1 位 / 8 位 PNG: 耗时、文件大小、写出过程中占用的像素内存。
+// 写出的每个文件都用独立的解码器 (zlib 解压 + 全部五种过滤器) 还原并与光栅化结果逐像素比较,
+// 构建带 stb_image 时再用它解码一次。
+// ---------------------------------------------------------------------------
+
+static uint32_t ReadBigEndian32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint8_t PaethPredictor(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+// 解码灰度 / 调色板 PNG (1 或 8 位, 不交错) 为 8 位灰度帧; 调色板取 R 分量
+static bool DecodePngForCheck(const std::vector<uint8_t>& png, qrcore::ImageFrame& outFrame, std::string& error) {
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (png.size() < 8 || memcmp(png.data(), kSignature, 8) != 0) {
+        error = "签名错误";
+        return false;
+    }
+    uint32_t width = 0, height = 0;
+    int bitDepth = 0, colorType = -1;
+    std::vector<uint8_t> idat, palette;
+    bool ended = false;
+    for (size_t pos = 8; pos + 12 <= png.size() && !ended;) {
+        uint32_t length = ReadBigEndian32(&png[pos]);
+        if (pos + 12 + length > png.size()) {
+            error = "块长度越界";
+            return false;
+        }
+        const uint8_t* type = &png[pos + 4];
+        const uint8_t* data = &png[pos + 8];
+        if (crc32(crc32(0L, nullptr, 0), type, length + 4) != ReadBigEndian32(data + length)) {
+            error = "CRC 错误";
+            return false;
+        }
+        if (memcmp(type, "IHDR", 4) == 0 && length == 13) {
+            width = ReadBigEndian32(data);
+            height = ReadBigEndian32(data + 4);
+            bitDepth = data[8];
+            colorType = data[9];
+            if (data[10] != 0 || data[11] != 0 || data[12] != 0) {
+                error = "不支持的压缩 / 过滤 / 交错方式";
+                return false;
+            }
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            palette.assign(data, data + length);
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            idat.insert(idat.end(), data, data + length);
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            ended = true;
+        }
+        pos += 12 + length;
+    }
+    if (!ended || width == 0 || height == 0 || (bitDepth != 1 && bitDepth != 8) ||
+        (colorType != 0 && colorType != 3) || (colorType == 3 && palette.size() < 6)) {
+        error = "缺少块或头部不支持";
+        return false;
+    }
+
+    size_t lineBytes = bitDepth == 8 ? width : (width + 7) / 8;
+    std::vector<uint8_t> raw((lineBytes + 1) * height);
+    uLongf rawSize = (uLongf)raw.size();
+    if (uncompress(raw.data(), &rawSize, idat.data(), (uLong)idat.size()) != Z_OK || rawSize != raw.size()) {
+        error = "解压失败或数据长度不符";
+        return false;
+    }
+
+    qrcore::ImageFrame frame = qrcore::AllocateFrame((int)width, (int)height, qrcore::PixelFormat::Lum, 1);
+    std::vector<uint8_t> prev(lineBytes, 0), line(lineBytes);
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* src = &raw[y * (lineBytes + 1)];
+        int filter = src[0];
+        for (size_t i = 0; i < lineBytes; i++) {
+            int a = i > 0 ? line[i - 1] : 0; // 1 位及 8 位灰度每像素不足 / 恰为 1 字节
+            int b = prev[i];
+            int c = i > 0 ? prev[i - 1] : 0;
+            int v = src[1 + i];
+            switch (filter) {
+                case 0: break;
+                case 1: v += a; break;
+                case 2: v += b; break;
+                case 3: v += (a + b) / 2; break;
+                case 4: v += PaethPredictor(a, b, c); break;
+                default:
+                    error = "未知的过滤类型";
+                    return false;
+            }
+            line[i] = (uint8_t)v;
+        }
+        uint8_t* dst = frame.row((int)y);
+        for (uint32_t x = 0; x < width; x++) {
+            int value = bitDepth == 8 ? line[x] : ((line[x >> 3] >> (7 - (x & 7))) & 1);
+            if (colorType == 3) {
+                dst[x] = (size_t)value * 3 < palette.size() ? palette[(size_t)value * 3] : 0;
+            } else {
+                dst[x] = bitDepth == 8 ? (uint8_t)value : (uint8_t)(value ? 0xFF : 0x00);
+            }
+        }
+        prev.swap(line);
+    }
+    outFrame = frame;
+    return true;
+}
+
+// 原方式: 先光栅化整幅 24 位图像, 再整体压缩 (每行过滤类型 0)
+static size_t EncodeFullRgbPng(const qrcore::ModuleMatrix& matrix, int scale, int border, int level,
+                               size_t& outPixelBytes) {
+    qrcore::ImageFrame frame;
+    qrcore::RasterizeQr(matrix, scale, border, qrcore::PixelFormat::RGB, frame);
+    size_t rowBytes = (size_t)frame.width * 3;
+    std::vector<uint8_t> filtered((rowBytes + 1) * frame.height);
+    for (int y = 0; y < frame.height; y++) {
+        filtered[y * (rowBytes + 1)] = 0;
+        memcpy(&filtered[y * (rowBytes + 1) + 1], frame.row(y), rowBytes);
+    }
+    std::vector<uint8_t> compressed(compressBound((uLong)filtered.size()));
+    uLongf size = (uLongf)compressed.size();
+    compress2(compressed.data(), &size, filtered.data(), (uLong)filtered.size(), level);
+    outPixelBytes = frame.byteSize() + filtered.size();
+    return size + 8 + 25 + 12 + 12; // 签名 + IHDR + IDAT + IEND 的开销
+}
+
+static bool CheckPng(const std::vector<uint8_t>& png, const qrcore::ImageFrame& expected, const char* what) {
+    qrcore::ImageFrame decoded;
+    std::string error;
+    if (!DecodePngForCheck(png, decoded, error)) {
+        fprintf(stderr, "%s: %s\n", what, error.c_str());
+        Check(false, "PNG 可被独立解码器解码");
+        return false;
+    }
+    bool same = SameFrame(decoded, expected);
+    Check(same, "PNG 像素与光栅化结果一致");
+
+    if (same && qrcore::HaveStbImage()) {
+        std::string path = (std::filesystem::temp_directory_path() / "qrbench_check.png").string();
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file) {
+            fwrite(png.data(), 1, png.size(), file);
+            fclose(file);
+        }
+        qrcore::ImageFrame stb;
+        bool loaded = qrcore::LoadImageFile(path, stb, error);
+        remove(path.c_str());
+        Check(loaded, "stb_image 可以解码 PNG");
+        if (loaded) {
+            // 调色板图像 stb 解码为 RGB, 取 R 分量比较
+            qrcore::ImageFrame lum = stb;
+            if (stb.format == qrcore::PixelFormat::RGB) {
+                lum = qrcore::AllocateFrame(stb.width, stb.height, qrcore::PixelFormat::Lum, 1);
+                for (int y = 0; y < stb.height; y++) {
+                    for (int x = 0; x < stb.width; x++) {
+                        lum.row(y)[x] = stb.row(y)[x * 3];
+                    }
+                }
+            }
+            same = SameFrame(lum, expected);
+            Check(same, "stb_image 解码结果与光栅化结果一致");
+        }
+    }
+    return same;
+}
+
+static void BenchPng(const BenchOptions& options) {
+    const std::vector<int> versions = options.quick ? std::vector<int>{10, 40} : std::vector<int>{2, 10, 25, 40};
+    const int scales[] = {4, 16};
+    const int border = 4;
+
+    struct Mode {
+        const char* name;
+        int bitDepth;
+        qrcore::PngColorMode colorMode;
+        int level;
+    };
+    const Mode modes[] = {
+        {"gray1-z1", 1, qrcore::PngColorMode::Gray, 1},
+        {"gray1-z6", 1, qrcore::PngColorMode::Gray, 6},
+        {"gray1-z9", 1, qrcore::PngColorMode::Gray, 9},
+        {"gray8-z6", 8, qrcore::PngColorMode::Gray, 6},
+        {"pal1-z9", 1, qrcore::PngColorMode::Palette, 9},
+        {"pal8-z6", 8, qrcore::PngColorMode::Palette, 6},
+    };
+
+    fprintf(stderr, "\n[png] %d 次/用例 (p50 毫秒)\n", options.iterations);
+    fprintf(stderr, "%-5s %5s %-9s %10s %10s %12s  %s\n", "版本", "倍数", "方式", "p50(ms)", "字节", "像素内存", "校验");
+
+    for (int version : versions) {
+        qrtools::SyntheticCode code;
+        if (!qrtools::EncodeForVersion(version, qrcodegen::QrCode::Ecc::MEDIUM, (uint32_t)version, code)) {
+            continue;
+        }
+        qrcore::ModuleMatrix matrix = qrcore::ToModuleMatrix(*code.qr);
+
+        for (int scale : scales) {
+            std::string caseName = "v" + std::to_string(version) + "x" + std::to_string(scale);
+            qrcore::ImageFrame expected;
+            qrcore::RasterizeQr(matrix, scale, border, qrcore::PixelFormat::Lum, expected);
+
+            // 原方式
+            {
+                std::vector<double> samples;
+                size_t bytes = 0, pixelBytes = 0;
+                for (int i = 0; i < options.iterations; i++) {
+                    auto start = Clock::now();
+                    bytes = EncodeFullRgbPng(matrix, scale, border, 6, pixelBytes);
+                    samples.push_back(ElapsedMs(start));
+                }
+                LatencyStats stats = Summarize(samples);
+                char extra[160];
+                snprintf(extra, sizeof(extra), ",\"method\":\"rgb24-full\",\"bytes\":%zu,\"pixel_bytes\":%zu", bytes,
+                         pixelBytes);
+                EmitRecord("png", caseName, stats, extra);
+                fprintf(stderr, "%-5d %5d %-9s %10.3f %10zu %12zu  -\n", version, scale, "rgb24", stats.p50, bytes,
+                        pixelBytes);
+            }
+
+            for (const Mode& mode : modes) {
+                qrcore::PngOptions png;
+                png.bitDepth = mode.bitDepth;
+                png.colorMode = mode.colorMode;
+                png.deflateLevel = mode.level;
+
+                std::vector<double> samples;
+                std::vector<uint8_t> output;
+                for (int i = 0; i < options.iterations; i++) {
+                    output.clear();
+                    std::string error;
+                    auto start = Clock::now();
+                    bool ok = qrcore::WriteQrPng(matrix, scale, border, png, [&output](const uint8_t* data, size_t size) {
+                        output.insert(output.end(), data, data + size);
+                        return true;
+                    }, error);
+                    samples.push_back(ElapsedMs(start));
+                    if (!ok) {
+                        fprintf(stderr, "%s: %s\n", mode.name, error.c_str());
+                        Check(false, "WriteQrPng 成功");
+                        break;
+                    }
+                }
+                bool valid = CheckPng(output, expected, mode.name);
+
+                // 写出时只持有一条扫描行 (及重复行) 和固定大小的压缩缓冲区
+                size_t side = (size_t)expected.width;
+                size_t lineBytes = mode.bitDepth == 8 ? side : (side + 7) / 8;
+                size_t pixelBytes = lineBytes * 2 + 1;
+
+                LatencyStats stats = Summarize(samples);
+                char extra[200];
+                snprintf(extra, sizeof(extra), ",\"method\":\"%s\",\"bytes\":%zu,\"pixel_bytes\":%zu,\"valid\":%s",
+                         mode.name, output.size(), pixelBytes, valid ? "true" : "false");
+                EmitRecord("png", caseName, stats, extra);
+                fprintf(stderr, "%-5d %5d %-9s %10.3f %10zu %12zu  %s\n", version, scale, mode.name, stats.p50,
+                        output.size(), pixelBytes, valid ? "ok" : "失败");
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// vector: SVG / PDF 矢量导出
+//
+// 导出后用这里的小型光栅化器 (只覆盖导出用到的语法: SVG 的 M/H/V/Z 路径,
+// PDF 内容流的 q/Q/cm/rg/re/f) 按非整数的像素/模块比例重新画出,
+// 再按模块中心采样与模块矩阵比较, 并交给 ZXing 识别出原文。
+// ---------------------------------------------------------------------------
+
+struct VectorRect {
+    double x0, y0, x1, y1; // 设备坐标 (左上原点, 单位与页面一致)
+    uint8_t value;         // 填充灰度
+};
+
+// 把矩形按像素中心是否落在其中画进灰度帧 (scale: 像素 / 页面单位)
+static void PaintRects(const std::vector<VectorRect>& rects, double scale, qrcore::ImageFrame& frame) {
+    for (const VectorRect& r : rects) {
+        int px0 = std::max(0, (int)ceil(r.x0 * scale - 0.5));
+        int px1 = std::min(frame.width, (int)ceil(r.x1 * scale - 0.5));
+        int py0 = std::max(0, (int)ceil(r.y0 * scale - 0.5));
+        int py1 = std::min(frame.height, (int)ceil(r.y1 * scale - 0.5));
+        for (int y = py0; y < py1; y++) {
+            if (px1 > px0) {
+                memset(frame.row(y) + px0, r.value, (size_t)(px1 - px0));
+            }
+        }
+    }
+}
+
+// 取 from 之后第一个 fill="#rrggbb" 的 R 分量作为灰度
+static uint8_t SvgGray(const std::string& svg, size_t from) {
+    size_t pos = svg.find("fill=\"#", from);
+    return pos == std::string::npos ? 0 : (uint8_t)strtol(svg.substr(pos + 7, 2).c_str(), nullptr, 16);
+}
+
+static bool RasterizeSvg(const std::string& svg, double pxPerModule, qrcore::ImageFrame& outFrame, std::string& error) {
+    int total = 0;
+    size_t viewBox = svg.find("viewBox=\"0 0 ");
+    if (viewBox == std::string::npos || sscanf(svg.c_str() + viewBox + 13, "%d", &total) != 1 || total <= 0) {
+        error = "缺少 viewBox";
+        return false;
+    }
+    int side = (int)lround(total * pxPerModule);
+    outFrame = qrcore::AllocateFrame(side, side, qrcore::PixelFormat::Lum, 1);
+    for (int y = 0; y < side; y++) {
+        memset(outFrame.row(y), 0xFF, (size_t)side); // 无背景时按白纸处理
+    }
+
+    std::vector<VectorRect> rects;
+    size_t background = svg.find("<rect ");
+    if (background != std::string::npos) {
+        rects.push_back({0, 0, (double)total, (double)total, SvgGray(svg, background)});
+    }
+    size_t path = svg.find("<path ");
+    size_t d = svg.find(" d=\"", path);
+    if (path == std::string::npos || d == std::string::npos) {
+        error = "缺少 path";
+        return false;
+    }
+    uint8_t dark = SvgGray(svg, path);
+
+    // 每个子路径须是轴对齐矩形, 取其外接框
+    const char* p = svg.c_str() + d + 4;
+    double cx = 0, cy = 0;
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+    int vertices = 0;
+    while (*p && *p != '"') {
+        char op = *p++;
+        char* end = nullptr;
+        switch (op) {
+            case 'M':
+                cx = strtod(p, &end);
+                cy = strtod(end, &end);
+                minX = maxX = cx;
+                minY = maxY = cy;
+                vertices = 1;
+                break;
+            case 'h': cx += strtod(p, &end); break;
+            case 'H': cx = strtod(p, &end); break;
+            case 'v': cy += strtod(p, &end); break;
+            case 'V': cy = strtod(p, &end); break;
+            case 'z':
+            case 'Z':
+                if (vertices != 4) {
+                    error = "子路径不是矩形";
+                    return false;
+                }
+                rects.push_back({minX, minY, maxX, maxY, dark});
+                vertices = 0;
+                continue;
+            default:
+                error = std::string("不支持的路径命令: ") + op;
+                return false;
+        }
+        p = end;
+        if (op != 'M') {
+            vertices++;
+            minX = std::min(minX, cx);
+            maxX = std::max(maxX, cx);
+            minY = std::min(minY, cy);
+            maxY = std::max(maxY, cy);
+        }
+    }
+    PaintRects(rects, pxPerModule, outFrame);
+    return true;
+}
+
+static bool InflateAll(const uint8_t* data, size_t size, std::string& out) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK) {
+        return false;
+    }
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = (uInt)size;
+    char buffer[16384];
+    int ret;
+    do {
+        stream.next_out = (Bytef*)buffer;
+        stream.avail_out = sizeof(buffer);
+        ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END) {
+            inflateEnd(&stream);
+            return false;
+        }
+        out.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (ret != Z_STREAM_END);
+    inflateEnd(&stream);
+    return true;
+}
+
+// pxPerModule 换算为像素 / 点时需要模块数 (由调用方给出)
+static bool RasterizePdf(const std::string& pdf, int totalModules, double pxPerModule, qrcore::ImageFrame& outFrame,
+                         std::string& error) {
+    double pageW = 0, pageH = 0;
+    size_t mediaBox = pdf.find("/MediaBox [0 0 ");
+    if (mediaBox == std::string::npos || sscanf(pdf.c_str() + mediaBox + 15, "%lf %lf", &pageW, &pageH) != 2 ||
+        pageW <= 0 || pageW != pageH) {
+        error = "缺少 MediaBox";
+        return false;
+    }
+    size_t lengthPos = pdf.find("/Length ");
+    size_t streamPos = pdf.find("stream\n");
+    long length = 0;
+    if (lengthPos == std::string::npos || streamPos == std::string::npos ||
+        sscanf(pdf.c_str() + lengthPos + 8, "%ld", &length) != 1 || streamPos + 7 + length > pdf.size() ||
+        pdf.compare(streamPos + 7 + length, 10, "\nendstream") != 0) {
+        error = "内容流长度不符";
+        return false;
+    }
+    std::string content;
+    if (!InflateAll((const uint8_t*)pdf.data() + streamPos + 7, (size_t)length, content)) {
+        error = "内容流解压失败";
+        return false;
+    }
+
+    double scale = totalModules * pxPerModule / pageW; // 像素 / 点
+    int side = (int)lround(pageW * scale);
+    outFrame = qrcore::AllocateFrame(side, side, qrcore::PixelFormat::Lum, 1);
+    for (int y = 0; y < side; y++) {
+        memset(outFrame.row(y), 0xFF, (size_t)side);
+    }
+
+    // 只支持缩放 + 平移的变换矩阵 (b = c = 0)
+    double ctm[6] = {1, 0, 0, 1, 0, 0};
+    std::vector<std::array<double, 6>> saved;
+    std::vector<double> operands;
+    std::vector<VectorRect> path, fills;
+    uint8_t color = 0;
+    const char* p = content.c_str();
+    while (*p) {
+        while (*p == ' ' || *p == '\n' || *p == '\r') p++;
+        if (!*p) break;
+        if ((*p >= '0' && *p <= '9') || *p == '-' || *p == '.') {
+            char* end = nullptr;
+            operands.push_back(strtod(p, &end));
+            p = end;
+            continue;
+        }
+        std::string op;
+        while (*p && *p != ' ' && *p != '\n' && *p != '\r') op += *p++;
+        if (op == "q") {
+            saved.push_back({ctm[0], ctm[1], ctm[2], ctm[3], ctm[4], ctm[5]});
+        } else if (op == "Q") {
+            if (!saved.empty()) {
+                std::copy(saved.back().begin(), saved.back().end(), ctm);
+                saved.pop_back();
+            }
+        } else if (op == "cm" && operands.size() == 6) {
+            const double* m = operands.data();
+            if (m[1] != 0 || m[2] != 0) {
+                error = "不支持旋转 / 斜切变换";
+                return false;
+            }
+            double next[6] = {m[0] * ctm[0], 0, 0, m[3] * ctm[3], m[4] * ctm[0] + ctm[4], m[5] * ctm[3] + ctm[5]};
+            std::copy(next, next + 6, ctm);
+        } else if (op == "rg" && operands.size() == 3) {
+            color = (uint8_t)lround(operands[0] * 255);
+        } else if (op == "re" && operands.size() == 4) {
+            // 变换到页面坐标 (左下原点), 再翻转为左上原点的设备坐标
+            double xa = operands[0] * ctm[0] + ctm[4], xb = (operands[0] + operands[2]) * ctm[0] + ctm[4];
+            double ya = operands[1] * ctm[3] + ctm[5], yb = (operands[1] + operands[3]) * ctm[3] + ctm[5];
+            path.push_back({std::min(xa, xb), pageH - std::max(ya, yb), std::max(xa, xb), pageH - std::min(ya, yb), 0});
+        } else if (op == "f") {
+            for (VectorRect& rect : path) {
+                rect.value = color;
+                fills.push_back(rect);
+            }
+            path.clear();
+        } else {
+            error = "不支持的操作符: " + op;
+            return false;
+        }
+        operands.clear();
+    }
+    PaintRects(fills, scale, outFrame);
+    return true;
+}
+
+// 在模块中心采样, 与模块矩阵 (含静区) 比较
+static bool SampleMatchesMatrix(const qrcore::ImageFrame& frame, const qrcore::ModuleMatrix& matrix, int border) {
+    int total = matrix.size + 2 * border;
+    double step = (double)frame.width / total;
+    for (int my = 0; my < total; my++) {
+        for (int mx = 0; mx < total; mx++) {
+            int x = mx - border, y = my - border;
+            bool dark = x >= 0 && y >= 0 && x < matrix.size && y < matrix.size && matrix.get(x, y);
+            uint8_t value = frame.row((int)((my + 0.5) * step))[(int)((mx + 0.5) * step)];
+            if ((value < 128) != dark) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void BenchVector(const BenchOptions& options) {
+    const std::vector<int> versions = options.quick ? std::vector<int>{5, 40} : std::vector<int>{1, 5, 15, 25, 40};
+    const double pxPerModule[] = {2.0, 3.3};
+    qrcore::VectorOptions vector;
+    qrcore::CascadeConfig cascade = qrcore::DefaultCascade();
+    cascade.budgetMs = 0;
+
+    fprintf(stderr, "\n[vector] 导出耗时 (p50 毫秒) / 大小 (字节), 矩形数对比深色模块数; 光栅化后采样并识别\n");
+    fprintf(stderr, "%-5s %7s %7s %9s %9s %9s %9s %9s  %s\n", "版本", "深色", "矩形", "svg(ms)", "svg", "pdf(ms)",
+            "pdf", "png16x", "往返");
+
+    for (int version : versions) {
+        qrtools::SyntheticCode code;
+        if (!qrtools::EncodeForVersion(version, qrcodegen::QrCode::Ecc::MEDIUM, (uint32_t)version, code)) {
+            continue;
+        }
+        qrcore::ModuleMatrix matrix = qrcore::ToModuleMatrix(*code.qr);
+        size_t darkModules = 0;
+        for (uint8_t module : matrix.modules) {
+            darkModules += module;
+        }
+        size_t rectCount = qrcore::MergeModuleRects(matrix).size();
+
+        std::string svg, pdf, error;
+        std::vector<double> svgMs, pdfMs;
+        for (int i = 0; i < options.iterations; i++) {
+            auto start = Clock::now();
+            qrcore::BuildQrSvg(matrix, vector, svg, error);
+            svgMs.push_back(ElapsedMs(start));
+            start = Clock::now();
+            qrcore::BuildQrPdf(matrix, vector, pdf, error);
+            pdfMs.push_back(ElapsedMs(start));
+        }
+        size_t pngBytes = 0;
+        qrcore::WriteQrPng(matrix, 16, vector.border, qrcore::PngOptions(), [&pngBytes](const uint8_t*, size_t size) {
+            pngBytes += size;
+            return true;
+        }, error);
+
+        // 往返: 两种格式 × 两种像素比例, 采样与识别都须通过
+        int total = matrix.size + 2 * vector.border;
+        bool roundTrip = true;
+        for (int format = 0; format < 2; format++) {
+            for (double px : pxPerModule) {
+                qrcore::ImageFrame frame;
+                bool ok = format == 0 ? RasterizeSvg(svg, px, frame, error) : RasterizePdf(pdf, total, px, frame, error);
+                if (!ok) {
+                    fprintf(stderr, "v%d %s: %s\n", version, format == 0 ? "svg" : "pdf", error.c_str());
+                }
+                bool sampled = ok && SampleMatchesMatrix(frame, matrix, vector.border);
+                Check(sampled, "矢量导出光栅化后与模块矩阵一致");
+                qrcore::ScanResult result;
+                bool decoded = sampled && qrcore::RunCascade(frame, cascade, result) && result.text == code.text;
+                Check(decoded, "矢量导出光栅化后可被 ZXing 识别出原文");
+                roundTrip = roundTrip && sampled && decoded;
+            }
+        }
+
+        LatencyStats s = Summarize(svgMs);
+        LatencyStats p = Summarize(pdfMs);
+        std::string caseName = "v" + std::to_string(version);
+        char extra[200];
+        snprintf(extra, sizeof(extra), ",\"format\":\"svg\",\"bytes\":%zu,\"rects\":%zu,\"dark_modules\":%zu,"
+                 "\"round_trip\":%s", svg.size(), rectCount, darkModules, roundTrip ? "true" : "false");
+        EmitRecord("vector", caseName, s, extra);
+        snprintf(extra, sizeof(extra), ",\"format\":\"pdf\",\"bytes\":%zu,\"png16x_bytes\":%zu,\"round_trip\":%s",
+                 pdf.size(), pngBytes, roundTrip ? "true" : "false");
+        EmitRecord("vector", caseName, p, extra);
+        fprintf(stderr, "%-5d %7zu %7zu %9.3f %9zu %9.3f %9zu %9zu  %s\n", version, darkModules, rectCount, s.p50,
+                svg.size(), p.p50, pdf.size(), pngBytes, roundTrip ? "ok" : "失败");
+    }
+}
+
+// ---------------------------------------------------------------------------
+// live: 固定区域的连续扫码
+//
+// 合成帧来源按时间脚本返回画面: 空白 → 二维码 A 静止 → A 移动 → 二维码 B 静止 → 空白。
+// 统计每段的抓取间隔 (静止时应退避到上限, 移动时应保持最短间隔)、每个内容是否只报告一次,
+// 以及从内容出现到报告的延迟; 再用模拟的慢识别 (每帧额外等待) 检查抓取不被识别阻塞。
+// 先检查大码分两次绘制 (最后一次变化只覆盖码的一部分, 只识别变化区域找不到码) 时仍能报告。
+// ---------------------------------------------------------------------------
+
+class ScriptedFrameSource : public qrcore::IFrameSource {
+public:
+    struct Segment {
+        const char* name;
+        int durationMs;
+        int code;    // -1 为空白, 否则为 codes 的下标
+        bool moving; // 每次抓取换一个位置
+    };
+
+    ScriptedFrameSource(const std::vector<Segment>& script, const std::vector<qrtools::SyntheticCode>& codes)
+        : m_script(script) {
+        const int width = 640, height = 480, moduleSize = 4;
+        qrcore::ImageFrame blank = qrtools::MakeCanvas(width, height);
+        qrtools::FillClutter(blank, 1);
+        m_blank = qrtools::ToBGRX(blank);
+        for (const qrtools::SyntheticCode& code : codes) {
+            std::vector<qrcore::ImageFrame> positions;
+            for (int i = 0; i < 8; i++) {
+                qrcore::ImageFrame canvas = qrtools::MakeCanvas(width, height);
+                qrtools::FillClutter(canvas, 1);
+                qrtools::DrawQrCode(*code.qr, moduleSize, 40 + i * 24, 40 + i * 12, canvas);
+                positions.push_back(qrtools::ToBGRX(canvas));
+            }
+            m_frames.push_back(positions);
+        }
+    }
+
+    void Begin() {
+        m_start = Clock::now();
+        m_captures.clear();
+    }
+
+    double TotalMs() const {
+        int total = 0;
+        for (const Segment& segment : m_script) {
+            total += segment.durationMs;
+        }
+        return total;
+    }
+
+    // 时间点所在的段 (超出脚本时为最后一段)
+    size_t SegmentAt(double ms) const {
+        for (size_t i = 0; i < m_script.size(); i++) {
+            if (ms < m_script[i].durationMs) {
+                return i;
+            }
+            ms -= m_script[i].durationMs;
+        }
+        return m_script.size() - 1;
+    }
+
+    double SegmentStartMs(size_t index) const {
+        double ms = 0;
+        for (size_t i = 0; i < index; i++) {
+            ms += m_script[i].durationMs;
+        }
+        return ms;
+    }
+
+    bool Capture(qrcore::ImageFrame& outFrame, std::string&) override {
+        double ms = ElapsedMs(m_start);
+        const Segment& segment = m_script[SegmentAt(ms)];
+        if (segment.code < 0) {
+            outFrame = m_blank;
+        } else {
+            const std::vector<qrcore::ImageFrame>& positions = m_frames[segment.code];
+            // 移动时不使用静止位置 0, 保证进入移动段的第一帧就有变化
+            outFrame = positions[segment.moving ? 1 + m_captures.size() % (positions.size() - 1) : 0];
+        }
+        m_captures.push_back(ms);
+        return true;
+    }
+
+    // 抓取时刻 (毫秒, 只在抓取线程停止后读取)
+    const std::vector<double>& Captures() const { return m_captures; }
+
+private:
+    std::vector<Segment> m_script;
+    qrcore::ImageFrame m_blank;
+    std::vector<std::vector<qrcore::ImageFrame>> m_frames; // 预先生成, 只读共享给识别线程
+    Clock::time_point m_start;
+    std::vector<double> m_captures;
+};
+
+static qrcore::ImageFrame CopyFrame(const qrcore::ImageFrame& frame) {
+    qrcore::ImageFrame copy = qrcore::AllocateFrame(frame.width, frame.height, frame.format);
+    size_t rowBytes = (size_t)frame.width * qrcore::BytesPerPixel(frame.format);
+    for (int y = 0; y < frame.height; y++) {
+        memcpy(copy.row(y), frame.row(y), rowBytes);
+    }
+    return copy;
+}
+
+// 按时间依次返回固定画面的帧来源 (最后一帧一直保持)
+class SequenceFrameSource : public qrcore::IFrameSource {
+public:
+    struct Step {
+        int durationMs;
+        qrcore::ImageFrame frame;
+    };
+
+    explicit SequenceFrameSource(std::vector<Step> steps) : m_steps(std::move(steps)), m_start(Clock::now()) {}
+
+    bool Capture(qrcore::ImageFrame& outFrame, std::string&) override {
+        double ms = ElapsedMs(m_start);
+        size_t i = 0;
+        while (i + 1 < m_steps.size() && ms >= m_steps[i].durationMs) {
+            ms -= m_steps[i].durationMs;
+            i++;
+        }
+        outFrame = m_steps[i].frame;
+        return true;
+    }
+
+private:
+    std::vector<Step> m_steps;
+    Clock::time_point m_start;
+};
+
+static void CheckLivePartialRedraw() {
+    qrtools::SyntheticCode code;
+    if (!qrtools::EncodeText("https://docs.example.com/share/partial-redraw", qrcodegen::QrCode::Ecc::MEDIUM, code)) {
+        Check(false, "生成连续扫码的测试二维码");
+        return;
+    }
+    // 1280x960 中的大码 (约 400 像素见方): 先出现上 60%, 再补全下 40%。
+    // 补全时的变化区域加上 roiMargin 仍不到整帧的一半, 只识别该区域时码不完整
+    const int width = 1280, height = 960, moduleSize = 10, left = 200, top = 150;
+    qrcore::ImageFrame blank = qrtools::MakeCanvas(width, height);
+    qrtools::FillClutter(blank, 2);
+    qrcore::ImageFrame full = qrtools::MakeCanvas(width, height);
+    qrtools::FillClutter(full, 2);
+    qrtools::DrawQrCode(*code.qr, moduleSize, left, top, full);
+    qrcore::ImageFrame partial = CopyFrame(blank);
+    int total = (code.qr->getSize() + 8) * moduleSize;
+    for (int y = top; y < top + total * 6 / 10; y++) {
+        memcpy(partial.row(y), full.row(y), (size_t)width);
+    }
+
+    SequenceFrameSource source({{150, qrtools::ToBGRX(blank)}, {300, qrtools::ToBGRX(partial)}, {0, qrtools::ToBGRX(full)}});
+    qrcore::LiveScanner scanner(source);
+    qrcore::LiveScanConfig config;
+    config.cascade = qrcore::DefaultCascade();
+    config.minIntervalMs = 20;
+    config.maxIntervalMs = 100;
+
+    std::mutex mutex;
+    std::vector<std::string> emitted;
+    scanner.Start(config, [&](std::unique_ptr<qrcore::LiveScanEvent> event) {
+        std::lock_guard<std::mutex> lock(mutex);
+        emitted.push_back(event->symbol.text);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    scanner.Stop();
+    qrcore::LiveScanStats stats = scanner.GetStats();
+
+    int count = 0;
+    for (const std::string& text : emitted) {
+        count += text == code.text ? 1 : 0;
+    }
+    Check(count == 1, "最后一次变化只覆盖大码的一部分时仍报告该码");
+    fprintf(stderr, "[live] 分两次绘制的大码: 识别 %llu (只识别变化区域 %llu), 整帧重试 %llu, 报告 %llu\n",
+            (unsigned long long)stats.decoded, (unsigned long long)stats.roiDecoded,
+            (unsigned long long)stats.retried, (unsigned long long)stats.emitted);
+}
+
+static void BenchLive(const BenchOptions& options) {
+    CheckLivePartialRedraw();
+
+    std::vector<qrtools::SyntheticCode> codes(2);
+    if (!qrtools::EncodeText("https://meet.example.com/j/4815162342", qrcodegen::QrCode::Ecc::MEDIUM, codes[0]) ||
+        !qrtools::EncodeText("WIFI:T:WPA;S:office;P:correct horse;;", qrcodegen::QrCode::Ecc::MEDIUM, codes[1])) {
+        Check(false, "生成连续扫码的测试二维码");
+        return;
+    }
+    int scale = options.quick ? 1 : 2;
+    std::vector<ScriptedFrameSource::Segment> script = {
+        {"blank", 500 * scale, -1, false},
+        {"A-static", 1000 * scale, 0, false},
+        {"A-moving", 600 * scale, 0, true},
+        {"B-static", 1000 * scale, 1, false},
+        {"blank-end", 400 * scale, -1, false},
+    };
+
+    qrcore::LiveScanConfig config;
+    config.cascade = qrcore::DefaultCascade();
+    config.minIntervalMs = 50;
+    config.maxIntervalMs = 200;
+
+    struct Mode {
+        const char* name;
+        int extraDecodeMs; // 模拟慢识别: 每帧额外等待的时间
+    };
+    const Mode modes[] = {{"normal", 0}, {"slow-decode", 300}};
+
+    fprintf(stderr, "\n[live] 抓取间隔 %d~%d ms (毫秒; 间隔为该段内相邻抓取之差)\n", config.minIntervalMs,
+            config.maxIntervalMs);
+    fprintf(stderr, "%-12s %-10s %7s %10s %10s %10s\n", "识别", "段", "抓取", "间隔 p50", "间隔 max", "报告延迟");
+
+    for (const Mode& mode : modes) {
+        ScriptedFrameSource source(script, codes);
+        qrcore::LiveScanner scanner(source);
+        if (mode.extraDecodeMs > 0) {
+            int extraMs = mode.extraDecodeMs;
+            scanner.SetDecoder([extraMs](const qrcore::ImageFrame& frame, const qrcore::CascadeConfig& cascade,
+                                         qrcore::ScanResult& result) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(extraMs));
+                qrcore::RunCascade(frame, cascade, result);
+            });
+        }
+
+        struct Emitted {
+            std::string text;
+            double atMs;
+        };
+        std::mutex mutex;
+        std::vector<Emitted> emitted;
+        std::atomic<bool> stopped(false);
+        std::atomic<int> lateCallbacks(0);
+
+        source.Begin();
+        auto start = Clock::now();
+        scanner.Start(config, [&](std::unique_ptr<qrcore::LiveScanEvent> event) {
+            if (stopped) {
+                lateCallbacks++;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            emitted.push_back({event->symbol.text, ElapsedMs(start)});
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds((int)source.TotalMs()));
+        scanner.Stop();
+        stopped = true;
+        qrcore::LiveScanStats stats = scanner.GetStats();
+        Check(lateCallbacks == 0, "Stop() 之后没有回调");
+
+        // 每个内容恰好报告一次
+        for (const qrtools::SyntheticCode& code : codes) {
+            int count = 0;
+            for (const Emitted& e : emitted) {
+                count += e.text == code.text ? 1 : 0;
+            }
+            Check(count == 1, "连续扫码中每个内容只报告一次");
+        }
+
+        // 按段统计抓取间隔
+        const std::vector<double>& captures = source.Captures();
+        std::vector<std::vector<double>> intervals(script.size());
+        for (size_t i = 1; i < captures.size(); i++) {
+            size_t segment = source.SegmentAt(captures[i - 1]);
+            if (segment == source.SegmentAt(captures[i])) {
+                intervals[segment].push_back(captures[i] - captures[i - 1]);
+            }
+        }
+
+        for (size_t s = 0; s < script.size(); s++) {
+            const ScriptedFrameSource::Segment& segment = script[s];
+            LatencyStats interval = Summarize(intervals[s]);
+            // 该段内容出现到被报告的延迟 (只统计带二维码且内容首次出现的段)
+            double reportMs = -1;
+            if (segment.code >= 0 && !segment.moving) {
+                for (const Emitted& e : emitted) {
+                    if (e.text == codes[segment.code].text) {
+                        reportMs = e.atMs - source.SegmentStartMs(s);
+                    }
+                }
+            }
+            if (segment.moving) {
+                // 移动时每次抓取都有变化; 慢识别也不应拉长抓取间隔
+                Check(interval.count > 0 && interval.p50 < config.minIntervalMs * 1.5,
+                      "画面变化时保持最短抓取间隔 (不被识别阻塞)");
+            } else if (segment.durationMs >= 4 * config.maxIntervalMs) {
+                // 足够长的静止段: 从段内第一次抓取起逐级退避, 应能达到上限
+                Check(interval.count > 0 && interval.max >= config.maxIntervalMs * 0.9,
+                      "画面不变时抓取间隔退避到上限");
+            }
+
+            char extra[200];
+            snprintf(extra, sizeof(extra), ",\"decoder\":\"%s\",\"captures\":%zu,\"report_ms\":%.1f", mode.name,
+                     intervals[s].size() + 1, reportMs);
+            EmitRecord("live", std::string(mode.name) + "/" + segment.name, interval, extra);
+            fprintf(stderr, "%-12s %-10s %7zu %10.1f %10.1f %10.1f\n", mode.name, segment.name,
+                    intervals[s].size() + 1, interval.p50, interval.max, reportMs);
+        }
+        fprintf(stderr, "%-12s 共抓取 %llu, 变化 %llu, 识别 %llu, 被覆盖 %llu, 报告 %llu\n", mode.name,
+                (unsigned long long)stats.captured, (unsigned long long)stats.changed,
+                (unsigned long long)stats.decoded, (unsigned long long)stats.superseded,
+                (unsigned long long)stats.emitted);
+        if (mode.extraDecodeMs > 0) {
+            Check(stats.superseded > 0, "识别较慢时旧帧被新帧覆盖");
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// change: 分块哈希的画面变化检测
+//
+// 先检查: 各 SIMD 级别的分块哈希与标量一致; 相同帧判为未变化; 单个像素的变化
+// 只影响它所在的分块, 变化区域为该分块; 尺寸变化视为整帧变化。
+// 再测量 1080p / 4K 帧每帧的检测耗时 (各 SIMD 级别 × 分块边长), 对比保留上一帧副本
+// 逐字节比较 (memcpy + memcmp) 的耗时, 以及整帧识别与只识别变化区域的耗时。
+// ---------------------------------------------------------------------------
+
+static std::vector<qrcore::SimdLevel> SupportedSimdLevels() {
+    std::vector<qrcore::SimdLevel> levels = {qrcore::SimdLevel::Scalar};
+    qrcore::SimdLevel detected = qrcore::DetectSimdLevel();
+    if (detected >= qrcore::SimdLevel::SSE2) {
+        levels.push_back(qrcore::SimdLevel::SSE2);
+    }
+    if (detected >= qrcore::SimdLevel::AVX2) {
+        levels.push_back(qrcore::SimdLevel::AVX2);
+    }
+    return levels;
+}
+
+static void CheckChangeDetector() {
+    // 奇数宽高, 含不足一块的边缘分块和不足 32 字节的段尾
+    qrcore::ImageFrame lum = qrtools::MakeCanvas(1001, 517);
+    qrtools::FillClutter(lum, 5);
+    qrcore::ImageFrame bgrx = qrtools::ToBGRX(lum);
+    for (const qrcore::ImageFrame* frame : {&lum, &bgrx}) {
+        for (int tileSize : {16, 64, 100}) {
+            std::vector<uint64_t> reference, hashes;
+            qrcore::HashTiles(qrcore::SimdLevel::Scalar, *frame, tileSize, reference);
+            for (qrcore::SimdLevel level : SupportedSimdLevels()) {
+                qrcore::HashTiles(level, *frame, tileSize, hashes);
+                Check(hashes == reference, "各 SIMD 级别的分块哈希与标量一致");
+            }
+        }
+    }
+
+    qrcore::ChangeDetector detector(64);
+    qrcore::ChangeResult first = detector.Update(bgrx);
+    Check(first.changed && first.reset && first.width == bgrx.width, "首帧视为整帧变化");
+
+    qrcore::ImageFrame copy = CopyFrame(bgrx);
+    qrcore::ChangeResult same = detector.Update(copy);
+    Check(!same.changed && same.changedTiles == 0 && same.width == 0, "相同帧判为未变化");
+
+    // 单个像素 (最后一块的右下角, 该块不足 64 像素)
+    copy.row(516)[1000 * 4] ^= 1;
+    qrcore::ChangeResult pixel = detector.Update(copy);
+    Check(pixel.changed && pixel.changedTiles == 1 && pixel.left == 960 && pixel.top == 512 &&
+          pixel.width == 41 && pixel.height == 5, "单个像素的变化只影响所在分块");
+
+    // 两处变化: 变化区域为两块的外接矩形
+    copy.row(10)[70 * 4 + 1] ^= 0x80;
+    copy.row(300)[500 * 4 + 2] ^= 0x80;
+    qrcore::ChangeResult two = detector.Update(copy);
+    Check(two.changedTiles == 2 && two.left == 64 && two.top == 0 && two.width == 512 - 64 &&
+          two.height == 320, "多处变化的区域为外接矩形");
+
+    qrcore::ChangeResult resized = detector.Update(CopyFrame(qrcore::CropFrame(copy, 0, 0, 1000, 517)));
+    Check(resized.reset && resized.changed, "尺寸变化视为整帧变化");
+}
+
+static void BenchChange(const BenchOptions& options) {
+    CheckChangeDetector();
+
+    struct Size {
+        const char* name;
+        int width;
+        int height;
+    };
+    const Size sizes[] = {{"1080p", 1920, 1080}, {"4k", 3840, 2160}};
+    const int tileSizes[] = {32, 64, 128};
+    qrcore::SimdLevel savedLevel = qrcore::ActiveSimdLevel();
+
+    fprintf(stderr, "\n[change] 每帧变化检测耗时 (毫秒), %d 次/用例\n", options.iterations);
+    fprintf(stderr, "%-6s %-14s %6s %10s %10s %9s\n", "尺寸", "方式", "分块", "p50", "p95", "GB/s");
+
+    for (const Size& size : sizes) {
+        qrcore::ImageFrame lum = qrtools::MakeCanvas(size.width, size.height);
+        qrtools::FillClutter(lum, 9);
+        qrcore::ImageFrame frame = qrtools::ToBGRX(lum);
+        lum = qrcore::ImageFrame();
+        double gigabytes = (double)frame.width * frame.height * 4 / 1e9;
+
+        auto emit = [&](const std::string& method, int tileSize, const std::vector<double>& samples) {
+            LatencyStats stats = Summarize(samples);
+            double gbps = stats.p50 > 0 ? gigabytes / (stats.p50 / 1000.0) : 0;
+            char extra[160];
+            snprintf(extra, sizeof(extra), ",\"method\":\"%s\",\"tile\":%d,\"gbps\":%.2f", method.c_str(), tileSize, gbps);
+            EmitRecord("change", std::string(size.name) + "/" + method + "/" + std::to_string(tileSize), stats, extra);
+            fprintf(stderr, "%-6s %-14s %6d %10.3f %10.3f %9.2f\n", size.name, method.c_str(), tileSize, stats.p50,
+                    stats.p95, gbps);
+        };
+
+        // 相同帧 (静止画面的常态): 每帧完整哈希一遍再逐块比较
+        for (qrcore::SimdLevel level : SupportedSimdLevels()) {
+            qrcore::SetSimdLevel(level);
+            for (int tileSize : tileSizes) {
+                qrcore::ChangeDetector detector(tileSize);
+                detector.Update(frame);
+                std::vector<double> samples;
+                for (int i = 0; i < options.iterations; i++) {
+                    auto start = Clock::now();
+                    qrcore::ChangeResult result = detector.Update(frame);
+                    samples.push_back(ElapsedMs(start));
+                    Check(!result.changed, "相同帧判为未变化");
+                }
+                emit(std::string("tiles-") + qrcore::SimdLevelName(level), tileSize, samples);
+            }
+        }
+        qrcore::SetSimdLevel(savedLevel);
+
+        // 对照: 保留上一帧副本, 逐字节比较后复制为新的基准
+        {
+            qrcore::ImageFrame previous = CopyFrame(frame);
+            size_t bytes = frame.byteSize();
+            std::vector<double> samples;
+            for (int i = 0; i < options.iterations; i++) {
+                auto start = Clock::now();
+                bool same = memcmp(previous.data, frame.data, bytes) == 0;
+                memcpy(previous.data, frame.data, bytes);
+                samples.push_back(ElapsedMs(start));
+                Check(same, "逐字节比较: 相同帧");
+            }
+            emit("memcmp-copy", 0, samples);
+        }
+
+        // 变化检测节省的识别: 整帧识别 / 只识别含二维码的变化区域 (与连续扫码相同的扩展方式)
+        {
+            qrtools::SyntheticCode code;
+            qrtools::EncodeText("https://dash.example.com/alert/2718", qrcodegen::QrCode::Ecc::MEDIUM, code);
+            qrcore::ImageFrame canvas = qrtools::MakeCanvas(size.width, size.height);
+            qrtools::FillClutter(canvas, 9);
+            int left = size.width / 2, top = size.height / 3;
+            qrtools::DrawQrCode(*code.qr, 4, left, top, canvas);
+            qrcore::ImageFrame changed = qrtools::ToBGRX(canvas);
+
+            qrcore::ChangeDetector detector(64);
+            detector.Update(frame);
+            qrcore::ChangeResult change = detector.Update(changed);
+            const int margin = qrcore::LiveScanConfig().roiMargin;
+            qrcore::ImageFrame roi = qrcore::CropFrame(changed, change.left - margin, change.top - margin,
+                                                       change.width + 2 * margin, change.height + 2 * margin);
+            qrcore::CascadeConfig cascade = qrcore::DefaultCascade();
+            int decodeIterations = std::max(1, options.iterations / 4);
+            std::vector<double> fullMs, roiMs;
+            bool fullOk = true, roiOk = true;
+            for (int i = 0; i < decodeIterations; i++) {
+                qrcore::ScanResult full, part;
+                auto start = Clock::now();
+                fullOk = qrcore::RunCascade(changed, cascade, full) && full.text == code.text && fullOk;
+                fullMs.push_back(ElapsedMs(start));
+                start = Clock::now();
+                roiOk = qrcore::RunCascade(roi, cascade, part) && part.text == code.text && roiOk;
+                roiMs.push_back(ElapsedMs(start));
+            }
+            Check(roiOk, "只识别变化区域即可识别出新出现的二维码");
+            char extra[200];
+            snprintf(extra, sizeof(extra), ",\"method\":\"decode-full\",\"ok\":%s", fullOk ? "true" : "false");
+            EmitRecord("change", std::string(size.name) + "/decode-full", Summarize(fullMs), extra);
+            snprintf(extra, sizeof(extra), ",\"method\":\"decode-roi\",\"ok\":%s,\"roi\":[%d,%d],\"changed_tiles\":%d",
+                     roiOk ? "true" : "false", roi.width, roi.height, change.changedTiles);
+            EmitRecord("change", std::string(size.name) + "/decode-roi", Summarize(roiMs), extra);
+            fprintf(stderr, "%-6s 识别: 整帧 p50 %.2f ms, 变化区域 %dx%d (%d 块) p50 %.2f ms\n", size.name,
+                    Summarize(fullMs).p50, roi.width, roi.height, change.changedTiles, Summarize(roiMs).p50);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// cache: 识别结果缓存
+//
+// 先检查: 相同画面无论像素格式都得到相同的键; 命中时内容与识别结果一致; 识别模式不同不命中;
+// 选区偏移几个像素时只在允许感知距离时命中, 且经确认后才采用; 同一位置换成另一个码时
+// 感知距离很小, 必须被确认步骤拒绝; 条目数不超过上限; 写入文件后重新加载仍命中,
+// 文件损坏时整体丢弃。
+// 再对比同一画面 (选区 / 1080p / 4K) 识别与计算键并命中缓存的耗时:
+//   cascade  默认级联 (单码模式, ScanImageForQR 原先每次执行的部分)
+//   harder   直接加强识别 (快速识别失败后的层级)
+//   key      计算缓存键 (灰度转换 + 哈希)
+//   hit      计算缓存键 + 查找命中
+// ---------------------------------------------------------------------------
+
+static void CheckDecodeResultCache() {
+    qrtools::SyntheticCode code, other;
+    qrtools::EncodeText("WIFI:T:WPA;S:office-5G;P:correct horse battery staple;;", qrcodegen::QrCode::Ecc::MEDIUM, code);
+    qrtools::EncodeText("https://meet.example.com/j/8812345678?pwd=Zm9vYmFy", qrcodegen::QrCode::Ecc::MEDIUM, other);
+    qrcore::ImageFrame canvas = qrtools::MakeCanvas(640, 640);
+    qrtools::FillClutter(canvas, 3);
+    qrtools::DrawQrCode(*code.qr, 6, 120, 120, canvas);
+    qrcore::ImageFrame lum = qrcore::CropFrame(canvas, 40, 40, 480, 480);
+    qrcore::ImageFrame bgrx = qrtools::ToBGRX(lum);
+
+    qrcore::DecodeCacheKey lumKey, key;
+    Check(qrcore::MakeDecodeCacheKey(lum, 1, lumKey) && qrcore::MakeDecodeCacheKey(bgrx, 1, key),
+          "缓存键: 计算成功");
+    Check(lumKey.exact == key.exact && lumKey.perceptual == key.perceptual, "缓存键: 与像素格式无关");
+
+    qrcore::ScanResult decoded;
+    decoded.success = true;
+    decoded.tier = "harder";
+    qrcore::DecodedSymbol symbol;
+    symbol.text = code.text;
+    symbol.format = "QRCode";
+    // 静区 4 模块 × 6 像素: 码在裁剪后的选区中从 (104, 104) 开始
+    int codeEnd = 104 + code.qr->getSize() * 6;
+    symbol.position.topLeft = {104, 104};
+    symbol.position.topRight = {codeEnd, 104};
+    symbol.position.bottomRight = {codeEnd, codeEnd};
+    symbol.position.bottomLeft = {104, codeEnd};
+    decoded.symbols.push_back(symbol);
+    qrcore::FinishResult(decoded);
+
+    qrcore::DecodeResultCache cache;
+    qrcore::ScanResult hit;
+    Check(!cache.Lookup(key, hit), "空缓存不命中");
+    cache.Insert(key, decoded);
+    Check(cache.Lookup(key, hit) && hit.cached && hit.text == code.text && hit.symbols.size() == 1 &&
+          hit.symbols[0].position.bottomRight.x == codeEnd, "精确命中, 内容与识别结果一致");
+
+    qrcore::DecodeCacheKey modeKey;
+    qrcore::MakeDecodeCacheKey(bgrx, 0, modeKey);
+    Check(!cache.Lookup(modeKey, hit), "识别模式不同不命中");
+
+    // 重新框选: 选区偏移 3 像素、宽高各差 4 像素
+    qrcore::ImageFrame shifted = qrtools::ToBGRX(qrcore::CropFrame(canvas, 43, 37, 484, 476));
+    qrcore::DecodeCacheKey shiftedKey;
+    qrcore::MakeDecodeCacheKey(shifted, 1, shiftedKey);
+    // 同一位置换成另一个码
+    qrcore::ImageFrame otherCanvas = qrtools::MakeCanvas(640, 640);
+    qrtools::FillClutter(otherCanvas, 3);
+    qrtools::DrawQrCode(*other.qr, 6, 120, 120, otherCanvas);
+    qrcore::DecodeCacheKey otherKey;
+    qrcore::MakeDecodeCacheKey(qrtools::ToBGRX(qrcore::CropFrame(otherCanvas, 40, 40, 480, 480)), 1, otherKey);
+    int shiftedDistance = qrcore::HammingDistance(key.perceptual, shiftedKey.perceptual);
+    int otherDistance = qrcore::HammingDistance(key.perceptual, otherKey.perceptual);
+    fprintf(stderr, "[cache] 感知距离: 选区偏移 %d, 另一个码 %d\n", shiftedDistance, otherDistance);
+
+    Check(!cache.Lookup(shiftedKey, hit), "不允许感知距离时, 偏移的选区不命中");
+    qrcore::DecodeCacheConfig fuzzy;
+    fuzzy.maxDistance = std::max(shiftedDistance, otherDistance);
+    cache.Configure(fuzzy);
+    qrcore::CascadeConfig cascade = qrcore::DefaultCascade();
+    qrcore::DecodeCacheHit how;
+    Check(cache.Lookup(shiftedKey, hit, &how) && how.fuzzy && how.tier == "harder" &&
+          qrcore::VerifyCachedResult(shifted, how.tier, cascade, hit) && hit.text == code.text,
+          "允许感知距离时, 偏移的选区命中并通过确认");
+    qrcore::ImageFrame otherFrame = qrtools::ToBGRX(qrcore::CropFrame(otherCanvas, 40, 40, 480, 480));
+    Check(!cache.Lookup(otherKey, hit, &how) || !qrcore::VerifyCachedResult(otherFrame, how.tier, cascade, hit),
+          "同一位置换成另一个码时, 感知命中被确认步骤拒绝");
+
+    // 持久化: 写入后重新加载仍命中; 文件损坏时整体丢弃
+    std::string path = (std::filesystem::temp_directory_path() / "qrbench_resultcache.bin").string();
+    std::string errorMsg;
+    Check(cache.SaveFile(path, errorMsg) && !cache.IsDirty(), "写入缓存文件");
+    qrcore::DecodeResultCache reloaded;
+    Check(reloaded.LoadFile(path, errorMsg), "加载缓存文件");
+    Check(reloaded.Lookup(key, hit) && hit.text == code.text && hit.symbols[0].position.topLeft.y == 104,
+          "重新加载后精确命中");
+    std::vector<uint8_t> data;
+    reloaded.Serialize(data);
+    data[data.size() / 2] ^= 0x40;
+    Check(!reloaded.Deserialize(data.data(), data.size(), errorMsg) && reloaded.GetStats().entries == 0,
+          "损坏的缓存数据整体丢弃");
+    std::filesystem::remove(path);
+
+    // 替换失败 (目标是非空目录): 返回 false, 保留 dirty 以便下次重试, 不留下临时文件
+    std::filesystem::create_directories(std::filesystem::path(path) / "occupied");
+    cache.Insert(otherKey, decoded);
+    Check(!cache.SaveFile(path, errorMsg) && cache.IsDirty() && !std::filesystem::exists(path + ".tmp"),
+          "替换缓存文件失败时保留 dirty 且不留下临时文件");
+    std::filesystem::remove_all(path);
+
+    // 容量上限: 最近使用的条目保留, 最早的被淘汰
+    qrcore::DecodeCacheConfig small;
+    small.capacity = 8;
+    qrcore::DecodeResultCache bounded(small);
+    for (int i = 0; i < 20; i++) {
+        qrcore::DecodeCacheKey k = key;
+        k.exact = key.exact + i;
+        bounded.Insert(k, decoded);
+    }
+    qrcore::DecodeCacheKey oldest = key, newest = key;
+    newest.exact = key.exact + 19;
+    Check(bounded.GetStats().entries == 8 && !bounded.Lookup(oldest, hit) && bounded.Lookup(newest, hit),
+          "条目数不超过上限, 按最近使用淘汰");
+}
+
+static void BenchResultCache(const BenchOptions& options) {
+    CheckDecodeResultCache();
+
+    struct Case {
+        const char* name;
+        int width;
+        int height;
+        int moduleSize;
+    };
+    const Case cases[] = {{"selection", 480, 480, 6}, {"1080p", 1920, 1080, 4}, {"4k", 3840, 2160, 4}};
+    qrcore::CascadeConfig cascade = qrcore::DefaultCascade();
+    cascade.maxSymbols = 1;
+    qrcore::CascadeConfig harder;
+    std::string errorMsg;
+    qrcore::ParseCascade("harder", cascade.budgetMs, harder, errorMsg);
+    harder.maxSymbols = 1;
+
+    fprintf(stderr, "\n[cache] 同一画面再次扫描的耗时 (p50 毫秒)\n");
+    fprintf(stderr, "%-10s %10s %10s %10s %10s %10s\n", "画面", "cascade", "harder", "key", "hit", "加速");
+
+    for (const Case& c : cases) {
+        qrtools::SyntheticCode code;
+        qrtools::EncodeText("WIFI:T:WPA;S:office-5G;P:correct horse battery staple;;", qrcodegen::QrCode::Ecc::MEDIUM,
+                            code);
+        qrcore::ImageFrame frame = qrtools::ToBGRX(qrtools::RenderSample(code, c.moduleSize, c.width, c.height, true));
+
+        std::vector<double> cascadeMs, harderMs, keyMs, hitMs;
+        int decodeIterations = std::max(1, options.iterations / 4);
+        qrcore::ScanResult decoded;
+        for (int i = 0; i < decodeIterations; i++) {
+            decoded = qrcore::ScanResult();
+            auto start = Clock::now();
+            qrcore::RunCascade(frame, cascade, decoded);
+            cascadeMs.push_back(ElapsedMs(start));
+            qrcore::ScanResult hard;
+            start = Clock::now();
+            qrcore::RunCascade(frame, harder, hard);
+            harderMs.push_back(ElapsedMs(start));
+        }
+        if (!decoded.success) {
+            // 识别失败时仍测量命中路径 (缓存只关心键, 不关心内容来源)
+            decoded.success = true;
+            decoded.symbols.assign(1, qrcore::DecodedSymbol());
+            decoded.symbols[0].text = code.text;
+            qrcore::FinishResult(decoded);
+        }
+
+        qrcore::DecodeResultCache cache;
+        qrcore::DecodeCacheKey key;
+        qrcore::MakeDecodeCacheKey(frame, 1, key);
+        cache.Insert(key, decoded);
+        bool allHit = true;
+        for (int i = 0; i < options.iterations; i++) {
+            auto start = Clock::now();
+            qrcore::DecodeCacheKey k;
+            qrcore::MakeDecodeCacheKey(frame, 1, k);
+            keyMs.push_back(ElapsedMs(start));
+            qrcore::ScanResult hit;
+            allHit = cache.Lookup(k, hit) && hit.text == decoded.text && allHit;
+            hitMs.push_back(ElapsedMs(start));
+        }
+        Check(allHit, "同一画面每次都命中");
+
+        LatencyStats d = Summarize(cascadeMs);
+        LatencyStats t = Summarize(harderMs);
+        LatencyStats k = Summarize(keyMs);
+        LatencyStats h = Summarize(hitMs);
+        // 加速比按加强识别计算: 反复扫描的码多是快速识别不了、需要逐级加强的码
+        double speedup = h.p50 > 0 ? t.p50 / h.p50 : 0;
+        Check(speedup >= 10, "命中缓存比加强识别快至少一个数量级");
+        EmitRecord("cache", std::string(c.name) + "/cascade", d, ",\"method\":\"cascade\"");
+        EmitRecord("cache", std::string(c.name) + "/harder", t, ",\"method\":\"harder\"");
+        EmitRecord("cache", std::string(c.name) + "/key", k, ",\"method\":\"key\"");
+        char extra[120];
+        snprintf(extra, sizeof(extra), ",\"method\":\"hit\",\"speedup\":%.1f", speedup);
+        EmitRecord("cache", std::string(c.name) + "/hit", h, extra);
+        fprintf(stderr, "%-10s %10.3f %10.3f %10.3f %10.3f %9.0fx\n", c.name, d.p50, t.p50, k.p50, h.p50, speedup);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// history: 扫描历史 (只追加日志 + 三元组索引)
+//
+// 合成数万条记录 (网址、Wi-Fi 配置、订单号、付款码等混合), 先检查: 查询结果与逐条比较的
+// 结果一致 (含大小写不同、短于 3 字节、增量部分中的记录); 日志末尾写了一半的记录在重新打开时
+// 被截掉, 索引仍可用; 删除索引后从日志重建; 索引正文 (偏移表、三元组表) 损坏而索引头完好时,
+// 读取或查询时发现越界并从日志重建, 结果仍正确。再计时:
+//   append   每条追加 (含每 4096 条合并一次索引)
+//   open     有索引时打开 (只核对索引头与最后一条记录)
+//   rebuild  删除索引后打开 (解析全部日志并重建索引)
+//   search   各查询经索引的耗时, 对比逐条读取记录比较 (linear)
+// ---------------------------------------------------------------------------
+
+static std::string MakeHistoryText(size_t i) {
+    uint32_t h = (uint32_t)i * 2654435761u;
+    char text[160];
+    switch (i % 5) {
+        case 0:
+            snprintf(text, sizeof(text), "https://shop.example.com/item/%u?ref=qr&campaign=%u", h % 1000000, h >> 24);
+            break;
+        case 1:
+            snprintf(text, sizeof(text), "WIFI:T:WPA;S:Office-%u;P:pass%08x;;", h % 97, h);
+            break;
+        case 2:
+            snprintf(text, sizeof(text), "ORDER-%07zu|SKU-%05u|QTY-%u", i, h % 100000, h % 9 + 1);
+            break;
+        case 3:
+            snprintf(text, sizeof(text), "wxp://f2f0%08x%08x", h, h ^ 0x5bd1e995u);
+            break;
+        default:
+            snprintf(text, sizeof(text), "BEGIN:VCARD\nFN:Contact %zu\nTEL:+86138%08u\nEND:VCARD", i, h % 100000000);
+            break;
+    }
+    return text;
+}
+
+// 逐条读取记录比较 (索引之前的做法), 按时间从新到旧
+static std::vector<size_t> LinearHistorySearch(qrcore::ScanHistory& history, const std::string& query,
+                                               size_t limit) {
+    std::string folded = query;
+    std::transform(folded.begin(), folded.end(), folded.begin(),
+                   [](char c) { return (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c; });
+    std::vector<size_t> results;
+    qrcore::HistoryEntry entry;
+    for (size_t i = history.Count(); i-- > 0 && results.size() < limit;) {
+        history.Get(i, entry);
+        std::transform(entry.text.begin(), entry.text.end(), entry.text.begin(),
+                       [](char c) { return (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c; });
+        if (entry.text.find(folded) != std::string::npos) {
+            results.push_back(i);
+        }
+    }
+    return results;
+}
+
+static void BenchHistory(const BenchOptions& options) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "qrbench_history";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::string logPath = (dir / "history.log").string();
+    std::string indexPath = (dir / "history.idx").string();
+    size_t records = options.quick ? 20000 : 50000;
+    std::string errorMsg;
+
+    // 追加
+    std::vector<double> appendMs;
+    {
+        qrcore::ScanHistory history;
+        Check(history.Open(logPath, indexPath, errorMsg), "创建扫描历史");
+        for (size_t i = 0; i < records; i++) {
+            qrcore::HistoryEntry entry;
+            entry.timeMs = 1700000000000LL + (int64_t)i * 1000;
+            entry.source = (qrcore::HistorySource)(i % 4);
+            entry.format = (i % 7 == 0) ? "DataMatrix" : "QRCode";
+            entry.text = MakeHistoryText(i);
+            auto start = Clock::now();
+            history.Append(entry, errorMsg);
+            appendMs.push_back(ElapsedMs(start));
+        }
+    }
+
+    // 有索引时打开; 打开后不应有增量记录, 也不应重建
+    std::vector<double> openMs;
+    int openIterations = std::max(1, options.iterations);
+    for (int i = 0; i < openIterations; i++) {
+        qrcore::ScanHistory history;
+        auto start = Clock::now();
+        bool ok = history.Open(logPath, indexPath, errorMsg);
+        openMs.push_back(ElapsedMs(start));
+        qrcore::ScanHistoryStats stats = history.GetStats();
+        Check(ok && stats.records == records && stats.indexedRecords == records && stats.tailRecords == 0 &&
+              !stats.rebuiltIndex, "有索引时打开不解析日志");
+    }
+
+    // 删除索引后打开 (重建)
+    std::vector<double> rebuildMs;
+    for (int i = 0; i < std::max(1, options.iterations / 4); i++) {
+        std::filesystem::remove(indexPath);
+        qrcore::ScanHistory history;
+        auto start = Clock::now();
+        bool ok = history.Open(logPath, indexPath, errorMsg);
+        rebuildMs.push_back(ElapsedMs(start));
+        Check(ok && history.GetStats().rebuiltIndex && history.Count() == records, "删除索引后从日志重建");
+    }
+
+    qrcore::ScanHistoryOptions historyOptions;
+    historyOptions.compactRecords = 1 << 20; // 检查增量部分, 不自动合并
+    qrcore::ScanHistory history(historyOptions);
+    Check(history.Open(logPath, indexPath, errorMsg), "打开扫描历史");
+    qrcore::HistoryEntry last;
+    Check(history.Get(records - 1, last) && last.text == MakeHistoryText(records - 1) &&
+          last.source == (qrcore::HistorySource)((records - 1) % 4) && last.timeMs == 1700000000000LL + (int64_t)(records - 1) * 1000,
+          "读取的记录与写入的一致");
+
+    // 增量部分中的记录 (尚未写入索引) 也能查到
+    qrcore::HistoryEntry extra;
+    extra.format = "QRCode";
+    extra.text = "https://shop.example.com/item/unindexed-Needle";
+    history.Append(extra, errorMsg);
+
+    struct Query {
+        const char* name;
+        const char* text;
+    };
+    const Query queries[] = {
+        {"rare", "order-0012347"},   // 一条 (大小写不同)
+        {"selective", "Office-42;"}, // 约 1/485
+        {"common", "shop.example"},  // 约 1/5, 只取前 200 条
+        {"tail", "needle"},          // 增量部分中的记录
+        {"short", "zz"},             // 短于 3 字节, 逐条比较
+        {"none", "no-such-payload"},
+    };
+    const size_t limit = 200;
+    for (const Query& q : queries) {
+        std::vector<size_t> expected = LinearHistorySearch(history, q.text, limit);
+        std::vector<size_t> actual = history.Search(q.text, limit);
+        std::string what = std::string("查询结果与逐条比较一致: ") + q.name;
+        Check(actual == expected, what.c_str());
+    }
+    Check(history.Search("order-0012347", limit).size() == 1 && history.Search("needle", limit).size() == 1,
+          "查询命中预期的记录数");
+
+    fprintf(stderr, "\n[history] %zu 条记录, 日志 %.1f MB, 索引 %.1f MB, 三元组 %zu\n", records,
+            history.GetStats().logBytes / 1048576.0, history.GetStats().indexBytes / 1048576.0,
+            history.GetStats().trigrams);
+    fprintf(stderr, "%-10s %12s %12s %10s %8s\n", "查询", "index(ms)", "linear(ms)", "加速", "结果");
+    for (const Query& q : queries) {
+        std::vector<double> indexMs, linearMs;
+        size_t found = 0;
+        for (int i = 0; i < options.iterations; i++) {
+            auto start = Clock::now();
+            found = history.Search(q.text, limit).size();
+            indexMs.push_back(ElapsedMs(start));
+        }
+        for (int i = 0; i < std::max(1, options.iterations / 4); i++) {
+            auto start = Clock::now();
+            LinearHistorySearch(history, q.text, limit);
+            linearMs.push_back(ElapsedMs(start));
+        }
+        LatencyStats s = Summarize(indexMs);
+        LatencyStats l = Summarize(linearMs);
+        double speedup = s.p50 > 0 ? l.p50 / s.p50 : 0;
+        if (strcmp(q.name, "rare") == 0 || strcmp(q.name, "none") == 0) {
+            Check(speedup >= 10, "罕见内容的索引查询比逐条比较快至少一个数量级");
+        }
+        char extraFields[120];
+        snprintf(extraFields, sizeof(extraFields), ",\"method\":\"index\",\"results\":%zu,\"speedup\":%.1f", found,
+                 speedup);
+        EmitRecord("history", std::string("search/") + q.name, s, extraFields);
+        EmitRecord("history", std::string("linear/") + q.name, l, ",\"method\":\"linear\"");
+        fprintf(stderr, "%-10s %12.4f %12.3f %9.0fx %8zu\n", q.name, s.p50, l.p50, speedup, found);
+    }
+    history.Close();
+
+    // 日志末尾写了一半的记录: 重新打开时截掉, 索引仍可用
+    uint64_t goodSize = std::filesystem::file_size(logPath);
+    {
+        FILE* f = fopen(logPath.c_str(), "ab");
+        const uint8_t partial[] = {40, 0, 0, 0, 0x12, 0x34, 0x56, 0x78, 1, 2, 3};
+        fwrite(partial, 1, sizeof(partial), f);
+        fclose(f);
+    }
+    {
+        qrcore::ScanHistory reopened;
+        bool ok = reopened.Open(logPath, indexPath, errorMsg);
+        qrcore::ScanHistoryStats stats = reopened.GetStats();
+        Check(ok && stats.truncatedTail && !stats.rebuiltIndex && stats.records == records + 1 &&
+              std::filesystem::file_size(logPath) == goodSize, "截掉写了一半的末尾记录, 索引仍可用");
+        Check(reopened.Search("needle", limit).size() == 1, "合并后的记录可经索引查到");
+    }
+
+    // 索引正文损坏 (索引头和最后一条记录完好, 打开时发现不了): 使用时发现越界, 从日志重建
+    auto corruptIndex = [&](uint64_t at, size_t bytes) {
+        FILE* f = fopen(indexPath.c_str(), "r+b");
+        std::vector<uint8_t> garbage(bytes, 0xEE);
+        fseek(f, (long)at, SEEK_SET);
+        fwrite(garbage.data(), 1, garbage.size(), f);
+        fclose(f);
+    };
+    const uint64_t offsetTable = 40, trigramTable = offsetTable + (uint64_t)(records + 1) * 8;
+    for (int target = 0; target < 2; target++) {
+        if (target == 0) {
+            corruptIndex(offsetTable + 8 * 100, 8 * 50); // 第 100~149 条记录的偏移
+        } else {
+            for (uint64_t i = 0; i < 5000; i++) {
+                corruptIndex(trigramTable + i * 16 + 8, 8); // 三元组本身不变 (仍有序), 起始越界
+            }
+        }
+        qrcore::ScanHistory corrupted;
+        bool ok = corrupted.Open(logPath, indexPath, errorMsg);
+        Check(ok && !corrupted.GetStats().rebuiltIndex, "索引头完好时打开不解析日志");
+        qrcore::HistoryEntry entry;
+        bool read = corrupted.Get(120, entry) && entry.text == MakeHistoryText(120);
+        std::vector<size_t> expected = LinearHistorySearch(corrupted, "shop.example", limit);
+        bool found = corrupted.Search("shop.example", limit) == expected && expected.size() == limit &&
+                     corrupted.Search("order-0012347", limit).size() == 1;
+        bool rebuilt = corrupted.GetStats().rebuiltIndex && corrupted.Count() == records + 1;
+        Check(read && found && rebuilt, target == 0 ? "偏移表损坏时从日志重建, 读取与查询结果正确"
+                                                    : "三元组表损坏时从日志重建, 查询结果正确");
+    }
+    {
+        qrcore::ScanHistory reopened;
+        bool ok = reopened.Open(logPath, indexPath, errorMsg);
+        ok = ok && reopened.Search("order-0012347", limit).size() == 1;
+        Check(ok && !reopened.GetStats().rebuiltIndex, "重建后的索引再次打开可直接使用");
+    }
+
+    LatencyStats a = Summarize(appendMs);
+    LatencyStats o = Summarize(openMs);
+    LatencyStats r = Summarize(rebuildMs);
+    Check(o.p50 < r.p50, "有索引时打开比重建快");
+    EmitRecord("history", "append", a, "");
+    EmitRecord("history", "open", o, "");
+    EmitRecord("history", "rebuild", r, "");
+    fprintf(stderr, "append p50 %.4f ms p99 %.4f ms, open p50 %.3f ms, rebuild p50 %.3f ms\n", a.p50, a.p99, o.p50,
+            r.p50);
+    std::filesystem::remove_all(dir);
+}
+
+// ---------------------------------------------------------------------------
+// trace: 扫码跟踪的开销与正确性
+//
+// 先检查: 嵌套的耗时段、跨线程按序号配对的异步段都能导出; 环形缓冲区写满后只保留最新的事件;
+// 多个线程高速记录的同时反复导出, 导出的每个事件都完整 (不会读到被覆盖一半的槽位);
+// 线程退出后缓冲区被之后的线程复用; 识别级联的各阶段 (灰度、层级、ZXing) 出现在跟踪中;
+// 导出的 JSON 中事件数与收集到的一致、名称正确转义。
+// 再计时每个跟踪点的开销 (纳秒):
+//   now       只读时钟
+//   disabled  跟踪关闭时的一个作用域
+//   scope     跟踪开启时的一个作用域 (两次读时钟 + 写入本线程缓冲区)
+//   instant   跟踪开启时的一个时刻事件
+//   threads4  4 个线程同时记录作用域时每个线程的开销
+// ---------------------------------------------------------------------------
+
+static size_t CountSubstring(const std::string& text, const std::string& pattern) {
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+static void CheckTrace() {
+    qrcore::SetTraceEnabled(true);
+    qrcore::ClearTrace();
+
+    // 嵌套的耗时段与跨线程的异步段
+    uint64_t scanId = qrcore::NewTraceId();
+    qrcore::TraceAsyncBegin("scan", scanId);
+    {
+        QRCORE_TRACE_SCOPE("outer", scanId);
+        QRCORE_TRACE_SCOPE("inner");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::thread([scanId]() {
+        qrcore::SetTraceThreadName("check-end");
+        qrcore::TraceAsyncEnd("scan", scanId);
+    }).join();
+    std::vector<qrcore::TraceEvent> events = qrcore::CollectTrace();
+    const qrcore::TraceEvent* outer = nullptr;
+    const qrcore::TraceEvent* inner = nullptr;
+    int asyncBegin = 0, asyncEnd = 0;
+    uint32_t beginTid = 0, endTid = 0;
+    for (const qrcore::TraceEvent& event : events) {
+        if (strcmp(event.name, "outer") == 0) {
+            outer = &event;
+        } else if (strcmp(event.name, "inner") == 0) {
+            inner = &event;
+        } else if (strcmp(event.name, "scan") == 0 && event.id == scanId) {
+            if (event.phase == qrcore::TracePhase::AsyncBegin) {
+                asyncBegin++;
+                beginTid = event.tid;
+            } else if (event.phase == qrcore::TracePhase::AsyncEnd) {
+                asyncEnd++;
+                endTid = event.tid;
+            }
+        }
+    }
+    Check(outer && inner && outer->id == scanId && inner->durNs >= 1000000 && outer->startNs <= inner->startNs &&
+          outer->startNs + outer->durNs >= inner->startNs + inner->durNs, "嵌套的耗时段完整且外层包含内层");
+    Check(asyncBegin == 1 && asyncEnd == 1 && beginTid != endTid, "跨线程的异步段按序号配对");
+
+    // 环形缓冲区写满后只保留最新的事件 (容量取 2 的幂, 最小 64)
+    qrcore::SetTraceBufferCapacity(64);
+    std::vector<uint64_t> kept;
+    std::thread([&kept]() {
+        qrcore::SetTraceThreadName("check-ring");
+        for (uint64_t i = 1; i <= 1000; i++) {
+            qrcore::TraceRecord(qrcore::TracePhase::Instant, "ring", qrcore::TraceNow(), 0, i);
+        }
+        for (const qrcore::TraceEvent& event : qrcore::CollectTrace()) {
+            if (strcmp(event.name, "ring") == 0) {
+                kept.push_back(event.id);
+            }
+        }
+    }).join();
+    qrcore::SetTraceBufferCapacity(4096);
+    Check(kept.size() == 64 && kept.front() == 937 && kept.back() == 1000, "缓冲区写满后保留最新的 64 个事件");
+
+    // 并发记录与导出: 名称、时长都由序号决定, 导出时任一字段不符即为读到了被覆盖一半的槽位
+    static const char* const kNames[] = {"alpha", "beta", "gamma"};
+    std::atomic<bool> stop{false};
+    std::atomic<int> started{0};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; t++) {
+        writers.emplace_back([&stop, &started]() {
+            for (uint64_t i = 1; !stop.load(std::memory_order_relaxed); i++) {
+                qrcore::TraceRecord(qrcore::TracePhase::Complete, kNames[i % 3], qrcore::TraceNow(), i * 7, i);
+                if (i == 1) {
+                    started++;
+                }
+            }
+        });
+    }
+    while (started < 4) {
+        std::this_thread::yield();
+    }
+    size_t checked = 0, torn = 0;
+    for (int round = 0; round < 50; round++) {
+        std::this_thread::yield(); // 单核上也让写线程在两次导出之间运行
+        for (const qrcore::TraceEvent& event : qrcore::CollectTrace()) {
+            if (event.name != kNames[0] && event.name != kNames[1] && event.name != kNames[2]) {
+                continue; // 其他检查留下的事件
+            }
+            checked++;
+            if (event.name != kNames[event.id % 3] || event.durNs != event.id * 7) {
+                torn++;
+            }
+        }
+    }
+    stop = true;
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    fprintf(stderr, "[trace] 并发导出核对 %zu 个事件\n", checked);
+    Check(checked > 0 && torn == 0, "并发记录时导出的事件都完整");
+
+    // 线程退出后缓冲区被复用
+    size_t buffersBefore = qrcore::TraceBufferCount();
+    for (int i = 0; i < 50; i++) {
+        std::thread([]() { qrcore::TraceInstant("short-lived"); }).join();
+    }
+    Check(qrcore::TraceBufferCount() <= buffersBefore + 1, "线程退出后缓冲区被复用, 个数不随线程数增长");
+
+    // 识别级联的各阶段
+    qrcore::ClearTrace();
+    qrtools::SyntheticCode code;
+    qrtools::EncodeText("https://example.com/trace", qrcodegen::QrCode::Ecc::MEDIUM, code);
+    qrcore::ImageFrame frame = qrtools::ToBGRX(qrtools::RenderSample(code, 4, 640, 480, true));
+    qrcore::CascadeConfig cascade = qrcore::DefaultCascade();
+    cascade.pyramid.maxLevels = 0;
+    qrcore::ScanResult result;
+    qrcore::RunCascade(frame, cascade, result);
+    events = qrcore::CollectTrace();
+    bool luma = false, zxing = false, tier = false;
+    for (const qrcore::TraceEvent& event : events) {
+        luma = luma || strcmp(event.name, "ToLuminance") == 0;
+        zxing = zxing || strncmp(event.name, "ZXing::ReadBarcode", 18) == 0; // 单码 / 多码
+        // 第一层在金字塔上成功时只有 pyramid_level, 否则有各层级名称
+        tier = tier || strcmp(event.name, "pyramid_level") == 0 || event.name == qrcore::TraceIntern(cascade.tiers[0].name);
+    }
+    Check(luma && zxing && tier, "识别级联的灰度、层级与 ZXing 阶段出现在跟踪中");
+
+    // JSON 导出
+    qrcore::TraceInstant("quote\"name");
+    events = qrcore::CollectTrace();
+    size_t complete = 0;
+    for (const qrcore::TraceEvent& event : events) {
+        complete += event.phase == qrcore::TracePhase::Complete ? 1 : 0;
+    }
+    std::string json = qrcore::FormatChromeTrace(events);
+    Check(json.rfind("{\"displayTimeUnit\"", 0) == 0 && CountSubstring(json, "\"ph\":\"X\"") == complete &&
+          CountSubstring(json, "quote\\\"name") == 1 && CountSubstring(json, "{") == CountSubstring(json, "}"),
+          "导出的 JSON 事件数一致、名称已转义");
+    std::string path = (std::filesystem::temp_directory_path() / "qrbench_trace.json").string();
+    std::string errorMsg;
+    Check(qrcore::SaveChromeTrace(path, errorMsg) && std::filesystem::file_size(path) >= json.size(),
+          "写入跟踪文件");
+    std::filesystem::remove(path);
+
+    qrcore::ClearTrace();
+    Check(qrcore::CollectTrace().empty(), "ClearTrace 之后不再导出之前的事件");
+}
+
+static void BenchTrace(const BenchOptions& options) {
+    CheckTrace();
+
+    const int batch = 100000;
+    auto perSpanNs = [batch](const LatencyStats& stats) { return stats.p50 * 1e6 / batch; };
+    std::vector<double> nowMs, disabledMs, scopeMs, instantMs;
+    volatile uint64_t sink = 0;
+    for (int iteration = 0; iteration < options.iterations; iteration++) {
+        auto start = Clock::now();
+        for (int i = 0; i < batch; i++) {
+            sink = sink + qrcore::TraceNow();
+        }
+        nowMs.push_back(ElapsedMs(start));
+
+        qrcore::SetTraceEnabled(false);
+        start = Clock::now();
+        for (int i = 0; i < batch; i++) {
+            QRCORE_TRACE_SCOPE("bench");
+        }
+        disabledMs.push_back(ElapsedMs(start));
+
+        qrcore::SetTraceEnabled(true);
+        start = Clock::now();
+        for (int i = 0; i < batch; i++) {
+            QRCORE_TRACE_SCOPE("bench", (uint64_t)i);
+        }
+        scopeMs.push_back(ElapsedMs(start));
+
+        start = Clock::now();
+        for (int i = 0; i < batch; i++) {
+            qrcore::TraceInstant("bench");
+        }
+        instantMs.push_back(ElapsedMs(start));
+    }
+
+    // 多个线程同时记录 (各写各的缓冲区, 不应互相拖慢)
+    std::vector<double> threadedMs;
+    std::mutex threadedMutex;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            for (int iteration = 0; iteration < options.iterations; iteration++) {
+                auto start = Clock::now();
+                for (int i = 0; i < batch; i++) {
+                    QRCORE_TRACE_SCOPE("bench");
+                }
+                double ms = ElapsedMs(start);
+                std::lock_guard<std::mutex> lock(threadedMutex);
+                threadedMs.push_back(ms);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    struct Row {
+        const char* name;
+        LatencyStats stats;
+    };
+    const Row rows[] = {{"now", Summarize(nowMs)},
+                        {"disabled", Summarize(disabledMs)},
+                        {"scope", Summarize(scopeMs)},
+                        {"instant", Summarize(instantMs)},
+                        {"threads4", Summarize(threadedMs)}};
+    fprintf(stderr, "\n[trace] 每个跟踪点的开销 (p50, 每批 %d 个)\n", batch);
+    for (const Row& row : rows) {
+        char extra[80];
+        snprintf(extra, sizeof(extra), ",\"batch\":%d,\"ns_per_span\":%.1f", batch, perSpanNs(row.stats));
+        EmitRecord("trace", row.name, row.stats, extra);
+        fprintf(stderr, "%-10s %8.1f ns\n", row.name, perSpanNs(row.stats));
+    }
+    Check(perSpanNs(rows[2].stats) < 1000 && perSpanNs(rows[4].stats) < 1000, "每个跟踪作用域的开销低于 1 微秒");
+    qrcore::SetTraceEnabled(false);
+    qrcore::ClearTrace();
+    (void)sink;
+}
+
+// ---------------------------------------------------------------------------
+// metrics: 运行指标的开销与正确性
+//
+// 先检查: 直方图桶的上界覆盖桶内的值且相对误差不超过 1/32; 多个线程同时计数 / 记录后总数准确;
+// 分位数与精确排序的结果相差不超过桶宽; Prometheus 文本中同名指标只有一组 HELP / TYPE;
+// 快照文件按间隔更新、停止时写入最终值且不留临时文件; 以本地采集程序 (本文件中的最小 HTTP 客户端)
+// 连接 127.0.0.1 上的端点, 读到的值与注册表一致、连续采集单调不减、未知路径返回 404。
+// 再计时:
+//   counter        单线程计数一次 (纳秒)
+//   histogram      单线程记录一次延迟 (纳秒)
+//   counter4       4 个线程同时累加同一个计数器时每次的开销 (纳秒)
+//   format         与托盘程序规模相当的注册表 (约 30 个指标) 生成一次文本快照
+//   scrape         采集程序经回环地址取一次快照的往返耗时
+// ---------------------------------------------------------------------------
+
+// 本地采集程序: 连接 127.0.0.1:port 发一个 GET, 返回状态码 (失败为 0) 和正文
+static int FetchLocal(int port, const char* path, std::string& outBody) {
+    outBody.clear();
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        return 0;
+    }
+    SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    bool opened = client != INVALID_SOCKET;
+#else
+    int client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    bool opened = client >= 0;
+#endif
+    std::string response;
+    if (opened) {
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons((uint16_t)port);
+        if (connect(client, (const sockaddr*)&address, sizeof(address)) == 0) {
+            std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+            send(client, request.data(), (int)request.size(), 0);
+            char buffer[4096];
+            int received;
+            while ((received = (int)recv(client, buffer, sizeof(buffer), 0)) > 0) {
+                response.append(buffer, received);
+            }
+        }
+#ifdef _WIN32
+        closesocket(client);
+#else
+        close(client);
+#endif
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    int status = 0;
+    size_t headerEnd = response.find("\r\n\r\n");
+    if (headerEnd == std::string::npos || sscanf(response.c_str(), "HTTP/1.1 %d", &status) != 1) {
+        return 0;
+    }
+    outBody = response.substr(headerEnd + 4);
+    return status;
+}
+
+// Prometheus 文本 → "名称{标签}" 到值 (跳过注释行)
+static std::map<std::string, double> ParseMetricsText(const std::string& text) {
+    std::map<std::string, double> samples;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        end = end == std::string::npos ? text.size() : end;
+        std::string line = text.substr(start, end - start);
+        size_t space = line.rfind(' ');
+        if (!line.empty() && line[0] != '#' && space != std::string::npos) {
+            samples[line.substr(0, space)] = atof(line.c_str() + space + 1);
+        }
+        start = end + 1;
+    }
+    return samples;
+}
+
+static std::string ReadTextFile(const std::string& path) {
+    std::string text;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file) {
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            text.append(buffer, n);
+        }
+        fclose(file);
+    }
+    return text;
+}
+
+static void CheckMetrics() {
+    // 桶的上界与相对误差
+    bool bucketsOk = true;
+    int lastIndex = -1;
+    for (uint64_t value = 0; value < 5000000; value += value < 1000 ? 1 : value / 997) {
+        int index = qrcore::MetricHistogram::BucketIndex(value);
+        uint64_t bound = qrcore::MetricHistogram::BucketUpperBound(index);
+        bucketsOk = bucketsOk && index >= lastIndex && index < qrcore::MetricHistogram::kBucketCount && bound >= value &&
+                    (double)(bound - value) <= value / 32.0 + 1e-9;
+        lastIndex = index;
+    }
+    bucketsOk = bucketsOk && qrcore::MetricHistogram::BucketIndex(~0ull) == qrcore::MetricHistogram::kBucketCount - 1;
+    Check(bucketsOk, "直方图桶的上界覆盖桶内的值, 相对误差不超过 1/32");
+
+    // 多个线程同时计数 / 记录
+    qrcore::MetricsRegistry registry;
+    qrcore::MetricCounter& counter = registry.GetCounter("check_total", "", "检查用计数器");
+    qrcore::MetricHistogram& histogram = registry.GetHistogram("check_seconds", "", "检查用直方图");
+    const int threads = 4, perThread = 200000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&counter, &histogram, t]() {
+            for (int i = 0; i < perThread; i++) {
+                counter.Add();
+                histogram.Record((uint64_t)(t * perThread + i) % 100000);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    qrcore::HistogramSnapshot snapshot = histogram.Snapshot();
+    uint64_t expectedSum = 0;
+    for (int t = 0; t < threads; t++) {
+        for (int i = 0; i < perThread; i++) {
+            expectedSum += (uint64_t)(t * perThread + i) % 100000;
+        }
+    }
+    Check(counter.Value() == (uint64_t)threads * perThread && snapshot.count == (uint64_t)threads * perThread &&
+          snapshot.sum == expectedSum && snapshot.max == 99999, "并发计数与记录后总数、总和、最大值准确");
+    Check(&registry.GetCounter("check_total") == &counter, "同名同标签取得同一个计数器");
+
+    // 分位数对比精确排序 (对数正态分布的延迟, 中位数约 20 ms)
+    qrcore::MetricHistogram latency;
+    std::vector<uint64_t> values;
+    uint32_t seed = 12345;
+    for (int i = 0; i < 100000; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        double u1 = ((seed >> 8) + 1) / 16777217.0;
+        seed = seed * 1664525u + 1013904223u;
+        double u2 = (seed >> 8) / 16777216.0;
+        double normal = std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+        uint64_t micros = (uint64_t)(20000.0 * std::exp(0.8 * normal));
+        values.push_back(micros);
+        latency.Record(micros);
+    }
+    std::sort(values.begin(), values.end());
+    qrcore::HistogramSnapshot latencySnapshot = latency.Snapshot();
+    double worstError = 0;
+    for (double q : {0.5, 0.9, 0.99, 0.999}) {
+        uint64_t exact = values[(size_t)std::ceil(q * values.size()) - 1];
+        double error = std::fabs((double)latencySnapshot.Percentile(q) - (double)exact) / (double)exact;
+        worstError = std::max(worstError, error);
+    }
+    fprintf(stderr, "[metrics] 分位数最大相对误差 %.4f\n", worstError);
+    Check(worstError <= 1.0 / 32 + 1e-6 && latencySnapshot.Percentile(1.0) == values.back(),
+          "分位数与精确排序相差不超过一个桶宽, p100 为最大值");
+
+    // 文本格式: 同名不同标签的指标共用一组 HELP / TYPE
+    registry.GetCounter("check_failures_total", "reason=\"a\"", "按原因").Add(3);
+    registry.GetCounter("check_failures_total", "reason=\"b\"").Add(5);
+    std::string text = registry.FormatPrometheus();
+    std::map<std::string, double> samples = ParseMetricsText(text);
+    Check(CountSubstring(text, "# TYPE check_failures_total counter") == 1 &&
+          CountSubstring(text, "# HELP check_failures_total") == 1 && samples["check_failures_total{reason=\"a\"}"] == 3 &&
+          samples["check_failures_total{reason=\"b\"}"] == 5 &&
+          samples["check_seconds_count"] == threads * perThread &&
+          std::fabs(samples["check_seconds_max"] - 0.099999) < 1e-9 &&
+          samples.count("check_seconds{quantile=\"0.99\"}") == 1,
+          "Prometheus 文本含计数、标签、分位数与最大值");
+
+    // 快照文件
+    std::string path = (std::filesystem::temp_directory_path() / "qrbench_metrics.prom").string();
+    std::string errorMsg;
+    qrcore::MetricsFileWriter writer(registry);
+    Check(writer.Start(path, 100, errorMsg), "启动快照文件线程");
+    std::this_thread::sleep_for(std::chrono::milliseconds(350));
+    uint64_t periodicWrites = writer.WriteCount();
+    counter.Add(7);
+    writer.Stop();
+    std::map<std::string, double> fileSamples = ParseMetricsText(ReadTextFile(path));
+    Check(periodicWrites >= 3 && writer.WriteCount() == periodicWrites + 1 &&
+          fileSamples["check_total"] == threads * perThread + 7 && !std::filesystem::exists(path + ".tmp"),
+          "快照文件按间隔更新, 停止时写入最终值且不留临时文件");
+    std::filesystem::remove(path);
+
+    // 本机端点 + 本地采集程序
+    qrcore::MetricsHttpServer server(registry);
+    Check(server.Start(0, errorMsg) && server.Port() > 0, "在 127.0.0.1 上启动指标端点");
+    std::atomic<bool> stop{false};
+    std::thread updater([&counter, &stop]() {
+        while (!stop.load(std::memory_order_relaxed)) {
+            counter.Add();
+            std::this_thread::yield();
+        }
+    });
+    std::string body;
+    bool scrapesOk = true;
+    double last = 0;
+    for (int i = 0; i < 5; i++) {
+        int status = FetchLocal(server.Port(), "/metrics", body);
+        double value = ParseMetricsText(body)["check_total"];
+        scrapesOk = scrapesOk && status == 200 && value >= last && value >= threads * perThread + 7;
+        last = value;
+    }
+    stop = true;
+    updater.join();
+    Check(scrapesOk, "采集程序读到的计数与注册表一致, 连续采集单调不减");
+    Check(FetchLocal(server.Port(), "/metrics", body) == 200 && ParseMetricsText(body)["check_total"] == counter.Value(),
+          "停止更新后采集到的值等于注册表中的值");
+    Check(FetchLocal(server.Port(), "/other", body) == 404, "未知路径返回 404");
+    Check(server.RequestCount() == 7, "端点逐个处理了全部请求");
+    server.Stop();
+    Check(FetchLocal(server.Port() == 0 ? 1 : server.Port(), "/metrics", body) == 0 && server.Port() == 0,
+          "停止后端点不再接受连接");
+}
+
+static void BenchMetrics(const BenchOptions& options) {
+    CheckMetrics();
+
+    // 与托盘程序规模相当的注册表
+    qrcore::MetricsRegistry registry;
+    for (int i = 0; i < 20; i++) {
+        registry.GetCounter("bench_events_total", "kind=\"" + std::to_string(i) + "\"", "基准用计数器").Add(i);
+    }
+    for (int i = 0; i < 8; i++) {
+        qrcore::MetricHistogram& histogram = registry.GetHistogram("bench_latency_seconds", "stage=\"" + std::to_string(i) + "\"");
+        for (int k = 0; k < 1000; k++) {
+            histogram.Record((uint64_t)(k * 37 + i));
+        }
+    }
+    qrcore::MetricCounter& counter = registry.GetCounter("bench_events_total", "kind=\"0\"");
+    qrcore::MetricHistogram& histogram = registry.GetHistogram("bench_latency_seconds", "stage=\"0\"");
+
+    const int batch = 100000;
+    auto perOpNs = [batch](const LatencyStats& stats) { return stats.p50 * 1e6 / batch; };
+    std::vector<double> counterMs, histogramMs, formatMs;
+    size_t textBytes = 0;
+    for (int iteration = 0; iteration < options.iterations; iteration++) {
+        auto start = Clock::now();
+        for (int i = 0; i < batch; i++) {
+            counter.Add();
+        }
+        counterMs.push_back(ElapsedMs(start));
+
+        start = Clock::now();
+        for (int i = 0; i < batch; i++) {
+            histogram.Record((uint64_t)i);
+        }
+        histogramMs.push_back(ElapsedMs(start));
+
+        start = Clock::now();
+        textBytes = registry.FormatPrometheus().size();
+        formatMs.push_back(ElapsedMs(start));
+    }
+
+    // 多个线程同时累加同一个计数器 (同一缓存行上的竞争)
+    std::vector<double> threadedMs;
+    std::mutex threadedMutex;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            for (int iteration = 0; iteration < options.iterations; iteration++) {
+                auto start = Clock::now();
+                for (int i = 0; i < batch; i++) {
+                    counter.Add();
+                }
+                double ms = ElapsedMs(start);
+                std::lock_guard<std::mutex> lock(threadedMutex);
+                threadedMs.push_back(ms);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // 采集往返
+    std::vector<double> scrapeMs;
+    qrcore::MetricsHttpServer server(registry);
+    std::string errorMsg;
+    if (server.Start(0, errorMsg)) {
+        std::string body;
+        for (int iteration = 0; iteration < options.iterations; iteration++) {
+            auto start = Clock::now();
+            FetchLocal(server.Port(), "/metrics", body);
+            scrapeMs.push_back(ElapsedMs(start));
+        }
+        server.Stop();
+    } else {
+        fprintf(stderr, "[metrics] 端点未启动: %s\n", errorMsg.c_str());
+    }
+
+    struct Row {
+        const char* name;
+        LatencyStats stats;
+    };
+    const Row perOp[] = {{"counter", Summarize(counterMs)},
+                         {"histogram", Summarize(histogramMs)},
+                         {"counter4", Summarize(threadedMs)}};
+    fprintf(stderr, "\n[metrics] 每次记录的开销 (p50, 每批 %d 次)\n", batch);
+    for (const Row& row : perOp) {
+        char extra[80];
+        snprintf(extra, sizeof(extra), ",\"batch\":%d,\"ns_per_op\":%.1f", batch, perOpNs(row.stats));
+        EmitRecord("metrics", row.name, row.stats, extra);
+        fprintf(stderr, "%-10s %8.1f ns\n", row.name, perOpNs(row.stats));
+    }
+    LatencyStats format = Summarize(formatMs);
+    char extra[80];
+    snprintf(extra, sizeof(extra), ",\"bytes\":%zu", textBytes);
+    EmitRecord("metrics", "format", format, extra);
+    fprintf(stderr, "format     %8.3f ms (%zu 字节)\n", format.p50, textBytes);
+    if (!scrapeMs.empty()) {
+        LatencyStats scrape = Summarize(scrapeMs);
+        EmitRecord("metrics", "scrape", scrape, extra);
+        fprintf(stderr, "scrape     %8.3f ms\n", scrape.p50);
+    }
+    Check(perOpNs(perOp[0].stats) < 100 && perOpNs(perOp[1].stats) < 200, "计数和记录延迟的开销在百纳秒以内");
+}
+
+// ---------------------------------------------------------------------------
+// framepool: 帧缓冲池
+//
+// 先检查: 释放后同尺寸的请求复用同一缓冲区, 同时使用的帧不共用缓冲区; 行字节数按 64 字节对齐;
+// 略小的请求取用较大的空闲缓冲区, 超出 maxWaste 时不取用; 空闲内存超出上限时按最久未用释放,
+// 上限为 0 时不复用; 池销毁后仍在使用的帧有效, 最后释放时由分配器回收; 多线程同时取用 / 释放后计数一致。
+// 再模拟扫码 (整屏截图 1080p / 4K 与连续扫码的固定选区): 每次从截图池取 BGRX 帧并写入像素 (代替 BitBlt),
+// 再做识别前处理 (灰度、金字塔两级、对比度拉伸、亮度增强), 对比复用与不复用 (FramePoolConfig.maxIdleBytes = 0):
+//   pooled / unpooled  每次的耗时 (ms) 与堆分配次数 (Linux 上替换全局 operator new 计数)
+// 稳定状态下复用时的堆分配次数须为 0。ZXing 识别本身的分配不在此范围内。
+// 最后走一遍与 ScanImageForQR 相同的实际路径 (截图帧 → DecodeWorker::Submit → 工作线程 RunCascade → 回调):
+//   submit  每次的耗时与堆分配次数; 与在当前线程直接识别同一帧相比, 多出的分配须不超过 1 次
+//           (交给回调、再由 UI 线程释放的结果对象), 其余都在 ZXing 识别内部
+// ---------------------------------------------------------------------------
+
+#ifdef __linux__
+#if defined(__GNUC__) && !defined(__clang__)
+// 替换的 operator new / delete 以 malloc / free 实现, 内联到调用处后 GCC 会误报不匹配
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<uint64_t> g_heapAllocations{0}; // 全局 operator new 调用次数
+
+void* operator new(size_t size) {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+void* operator new(size_t size, std::align_val_t align) {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    size_t alignment = std::max((size_t)align, sizeof(void*));
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment, size ? size : 1) != 0) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void* operator new[](size_t size, std::align_val_t align) {
+    return operator new(size, align);
+}
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size, align);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void operator delete(void* p) noexcept {
+    free(p);
+}
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+    free(p);
+}
+void operator delete[](void* p, std::align_val_t) noexcept {
+    free(p);
+}
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    free(p);
+}
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    free(p);
+}
+
+static bool CanCountAllocations() {
+    return true;
+}
+static uint64_t HeapAllocations() {
+    return g_heapAllocations.load(std::memory_order_relaxed);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#else
+static bool CanCountAllocations() {
+    return false;
+}
+static uint64_t HeapAllocations() {
+    return 0;
+}
+#endif
+
+// 记录分配与释放次数的堆分配器
+class CountingFrameAllocator : public qrcore::IFrameAllocator {
+public:
+    bool Allocate(int width, int height, qrcore::PixelFormat format, qrcore::FrameBuffer& outBuffer) override {
+        allocated++;
+        return qrcore::HeapFrameAllocator().Allocate(width, height, format, outBuffer);
+    }
+    void Free(qrcore::FrameBuffer& buffer) override {
+        freed++;
+        qrcore::HeapFrameAllocator().Free(buffer);
+    }
+
+    std::atomic<int> allocated{0};
+    std::atomic<int> freed{0};
+};
+
+static void CheckFramePool() {
+    CountingFrameAllocator allocator;
+    qrcore::ImageFrame survivor;
+    {
+        qrcore::FramePoolConfig config;
+        config.maxIdleBytes = (size_t)8 << 20;
+        qrcore::FramePool pool(allocator, config);
+
+        uint8_t* first;
+        {
+            qrcore::ImageFrame a = pool.Acquire(1000, 600, qrcore::PixelFormat::BGRX);
+            qrcore::ImageFrame b = pool.Acquire(1000, 600, qrcore::PixelFormat::BGRX);
+            Check(!a.empty() && !b.empty() && a.data != b.data && a.width == 1000 && a.height == 600,
+                  "同时使用的帧不共用缓冲区");
+            Check(a.stride % 64 == 0 && ((uintptr_t)a.data % 64) == 0 && a.stride >= 1000 * 4, "行字节数与首地址按 64 字节对齐");
+            first = a.data;
+            memset(a.data, 0x5A, a.byteSize());
+        }
+        qrcore::ImageFrame again = pool.Acquire(1000, 600, qrcore::PixelFormat::BGRX);
+        qrcore::ImageFrame smaller = pool.Acquire(990, 590, qrcore::PixelFormat::BGRX);
+        qrcore::FramePoolStats stats = pool.GetStats();
+        Check((again.data == first || smaller.data == first) && stats.reused == 2 && stats.allocated == 2,
+              "释放后同尺寸或略小的请求复用空闲缓冲区");
+        again = qrcore::ImageFrame();
+        smaller = qrcore::ImageFrame();
+
+        qrcore::ImageFrame tiny = pool.Acquire(100, 100, qrcore::PixelFormat::BGRX);
+        qrcore::ImageFrame lum = pool.Acquire(1000, 600, qrcore::PixelFormat::Lum);
+        Check(pool.GetStats().allocated == 4, "面积超出 maxWaste 或格式不同时不取用已有缓冲区");
+        tiny = qrcore::ImageFrame();
+        lum = qrcore::ImageFrame();
+
+        // 空闲约 2 x 2.4 MB + 小块; 上限降到 3 MB 后下一次取用时释放最久未用的
+        config.maxIdleBytes = (size_t)3 << 20;
+        pool.Configure(config);
+        qrcore::ImageFrame next = pool.Acquire(64, 64, qrcore::PixelFormat::Lum);
+        stats = pool.GetStats();
+        Check(stats.evicted >= 1 && stats.idleBytes <= config.maxIdleBytes, "空闲内存超出上限时按最久未用释放");
+        next = qrcore::ImageFrame();
+
+        config.maxIdleBytes = 0;
+        pool.Configure(config);
+        uint64_t allocatedBefore = pool.GetStats().allocated;
+        for (int i = 0; i < 3; i++) {
+            qrcore::ImageFrame frame = pool.Acquire(640, 480, qrcore::PixelFormat::BGRX);
+        }
+        Check(pool.GetStats().allocated == allocatedBefore + 3 && pool.GetStats().reused == 2, "上限为 0 时不复用");
+
+        // 多线程同时取用 / 释放
+        config.maxIdleBytes = (size_t)64 << 20;
+        pool.Configure(config);
+        std::vector<std::thread> threads;
+        std::atomic<int> corrupted{0};
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&pool, &corrupted, t]() {
+                for (int i = 0; i < 500; i++) {
+                    qrcore::ImageFrame frame = pool.Acquire(256 + (i % 3) * 16, 128, qrcore::PixelFormat::Lum);
+                    for (int y = 0; y < frame.height; y++) {
+                        memset(frame.row(y), t + 1, frame.width);
+                    }
+                    std::this_thread::yield();
+                    for (int y = 0; y < frame.height; y++) {
+                        if (frame.row(y)[0] != t + 1 || frame.row(y)[frame.width - 1] != t + 1) {
+                            corrupted++;
+                        }
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        stats = pool.GetStats();
+        Check(corrupted == 0 && stats.allocated <= allocatedBefore + 3 + 12, "多线程取用时同一缓冲区不会同时交给两个帧");
+
+        survivor = pool.Acquire(320, 240, qrcore::PixelFormat::BGRX);
+        memset(survivor.data, 0, survivor.byteSize());
+    }
+    // 池已销毁, survivor 仍持有缓冲区
+    memset(survivor.data, 0xFF, survivor.byteSize());
+    Check(allocator.freed == allocator.allocated - 1, "池销毁时释放空闲缓冲区, 使用中的保留");
+    survivor = qrcore::ImageFrame();
+    Check(allocator.freed == allocator.allocated, "池销毁后最后一个帧释放时回收缓冲区");
+}
+
+struct PoolScenario {
+    const char* name;
+    int width;
+    int height;
+};
+
+// 一次扫码的截图与识别前处理; 返回前释放全部帧
+static void SimulateScan(qrcore::FramePool& capturePool, const qrcore::ImageFrame& screen, int width, int height,
+                         std::vector<qrcore::PyramidLevel>& levels) {
+    qrcore::ImageFrame capture = capturePool.Acquire(width, height, qrcore::PixelFormat::BGRX);
+    for (int y = 0; y < height; y++) {
+        memcpy(capture.row(y), screen.row(y), (size_t)width * 4); // 代替 BitBlt
+    }
+    qrcore::ImageFrame lum = qrcore::ToLuminance(capture);
+    qrcore::PyramidConfig pyramid;
+    qrcore::BuildPyramid(lum, pyramid, levels);
+    qrcore::ImageFrame contrast = qrcore::StretchContrast(lum);
+    qrcore::ImageFrame brightness = qrcore::AdjustBrightness(lum);
+    levels.clear();
+}
+
+// 与 ScanImageForQR 相同的提交路径: 截图帧交给 DecodeWorker, 工作线程按共用的级联配置识别, 等回调返回
+struct SubmitWaiter {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+};
+
+static void SubmitScan(qrcore::DecodeWorker& worker, const std::shared_ptr<const qrcore::CascadeConfig>& cascade,
+                       qrcore::FramePool& capturePool, const qrcore::ImageFrame& screen, int width, int height,
+                       SubmitWaiter& waiter) {
+    qrcore::DecodeJob job;
+    job.frame = capturePool.Acquire(width, height, qrcore::PixelFormat::BGRX);
+    for (int y = 0; y < height; y++) {
+        memcpy(job.frame.row(y), screen.row(y), (size_t)width * 4); // 代替 BitBlt
+    }
+    job.cascade = cascade;
+    waiter.done = false;
+    worker.Submit(std::move(job), [&waiter](std::unique_ptr<qrcore::ScanResult>) {
+        std::lock_guard<std::mutex> lock(waiter.mutex);
+        waiter.done = true;
+        waiter.cv.notify_all();
+    });
+    std::unique_lock<std::mutex> lock(waiter.mutex);
+    waiter.cv.wait(lock, [&waiter] { return waiter.done; });
+}
+
+// 实际提交路径每次扫码的堆分配, 与在当前线程直接识别同一帧对比; 返回多出的次数
+static double MeasureSubmitPath(const PoolScenario& scenario, const qrcore::ImageFrame& screen,
+                                const BenchOptions& options) {
+    qrcore::FramePoolConfig config;
+    config.maxIdleBytes = (size_t)256 << 20;
+    qrcore::DefaultFramePool().Configure(config);
+    qrcore::FramePool capturePool(qrcore::HeapFrameAllocator(), config);
+    auto cascade = std::make_shared<const qrcore::CascadeConfig>(qrcore::DefaultCascade());
+    qrcore::DecodeWorker worker;
+    worker.Start();
+    SubmitWaiter waiter;
+
+    for (int i = 0; i < 3; i++) { // 预热: 缓冲区进入池中, 队列容量与线程名称就绪
+        SubmitScan(worker, cascade, capturePool, screen, scenario.width, scenario.height, waiter);
+    }
+    std::vector<double> samples;
+    samples.reserve(options.iterations);
+    uint64_t before = HeapAllocations();
+    for (int i = 0; i < options.iterations; i++) {
+        auto start = Clock::now();
+        SubmitScan(worker, cascade, capturePool, screen, scenario.width, scenario.height, waiter);
+        samples.push_back(ElapsedMs(start));
+    }
+    double submitted = (double)(HeapAllocations() - before) / options.iterations;
+    worker.Stop();
+
+    // 对照: 同一帧在当前线程直接识别 (ZXing 内部及结果内容的分配)
+    qrcore::ImageFrame frame = capturePool.Acquire(scenario.width, scenario.height, qrcore::PixelFormat::BGRX);
+    for (int y = 0; y < scenario.height; y++) {
+        memcpy(frame.row(y), screen.row(y), (size_t)scenario.width * 4);
+    }
+    {
+        qrcore::ScanResult warm;
+        qrcore::RunCascade(frame, *cascade, warm);
+    }
+    before = HeapAllocations();
+    for (int i = 0; i < options.iterations; i++) {
+        qrcore::ScanResult result;
+        qrcore::RunCascade(frame, *cascade, result);
+    }
+    double direct = (double)(HeapAllocations() - before) / options.iterations;
+
+    LatencyStats stats = Summarize(samples);
+    char extra[160];
+    snprintf(extra, sizeof(extra), ",\"width\":%d,\"height\":%d,\"allocations_per_scan\":%.2f,\"decode_allocations\":%.2f",
+             scenario.width, scenario.height, submitted, direct);
+    EmitRecord("framepool", std::string(scenario.name) + "/submit", stats, extra);
+    fprintf(stderr, "%-13s submit %8.3f ms (%.1f 次分配, 其中直接识别 %.1f 次)\n", scenario.name, stats.p50, submitted,
+            direct);
+    return submitted - direct;
+}
+
+static void BenchFramePool(const BenchOptions& options) {
+    CheckFramePool();
+    if (!CanCountAllocations()) {
+        fprintf(stderr, "[framepool] 本平台不计数堆分配, 只测耗时\n");
+    }
+
+    const PoolScenario scenarios[] = {
+        {"screen_1080p", 1920, 1080},
+        {"screen_4k", 3840, 2160},
+        {"live_region", 800, 600},
+    };
+    fprintf(stderr, "\n[framepool] 截图 + 识别前处理 (p50)\n");
+    for (const PoolScenario& scenario : scenarios) {
+        qrtools::SyntheticCode code;
+        qrtools::EncodeText("https://example.com/framepool", qrcodegen::QrCode::Ecc::MEDIUM, code);
+        qrcore::ImageFrame screen =
+            qrtools::ToBGRX(qrtools::RenderSample(code, 6, scenario.width, scenario.height, true));
+
+        double allocationsPerScan[2] = {0, 0};
+        LatencyStats stats[2];
+        for (int pooled = 1; pooled >= 0; pooled--) {
+            qrcore::FramePoolConfig config;
+            config.maxIdleBytes = pooled ? (size_t)256 << 20 : 0;
+            qrcore::DefaultFramePool().Configure(config);
+            qrcore::DefaultFramePool().Trim();
+            qrcore::FramePool capturePool(qrcore::HeapFrameAllocator(), config);
+            std::vector<qrcore::PyramidLevel> levels;
+            levels.reserve(8);
+
+            for (int i = 0; i < 3; i++) { // 预热: 各尺寸的缓冲区进入池中
+                SimulateScan(capturePool, screen, scenario.width, scenario.height, levels);
+            }
+            std::vector<double> samples;
+            samples.reserve(options.iterations);
+            uint64_t before = HeapAllocations();
+            for (int i = 0; i < options.iterations; i++) {
+                auto start = Clock::now();
+                SimulateScan(capturePool, screen, scenario.width, scenario.height, levels);
+                samples.push_back(ElapsedMs(start));
+            }
+            allocationsPerScan[pooled] = (double)(HeapAllocations() - before) / options.iterations;
+            stats[pooled] = Summarize(samples);
+            char extra[96];
+            snprintf(extra, sizeof(extra), ",\"width\":%d,\"height\":%d,\"allocations_per_scan\":%.2f", scenario.width,
+                     scenario.height, allocationsPerScan[pooled]);
+            EmitRecord("framepool", std::string(scenario.name) + (pooled ? "/pooled" : "/unpooled"), stats[pooled], extra);
+        }
+        fprintf(stderr, "%-13s pooled %8.3f ms (%.1f 次分配)  unpooled %8.3f ms (%.1f 次分配)\n", scenario.name,
+                stats[1].p50, allocationsPerScan[1], stats[0].p50, allocationsPerScan[0]);
+        double submitOverhead = MeasureSubmitPath(scenario, screen, options);
+        if (CanCountAllocations()) {
+            Check(allocationsPerScan[1] == 0, "复用时稳定状态下截图到识别前处理没有堆分配");
+            Check(allocationsPerScan[0] >= 5, "不复用时每次扫码分配各帧 (对照)");
+            Check(submitOverhead <= 1.0, "经解码线程提交比直接识别每次最多多分配 1 次 (交给回调的结果对象)");
+        }
+    }
+    qrcore::DefaultFramePool().Configure(qrcore::FramePoolConfig());
+    qrcore::DefaultFramePool().Trim();
+}
+
+// ---------------------------------------------------------------------------
+// overlay: 选区覆盖层的脏矩形合成
+//
+// 先检查脏区域的合并 (同一条边前后位置合并为一条, 相交的横竖边不合并, 矩形数有上限且不丢失覆盖),
+// 以及随机拖拽 (含贴近屏幕边缘、选框缩小和隐藏) 时每一步增量重绘后的后备缓冲区与整幅重绘逐字节一致。
+// 再模拟 1080p / 4K / 5K 屏幕上从左上向右下拖出选框, 每次鼠标移动:
+//   full   旧做法: 新建整屏缓冲区、填充、画选框, 整屏复制到屏幕
+//   dirty  常驻后备缓冲区, 只重绘并复制新旧选框的边线和标签区域
+// 输出每帧耗时与处理的像素数, 两种做法最终的屏幕内容须一致。
+// ---------------------------------------------------------------------------
+
+// 把 rects 范围内的后备缓冲区像素复制到屏幕 (代替 BitBlt)
+static void PresentRects(const qrcore::ImageFrame& back, const qrcore::ImageFrame& screen,
+                         const std::vector<qrcore::OverlayRect>& rects) {
+    for (const qrcore::OverlayRect& rect : rects) {
+        for (int y = rect.top; y < rect.bottom; y++) {
+            memcpy(screen.row(y) + (size_t)rect.left * 4, back.row(y) + (size_t)rect.left * 4, (size_t)rect.width() * 4);
+        }
+    }
+}
+
+static bool FramesEqual(const qrcore::ImageFrame& a, const qrcore::ImageFrame& b) {
+    if (a.width != b.width || a.height != b.height) {
+        return false;
+    }
+    for (int y = 0; y < a.height; y++) {
+        if (memcmp(a.row(y), b.row(y), (size_t)a.width * 4) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 整幅重绘 selection 的参考结果
+static void RenderOverlayReference(const qrcore::ImageFrame& target, const qrcore::OverlayRect& selection, bool visible) {
+    qrcore::OverlayCompositor reference;
+    std::string errorMsg;
+    reference.Attach(target, errorMsg);
+    reference.SetSelection(selection, visible);
+    std::vector<qrcore::OverlayRect> rects;
+    reference.Flush(rects);
+}
+
+static void CheckOverlay() {
+    qrcore::DirtyRegion region(4);
+    region.Add({100, 50, 102, 300});
+    region.Add({100, 60, 102, 320});
+    Check(region.Rects().size() == 1 && region.Rects()[0].top == 50 && region.Rects()[0].bottom == 320,
+          "同一条边前后两次的位置合并为一条");
+    region.Add({100, 50, 900, 52});
+    Check(region.Rects().size() == 2, "相交的横竖边不合并为外接矩形");
+    region.Add({100, 50, 900, 52});
+    Check(region.Rects().size() == 2, "已被覆盖的矩形不重复加入");
+
+    std::vector<qrcore::OverlayRect> added;
+    std::mt19937 rng(24);
+    qrcore::DirtyRegion capped(6);
+    for (int i = 0; i < 40; i++) {
+        int x = (int)(rng() % 900), y = (int)(rng() % 900);
+        qrcore::OverlayRect rect = {x, y, x + 2 + (int)(rng() % 60), y + 2 + (int)(rng() % 60)};
+        capped.Add(rect);
+        added.push_back(rect);
+    }
+    bool covered = capped.Rects().size() <= 6;
+    for (const qrcore::OverlayRect& rect : added) {
+        for (int y = rect.top; y < rect.bottom && covered; y += 7) {
+            for (int x = rect.left; x < rect.right && covered; x += 7) {
+                bool inside = false;
+                for (const qrcore::OverlayRect& r : capped.Rects()) {
+                    inside = inside || (x >= r.left && x < r.right && y >= r.top && y < r.bottom);
+                }
+                covered = inside;
+            }
+        }
+    }
+    Check(covered, "矩形数超出上限时合并, 不丢失覆盖");
+
+    // 随机拖拽: 每一步增量重绘后与整幅重绘一致
+    const int width = 640, height = 400;
+    qrcore::ImageFrame back = qrcore::AllocateFrame(width, height, qrcore::PixelFormat::BGRX);
+    qrcore::ImageFrame expected = qrcore::AllocateFrame(width, height, qrcore::PixelFormat::BGRX);
+    qrcore::OverlayCompositor compositor;
+    std::string errorMsg;
+    Check(compositor.Attach(back, errorMsg), "绑定后备缓冲区");
+    qrcore::ImageFrame lum = qrcore::AllocateFrame(width, height, qrcore::PixelFormat::Lum);
+    Check(!compositor.Attach(lum, errorMsg), "非 BGRX 的后备缓冲区被拒绝");
+    compositor.Attach(back, errorMsg);
+
+    std::vector<qrcore::OverlayRect> rects;
+    compositor.Flush(rects);
+    bool consistent = true;
+    int64_t dirtyPixels = 0;
+    int steps = 0;
+    for (int drag = 0; drag < 12 && consistent; drag++) {
+        int startX = (int)(rng() % width), startY = (int)(rng() % height);
+        for (int move = 0; move < 25 && consistent; move++) {
+            int x = (int)(rng() % (width + 40)) - 20, y = (int)(rng() % (height + 40)) - 20; // 可超出屏幕
+            qrcore::OverlayRect selection = {std::min(startX, x), std::min(startY, y), std::max(startX, x), std::max(startY, y)};
+            bool visible = move != 24 || drag % 3 != 0; // 偶尔松开后隐藏 (选区过小)
+            compositor.SetSelection(selection, visible);
+            compositor.Flush(rects);
+            for (const qrcore::OverlayRect& rect : rects) {
+                dirtyPixels += rect.area();
+            }
+            RenderOverlayReference(expected, selection, visible);
+            consistent = FramesEqual(back, expected);
+            steps++;
+        }
+    }
+    Check(consistent, "每一步增量重绘后与整幅重绘一致");
+    Check(dirtyPixels < (int64_t)steps * width * height / 2, "增量重绘的像素远少于整幅重绘");
+    Check(compositor.LabelRect().empty() || compositor.LabelRect().bottom <= height, "标签区域裁剪到缓冲区内");
+}
+
+static void BenchOverlay(const BenchOptions& options) {
+    CheckOverlay();
+
+    struct Screen {
+        const char* name;
+        int width;
+        int height;
+    };
+    const Screen screens[] = {{"1080p", 1920, 1080}, {"4k", 3840, 2160}, {"5k", 5120, 2880}};
+    const int moves = options.quick ? 40 : 120;
+    fprintf(stderr, "\n[overlay] 拖拽选框的每帧耗时 (p50 / p99) 与处理的像素数\n");
+    for (const Screen& screen : screens) {
+        // 从左上四分之一处向右下拖出选框
+        std::vector<qrcore::OverlayRect> path;
+        int startX = screen.width / 4, startY = screen.height / 4;
+        for (int i = 1; i <= moves; i++) {
+            int x = startX + (int)((int64_t)(screen.width / 2) * i / moves);
+            int y = startY + (int)((int64_t)(screen.height / 2) * i / moves);
+            path.push_back({startX, startY, x, y});
+        }
+
+        qrcore::ImageFrame fullScreen = qrcore::AllocateFrame(screen.width, screen.height, qrcore::PixelFormat::BGRX);
+        qrcore::ImageFrame dirtyScreen = qrcore::AllocateFrame(screen.width, screen.height, qrcore::PixelFormat::BGRX);
+        LatencyStats stats[2];
+        double pixelsPerFrame[2] = {0, 0};
+
+        // full: 每帧新建整屏缓冲区并整屏复制
+        {
+            std::vector<double> samples;
+            std::vector<qrcore::OverlayRect> rects;
+            int64_t pixels = 0;
+            for (const qrcore::OverlayRect& selection : path) {
+                auto start = Clock::now();
+                qrcore::ImageFrame back = qrcore::AllocateFrame(screen.width, screen.height, qrcore::PixelFormat::BGRX);
+                RenderOverlayReference(back, selection, true);
+                rects.assign(1, {0, 0, screen.width, screen.height});
+                PresentRects(back, fullScreen, rects);
+                samples.push_back(ElapsedMs(start));
+                pixels += (int64_t)screen.width * screen.height;
+            }
+            stats[0] = Summarize(samples);
+            pixelsPerFrame[0] = (double)pixels / path.size();
+        }
+
+        // dirty: 常驻后备缓冲区, 只重绘、复制脏矩形
+        {
+            qrcore::ImageFrame back = qrcore::AllocateFrame(screen.width, screen.height, qrcore::PixelFormat::BGRX);
+            qrcore::OverlayCompositor compositor;
+            std::string errorMsg;
+            compositor.Attach(back, errorMsg);
+            std::vector<qrcore::OverlayRect> rects;
+            rects.reserve(32);
+            compositor.Flush(rects); // 覆盖层显示时的首次整屏绘制, 不计入
+            PresentRects(back, dirtyScreen, rects);
+
+            std::vector<double> samples;
+            int64_t pixels = 0;
+            for (const qrcore::OverlayRect& selection : path) {
+                auto start = Clock::now();
+                compositor.SetSelection(selection, true);
+                compositor.Flush(rects);
+                PresentRects(back, dirtyScreen, rects);
+                samples.push_back(ElapsedMs(start));
+                for (const qrcore::OverlayRect& rect : rects) {
+                    pixels += rect.area();
+                }
+            }
+            stats[1] = Summarize(samples);
+            pixelsPerFrame[1] = (double)pixels / path.size();
+        }
+
+        const char* modes[2] = {"full", "dirty"};
+        for (int m = 0; m < 2; m++) {
+            char extra[96];
+            snprintf(extra, sizeof(extra), ",\"width\":%d,\"height\":%d,\"pixels_per_frame\":%.0f", screen.width,
+                     screen.height, pixelsPerFrame[m]);
+            EmitRecord("overlay", std::string(screen.name) + "/" + modes[m], stats[m], extra);
+        }
+        fprintf(stderr, "%-6s full %8.3f / %8.3f ms (%9.0f 像素)  dirty %7.3f / %7.3f ms (%7.0f 像素)\n", screen.name,
+                stats[0].p50, stats[0].p99, pixelsPerFrame[0], stats[1].p50, stats[1].p99, pixelsPerFrame[1]);
+        Check(FramesEqual(fullScreen, dirtyScreen), "两种做法最终的屏幕内容一致");
+        Check(pixelsPerFrame[1] * 20 < pixelsPerFrame[0], "增量重绘每帧处理的像素不到整屏的 5%");
+        Check(stats[1].p50 < stats[0].p50, "增量重绘每帧耗时低于整屏重绘");
+    }
+}
+
+// ---------------------------------------------------------------------------
+// freeze: 覆盖层定格截图与选区截取视图
+//
+// 先检查 CropFrame 截取视图: 指向原帧内存 (行字节数不变、首地址按行列偏移)、共用 owner,
+// 超出原帧的部分被裁掉, 完全在外时为空帧; 截取视图的截取与直接截取一致; 原帧释放后视图仍有效,
+// 视图释放前缓冲区不回到帧缓冲池。再检查带背景图的覆盖层: 增量重绘与整幅重绘一致, 背景按 backgroundDim 变暗。
+// 再模拟选定后把选区交给识别 (4K 整屏):
+//   recapture  旧做法: 覆盖层关闭后再截一次选区 (从截图池取帧并复制像素, 代替 BitBlt)
+//   crop       定格截图上的截取视图
+// 以及覆盖层打开时以变暗的截图整幅绘制后备缓冲区的耗时 (1080p / 4K / 5K)。
+// ---------------------------------------------------------------------------
+
+static void CheckFreezeFrame() {
+    bool released = false;
+    qrcore::ImageFrame screen;
+    {
+        qrcore::ImageFrame allocated = qrcore::AllocateFrame(640, 360, qrcore::PixelFormat::BGRX);
+        std::shared_ptr<void> owner(allocated.owner.get(), [&released, keep = allocated.owner](void*) { released = true; });
+        screen = qrcore::WrapFrame(allocated.data, allocated.width, allocated.height, allocated.stride, allocated.format, owner);
+    }
+    for (int y = 0; y < screen.height; y++) {
+        for (int x = 0; x < screen.width * 4; x++) {
+            screen.row(y)[x] = (uint8_t)(x * 7 + y * 13);
+        }
+    }
+
+    qrcore::ImageFrame crop = qrcore::CropFrame(screen, 100, 50, 200, 120);
+    Check(crop.data == screen.row(50) + 100 * 4 && crop.stride == screen.stride && crop.width == 200 && crop.height == 120 &&
+              crop.owner == screen.owner,
+          "截取视图指向原帧内存, 行字节数不变并共用 owner");
+    bool same = true;
+    for (int y = 0; y < crop.height; y++) {
+        same = same && memcmp(crop.row(y), screen.row(50 + y) + 100 * 4, (size_t)crop.width * 4) == 0;
+    }
+    Check(same, "截取视图的像素与原帧对应区域一致");
+    crop.row(0)[0] = 0xAB;
+    Check(screen.row(50)[100 * 4] == 0xAB, "截取视图不复制像素 (写入在原帧可见)");
+
+    qrcore::ImageFrame nested = qrcore::CropFrame(crop, 10, 20, 30, 40);
+    qrcore::ImageFrame direct = qrcore::CropFrame(screen, 110, 70, 30, 40);
+    Check(nested.data == direct.data && nested.width == direct.width && nested.height == direct.height, "截取视图的截取与直接截取一致");
+
+    qrcore::ImageFrame clipped = qrcore::CropFrame(screen, -20, -10, 100, 60);
+    Check(clipped.data == screen.data && clipped.width == 80 && clipped.height == 50, "左上超出原帧的部分被裁掉");
+    clipped = qrcore::CropFrame(screen, 600, 300, 100, 100);
+    Check(clipped.width == 40 && clipped.height == 60, "右下超出原帧的部分被裁掉");
+    Check(qrcore::CropFrame(screen, 700, 10, 50, 50).empty() && qrcore::CropFrame(screen, 10, 10, 0, 50).empty() &&
+              qrcore::CropFrame(qrcore::ImageFrame(), 0, 0, 10, 10).empty(),
+          "完全在原帧外或尺寸为 0 时为空帧");
+    nested = qrcore::ImageFrame();
+    direct = qrcore::ImageFrame();
+    clipped = qrcore::ImageFrame();
+
+    screen = qrcore::ImageFrame();
+    Check(!released && crop.row(crop.height - 1)[crop.width * 4 - 1] == (uint8_t)((299 * 4 + 3) * 7 + 169 * 13),
+          "原帧释放后截取视图仍有效");
+    crop = qrcore::ImageFrame();
+    Check(released, "最后一个截取视图释放时释放原帧内存");
+
+    // 截取视图持有池中的缓冲区: 视图释放前不被复用
+    qrcore::FramePool pool;
+    qrcore::ImageFrame pooled = pool.Acquire(800, 600, qrcore::PixelFormat::BGRX);
+    uint8_t* pooledData = pooled.data;
+    qrcore::ImageFrame view = qrcore::CropFrame(pooled, 100, 100, 300, 200);
+    pooled = qrcore::ImageFrame();
+    qrcore::ImageFrame other = pool.Acquire(800, 600, qrcore::PixelFormat::BGRX);
+    Check(other.data != pooledData, "截取视图释放前缓冲区不回到池中");
+    other = qrcore::ImageFrame();
+    view = qrcore::ImageFrame();
+    qrcore::ImageFrame again = pool.Acquire(800, 600, qrcore::PixelFormat::BGRX);
+    Check(again.data == pooledData || pool.GetStats().reused >= 1, "截取视图释放后缓冲区回到池中");
+    again = qrcore::ImageFrame();
+
+    // 带背景图的覆盖层
+    const int width = 320, height = 200;
+    qrcore::ImageFrame background = qrcore::AllocateFrame(width - 20, height, qrcore::PixelFormat::BGRX); // 右侧 20 列无背景
+    for (int y = 0; y < background.height; y++) {
+        for (int x = 0; x < background.width * 4; x++) {
+            background.row(y)[x] = (uint8_t)(x * 3 + y * 5);
+        }
+    }
+    qrcore::ImageFrame back = qrcore::AllocateFrame(width, height, qrcore::PixelFormat::BGRX);
+    qrcore::ImageFrame expected = qrcore::AllocateFrame(width, height, qrcore::PixelFormat::BGRX);
+    qrcore::OverlayCompositor compositor;
+    std::string errorMsg;
+    compositor.Attach(back, errorMsg);
+    Check(compositor.SetBackground(background, errorMsg), "设置背景图");
+    std::vector<qrcore::OverlayRect> rects;
+    compositor.Flush(rects);
+    uint8_t sample = background.row(7)[11 * 4 + 2];
+    Check(back.row(7)[11 * 4 + 2] == (uint8_t)((sample * 128) >> 8) && back.row(7)[(width - 1) * 4 + 2] == 0,
+          "背景图按 backgroundDim 变暗, 未覆盖的部分为背景色");
+
+    std::mt19937 rng(25);
+    bool consistent = true;
+    for (int move = 0; move < 60 && consistent; move++) {
+        int x0 = (int)(rng() % width), y0 = (int)(rng() % height);
+        int x1 = (int)(rng() % width), y1 = (int)(rng() % height);
+        qrcore::OverlayRect selection = {std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1)};
+        compositor.SetSelection(selection, true);
+        compositor.Flush(rects);
+
+        qrcore::OverlayCompositor reference;
+        reference.Attach(expected, errorMsg);
+        reference.SetBackground(background, errorMsg);
+        reference.SetSelection(selection, true);
+        std::vector<qrcore::OverlayRect> all;
+        reference.Flush(all);
+        consistent = FramesEqual(back, expected);
+    }
+    Check(consistent, "有背景图时增量重绘与整幅重绘一致");
+    Check(compositor.SetBackground(qrcore::ImageFrame(), errorMsg) && !compositor.SetBackground(qrcore::AllocateFrame(8, 8, qrcore::PixelFormat::Lum), errorMsg),
+          "空帧恢复纯色背景, 非 BGRX 背景图被拒绝");
+}
+
+static void BenchFreezeFrame(const BenchOptions& options) {
+    CheckFreezeFrame();
+
+    // 选定后交给识别的帧
+    const int screenWidth = 3840, screenHeight = 2160;
+    qrcore::ImageFrame screen = qrcore::AllocateFrame(screenWidth, screenHeight, qrcore::PixelFormat::BGRX);
+    memset(screen.data, 0x80, screen.byteSize());
+    qrcore::FramePool capturePool;
+    struct Selection {
+        const char* name;
+        int width;
+        int height;
+    };
+    const Selection selections[] = {{"400x400", 400, 400}, {"1280x720", 1280, 720}, {"3000x1800", 3000, 1800}};
+    fprintf(stderr, "\n[freeze] 选定后交给识别的帧 (4K 屏幕, p50)\n");
+    for (const Selection& selection : selections) {
+        int left = (screenWidth - selection.width) / 2, top = (screenHeight - selection.height) / 2;
+        LatencyStats stats[2];
+        for (int mode = 0; mode < 2; mode++) {
+            std::vector<double> samples;
+            for (int i = 0; i < options.iterations; i++) {
+                auto start = Clock::now();
+                qrcore::ImageFrame frame;
+                if (mode == 0) {
+                    frame = capturePool.Acquire(selection.width, selection.height, qrcore::PixelFormat::BGRX);
+                    for (int y = 0; y < selection.height; y++) {
+                        memcpy(frame.row(y), screen.row(top + y) + (size_t)left * 4, (size_t)selection.width * 4);
+                    }
+                } else {
+                    frame = qrcore::CropFrame(screen, left, top, selection.width, selection.height);
+                }
+                samples.push_back(ElapsedMs(start));
+                Check(frame.width == selection.width && frame.row(frame.height - 1)[0] == 0x80, "交给识别的帧内容正确");
+            }
+            stats[mode] = Summarize(samples);
+            char extra[64];
+            snprintf(extra, sizeof(extra), ",\"width\":%d,\"height\":%d", selection.width, selection.height);
+            EmitRecord("freeze", std::string(selection.name) + (mode == 0 ? "/recapture" : "/crop"), stats[mode], extra);
+        }
+        fprintf(stderr, "%-10s recapture %8.3f ms  crop %8.4f ms\n", selection.name, stats[0].p50, stats[1].p50);
+        Check(stats[1].p50 <= stats[0].p50, "截取视图不慢于再次截图");
+    }
+
+    // 覆盖层打开时以变暗的截图整幅绘制
+    struct Screen {
+        const char* name;
+        int width;
+        int height;
+    };
+    const Screen screens[] = {{"1080p", 1920, 1080}, {"4k", 3840, 2160}, {"5k", 5120, 2880}};
+    fprintf(stderr, "\n[freeze] 覆盖层首次绘制 (变暗的定格截图, p50)\n");
+    for (const Screen& size : screens) {
+        qrcore::ImageFrame shot = qrcore::AllocateFrame(size.width, size.height, qrcore::PixelFormat::BGRX);
+        memset(shot.data, 0xC0, shot.byteSize());
+        qrcore::ImageFrame back = qrcore::AllocateFrame(size.width, size.height, qrcore::PixelFormat::BGRX);
+        qrcore::OverlayCompositor compositor;
+        std::string errorMsg;
+        compositor.Attach(back, errorMsg);
+        std::vector<qrcore::OverlayRect> rects;
+        std::vector<double> samples;
+        for (int i = 0; i < options.iterations; i++) {
+            auto start = Clock::now();
+            compositor.SetBackground(shot, errorMsg);
+            compositor.Flush(rects);
+            samples.push_back(ElapsedMs(start));
+        }
+        LatencyStats stats = Summarize(samples);
+        char extra[64];
+        snprintf(extra, sizeof(extra), ",\"width\":%d,\"height\":%d", size.width, size.height);
+        EmitRecord("freeze", std::string(size.name) + "/first_paint", stats, extra);
+        fprintf(stderr, "%-6s %8.3f ms\n", size.name, stats.p50);
+        Check(back.row(size.height - 1)[0] == (0xC0 * 128) >> 8, "首次绘制为变暗的截图");
+    }
+}
+
+// ---------------------------------------------------------------------------
+// worker: 解码工作线程
+//
+// 先检查: 未启动或已停止时拒绝提交; 回调按提交顺序在同一个工作线程上调用;
+// 停止时丢弃尚未开始的任务且不调用其回调, 正在执行的任务照常完成; 停止后可重新启动。
+// 再对比 (640x480 选区, 默认级联):
+//   direct   截图线程上直接识别 (原先的做法, 阻塞调用方)
+//   worker   提交到工作线程, 从提交到回调的延迟 (含线程切换与排队)
+// 以及连续提交 N 个任务时的吞吐 (次/秒)。
+// ---------------------------------------------------------------------------
+
+static void CheckDecodeWorker() {
+    qrcore::DecodeWorker worker;
+    qrcore::ImageFrame frame = qrcore::AllocateFrame(64, 64, qrcore::PixelFormat::Lum);
+    memset(frame.data, 0xFF, frame.byteSize());
+    auto cascade = std::make_shared<qrcore::CascadeConfig>(qrcore::DefaultCascade());
+    cascade->tiers.resize(1);
+    auto makeJob = [&frame, &cascade]() {
+        qrcore::DecodeJob job;
+        job.frame = frame;
+        job.cascade = cascade;
+        return job;
+    };
+    Check(!worker.Submit(makeJob(), nullptr), "未启动时拒绝提交");
+
+    worker.Start();
+    qrcore::DecodeJob unconfigured;
+    unconfigured.frame = frame;
+    Check(!worker.Submit(std::move(unconfigured), nullptr), "未给出识别配置时拒绝提交");
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<int> order;
+    std::vector<std::thread::id> threads;
+    const int jobs = 16;
+    for (int i = 0; i < jobs; i++) {
+        worker.Submit(makeJob(), [&, i](std::unique_ptr<qrcore::ScanResult> result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(result ? i : -1);
+            threads.push_back(std::this_thread::get_id());
+            cv.notify_all();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::seconds(30), [&] { return (int)order.size() == jobs; });
+    }
+    bool inOrder = (int)order.size() == jobs;
+    for (int i = 0; i < (int)order.size(); i++) {
+        inOrder = inOrder && order[i] == i;
+    }
+    Check(inOrder, "回调按提交顺序调用, 每个都带结果");
+    bool sameThread = !threads.empty() && threads[0] != std::this_thread::get_id();
+    for (const std::thread::id& id : threads) {
+        sameThread = sameThread && id == threads[0];
+    }
+    Check(sameThread, "回调都在同一个工作线程上调用");
+
+    // 第一个任务的回调阻塞住工作线程, 其后的任务在停止时仍在排队
+    std::atomic<bool> release{false};
+    std::atomic<bool> firstStarted{false};
+    std::atomic<int> dropped{0};
+    worker.Submit(makeJob(), [&](std::unique_ptr<qrcore::ScanResult>) {
+        firstStarted = true;
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    while (!firstStarted) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (int i = 0; i < 4; i++) {
+        worker.Submit(makeJob(), [&](std::unique_ptr<qrcore::ScanResult>) { dropped++; });
+    }
+    Check(worker.PendingCount() == 4, "工作线程忙时新任务排队");
+    std::thread stopper([&worker]() { worker.Stop(); });
+    while (worker.PendingCount() != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    release = true;
+    stopper.join();
+    Check(dropped == 0, "停止时丢弃尚未开始的任务, 不调用其回调");
+    Check(!worker.Submit(makeJob(), nullptr), "停止后拒绝提交");
+
+    worker.Start();
+    std::atomic<bool> done{false};
+    worker.Submit(makeJob(), [&](std::unique_ptr<qrcore::ScanResult>) { done = true; });
+    for (int i = 0; i < 30000 && !done; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    Check(done, "停止后可重新启动");
+    worker.Stop();
+}
+
+static void BenchDecodeWorker(const BenchOptions& options) {
+    CheckDecodeWorker();
+
+    qrtools::SyntheticCode code;
+    if (!qrtools::EncodeText("https://example.com/worker", qrcodegen::QrCode::Ecc::MEDIUM, code)) {
+        Check(false, "生成解码线程的测试二维码");
+        return;
+    }
+    qrcore::ImageFrame frame = qrtools::ToBGRX(qrtools::RenderSample(code, 4, 640, 480, true));
+    qrcore::CascadeConfig cascade = qrcore::DefaultCascade();
+    cascade.budgetMs = 0;
+    auto sharedCascade = std::make_shared<const qrcore::CascadeConfig>(cascade);
+
+    std::vector<double> direct;
+    for (int i = 0; i < options.iterations; i++) {
+        qrcore::ScanResult result;
+        auto start = Clock::now();
+        qrcore::RunCascade(frame, cascade, result);
+        direct.push_back(ElapsedMs(start));
+    }
+
+    qrcore::DecodeWorker worker;
+    worker.Start();
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<double> latency;
+    int decoded = 0;
+    for (int i = 0; i < options.iterations; i++) {
+        qrcore::DecodeJob job;
+        job.frame = frame;
+        job.cascade = sharedCascade;
+        bool finished = false;
+        auto start = Clock::now();
+        worker.Submit(std::move(job), [&](std::unique_ptr<qrcore::ScanResult> result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            latency.push_back(ElapsedMs(start));
+            decoded += result->success && result->text == code.text ? 1 : 0;
+            finished = true;
+            cv.notify_all();
+        });
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return finished; });
+    }
+
+    // 吞吐: 连续提交, 等全部回调
+    const int batch = options.quick ? 20 : 100;
+    int completed = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < batch; i++) {
+        qrcore::DecodeJob job;
+        job.frame = frame;
+        job.cascade = sharedCascade;
+        worker.Submit(std::move(job), [&](std::unique_ptr<qrcore::ScanResult>) {
+            std::lock_guard<std::mutex> lock(mutex);
+            completed++;
+            cv.notify_all();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return completed == batch; });
+    }
+    double batchMs = ElapsedMs(start);
+    worker.Stop();
+
+    LatencyStats directStats = Summarize(direct);
+    LatencyStats workerStats = Summarize(latency);
+    double perSecond = batchMs > 0 ? batch * 1000.0 / batchMs : 0.0;
+    EmitRecord("worker", "direct", directStats, "");
+    char extra[64];
+    snprintf(extra, sizeof(extra), ",\"per_s\":%.1f", perSecond);
+    EmitRecord("worker", "worker", workerStats, extra);
+    fprintf(stderr, "\n[worker] 640x480 默认级联: 直接识别 p50 %.3f ms, 经工作线程 p50 %.3f ms (p99 %.3f), 吞吐 %.1f 次/秒\n",
+            directStats.p50, workerStats.p50, workerStats.p99, perSecond);
+    Check(decoded == options.iterations, "经工作线程识别出合成的二维码");
+}
+
+// ---------------------------------------------------------------------------
+// convert: 灰度转换内核
+//
+// 先检查 SSE2 / AVX2 与标量参考逐字节一致: 每种像素格式 (BGRX / RGB / BGR / Lum), 奇数及不足一个
+// 向量的宽度, 行首不对齐 (源行偏移 0~3 像素), 且不写出 width 之后的字节; 标量参考与 RGBToLum 一致;
+// ConvertToLum 截取区域的结果与逐行标量转换一致。超出 CPU 支持的级别按支持的最高级别执行。
+// 再测 1080p / 4K 整帧转换 (各 SIMD 级别, 各格式) 的耗时与吞吐 (百万像素/秒)。
+// ---------------------------------------------------------------------------
+
+static void CheckConvert() {
+    const qrcore::PixelFormat formats[] = {qrcore::PixelFormat::BGRX, qrcore::PixelFormat::RGB, qrcore::PixelFormat::BGR,
+                                           qrcore::PixelFormat::Lum};
+    const qrcore::SimdLevel levels[] = {qrcore::SimdLevel::SSE2, qrcore::SimdLevel::AVX2};
+    std::vector<int> widths;
+    for (int w = 1; w <= 70; w++) {
+        widths.push_back(w);
+    }
+    widths.insert(widths.end(), {95, 127, 129, 255, 257, 1023, 1921});
+
+    std::mt19937 rng(4);
+    std::vector<uint8_t> src((1921 + 8) * 4);
+    for (uint8_t& b : src) {
+        b = (uint8_t)rng();
+    }
+    const int guard = 32;
+    std::vector<uint8_t> expected(1921 + guard), actual(1921 + guard);
+    int mismatches = 0, overruns = 0;
+    for (qrcore::PixelFormat format : formats) {
+        int bpp = qrcore::BytesPerPixel(format);
+        for (int width : widths) {
+            for (int offset = 0; offset < 4; offset++) {
+                const uint8_t* row = src.data() + (size_t)offset * bpp;
+                std::fill(expected.begin(), expected.end(), 0xCD);
+                qrcore::ConvertRowToLum(qrcore::SimdLevel::Scalar, row, format, expected.data(), width);
+                for (qrcore::SimdLevel level : levels) {
+                    std::fill(actual.begin(), actual.end(), 0xCD);
+                    qrcore::ConvertRowToLum(level, row, format, actual.data(), width);
+                    mismatches += memcmp(actual.data(), expected.data(), width) != 0 ? 1 : 0;
+                    for (int i = width; i < width + guard; i++) {
+                        overruns += actual[i] != 0xCD ? 1 : 0;
+                    }
+                }
+            }
+        }
+    }
+    Check(mismatches == 0, "SSE2 / AVX2 与标量参考逐字节一致 (各格式、宽度、行首偏移)");
+    Check(overruns == 0, "不写出 width 之后的字节");
+
+    bool reference = true;
+    uint8_t lum[64];
+    qrcore::ConvertRowToLum(qrcore::SimdLevel::Scalar, src.data(), qrcore::PixelFormat::BGRX, lum, 64);
+    for (int x = 0; x < 64; x++) {
+        reference = reference && lum[x] == qrcore::RGBToLum(src[x * 4 + 2], src[x * 4 + 1], src[x * 4]);
+    }
+    qrcore::ConvertRowToLum(qrcore::SimdLevel::Scalar, src.data(), qrcore::PixelFormat::RGB, lum, 64);
+    for (int x = 0; x < 64; x++) {
+        reference = reference && lum[x] == qrcore::RGBToLum(src[x * 3], src[x * 3 + 1], src[x * 3 + 2]);
+    }
+    Check(reference, "标量参考与 RGBToLum 的权重一致");
+
+    // 截取区域转换 (源帧带行尾填充, 截取起点不对齐)
+    qrcore::ImageFrame frame = qrcore::AllocateFrame(301, 77, qrcore::PixelFormat::BGRX, 64);
+    for (int y = 0; y < frame.height; y++) {
+        for (int x = 0; x < frame.width * 4; x++) {
+            frame.row(y)[x] = (uint8_t)rng();
+        }
+    }
+    bool cropped = true;
+    for (qrcore::SimdLevel level : {qrcore::SimdLevel::Scalar, qrcore::SimdLevel::SSE2, qrcore::SimdLevel::AVX2}) {
+        qrcore::SetSimdLevel(level);
+        qrcore::ImageFrame out;
+        cropped = cropped && qrcore::ConvertToLum(frame, 13, 5, 250, 60, out) && out.width == 250 && out.height == 60;
+        for (int y = 0; cropped && y < out.height; y++) {
+            qrcore::ConvertRowToLum(qrcore::SimdLevel::Scalar, frame.row(5 + y) + 13 * 4, frame.format, expected.data(), 250);
+            cropped = memcmp(out.row(y), expected.data(), 250) == 0;
+        }
+    }
+    qrcore::SetSimdLevel(qrcore::DetectSimdLevel());
+    Check(cropped, "ConvertToLum 截取区域与逐行标量转换一致 (各级别)");
+    Check(qrcore::ClampSimdLevel(qrcore::SimdLevel::AVX2) == qrcore::DetectSimdLevel() &&
+              qrcore::ClampSimdLevel(qrcore::SimdLevel::Scalar) == qrcore::SimdLevel::Scalar,
+          "指定级别限制到 CPU 支持的最高级别");
+}
+
+static void BenchConvert(const BenchOptions& options) {
+    CheckConvert();
+
+    struct Size {
+        const char* name;
+        int width;
+        int height;
+    };
+    const Size sizes[] = {{"1080p", 1920, 1080}, {"4k", 3840, 2160}};
+    const qrcore::PixelFormat formats[] = {qrcore::PixelFormat::BGRX, qrcore::PixelFormat::RGB};
+    const char* formatNames[] = {"bgrx", "rgb"};
+    const qrcore::SimdLevel levels[] = {qrcore::SimdLevel::Scalar, qrcore::SimdLevel::SSE2, qrcore::SimdLevel::AVX2};
+
+    fprintf(stderr, "\n[convert] 整帧灰度转换 (p50 毫秒 / 百万像素每秒), CPU 支持: %s\n",
+            qrcore::SimdLevelName(qrcore::DetectSimdLevel()));
+    std::mt19937 rng(4);
+    for (const Size& size : sizes) {
+        for (int f = 0; f < 2; f++) {
+            qrcore::ImageFrame frame = qrcore::AllocateFrame(size.width, size.height, formats[f]);
+            for (size_t i = 0; i < frame.byteSize(); i++) {
+                frame.data[i] = (uint8_t)rng();
+            }
+            qrcore::ImageFrame lum = qrcore::AllocateFrame(size.width, size.height, qrcore::PixelFormat::Lum);
+            fprintf(stderr, "%-6s %-5s", size.name, formatNames[f]);
+            for (qrcore::SimdLevel level : levels) {
+                if (qrcore::ClampSimdLevel(level) != level) {
+                    fprintf(stderr, "  %s n/a", qrcore::SimdLevelName(level));
+                    continue; // CPU 不支持
+                }
+                std::vector<double> samples;
+                for (int i = 0; i < options.iterations; i++) {
+                    auto start = Clock::now();
+                    for (int y = 0; y < frame.height; y++) {
+                        qrcore::ConvertRowToLum(level, frame.row(y), frame.format, lum.row(y), frame.width);
+                    }
+                    samples.push_back(ElapsedMs(start));
+                }
+                LatencyStats stats = Summarize(samples);
+                double mpixPerSecond = stats.p50 > 0 ? (double)size.width * size.height / 1000.0 / stats.p50 : 0.0;
+                char extra[128];
+                snprintf(extra, sizeof(extra), ",\"simd\":\"%s\",\"format\":\"%s\",\"mpix_per_s\":%.1f",
+                         qrcore::SimdLevelName(level), formatNames[f], mpixPerSecond);
+                EmitRecord("convert", std::string(size.name) + "/" + formatNames[f] + "/" + qrcore::SimdLevelName(level),
+                           stats, extra);
+                fprintf(stderr, "  %s %7.3f ms (%6.0f)", qrcore::SimdLevelName(level), stats.p50, mpixPerSecond);
+            }
+            fprintf(stderr, "\n");
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// multicode: 多码识别
+//
+// 先检查去重和阅读顺序: 行内纵坐标有抖动的码阵, 以任意顺序输入都排成自上而下、自左而右;
+// 沿一行逐渐下斜的码 (相邻两个在同一行, 首尾不在) 的排列结果与输入顺序无关; 重复码只保留先出现的。
+// 再在合成画布上按 2 行 × 3 列绘制 6 个不同内容的码, 多码识别应按阅读顺序全部识别出来。
+// 最后测画布上码数 1 / 2 / 4 / 8 / 16 时多码识别 (DecodeFrame, 以及默认级联) 的耗时,
+// 输出每多一个码增加的耗时。
+// ---------------------------------------------------------------------------
+
+// 以 (cx, cy) 为中心、边长 size 的轴对齐码
+static qrcore::DecodedSymbol MakeSymbolAt(const std::string& text, int cx, int cy, int size) {
+    qrcore::DecodedSymbol symbol;
+    symbol.text = text;
+    symbol.format = "QRCode";
+    int half = size / 2;
+    symbol.position.topLeft = {cx - half, cy - half};
+    symbol.position.topRight = {cx + half, cy - half};
+    symbol.position.bottomRight = {cx + half, cy + half};
+    symbol.position.bottomLeft = {cx - half, cy + half};
+    return symbol;
+}
+
+static std::string SymbolOrder(const std::vector<qrcore::DecodedSymbol>& symbols) {
+    std::string order;
+    for (const qrcore::DecodedSymbol& symbol : symbols) {
+        order += symbol.text + " ";
+    }
+    return order;
+}
+
+// 在画布上按 columns 列铺 count 个不同内容的码 (版本 3, 每模块 4 像素), 返回按阅读顺序的内容
+static std::vector<std::string> DrawCodeGrid(int count, int columns, qrcore::ImageFrame& canvas) {
+    std::vector<std::string> texts;
+    const int moduleSize = 4;
+    for (int i = 0; i < count; i++) {
+        qrtools::SyntheticCode code;
+        if (!qrtools::EncodeForVersion(3, qrcodegen::QrCode::Ecc::MEDIUM, 500 + i, code)) {
+            continue;
+        }
+        int cell = (code.qr->getSize() + 8) * moduleSize + 16;
+        qrtools::DrawQrCode(*code.qr, moduleSize, 16 + (i % columns) * cell, 16 + (i / columns) * cell, canvas);
+        texts.push_back(code.text);
+    }
+    return texts;
+}
+
+static void CheckMultiCode() {
+    // 3 行 × 4 列, 码高 100, 行内纵坐标抖动不超过 ±20
+    std::vector<qrcore::DecodedSymbol> grid;
+    std::string expected;
+    const int jitter[12] = {0, 17, -12, 20, -20, 5, 11, -3, 8, -19, 15, 0};
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            std::string text = std::to_string(row) + std::to_string(col);
+            grid.push_back(MakeSymbolAt(text, 100 + col * 150, 100 + row * 160 + jitter[row * 4 + col], 100));
+            expected += text + " ";
+        }
+    }
+    std::mt19937 rng(5);
+    bool ordered = true;
+    for (int round = 0; round < 50; round++) {
+        std::vector<qrcore::DecodedSymbol> symbols = grid;
+        std::shuffle(symbols.begin(), symbols.end(), rng);
+        qrcore::DeduplicateSymbols(symbols);
+        ordered = ordered && SymbolOrder(symbols) == expected;
+    }
+    Check(ordered, "多码按阅读顺序排列 (任意输入顺序, 行内纵坐标有抖动)");
+
+    // 逐渐下斜的一行: 相邻两码纵坐标差小于半个码高, 首尾之差大于半个码高 ("同一行" 不可传递)
+    std::vector<qrcore::DecodedSymbol> slanted;
+    for (int i = 0; i < 8; i++) {
+        slanted.push_back(MakeSymbolAt("s" + std::to_string(i), 100 + i * 120, 100 + i * 30, 100));
+    }
+    std::string reference;
+    bool stable = true;
+    for (int round = 0; round < 50; round++) {
+        std::vector<qrcore::DecodedSymbol> symbols = slanted;
+        std::shuffle(symbols.begin(), symbols.end(), rng);
+        qrcore::DeduplicateSymbols(symbols);
+        std::string order = SymbolOrder(symbols);
+        if (round == 0) {
+            reference = order;
+        }
+        stable = stable && order == reference && symbols.size() == slanted.size();
+    }
+    Check(stable, "排列结果与输入顺序无关 (下斜的一行)");
+
+    std::vector<qrcore::DecodedSymbol> duplicated = {MakeSymbolAt("a", 300, 100, 100), MakeSymbolAt("b", 100, 100, 100),
+                                                     MakeSymbolAt("a", 100, 400, 100)};
+    qrcore::DeduplicateSymbols(duplicated);
+    Check(SymbolOrder(duplicated) == "b a " && duplicated.size() == 2 && duplicated[1].position.center().x == 300,
+          "重复码只保留先出现的一个");
+
+    // 合成画布上的多码识别
+    qrcore::ImageFrame canvas = qrtools::MakeCanvas(1280, 720);
+    std::vector<std::string> texts = DrawCodeGrid(6, 3, canvas);
+    qrcore::ScanOptions options;
+    options.maxSymbols = 0;
+    qrcore::ScanResult result;
+    qrcore::DecodeFrame(qrtools::ToBGRX(canvas), options, result);
+    std::vector<std::string> decoded;
+    for (const qrcore::DecodedSymbol& symbol : result.symbols) {
+        decoded.push_back(symbol.text);
+    }
+    Check(texts.size() == 6 && decoded == texts, "多码识别按阅读顺序识别出画布上的全部 6 个码");
+}
+
+static void BenchMultiCode(const BenchOptions& options) {
+    CheckMultiCode();
+
+    fprintf(stderr, "\n[multicode] 1920x1080 画布上的码数 - 多码识别耗时 (毫秒), %d 次/用例\n", options.iterations);
+    fprintf(stderr, "%-6s %-8s %6s %10s %10s %14s\n", "码数", "方式", "识别数", "p50", "p95", "每多一个码");
+    qrcore::ScanOptions scanOptions;
+    scanOptions.maxSymbols = 0;
+    qrcore::CascadeConfig cascade = qrcore::DefaultCascade();
+    double baseline[2] = {0, 0};
+    for (int count : {1, 2, 4, 8, 16}) {
+        qrcore::ImageFrame canvas = qrtools::MakeCanvas(1920, 1080);
+        DrawCodeGrid(count, 8, canvas);
+        qrcore::ImageFrame frame = qrtools::ToBGRX(canvas);
+        for (int method = 0; method < 2; method++) {
+            std::vector<double> samples;
+            size_t found = 0;
+            for (int i = 0; i < options.iterations; i++) {
+                qrcore::ScanResult result;
+                auto start = Clock::now();
+                if (method == 0) {
+                    qrcore::DecodeFrame(frame, scanOptions, result);
+                } else {
+                    qrcore::RunCascade(frame, cascade, result);
+                }
+                samples.push_back(ElapsedMs(start));
+                found = result.symbols.size();
+            }
+            LatencyStats stats = Summarize(samples);
+            if (count == 1) {
+                baseline[method] = stats.p50;
+            }
+            double perExtra = count > 1 ? (stats.p50 - baseline[method]) / (count - 1) : 0.0;
+            const char* name = method == 0 ? "decode" : "cascade";
+            char extra[128];
+            snprintf(extra, sizeof(extra), ",\"codes\":%d,\"found\":%zu,\"ms_per_extra_code\":%.4f", count, found, perExtra);
+            EmitRecord("multicode", std::string(name) + "/" + std::to_string(count), stats, extra);
+            fprintf(stderr, "%-6d %-8s %6zu %10.3f %10.3f %14.3f\n", count, name, found, stats.p50, stats.p95, perExtra);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// tiling: 全屏分块识别
+//
+// 4K (3840x2160) / 5K (5120x2880) 合成屏幕 (灰色杂物背景) 上放几个码, 其中一个跨在分块边界上,
+// 按默认分块配置并行识别整屏, 分别测共用默认时间预算和不限预算时的耗时。
+// 检查: 不限预算时识别出全部码 (跨边界的码完整落在某个重叠分块内);
+// 预算很小时各分块共用截止时间, 总耗时不超过预算加一次灰度转换和单个分块一层识别的耗时, 且置 budgetExceeded。
+// ---------------------------------------------------------------------------
+
+// 合成屏幕: 杂物背景上放 4 个码, 第一个跨在第一列与第二列分块的边界上; 返回各码内容
+static std::vector<std::string> MakeTilingScreen(int width, int height, qrcore::ImageFrame& outFrame) {
+    qrcore::ImageFrame canvas = qrtools::MakeCanvas(width, height);
+    qrtools::FillClutter(canvas, 6);
+    const int moduleSize = 4;
+    const int positions[4][2] = {{1024 - 120, 300}, {width / 2, height / 2}, {width - 400, 200}, {200, height - 400}};
+    std::vector<std::string> texts;
+    for (int i = 0; i < 4; i++) {
+        qrtools::SyntheticCode code;
+        if (qrtools::EncodeForVersion(4, qrcodegen::QrCode::Ecc::MEDIUM, 600 + i, code)) {
+            qrtools::DrawQrCode(*code.qr, moduleSize, positions[i][0], positions[i][1], canvas);
+            texts.push_back(code.text);
+        }
+    }
+    outFrame = qrtools::ToBGRX(canvas);
+    return texts;
+}
+
+static bool FoundAllTexts(const qrcore::ScanResult& result, const std::vector<std::string>& texts) {
+    for (const std::string& text : texts) {
+        bool found = false;
+        for (const qrcore::DecodedSymbol& symbol : result.symbols) {
+            found = found || symbol.text == text;
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return !texts.empty();
+}
+
+static void CheckTiling() {
+    qrcore::ImageFrame frame;
+    std::vector<std::string> texts = MakeTilingScreen(3840, 2160, frame);
+
+    qrcore::TileScanConfig config;
+    config.cascade = qrcore::DefaultCascade();
+    config.cascade.budgetMs = 0;
+    qrcore::ScanResult result;
+    qrcore::ScanTiles(frame, config, result);
+    Check(FoundAllTexts(result, texts) && result.symbols.size() == texts.size() && !result.budgetExceeded,
+          "不限预算时全屏分块识别出全部码 (含跨分块边界的码, 且不重复)");
+
+    // 单个分块执行第一层的耗时, 作为截止时间之后的最大超出量
+    qrcore::CascadeConfig first = config.cascade;
+    first.tiers.resize(1);
+    auto lumStart = Clock::now();
+    qrcore::ImageFrame lum = qrcore::ToLuminance(frame);
+    double lumMs = ElapsedMs(lumStart);
+    double tileMs = 0;
+    for (const qrcore::Tile& tile : qrcore::PartitionTiles(lum.width, lum.height, config.tileSize, config.overlap)) {
+        qrcore::ScanResult tileResult;
+        auto start = Clock::now();
+        qrcore::RunCascade(qrcore::CropFrame(lum, tile.left, tile.top, tile.width, tile.height), first, tileResult);
+        tileMs = std::max(tileMs, ElapsedMs(start));
+    }
+
+    config.cascade.budgetMs = 1;
+    size_t tileCount = qrcore::PartitionTiles(frame.width, frame.height, config.tileSize, config.overlap).size();
+    qrcore::ScanResult bounded;
+    auto start = Clock::now();
+    qrcore::ScanTiles(frame, config, bounded);
+    double boundedMs = ElapsedMs(start);
+    Check(bounded.budgetExceeded && bounded.tiersTried < (int)(tileCount * config.cascade.tiers.size()),
+          "各分块共用截止时间: 到期后不再识别剩余分块和层级");
+    Check(boundedMs <= config.cascade.budgetMs + lumMs + 2 * tileMs + 20,
+          "全屏扫码总耗时不超过预算加一次灰度转换和单个分块一层识别的耗时");
+}
+
+static void BenchTiling(const BenchOptions& options) {
+    CheckTiling();
+
+    struct Screen {
+        const char* name;
+        int width;
+        int height;
+    };
+    const Screen screens[] = {{"4k", 3840, 2160}, {"5k", 5120, 2880}};
+    const int budgets[] = {qrcore::DefaultCascade().budgetMs, 0};
+
+    fprintf(stderr, "\n[tiling] 全屏分块识别耗时 (毫秒), %d 次/用例, %u 个硬件线程\n", options.iterations,
+            std::thread::hardware_concurrency());
+    fprintf(stderr, "%-5s %-8s %6s %6s %10s %10s %10s %8s\n", "屏幕", "预算", "分块", "识别数", "p50", "p95", "max", "超出预算");
+    for (const Screen& screen : screens) {
+        qrcore::ImageFrame frame;
+        std::vector<std::string> texts = MakeTilingScreen(screen.width, screen.height, frame);
+        qrcore::TileScanConfig config;
+        config.cascade = qrcore::DefaultCascade();
+        size_t tileCount = qrcore::PartitionTiles(frame.width, frame.height, config.tileSize, config.overlap).size();
+        for (int budget : budgets) {
+            config.cascade.budgetMs = budget;
+            std::vector<double> samples;
+            size_t found = 0;
+            int exceeded = 0;
+            for (int i = 0; i < options.iterations; i++) {
+                qrcore::ScanResult result;
+                auto start = Clock::now();
+                qrcore::ScanTiles(frame, config, result);
+                samples.push_back(ElapsedMs(start));
+                found = result.symbols.size();
+                exceeded += result.budgetExceeded ? 1 : 0;
+            }
+            LatencyStats stats = Summarize(samples);
+            std::string budgetName = budget > 0 ? std::to_string(budget) + "ms" : "none";
+            char extra[160];
+            snprintf(extra, sizeof(extra), ",\"width\":%d,\"height\":%d,\"tiles\":%zu,\"budget_ms\":%d,\"codes\":%zu,"
+                     "\"found\":%zu,\"budget_exceeded\":%d",
+                     screen.width, screen.height, tileCount, budget, texts.size(), found, exceeded);
+            EmitRecord("tiling", std::string(screen.name) + "/" + budgetName, stats, extra);
+            fprintf(stderr, "%-5s %-8s %6zu %6zu %10.3f %10.3f %10.3f %8d\n", screen.name, budgetName.c_str(), tileCount,
+                    found, stats.p50, stats.p95, stats.max, exceeded);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+struct BenchEntry {
+    const char* name;
+    void (*run)(const BenchOptions&);
+};
+
+static const BenchEntry kBenches[] = {
+    {"stages", BenchStages},
+    {"pyramid", BenchPyramid},
+    {"raster", BenchRaster},
+    {"encodecache", BenchEncodeCache},
+    {"preview", BenchPreview},
+    {"png", BenchPng},
+    {"vector", BenchVector},
+    {"live", BenchLive},
+    {"change", BenchChange},
+    {"cache", BenchResultCache},
+    {"history", BenchHistory},
+    {"trace", BenchTrace},
+    {"metrics", BenchMetrics},
+    {"framepool", BenchFramePool},
+    {"overlay", BenchOverlay},
+    {"freeze", BenchFreezeFrame},
+    {"worker", BenchDecodeWorker},
+    {"convert", BenchConvert},
+    {"multicode", BenchMultiCode},
+    {"tiling", BenchTiling},
+};
+
+static void PrintUsage() {
+    fprintf(stderr, "用法: qrbench [--iterations N] [--quick] [--clipboard] [基准名...]\n"
+                    "  --iterations  每个用例的重复次数, 默认 20\n"
+                    "  --quick       只取部分二维码版本\n"
+                    "  --clipboard   测量剪贴板阶段 (仅 Windows, 会覆盖剪贴板内容)\n"
+                    "  可选基准:");
+    for (const BenchEntry& entry : kBenches) {
+        fprintf(stderr, " %s", entry.name);
+    }
+    fprintf(stderr, "\n  不指定基准名时全部运行\n");
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    std::vector<std::string> selected;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+        } else if (strcmp(argv[i], "--clipboard") == 0) {
+            options.clipboard = true;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            PrintUsage();
+            return 0;
+        } else {
+            selected.push_back(argv[i]);
+        }
+    }
+
+    for (const std::string& name : selected) {
+        bool known = false;
+        for (const BenchEntry& entry : kBenches) {
+            known = known || name == entry.name;
+        }
+        if (!known) {
+            fprintf(stderr, "未知的基准: %s\n", name.c_str());
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    // 首行记录构建与运行参数, 便于对比不同构建的结果
+    printf("{\"bench\":\"meta\",\"simd\":\"%s\",\"iterations\":%d,\"quick\":%s}\n",
+           qrcore::SimdLevelName(qrcore::ActiveSimdLevel()), options.iterations, options.quick ? "true" : "false");
+
+    for (const BenchEntry& entry : kBenches) {
+        if (selected.empty() || std::find(selected.begin(), selected.end(), entry.name) != selected.end()) {
+            entry.run(options);
+        }
+    }
+    return g_checkFailures == 0 ? 0 : 1;
+}
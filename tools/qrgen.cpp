@@ -0,0 +1,628 @@
+/*
+ * qrgen - 无界面批量生成二维码
+ *
+ * 从 CSV 或 JSON Lines 读取记录 (内容、纠错级别、放大倍数、输出文件名),
+ * 用与托盘程序生成窗口相同的编码 (EncodeQrText) 和写出代码 (WriteQrPng /
+ * BuildQrSvg / BuildQrPdf) 批量生成文件, 用于资产标签等场景。
+ *
+ * 主线程流式读取输入, 记录经有界队列交给固定数量的工作线程; PNG 按行压缩后
+ * 直接写入文件, 不生成整幅位图。因此内存占用只与线程数和队列长度有关,
+ * 与输入记录数和图像尺寸无关。
+ *
+ * CSV: 首行含 text / payload 列名时视为表头 (可选列 ecc, scale, output / name),
+ *      否则按 内容,纠错级别,倍数,输出名 的位置解析; 支持带引号和换行的字段。
+ * JSON Lines: 每行一个对象, 键同上。
+ * 缺省的纠错级别、倍数取命令行的值; 输出名缺省为记录序号 (000001.png),
+ * 扩展名 .png / .svg / .pdf 决定输出格式。
+ *
+ * 用法: qrgen [选项] 输入文件 (- 表示标准输入)
+ */
+
+#include "JsonLines.h"
+#include "core/PngWriter.h"
+#include "core/QrEncode.h"
+#include "core/QrVector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static void PrintUsage() {
+    fprintf(stderr,
+        "用法: qrgen [选项] 输入文件 (- 表示标准输入)\n"
+        "  --format      输入格式 csv 或 jsonl, 默认按扩展名判断 (.jsonl / .json 为 JSON Lines)\n"
+        "  --out         输出目录, 默认当前目录 (不存在时创建)\n"
+        "  --ecc         缺省纠错级别 L/M/Q/H, 默认 M\n"
+        "  --scale       缺省放大倍数 (每模块像素数, 仅 PNG), 默认 10\n"
+        "  --border      静区模块数, 默认 4\n"
+        "  --ext         输出名缺省或没有扩展名时使用的格式 png/svg/pdf, 默认 png\n"
+        "  --png-depth   PNG 位深 1 或 8, 默认 1\n"
+        "  --deflate     PNG 压缩级别 0~9, 默认 9\n"
+        "  --size-mm     SVG / PDF 的边长 (毫米), 默认 50\n"
+        "  --jobs        并行生成的线程数, 默认为硬件线程数\n"
+        "  --json        每条记录输出一行 JSON (序号、输出路径、版本、字节数、耗时)\n");
+}
+
+struct GenRecord {
+    size_t index = 0;    // 记录序号 (从 1 开始)
+    size_t line = 0;     // 在输入中的起始行号, 用于报错
+    std::string text;
+    int ecc = 1;
+    int scale = 10;
+    std::string output;
+    std::string error;   // 解析阶段的错误, 非空时工作线程直接报告
+};
+
+struct GenDefaults {
+    int ecc = 1;
+    int scale = 10;
+    std::string ext = ".png";
+};
+
+// 读取一行 (不含换行符; 兼容 CRLF)。到达文件尾且没有读到内容时返回 false
+static bool ReadLine(FILE* file, std::string& line) {
+    line.clear();
+    int c;
+    bool any = false;
+    while ((c = fgetc(file)) != EOF) {
+        any = true;
+        if (c == '\n') {
+            break;
+        }
+        line += (char)c;
+    }
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    return any;
+}
+
+static void StripUtf8Bom(std::string& line) {
+    if (line.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        line.erase(0, 3);
+    }
+}
+
+/*
+ * 读取一条 CSV 记录 (RFC 4180): 引号内的逗号、换行和 "" 转义都属于字段内容。
+ * lineNo 随读取的物理行数增加。
+ */
+static bool ReadCsvRecord(FILE* file, std::vector<std::string>& fields, size_t& lineNo, std::string& outErrorMsg) {
+    fields.clear();
+    std::string line;
+    if (!ReadLine(file, line)) {
+        return false;
+    }
+    lineNo++;
+    if (lineNo == 1) {
+        StripUtf8Bom(line);
+    }
+
+    std::string field;
+    bool quoted = false;
+    size_t i = 0;
+    for (;;) {
+        if (i == line.size()) {
+            if (!quoted) {
+                fields.push_back(field);
+                return true;
+            }
+            // 引号内换行: 接着读下一物理行
+            if (!ReadLine(file, line)) {
+                outErrorMsg = "引号未闭合";
+                fields.push_back(field);
+                return true;
+            }
+            lineNo++;
+            field += '\n';
+            i = 0;
+            continue;
+        }
+        char c = line[i++];
+        if (quoted) {
+            if (c != '"') {
+                field += c;
+            } else if (i < line.size() && line[i] == '"') {
+                field += '"';
+                i++;
+            } else {
+                quoted = false;
+            }
+        } else if (c == '"' && field.empty()) {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+}
+
+static std::string Lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return text;
+}
+
+static std::string Trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(begin, end - begin + 1);
+}
+
+// 把解析出的字段 (键 -> 值, 键已小写) 填入记录; 空值取缺省
+static void FillRecord(const std::map<std::string, std::string>& fields, const GenDefaults& defaults,
+                       GenRecord& record) {
+    auto get = [&](const char* a, const char* b) -> std::string {
+        auto it = fields.find(a);
+        if (it == fields.end() && b) {
+            it = fields.find(b);
+        }
+        return it == fields.end() ? std::string() : it->second;
+    };
+
+    record.text = get("text", "payload");
+    record.ecc = defaults.ecc;
+    record.scale = defaults.scale;
+    record.output = Trim(get("output", "name"));
+
+    std::string ecc = Trim(get("ecc", nullptr));
+    if (!ecc.empty() && !qrcore::ParseEccLevel(ecc, record.ecc)) {
+        record.error = "纠错级别无效: " + ecc;
+        return;
+    }
+    std::string scale = Trim(get("scale", nullptr));
+    if (!scale.empty()) {
+        char* end = nullptr;
+        long value = strtol(scale.c_str(), &end, 10);
+        if (*end != '\0' || value < 1 || value > 100) {
+            record.error = "放大倍数无效 (1~100): " + scale;
+            return;
+        }
+        record.scale = (int)value;
+    }
+    if (record.text.empty()) {
+        record.error = "内容为空";
+    }
+}
+
+/*
+ * 记录输入: CSV 或 JSON Lines, 每次返回一条记录 (含解析错误的记录也返回,
+ * 由工作线程统一计入错误)。
+ */
+class RecordReader {
+public:
+    RecordReader(FILE* file, bool jsonl, const GenDefaults& defaults)
+        : m_file(file), m_jsonl(jsonl), m_defaults(defaults) {}
+
+    bool Next(GenRecord& record) {
+        record = GenRecord();
+        return m_jsonl ? NextJson(record) : NextCsv(record);
+    }
+
+private:
+    bool NextJson(GenRecord& record) {
+        std::string line;
+        for (;;) {
+            if (!ReadLine(m_file, line)) {
+                return false;
+            }
+            m_lineNo++;
+            if (m_lineNo == 1) {
+                StripUtf8Bom(line);
+            }
+            if (!Trim(line).empty()) {
+                break;
+            }
+        }
+        record.index = ++m_count;
+        record.line = m_lineNo;
+
+        std::map<std::string, std::string> raw, fields;
+        if (!qrtools::ParseFlatJsonObject(line, raw, record.error)) {
+            return true;
+        }
+        for (const auto& kv : raw) {
+            fields[Lower(kv.first)] = kv.second;
+        }
+        FillRecord(fields, m_defaults, record);
+        return true;
+    }
+
+    bool NextCsv(GenRecord& record) {
+        std::vector<std::string> values;
+        std::string error;
+        for (;;) {
+            size_t startLine = m_lineNo + 1;
+            if (!ReadCsvRecord(m_file, values, m_lineNo, error)) {
+                return false;
+            }
+            if (values.size() == 1 && Trim(values[0]).empty() && error.empty()) {
+                continue; // 空行
+            }
+            record.line = startLine;
+            if (startLine == 1 && IsHeader(values)) {
+                for (const std::string& value : values) {
+                    m_columns.push_back(Lower(Trim(value)));
+                }
+                continue;
+            }
+            break;
+        }
+        record.index = ++m_count;
+        if (!error.empty()) {
+            record.error = error;
+            return true;
+        }
+
+        // 没有表头时按位置: 内容, 纠错级别, 倍数, 输出名
+        static const char* kPositional[] = {"text", "ecc", "scale", "output"};
+        std::map<std::string, std::string> fields;
+        for (size_t i = 0; i < values.size(); i++) {
+            if (!m_columns.empty()) {
+                if (i < m_columns.size()) {
+                    fields[m_columns[i]] = values[i];
+                }
+            } else if (i < 4) {
+                fields[kPositional[i]] = values[i];
+            }
+        }
+        FillRecord(fields, m_defaults, record);
+        return true;
+    }
+
+    static bool IsHeader(const std::vector<std::string>& values) {
+        for (const std::string& value : values) {
+            std::string name = Lower(Trim(value));
+            if (name == "text" || name == "payload") {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    FILE* m_file;
+    bool m_jsonl;
+    GenDefaults m_defaults;
+    size_t m_lineNo = 0;
+    size_t m_count = 0;
+    std::vector<std::string> m_columns;
+};
+
+/*
+ * 有界队列: 读取线程在队列满时等待, 使内存中的记录数不超过上限
+ * (输入再大也只保留 capacity 条)。
+ */
+class RecordQueue {
+public:
+    explicit RecordQueue(size_t capacity) : m_capacity(capacity) {}
+
+    void Push(GenRecord&& record) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [&] { return m_queue.size() < m_capacity; });
+        m_queue.push_back(std::move(record));
+        m_peak = std::max(m_peak, m_queue.size());
+        m_notEmpty.notify_one();
+    }
+
+    // 队列已关闭且取空时返回 false
+    bool Pop(GenRecord& record) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [&] { return !m_queue.empty() || m_closed; });
+        if (m_queue.empty()) {
+            return false;
+        }
+        record = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+    }
+
+    size_t Peak() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_peak;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_notFull, m_notEmpty;
+    std::deque<GenRecord> m_queue;
+    size_t m_capacity;
+    size_t m_peak = 0;
+    bool m_closed = false;
+};
+
+struct GenOptions {
+    fs::path outDir;
+    std::string defaultExt = ".png";
+    int border = 4;
+    qrcore::PngOptions png;
+    qrcore::VectorOptions vector;
+};
+
+struct GenOutcome {
+    bool ok = false;
+    std::string path;
+    std::string error;
+    int version = 0;
+    uint64_t bytes = 0;
+    double encodeMs = 0;
+    double writeMs = 0;
+};
+
+// 输出名不能跳出输出目录 (绝对路径或含 ..)
+static bool ResolveOutput(const GenRecord& record, const GenOptions& options, fs::path& outPath,
+                          std::string& outErrorMsg) {
+    fs::path name;
+    if (record.output.empty()) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%06zu", record.index);
+        name = buffer;
+    } else {
+        name = fs::u8path(record.output);
+    }
+    if (name.is_absolute() || name.has_root_name()) {
+        outErrorMsg = "输出名不能是绝对路径: " + record.output;
+        return false;
+    }
+    for (const fs::path& part : name) {
+        if (part == "..") {
+            outErrorMsg = "输出名不能包含 ..: " + record.output;
+            return false;
+        }
+    }
+    if (!name.has_extension()) {
+        name += options.defaultExt;
+    }
+    outPath = options.outDir / name;
+    return true;
+}
+
+static bool WriteFileBytes(const fs::path& path, const std::string& data, std::string& outErrorMsg) {
+    FILE* file = fopen(path.string().c_str(), "wb");
+    if (!file) {
+        outErrorMsg = "无法创建文件: " + path.string();
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    if (fclose(file) != 0 || !ok) {
+        outErrorMsg = "写入文件失败: " + path.string();
+        return false;
+    }
+    return true;
+}
+
+static GenOutcome Generate(const GenRecord& record, const GenOptions& options) {
+    GenOutcome outcome;
+    if (!record.error.empty()) {
+        outcome.error = record.error;
+        return outcome;
+    }
+    fs::path path;
+    if (!ResolveOutput(record, options, path, outcome.error)) {
+        return outcome;
+    }
+    outcome.path = path.string();
+
+    std::string ext = Lower(path.extension().string());
+    if (ext != ".png" && ext != ".svg" && ext != ".pdf") {
+        outcome.error = "不支持的输出格式: " + ext;
+        return outcome;
+    }
+
+    auto start = Clock::now();
+    qrcore::ModuleMatrix matrix;
+    try {
+        matrix = qrcore::EncodeQrText(record.text, record.ecc);
+    } catch (const std::exception& e) {
+        outcome.error = std::string("编码失败: ") + e.what();
+        return outcome;
+    }
+    auto encoded = Clock::now();
+    outcome.encodeMs = std::chrono::duration<double, std::milli>(encoded - start).count();
+    outcome.version = (matrix.size - 17) / 4;
+
+    std::error_code ec;
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+    }
+
+    if (ext == ".png") {
+        outcome.ok = qrcore::SaveQrPngFile(outcome.path, matrix, record.scale, options.border, options.png,
+                                           outcome.error);
+    } else {
+        qrcore::VectorOptions vector = options.vector;
+        vector.border = options.border;
+        std::string data;
+        outcome.ok = (ext == ".svg" ? qrcore::BuildQrSvg(matrix, vector, data, outcome.error)
+                                    : qrcore::BuildQrPdf(matrix, vector, data, outcome.error)) &&
+                     WriteFileBytes(path, data, outcome.error);
+    }
+    outcome.writeMs = std::chrono::duration<double, std::milli>(Clock::now() - encoded).count();
+    if (outcome.ok) {
+        outcome.bytes = (uint64_t)fs::file_size(path, ec);
+    }
+    return outcome;
+}
+
+static std::string OutcomeJson(const GenRecord& record, const GenOutcome& outcome) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "{\"index\":%zu,\"line\":%zu", record.index, record.line);
+    std::string line = buffer;
+    if (!outcome.path.empty()) {
+        line += ",\"path\":" + qrtools::JsonQuote(outcome.path);
+    }
+    if (!outcome.ok) {
+        line += ",\"status\":\"error\",\"error\":" + qrtools::JsonQuote(outcome.error) + "}";
+        return line;
+    }
+    snprintf(buffer, sizeof(buffer),
+             ",\"status\":\"ok\",\"version\":%d,\"ecc\":\"%c\",\"scale\":%d,\"bytes\":%llu,"
+             "\"encode_ms\":%.3f,\"write_ms\":%.3f}",
+             outcome.version, "LMQH"[record.ecc & 3], record.scale, (unsigned long long)outcome.bytes,
+             outcome.encodeMs, outcome.writeMs);
+    line += buffer;
+    return line;
+}
+
+static std::string OutcomeText(const GenRecord& record, const GenOutcome& outcome) {
+    char buffer[128];
+    if (!outcome.ok) {
+        snprintf(buffer, sizeof(buffer), "#%zu (第 %zu 行)\tERROR\t", record.index, record.line);
+        return buffer + outcome.error;
+    }
+    snprintf(buffer, sizeof(buffer), "\tOK\tv%d-%c\t%llu 字节\t%.2fms", outcome.version, "LMQH"[record.ecc & 3],
+             (unsigned long long)outcome.bytes, outcome.encodeMs + outcome.writeMs);
+    return outcome.path + buffer;
+}
+
+int main(int argc, char** argv) {
+    std::string format;
+    std::string input;
+    GenDefaults defaults;
+    GenOptions options;
+    options.outDir = ".";
+    int jobs = (int)std::thread::hardware_concurrency();
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = Lower(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            options.outDir = fs::u8path(argv[++i]);
+        } else if (strcmp(argv[i], "--ecc") == 0 && i + 1 < argc) {
+            if (!qrcore::ParseEccLevel(argv[++i], defaults.ecc)) {
+                fprintf(stderr, "纠错级别无效: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            defaults.scale = std::max(1, std::min(100, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--border") == 0 && i + 1 < argc) {
+            options.border = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--ext") == 0 && i + 1 < argc) {
+            options.defaultExt = "." + Lower(argv[++i]);
+        } else if (strcmp(argv[i], "--png-depth") == 0 && i + 1 < argc) {
+            options.png.bitDepth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--deflate") == 0 && i + 1 < argc) {
+            options.png.deflateLevel = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size-mm") == 0 && i + 1 < argc) {
+            options.vector.sizeMm = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            PrintUsage();
+            return 0;
+        } else if (input.empty()) {
+            input = argv[i];
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (input.empty()) {
+        PrintUsage();
+        return 2;
+    }
+    if (format.empty()) {
+        std::string ext = Lower(fs::path(input).extension().string());
+        format = (ext == ".jsonl" || ext == ".json" || ext == ".ndjson") ? "jsonl" : "csv";
+    }
+    if (format != "csv" && format != "jsonl") {
+        fprintf(stderr, "输入格式无效: %s\n", format.c_str());
+        return 2;
+    }
+
+    std::error_code ec;
+    fs::create_directories(options.outDir, ec);
+    if (!fs::is_directory(options.outDir, ec)) {
+        fprintf(stderr, "无法创建输出目录: %s\n", options.outDir.string().c_str());
+        return 1;
+    }
+
+    FILE* file = input == "-" ? stdin : fopen(input.c_str(), "rb");
+    if (!file) {
+        fprintf(stderr, "无法打开输入文件: %s\n", input.c_str());
+        return 1;
+    }
+    jobs = std::max(1, jobs);
+
+    // 队列长度为线程数的 8 倍: 足以吸收单条记录耗时的波动, 又不会囤积大量记录
+    RecordQueue queue((size_t)jobs * 8);
+    std::atomic<size_t> generated{0}, errors{0};
+    std::atomic<uint64_t> totalBytes{0};
+    std::mutex outputMutex;
+    auto start = Clock::now();
+
+    auto worker = [&]() {
+        GenRecord record;
+        while (queue.Pop(record)) {
+            GenOutcome outcome = Generate(record, options);
+            if (outcome.ok) {
+                generated++;
+                totalBytes += outcome.bytes;
+            } else {
+                errors++;
+            }
+
+            std::string line = json ? OutcomeJson(record, outcome) : OutcomeText(record, outcome);
+            std::lock_guard<std::mutex> lock(outputMutex);
+            FILE* out = (outcome.ok || json) ? stdout : stderr;
+            fputs(line.c_str(), out);
+            fputc('\n', out);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < jobs; i++) {
+        threads.emplace_back(worker);
+    }
+
+    RecordReader reader(file, format == "jsonl", defaults);
+    GenRecord record;
+    size_t total = 0;
+    while (reader.Next(record)) {
+        queue.Push(std::move(record));
+        total++;
+    }
+    queue.Close();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    if (file != stdin) {
+        fclose(file);
+    }
+    fflush(stdout);
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    fprintf(stderr, "%zu 条记录: 生成 %zu, 错误 %zu; 用时 %.2f 秒, %.1f 个/秒, 共 %.1f MB (%d 线程, 队列峰值 %zu)\n",
+            total, generated.load(), errors.load(), seconds, seconds > 0 ? generated / seconds : 0.0,
+            totalBytes / (1024.0 * 1024.0), jobs, queue.Peak());
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,292 @@
+/*
+ * qrscan - 无界面二维码识别工具
+ *
+ * 用与托盘程序相同的分级识别 (DecodeCascade) 批量识别图像文件,
+ * 输出每个文件成功的层级和耗时, 用于在 Linux 上调优层级顺序,
+ * 也用于批量识别截图、扫描件存档。
+ *
+ * 目录会被递归遍历 (只取常见图像扩展名); 文件由固定数量的工作线程并行识别,
+ * 同时在内存中的图像总量受 --max-memory 限制: 超出时工作线程在读取像素前等待。
+ *
+ * 用法: qrscan [选项] 文件或目录...
+ */
+
+#include "JsonLines.h"
+#include "core/DecodeCascade.h"
+#include "core/ImageIO.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static void PrintUsage() {
+    fprintf(stderr,
+        "用法: qrscan [选项] 文件或目录...\n"
+        "  --cascade     逗号分隔的识别层级, 默认 fast,harder,contrast,brightness\n"
+        "                可选: fast, harder, invert, contrast, brightness\n"
+        "  --budget      每张图的时间预算 (毫秒), 0 表示不限, 默认 1500\n"
+        "  --single      只取第一个码 (默认识别图中全部码)\n"
+        "  --pyramid     单码模式下大图先尝试的缩小级数, 0 表示不使用, 默认 2\n"
+        "  --jobs        并行识别的线程数, 默认为硬件线程数\n"
+        "  --max-memory  同时在内存中的图像总量上限 (MB), 默认 512\n"
+        "  --json        每个文件输出一行 JSON (路径、内容、码制、位置、耗时)\n");
+}
+
+// 递归遍历时识别的扩展名
+static bool IsImageFile(const fs::path& path) {
+    static const char* kExtensions[] = {".png", ".jpg", ".jpeg", ".bmp", ".gif", ".tga", ".pgm", ".ppm", ".pnm"};
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    for (const char* known : kExtensions) {
+        if (ext == known) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 展开参数中的目录; 命令行直接给出的文件不检查扩展名
+static void CollectInputs(const std::vector<std::string>& args, std::vector<std::string>& outPaths) {
+    for (const std::string& arg : args) {
+        std::error_code ec;
+        if (!fs::is_directory(arg, ec)) {
+            outPaths.push_back(arg);
+            continue;
+        }
+
+        std::vector<std::string> found;
+        fs::recursive_directory_iterator it(arg, fs::directory_options::skip_permission_denied, ec);
+        for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_regular_file(ec) && IsImageFile(it->path())) {
+                found.push_back(it->path().string());
+            }
+        }
+        // 目录内按路径排序, 使输出顺序与文件系统无关 (并行时仍按完成顺序输出)
+        std::sort(found.begin(), found.end());
+        outPaths.insert(outPaths.end(), found.begin(), found.end());
+    }
+}
+
+/*
+ * 内存预算: 工作线程读取像素前按估算大小申请, 识别完成后归还。
+ * 单张图超过上限时, 只在没有其他图像占用内存时放行, 避免死锁。
+ */
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t limitBytes) : m_limit(limitBytes) {}
+
+    void Acquire(size_t bytes) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&] { return m_used == 0 || m_used + bytes <= m_limit; });
+        m_used += bytes;
+        m_peak = std::max(m_peak, m_used);
+    }
+
+    void Release(size_t bytes) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_used -= bytes;
+        }
+        m_cv.notify_all();
+    }
+
+    size_t Peak() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_peak;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    size_t m_limit;
+    size_t m_used = 0;
+    size_t m_peak = 0;
+};
+
+// 估算识别一张图时的峰值内存: 解码后的帧 + 解码器的临时缓冲 + 灰度副本
+static size_t EstimateScanBytes(int width, int height, int bytesPerPixel) {
+    size_t pixels = (size_t)width * height;
+    return pixels * bytesPerPixel * 2 + pixels;
+}
+
+static std::string PositionJson(const qrcore::SymbolPosition& p) {
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "[[%d,%d],[%d,%d],[%d,%d],[%d,%d]]",
+             p.topLeft.x, p.topLeft.y, p.topRight.x, p.topRight.y,
+             p.bottomRight.x, p.bottomRight.y, p.bottomLeft.x, p.bottomLeft.y);
+    return buffer;
+}
+
+static std::string ResultJson(const std::string& path, bool loaded, const qrcore::ScanResult& result,
+                              const std::string& errorMsg, double loadMs) {
+    std::string line = "{\"path\":" + qrtools::JsonQuote(path);
+    char buffer[256];
+    if (!loaded) {
+        line += ",\"status\":\"error\",\"error\":" + qrtools::JsonQuote(errorMsg) + "}";
+        return line;
+    }
+
+    line += result.success ? ",\"status\":\"ok\"" : ",\"status\":\"fail\"";
+    line += ",\"symbols\":[";
+    for (size_t i = 0; i < result.symbols.size(); i++) {
+        const qrcore::DecodedSymbol& symbol = result.symbols[i];
+        line += i ? ",{" : "{";
+        line += "\"text\":" + qrtools::JsonQuote(symbol.text);
+        line += ",\"format\":" + qrtools::JsonQuote(symbol.format);
+        line += ",\"position\":" + PositionJson(symbol.position) + "}";
+    }
+    line += "]";
+    snprintf(buffer, sizeof(buffer),
+             ",\"tier\":%s,\"tiers_tried\":%d,\"budget_exceeded\":%s,"
+             "\"load_ms\":%.3f,\"decode_ms\":%.3f,\"total_ms\":%.3f}",
+             qrtools::JsonQuote(result.tier).c_str(), result.tiersTried,
+             result.budgetExceeded ? "true" : "false", loadMs, result.decodeMs, result.totalMs);
+    line += buffer;
+    return line;
+}
+
+static std::string ResultText(const std::string& path, bool loaded, const qrcore::ScanResult& result,
+                              const std::string& errorMsg, int tierCount) {
+    char buffer[128];
+    if (!loaded) {
+        return path + "\tERROR\t-\t-\t" + errorMsg;
+    }
+    if (result.success) {
+        snprintf(buffer, sizeof(buffer), "\tOK[%d]\t%s(%d/%d)\t%.2fms\t", (int)result.symbols.size(),
+                 result.tier.c_str(), result.tierIndex + 1, tierCount, result.totalMs);
+        return path + buffer + qrcore::JoinSymbolTexts(result, " | ");
+    }
+    snprintf(buffer, sizeof(buffer), "\tFAIL\t-(%d/%d)%s\t%.2fms\t-", result.tiersTried, tierCount,
+             result.budgetExceeded ? " budget" : "", result.totalMs);
+    return path + buffer;
+}
+
+int main(int argc, char** argv) {
+    std::string cascadeSpec = qrcore::CascadeToString(qrcore::DefaultCascade());
+    int budgetMs = qrcore::DefaultCascade().budgetMs;
+    bool single = false;
+    int pyramidLevels = qrcore::PyramidConfig().maxLevels;
+    int jobs = (int)std::thread::hardware_concurrency();
+    size_t maxMemoryMB = 512;
+    bool json = false;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cascade") == 0 && i + 1 < argc) {
+            cascadeSpec = argv[++i];
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budgetMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--single") == 0) {
+            single = true;
+        } else if (strcmp(argv[i], "--pyramid") == 0 && i + 1 < argc) {
+            pyramidLevels = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-memory") == 0 && i + 1 < argc) {
+            maxMemoryMB = (size_t)std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            PrintUsage();
+            return 0;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.empty()) {
+        PrintUsage();
+        return 2;
+    }
+
+    qrcore::CascadeConfig cascade;
+    std::string errorMsg;
+    if (!qrcore::ParseCascade(cascadeSpec, budgetMs, cascade, errorMsg)) {
+        fprintf(stderr, "%s\n", errorMsg.c_str());
+        return 2;
+    }
+    cascade.maxSymbols = single ? 1 : 0;
+    cascade.pyramid.maxLevels = pyramidLevels;
+
+    std::vector<std::string> paths;
+    CollectInputs(args, paths);
+    if (paths.empty()) {
+        fprintf(stderr, "没有找到图像文件\n");
+        return 1;
+    }
+    jobs = std::max(1, std::min(jobs, (int)paths.size()));
+
+    MemoryBudget memory(maxMemoryMB * 1024 * 1024);
+    std::atomic<size_t> next{0};
+    std::atomic<int> succeeded{0}, failed{0}, errors{0};
+    std::mutex outputMutex;
+    auto start = Clock::now();
+
+    auto worker = [&]() {
+        for (size_t index = next++; index < paths.size(); index = next++) {
+            const std::string& path = paths[index];
+            std::string error;
+            qrcore::ScanResult result;
+            double loadMs = 0;
+            bool loaded = false;
+
+            int width = 0, height = 0, bytesPerPixel = 0;
+            if (qrcore::ReadImageInfo(path, width, height, bytesPerPixel, error)) {
+                size_t bytes = EstimateScanBytes(width, height, bytesPerPixel);
+                memory.Acquire(bytes);
+                {
+                    auto loadStart = Clock::now();
+                    qrcore::ImageFrame frame;
+                    loaded = qrcore::LoadImageFile(path, frame, error);
+                    loadMs = std::chrono::duration<double, std::milli>(Clock::now() - loadStart).count();
+                    if (loaded) {
+                        qrcore::RunCascade(frame, cascade, result);
+                    }
+                }
+                memory.Release(bytes);
+            }
+
+            if (!loaded) {
+                errors++;
+            } else if (result.success) {
+                succeeded++;
+            } else {
+                failed++;
+            }
+
+            std::string line = json ? ResultJson(path, loaded, result, error, loadMs)
+                                    : ResultText(path, loaded, result, error, (int)cascade.tiers.size());
+            std::lock_guard<std::mutex> lock(outputMutex);
+            fputs(line.c_str(), stdout);
+            fputc('\n', stdout);
+            fflush(stdout);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < jobs; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    fprintf(stderr, "%zu 张图像: 成功 %d, 未识别 %d, 错误 %d; 用时 %.2f 秒, %.1f 张/秒 (%d 线程, 内存峰值 %.1f MB)\n",
+            paths.size(), succeeded.load(), failed.load(), errors.load(), seconds,
+            seconds > 0 ? paths.size() / seconds : 0.0, jobs, memory.Peak() / (1024.0 * 1024.0));
+    return (failed == 0 && errors == 0) ? 0 : 1;
+}
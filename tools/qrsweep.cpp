@@ -0,0 +1,272 @@
+/*
+ * qrsweep - 识别参数的成功率 / 耗时扫描
+ *
+ * 用 qrcodegen 生成二维码, 施加可控的失真 (模糊、JPEG 压缩、非整数缩放、噪声、
+ * 低对比度、反色、旋转、静区被裁), 再对每种 ZXing 识别参数组合
+ * (tryHarder / tryRotate / tryInvert / tryDownscale) 以及若干识别级联
+ * 测量成功率和耗时, 输出帕累托表, 用实测数据选择默认参数。
+ *
+ * 每个 (参数, 失真) 组合输出一行 JSON 到标准输出, 每个参数组合再输出一行汇总;
+ * 帕累托表输出到标准错误。
+ *
+ * 用法: qrsweep [--repeat N] [--quick]
+ */
+
+#include "BenchStats.h"
+#include "Distortions.h"
+#include "SyntheticCorpus.h"
+#include "core/DecodeCascade.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using qrtools::Clock;
+using qrtools::ElapsedMs;
+
+static const int kModuleSize = 4;  // 失真前的模块像素数
+static const int kQuietModules = 4; // RenderSample 绘制的静区宽度
+
+struct Distortion {
+    std::string name;  // 如 "blur:2.0"
+    std::string group; // 汇总表中的列, 如 "blur"
+    std::function<qrcore::ImageFrame(const qrcore::ImageFrame&, uint32_t seed)> apply;
+};
+
+static std::vector<Distortion> MakeDistortions() {
+    using qrcore::ImageFrame;
+    std::vector<Distortion> list;
+    list.push_back({"none", "none", [](const ImageFrame& f, uint32_t) { return f; }});
+    for (double sigma : {1.0, 2.0}) {
+        list.push_back({"blur:" + std::to_string(sigma).substr(0, 3), "blur",
+                        [sigma](const ImageFrame& f, uint32_t) { return qrtools::GaussianBlur(f, sigma); }});
+    }
+    for (int quality : {30, 10}) {
+        list.push_back({"jpeg:q" + std::to_string(quality), "jpeg",
+                        [quality](const ImageFrame& f, uint32_t) { return qrtools::JpegArtifacts(f, quality); }});
+    }
+    for (double factor : {0.6, 0.77, 1.37}) {
+        list.push_back({"scale:" + std::to_string(factor).substr(0, 4), "scale",
+                        [factor](const ImageFrame& f, uint32_t) { return qrtools::Resample(f, factor); }});
+    }
+    for (double sigma : {25.0, 50.0}) {
+        list.push_back({"noise:" + std::to_string((int)sigma), "noise",
+                        [sigma](const ImageFrame& f, uint32_t seed) { return qrtools::AddNoise(f, sigma, seed); }});
+    }
+    list.push_back({"contrast:110-150", "contrast",
+                    [](const ImageFrame& f, uint32_t) { return qrtools::ReduceContrast(f, 110, 150); }});
+    list.push_back({"contrast:120-136", "contrast",
+                    [](const ImageFrame& f, uint32_t) { return qrtools::ReduceContrast(f, 120, 136); }});
+    list.push_back({"invert", "invert", [](const ImageFrame& f, uint32_t) { return qrtools::Invert(f); }});
+    for (double degrees : {10.0, 30.0, 45.0}) {
+        list.push_back({"rotate:" + std::to_string((int)degrees), "rotate",
+                        [degrees](const ImageFrame& f, uint32_t) { return qrtools::Rotate(f, degrees); }});
+    }
+    for (int keep : {1, 0}) {
+        list.push_back({"quiet:" + std::to_string(keep), "quiet", [keep](const ImageFrame& f, uint32_t) {
+                            return qrtools::ClipQuietZone(f, kModuleSize, kQuietModules, keep);
+                        }});
+    }
+    return list;
+}
+
+// 一组待比较的识别参数: 单次 ZXing 识别, 或一个识别级联
+struct Candidate {
+    std::string name;
+    bool useCascade = false;
+    qrcore::ScanOptions options;
+    qrcore::CascadeConfig cascade;
+};
+
+static std::vector<Candidate> MakeCandidates() {
+    std::vector<Candidate> list;
+    for (int bits = 0; bits < 16; bits++) {
+        Candidate c;
+        c.options.tryHarder = (bits & 1) != 0;
+        c.options.tryRotate = (bits & 2) != 0;
+        c.options.tryInvert = (bits & 4) != 0;
+        c.options.tryDownscale = (bits & 8) != 0;
+        c.options.maxSymbols = 1;
+        const char* names[] = {"harder", "rotate", "invert", "downscale"};
+        for (int i = 0; i < 4; i++) {
+            if (bits & (1 << i)) {
+                c.name += c.name.empty() ? names[i] : std::string("+") + names[i];
+            }
+        }
+        if (c.name.empty()) {
+            c.name = "plain";
+        }
+        list.push_back(c);
+    }
+
+    for (const char* spec : {"fast,harder,contrast,brightness", "fast,harder,invert", "fast,invert,contrast"}) {
+        Candidate c;
+        std::string errorMsg;
+        qrcore::ParseCascade(spec, 0, c.cascade, errorMsg);
+        c.cascade.maxSymbols = 1;
+        c.useCascade = true;
+        c.name = std::string("cascade:") + spec;
+        list.push_back(c);
+    }
+    return list;
+}
+
+struct Cell {
+    int attempts = 0;
+    int successes = 0;
+    std::vector<double> samples;
+};
+
+int main(int argc, char** argv) {
+    int repeat = 3;
+    bool quick = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else {
+            fprintf(stderr,
+                "用法: qrsweep [--repeat N] [--quick]\n"
+                "  --repeat  每张图每组参数重复识别的次数 (取中位数耗时), 默认 3\n"
+                "  --quick   减少二维码版本和纠错级别\n");
+            return strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0 ? 0 : 2;
+        }
+    }
+
+    // 语料: 不同版本和纠错级别的二维码, 模块 4 像素, 4 模块静区
+    std::vector<int> versions = quick ? std::vector<int>{2, 10} : std::vector<int>{1, 3, 6, 10, 15, 25};
+    std::vector<qrcodegen::QrCode::Ecc> eccs = quick
+        ? std::vector<qrcodegen::QrCode::Ecc>{qrcodegen::QrCode::Ecc::MEDIUM}
+        : std::vector<qrcodegen::QrCode::Ecc>{qrcodegen::QrCode::Ecc::LOW, qrcodegen::QrCode::Ecc::MEDIUM,
+                                              qrcodegen::QrCode::Ecc::HIGH};
+    std::vector<qrtools::SyntheticCode> codes;
+    for (int version : versions) {
+        for (auto ecc : eccs) {
+            qrtools::SyntheticCode code;
+            if (qrtools::EncodeForVersion(version, ecc, (uint32_t)(version * 31 + (int)ecc + 1), code)) {
+                codes.push_back(code);
+            }
+        }
+    }
+
+    std::vector<Distortion> distortions = MakeDistortions();
+    std::vector<Candidate> candidates = MakeCandidates();
+    // cells[candidate][distortion]
+    std::vector<std::vector<Cell>> cells(candidates.size(), std::vector<Cell>(distortions.size()));
+
+    fprintf(stderr, "[qrsweep] %zu 个二维码 x %zu 种失真 x %zu 组参数, 每次重复 %d 次\n",
+            codes.size(), distortions.size(), candidates.size(), repeat);
+
+    for (size_t d = 0; d < distortions.size(); d++) {
+        for (size_t k = 0; k < codes.size(); k++) {
+            const qrtools::SyntheticCode& code = codes[k];
+            qrcore::ImageFrame image = distortions[d].apply(qrtools::RenderSample(code, kModuleSize),
+                                                           (uint32_t)(k * 977 + d + 1));
+
+            for (size_t c = 0; c < candidates.size(); c++) {
+                const Candidate& candidate = candidates[c];
+                std::vector<double> times;
+                bool success = false;
+                for (int r = 0; r < repeat; r++) {
+                    qrcore::ScanResult result;
+                    auto start = Clock::now();
+                    bool ok = candidate.useCascade ? qrcore::RunCascade(image, candidate.cascade, result)
+                                                   : qrcore::DecodeFrame(image, candidate.options, result);
+                    times.push_back(ElapsedMs(start));
+                    success = ok && result.text == code.text;
+                }
+                std::sort(times.begin(), times.end());
+                Cell& cell = cells[c][d];
+                cell.attempts++;
+                cell.successes += success ? 1 : 0;
+                cell.samples.push_back(times[times.size() / 2]);
+            }
+        }
+    }
+
+    // 每组参数的汇总与帕累托前沿: 没有其他参数组合在成功率不低、平均耗时不高且至少一项更优
+    struct Summary {
+        double successRate = 0;
+        qrtools::LatencyStats stats;
+        bool pareto = true;
+    };
+    std::vector<Summary> summaries(candidates.size());
+    for (size_t c = 0; c < candidates.size(); c++) {
+        int attempts = 0, successes = 0;
+        std::vector<double> all;
+        for (size_t d = 0; d < distortions.size(); d++) {
+            const Cell& cell = cells[c][d];
+            attempts += cell.attempts;
+            successes += cell.successes;
+            all.insert(all.end(), cell.samples.begin(), cell.samples.end());
+
+            qrtools::LatencyStats stats = qrtools::Summarize(cell.samples);
+            printf("{\"candidate\":\"%s\",\"distortion\":\"%s\",\"n\":%d,\"success_rate\":%.4f,"
+                   "\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p95_ms\":%.4f}\n",
+                   candidates[c].name.c_str(), distortions[d].name.c_str(), cell.attempts,
+                   cell.attempts ? (double)cell.successes / cell.attempts : 0.0, stats.mean, stats.p50, stats.p95);
+        }
+        summaries[c].successRate = attempts ? (double)successes / attempts : 0.0;
+        summaries[c].stats = qrtools::Summarize(all);
+    }
+    for (size_t a = 0; a < candidates.size(); a++) {
+        for (size_t b = 0; b < candidates.size(); b++) {
+            const Summary& sa = summaries[a];
+            const Summary& sb = summaries[b];
+            if (a != b && sb.successRate >= sa.successRate && sb.stats.mean <= sa.stats.mean &&
+                (sb.successRate > sa.successRate || sb.stats.mean < sa.stats.mean)) {
+                summaries[a].pareto = false;
+                break;
+            }
+        }
+    }
+    for (size_t c = 0; c < candidates.size(); c++) {
+        printf("{\"candidate\":\"%s\",\"distortion\":\"all\",\"success_rate\":%.4f,\"mean_ms\":%.4f,"
+               "\"p50_ms\":%.4f,\"p95_ms\":%.4f,\"pareto\":%s}\n",
+               candidates[c].name.c_str(), summaries[c].successRate, summaries[c].stats.mean,
+               summaries[c].stats.p50, summaries[c].stats.p95, summaries[c].pareto ? "true" : "false");
+    }
+
+    // 帕累托表: 按平均耗时排序, 每类失真一列成功率
+    std::vector<std::string> groups;
+    for (const Distortion& d : distortions) {
+        if (std::find(groups.begin(), groups.end(), d.group) == groups.end()) {
+            groups.push_back(d.group);
+        }
+    }
+    std::vector<size_t> order(candidates.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) { return summaries[a].stats.mean < summaries[b].stats.mean; });
+
+    fprintf(stderr, "\n%-42s %1s %6s %8s %8s", "参数", "P", "成功率", "mean", "p95");
+    for (const std::string& g : groups) {
+        fprintf(stderr, " %8s", g.c_str());
+    }
+    fprintf(stderr, "\n");
+    for (size_t c : order) {
+        fprintf(stderr, "%-42s %1s %5.1f%% %8.2f %8.2f", candidates[c].name.c_str(),
+                summaries[c].pareto ? "*" : "", summaries[c].successRate * 100,
+                summaries[c].stats.mean, summaries[c].stats.p95);
+        for (const std::string& g : groups) {
+            int attempts = 0, successes = 0;
+            for (size_t d = 0; d < distortions.size(); d++) {
+                if (distortions[d].group == g) {
+                    attempts += cells[c][d].attempts;
+                    successes += cells[c][d].successes;
+                }
+            }
+            fprintf(stderr, " %7.0f%%", attempts ? 100.0 * successes / attempts : 0.0);
+        }
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, "\n* = 帕累托最优 (成功率与平均耗时无法同时被其他参数超越); 耗时单位毫秒\n");
+    return 0;
+}